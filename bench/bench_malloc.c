@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+// Malloc/free hot path: run natively and under liboswatch_malloc.so to get
+// the per-call cost of interception.
+//
+// Usage: bench_malloc <threads> <ops_per_thread> <label>
+
+static long ops_per_thread;
+
+static void* worker(void *arg) {
+    (void)arg;
+    static const size_t sizes[] = { 16, 48, 128, 512, 2048 };
+
+    for (long i = 0; i < ops_per_thread; i++) {
+        void *p = malloc(sizes[i % 5]);
+        if (!p) break;
+        *(volatile char *)p = 1;
+        free(p);
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <threads> <ops_per_thread> <label>\n", argv[0]);
+        return 1;
+    }
+
+    int threads = atoi(argv[1]);
+    ops_per_thread = atol(argv[2]);
+    const char *label = argv[3];
+    if (threads < 1 || threads > 256) threads = 1;
+
+    pthread_t tids[256];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&tids[t], NULL, worker, NULL);
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    double ops = (double)ops_per_thread * threads;
+
+    // One op is a malloc + free pair
+    printf("{\"bench\":\"malloc_free\",\"mode\":\"%s\",\"threads\":%d,\"ops\":%.0f,"
+           "\"metric\":\"ns_per_op\",\"value\":%.1f}\n",
+           label, threads, ops, ns / ops);
+    return 0;
+}
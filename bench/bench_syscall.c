@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+// Cheapest possible syscall in a loop: run natively and under oswatch to
+// get the ptrace cost per traced syscall.
+//
+// Usage: bench_syscall <iterations> <label>
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <iterations> <label>\n", argv[0]);
+        return 1;
+    }
+
+    long iterations = atol(argv[1]);
+    const char *label = argv[2];
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < iterations; i++) {
+        syscall(SYS_getppid);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+
+    printf("{\"bench\":\"syscall\",\"mode\":\"%s\",\"ops\":%ld,"
+           "\"metric\":\"ns_per_syscall\",\"value\":%.1f}\n",
+           label, iterations, ns / iterations);
+    return 0;
+}
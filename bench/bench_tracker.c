@@ -0,0 +1,154 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <stdint.h>
+
+// Tracker hot paths, driven in-process through the real pipe and parser:
+//   - ingest: events/sec through process_malloc_events
+//   - table:  insert and free+insert throughput at 1K..max live blocks
+//
+// Usage: bench_tracker <max_live> [shards]
+
+#define CHURN_OPS 20000
+#define HEAP_BASE 0x100000000UL
+
+static ProcessStats stats;
+static int write_fd;
+static char pending[60000];
+static size_t pending_len;
+static double ingest_ms;
+static int shards;
+
+// Hand the batched lines to oswatch; only this part is timed
+static void flush_events(void) {
+    struct timespec start, end;
+
+    if (write(write_fd, pending, pending_len) != (ssize_t)pending_len) {
+        perror("write");
+        exit(1);
+    }
+    pending_len = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    process_malloc_events(&stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ingest_ms += calculate_time_diff(&start, &end);
+}
+
+// Wait for the shard workers; their time counts as ingest too
+static void sync_tracker(void) {
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tracker_sync(&stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ingest_ms += calculate_time_diff(&start, &end);
+}
+
+static void emit_alloc(uintptr_t addr, size_t size) {
+    if (pending_len > sizeof(pending) - 128) flush_events();
+    pending_len += sprintf(pending + pending_len, "ALLOC %p %zu %p\n",
+                           (void*)addr, size, (void*)0x401000);
+}
+
+static void emit_free(uintptr_t addr) {
+    if (pending_len > sizeof(pending) - 128) flush_events();
+    pending_len += sprintf(pending + pending_len, "FREE %p\n", (void*)addr);
+}
+
+static void reset_stats(void) {
+    int read_fd = stats.notify_pipe[0];
+    cleanup_process_stats(&stats);
+    init_process_stats(&stats, 0, "bench");
+    stats.notify_pipe[0] = read_fd;
+    stats.requested_shards = shards;
+    ingest_ms = 0;
+}
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static void bench_ingest(size_t events) {
+    reset_stats();
+
+    // Short-lived blocks: measures parsing and dispatch, not chain length
+    for (size_t i = 0; i < events / 2; i++) {
+        uintptr_t addr = HEAP_BASE + (i % 64) * 32;
+        emit_alloc(addr, 24);
+        emit_free(addr);
+    }
+    flush_events();
+    sync_tracker();
+
+    printf("{\"bench\":\"ingest\",\"events\":%zu,\"shards\":%d,\"metric\":\"events_per_sec\",\"value\":%.0f}\n",
+           events, stats.shard_count, events / (ingest_ms / 1000.0));
+}
+
+static void bench_table(size_t live) {
+    uintptr_t *slots = malloc(live * sizeof(uintptr_t));
+    if (!slots) {
+        fprintf(stderr, "bench_tracker: cannot track %zu live blocks\n", live);
+        return;
+    }
+
+    reset_stats();
+
+    // Insert: grow the table to `live` blocks
+    for (size_t i = 0; i < live; i++) {
+        slots[i] = HEAP_BASE + i * 32;
+        emit_alloc(slots[i], 24);
+    }
+    flush_events();
+    sync_tracker();
+    double insert_ms = ingest_ms;
+
+    // Churn: free a random live block, allocate a new one in its place
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+    uintptr_t next_addr = HEAP_BASE + live * 32;
+    ingest_ms = 0;
+    for (size_t i = 0; i < CHURN_OPS; i++) {
+        size_t victim = next_random(&rng) % live;
+        emit_free(slots[victim]);
+        slots[victim] = next_addr;
+        emit_alloc(next_addr, 24);
+        next_addr += 32;
+    }
+    flush_events();
+    sync_tracker();
+    double churn_ms = ingest_ms;
+
+    printf("{\"bench\":\"table\",\"live\":%zu,\"shards\":%d,\"metric\":\"inserts_per_sec\",\"value\":%.0f}\n",
+           live, stats.shard_count, live / (insert_ms / 1000.0));
+    printf("{\"bench\":\"table\",\"live\":%zu,\"shards\":%d,\"metric\":\"churn_ops_per_sec\",\"value\":%.0f}\n",
+           live, stats.shard_count, CHURN_OPS / (churn_ms / 1000.0));
+
+    free(slots);
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_live = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+    shards = argc > 2 ? atoi(argv[2]) : 0;
+    int fds[2];
+
+    if (pipe(fds) == -1) {
+        perror("pipe");
+        return 1;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    write_fd = fds[1];
+
+    init_process_stats(&stats, 0, "bench");
+    stats.notify_pipe[0] = fds[0];
+    stats.requested_shards = shards;
+
+    bench_ingest(1000000);
+    for (size_t live = 1000; live <= max_live; live *= 10) {
+        bench_table(live);
+    }
+
+    cleanup_process_stats(&stats);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Run the oswatch microbenchmarks and write one JSON object per line.
+#
+# Usage: bench/run_bench.sh [output_file]
+#
+# Tunables (environment):
+#   BENCH_OPS       malloc/free pairs per thread      (default 1000000)
+#   BENCH_SYSCALLS  syscalls per run                  (default 200000)
+#   BENCH_THREADS   thread counts for malloc_free     (default "1 2 4 8")
+#   BENCH_MAX_LIVE  largest live table size           (default 10000000)
+
+OUT=${1:-bench_output.txt}
+OPS=${BENCH_OPS:-1000000}
+SYSCALLS=${BENCH_SYSCALLS:-200000}
+THREADS=${BENCH_THREADS:-"1 2 4 8"}
+MAX_LIVE=${BENCH_MAX_LIVE:-10000000}
+
+VERSION=$(git describe --always --dirty 2>/dev/null || echo unknown)
+STAMP=$(date +%s)
+
+# Tag each result so runs can be compared across versions
+tag() {
+    grep -o '{"bench"[^}]*}' | sed "s/^{/{\"version\":\"$VERSION\",\"timestamp\":$STAMP,/"
+}
+
+: > "$OUT"
+
+for t in $THREADS; do
+    echo "malloc_free: $t thread(s)" >&2
+    bench/bench_malloc "$t" "$OPS" native | tag >> "$OUT"
+    # Interceptor writing to /dev/null: cost of interception alone
+    OSWATCH_NOTIFY_FD=3 LD_PRELOAD=./liboswatch_malloc.so \
+        bench/bench_malloc "$t" "$OPS" intercepted 3>/dev/null | tag >> "$OUT"
+    # Full pipeline: interceptor pipe drained by the tracer
+    ./oswatch bench/bench_malloc "$t" "$OPS" oswatch | tag >> "$OUT"
+done
+
+echo "syscall" >&2
+bench/bench_syscall "$SYSCALLS" native | tag >> "$OUT"
+./oswatch bench/bench_syscall "$SYSCALLS" oswatch | tag >> "$OUT"
+
+echo "tracker (up to $MAX_LIVE live blocks)" >&2
+bench/bench_tracker "$MAX_LIVE" | tag >> "$OUT"
+
+cat "$OUT"
@@ -14,6 +14,9 @@
 #include <time.h>
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/resource.h>
 
 // ANSI Color codes for pretty output
 #define COLOR_RESET   "\033[0m"
@@ -28,7 +31,155 @@
 // Configuration
 #define MAX_SYSCALL_NUM 400
 #define HASH_TABLE_SIZE 256
-#define MALLOC_HASH_SIZE 1024
+#define MALLOC_HASH_SIZE 1024         // Initial buckets per shard; tables grow
+#define MAX_TRACKER_SHARDS 16
+#define SHARD_BATCH_EVENTS 512
+#define SHARD_MAX_QUEUED 256          // Batches in flight before the parser waits
+#define SITE_HASH_SIZE 256
+#define MMAP_TRACK_THRESHOLD 65536   // mmaps at or above this are tracked
+#define GROWTH_PENDING_WINDOW 64     // events unclaimed growth waits for its malloc
+#define MAX_SCAN_THREADS 8
+#define ARENA_CHUNK_SIZE (1024 * 1024)
+#define INTERN_HASH_SIZE 256
+#define MAX_EVENT_LINE 256           // Longest interceptor line we reassemble
+#define MAX_CODE_MAPPINGS 128
+#define FAILURE_HASH_SIZE 256
+#define MAX_FAILED_PATH 256          // Longest path argument decoded from the tracee
+#define MAX_STARTUP_LIBS 64
+#define MAX_STARTUP_FDS 256
+#define FILE_ACCESS_HASH_SIZE 256
+#define IO_SIZE_BUCKETS 6            // <64, <512, <4K, <64K, <1M, 1M+ bytes
+#define TINY_IO_SIZE 512             // Writes below this are "tiny"
+#define SOCKET_HASH_SIZE 128
+#define LOCK_HASH_SIZE 256
+#define LOCK_WAIT_BUCKETS 6          // <10us, <100us, <1ms, <10ms, <100ms, 100ms+
+#define MAX_SCHED_THREADS 128        // Threads the scheduler sampler keeps files open for
+#define SCHED_BLOCKED_SLOTS 6        // Distinct blocking syscalls remembered per thread
+#define DEFAULT_SCHED_INTERVAL_MS 10
+#define JSON_MAX_DEPTH 16
+#define JSON_SCHEMA_VERSION 1        // Bump on any incompatible change to --format=json
+#define TRACE_BUFFER_SIZE (256 * 1024)  // --trace-out bytes held before a write()
+#define TRACE_EVENT_MAX 1024         // Longest single trace event
+#define TRACE_COUNTER_INTERVAL_MS 10.0
+#define MAX_INJECT_RULES 16          // --inject rules per run
+#define MAX_INJECT_SPEC 64
+#define DEFAULT_INJECT_SEED 1
+#define ALLOC_TRACE_VERSION 1        // Bump on any incompatible change to --record-allocs
+#define ALLOC_TRACE_BUFFER_SIZE (256 * 1024)
+#define ALLOC_RECORD_MAX 25          // Longest encoded record (realloc)
+#define LATENCY_BUCKETS 101          // 1us..~17s per syscall, four per power of two
+#define PROFILE_VERSION 2            // Bump on any incompatible change to the profile format
+#define MAX_PROFILE_NAME 128
+#define PROFILE_MIN_CALLS 10         // Fewer calls than this in both runs is noise
+#define DEFAULT_REGRESS_PCT 25.0     // --threshold
+#define DEFAULT_REGRESS_MS 0.5       // --threshold-ms
+#define LIVE_PUBLISH_INTERVAL_MS 100.0  // --metrics/--top snapshot refresh
+#define LIVE_LATENCY_BOUNDS 7        // 10us..10s by decade, then +Inf
+#define LIVE_TOP_SITES 16            // Allocation sites per snapshot (and per shard)
+#define LIVE_MAX_READERS 3           // The metrics server, the dashboard and the budgets
+#define TOP_FRAME_MS 500             // --top redraw interval
+#define LOG_RING_RECORDS 65536       // Verbose events buffered before dropping (power of two)
+#define LOG_BUFFER_SIZE (64 * 1024)  // Formatted verbose text per write()
+#define LOG_IDLE_US 2000             // Writer's nap when the ring is empty
+#define METRICS_REQUEST_MAX 2048     // Longest HTTP request header read
+
+// Reachability of a live malloc block after a leak scan (reachability.c)
+enum {
+    REACH_UNKNOWN = 0,         // Not scanned (or not yet marked)
+    REACH_REACHABLE,           // Still reachable from roots
+    REACH_INDIRECT,            // Only referenced from lost blocks
+    REACH_DEFINITE,            // No references at all
+    REACH_STATES
+};
+
+// Software perf counters opened on the tracee (perf_counters.c)
+enum {
+    COUNTER_TASK_CLOCK = 0,    // ns on CPU
+    COUNTER_MINOR_FAULTS,
+    COUNTER_MAJOR_FAULTS,
+    COUNTER_CONTEXT_SWITCHES,
+    COUNTER_CPU_MIGRATIONS,
+    COUNTER_COUNT
+};
+
+// Thread state seen by the scheduler sampler (sched_sampler.c)
+enum {
+    THREAD_RUNNING,             // R: on a CPU or waiting for one
+    THREAD_SLEEPING,            // S
+    THREAD_DISK,                // D: uninterruptible
+    THREAD_STOPPED,             // t/T: held by the tracer or a signal
+    THREAD_OTHER,
+    THREAD_STATES
+};
+
+// Per-task /proc files the sampler keeps open
+enum {
+    SCHED_FILE_SCHEDSTAT,      // run_ns wait_ns timeslices
+    SCHED_FILE_STATUS,         // Name, State, context switches
+    SCHED_FILE_SYSCALL,        // Syscall the task is blocked in
+    SCHED_FILES
+};
+
+// How a live block at exit is reported (malloc_tracker.c)
+enum {
+    LEAK_USER,                 // Leaked by user code
+    LEAK_LIBRARY,              // libc/ld.so buffers, freed by the OS at exit
+    LEAK_REACHABLE,            // User block still referenced (--leak-check)
+    LEAK_CLASSES
+};
+
+// What a baseline delta measures, for formatting (baseline.c)
+enum {
+    DELTA_COUNT,
+    DELTA_MS,
+    DELTA_BYTES,
+    DELTA_KB
+};
+
+// Report output (--format)
+enum {
+    REPORT_TEXT = 0,
+    REPORT_JSON
+};
+
+// Bump-pointer arena for tracker metadata - everything is released at once
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *chunks;
+    size_t bytes_reserved;     // Sum of chunk sizes
+    size_t bytes_used;         // Handed out by arena_alloc
+} Arena;
+
+// Fixed-size node allocator on top of an arena, recycling freed nodes
+typedef struct {
+    const char *name;
+    Arena *arena;
+    size_t object_size;
+    void *free_list;
+    size_t live;
+    size_t peak;
+} Slab;
+
+// Interned string (filenames etc.), stored in the arena
+typedef struct InternedString {
+    struct InternedString *next;
+    char text[];
+} InternedString;
+
+// Executable file mapping of the tracee, captured at exit (symbols.c)
+typedef struct {
+    unsigned long start;
+    unsigned long end;
+    unsigned long offset;
+    const char *path;          // Interned
+    int is_runtime;            // libc, ld.so, libstdc++ and friends
+} CodeMapping;
 
 // System call information structure
 typedef struct {
@@ -44,7 +195,7 @@ typedef struct {
 typedef struct MemoryBlock {
     void *address;
     size_t size;
-    const char *syscall_type;  // "mmap", "brk", etc.
+    const char *syscall_type;  // "mmap", "brk", etc. (string constant, not copied)
     struct timespec timestamp;
     struct MemoryBlock *next;
 } MemoryBlock;
@@ -53,29 +204,721 @@ typedef struct MemoryBlock {
 typedef struct MallocBlock {
     void *address;
     size_t size;
+    void *site;                // Return address of the malloc caller
+    unsigned char reach;       // REACH_* after a leak scan
     struct MallocBlock *next;
 } MallocBlock;
 
+// Per call-site allocation statistics (keyed by the caller's return address)
+typedef struct AllocSite {
+    void *site;
+    size_t allocations;
+    size_t bytes_allocated;
+    size_t live_blocks;
+    size_t live_bytes;
+
+    // OS-level growth this site triggered (see growth_tracker.c)
+    size_t brk_extensions;
+    size_t brk_bytes;
+    size_t mmap_allocations;
+    size_t mmap_bytes;
+    size_t largest_trigger;    // Largest request that grew the heap
+    struct AllocSite *next;
+} AllocSite;
+
+// A call site holding live heap, from the shards' hot lists
+typedef struct {
+    void *site;
+    unsigned long long live_bytes;
+    unsigned long long live_blocks;
+    unsigned long long allocations;
+    char name[64];                     // module+offset once the mapping is known
+} LiveSite;
+
+// Heap extension (brk) or anonymous mmap waiting to be matched with the
+// malloc call that caused it. Both streams share stats->event_seq.
+typedef struct HeapGrowth {
+    size_t seq;
+    int is_mmap;
+    void *address;
+    size_t size;
+    struct HeapGrowth *next;
+} HeapGrowth;
+
+// Failing syscalls, one entry per (syscall, errno) (error_tracker.c)
+typedef struct SyscallFailure {
+    long syscall_num;
+    int error;
+    size_t count;
+    double time_ms;
+    struct SyscallFailure *next;
+} SyscallFailure;
+
+// Path arguments of failing calls, one entry per (path, errno)
+typedef struct FailedPath {
+    const char *path;          // Interned, owned by the stats arena
+    long syscall_num;          // Last syscall that failed on it
+    int error;
+    size_t count;
+    double time_ms;
+    struct FailedPath *next;
+} FailedPath;
+
+// A file the dynamic loader opened before main, keyed by file name so the
+// failed search-path probes for a library land on the same row (startup.c)
+typedef struct {
+    const char *name;          // Interned basename, or "[ld.so]" / "[init]"
+    const char *path;          // Interned path that opened, NULL if never found
+    size_t syscalls;
+    size_t probes;             // Failed opens while searching for it
+    double syscall_ms;
+    double wall_ms;            // Gaps between loader syscalls charged to it
+    size_t mapped_bytes;
+    unsigned long map_start;   // Address span of its mappings, for mprotect/munmap
+    unsigned long map_end;
+} StartupLibrary;
+
+// --startup: exec-to-main breakdown
+typedef struct {
+    int enabled;
+    int active;                // Between the exec stop and main
+    struct timespec exec_time;
+    struct timespec last_event;
+    struct timespec loader_exit_time;
+    struct timespec main_time;
+    int left_loader;           // First syscall issued outside ld.so's text
+    long loader_exit_syscall;
+    const char *loader_exit_module;
+    int reached_main;
+    const char *target;        // "main()", or "entry point" for stripped binaries
+    unsigned long breakpoint;  // int3 address, 0 once hit (or never armed)
+    long breakpoint_word;      // Original text under it
+    unsigned long loader_start;
+    unsigned long loader_end;
+    size_t syscalls;
+    double syscall_ms;
+    StartupLibrary libs[MAX_STARTUP_LIBS];
+    int lib_count;
+    int fd_lib[MAX_STARTUP_FDS];  // Library index per open fd, -1 if none
+} StartupProfile;
+
+// --inject: one fault applied to a fraction of one syscall's calls
+enum { INJECT_DELAY, INJECT_ERROR, INJECT_SHORT };
+
+typedef struct {
+    char spec[MAX_INJECT_SPEC];  // As given, for the report
+    int nr;
+    int action;
+    int error;                 // INJECT_ERROR: errno returned
+    double delay_ms;           // INJECT_DELAY: added before the call runs
+    double probability;        // 0..1
+    unsigned long long rng;    // Own stream, so rules don't shift each other
+    size_t matched;
+    size_t injected;
+    double delay_total_ms;
+    unsigned long long bytes_withheld;  // INJECT_SHORT: count reduced by
+} InjectRule;
+
+// Faults injected at the main thread's ptrace stops (fault_injector.c)
+typedef struct {
+    int count;
+    InjectRule rules[MAX_INJECT_RULES];
+    unsigned long long seed;
+    unsigned char armed[MAX_SYSCALL_NUM];  // Some rule names this syscall
+    int pending_error;         // Entry skipped the call; exit returns -this
+    long pending_nr;
+} FaultInjector;
+
+// How a file was read and written (file_tracker.c)
+typedef struct {
+    size_t reads;
+    size_t writes;
+    off_t bytes_read;
+    off_t bytes_written;
+    size_t sequential;         // Started where the previous access ended
+    size_t strided;            // Same non-zero gap as the previous access
+    size_t random;
+    size_t sizes[IO_SIZE_BUCKETS];
+    size_t tiny_writes;
+    size_t tiny_run_max;       // Longest run of back-to-back tiny writes
+    size_t rereads;            // Reads inside a range this fd already read
+    off_t reread_bytes;
+    size_t fsyncs;
+    size_t fsyncs_per_write;   // fsyncs with at most one write before them
+} IoPattern;
+
+// What a tracked fd refers to (track_file_close/track_file_dup)
+enum { FD_UNTRACKED = 0, FD_FILE, FD_SOCKET };
+
+enum {
+    SOCK_ROLE_NONE = 0,        // Created, never connected or listening
+    SOCK_ROLE_CLIENT,          // connect()ed
+    SOCK_ROLE_SERVER,          // Returned by accept()
+    SOCK_ROLE_LISTEN,
+    SOCK_ROLE_DGRAM,           // Unconnected datagram socket (sendto/recvfrom)
+    SOCK_ROLE_PAIR,            // socketpair()
+    SOCK_ROLES
+};
+
+// Socket side of a FileDescriptor, allocated only for sockets (socket_tracker.c)
+typedef struct {
+    int family;
+    int type;
+    int role;                  // SOCK_ROLE_*
+    const char *local;         // Interned bind() address, NULL if never bound
+    const char *peer;          // Interned remote endpoint
+    int is_dup;                // Another fd owns the connection's lifetime
+    int connect_pending;       // Non-blocking connect still in flight
+    struct timespec connect_start;
+    double connect_ms;
+    size_t accepted;           // Listening sockets: connections handed out
+    size_t msgs_sent;
+    size_t msgs_received;
+    off_t bytes_sent;
+    off_t bytes_received;
+    int shutdown_how;          // Last shutdown(2) argument, -1 if none
+} SocketInfo;
+
+// Closed sockets, aggregated per (endpoint, role)
+typedef struct SocketEndpoint {
+    const char *endpoint;      // Peer, or the local address for listeners
+    int role;
+    size_t sockets;
+    size_t failed_connects;
+    size_t connects;
+    double connect_ms;
+    double connect_max_ms;
+    double lifetime_ms;
+    double lifetime_max_ms;
+    size_t accepted;
+    size_t msgs_sent;
+    size_t msgs_received;
+    off_t bytes_sent;
+    off_t bytes_received;
+    struct SocketEndpoint *next;
+} SocketEndpoint;
+
+// Kinds of pthread object the interceptor reports waits on (lock_tracker.c)
+enum {
+    LOCK_MUTEX,
+    LOCK_RWLOCK,
+    LOCK_CONDVAR,
+    LOCK_KINDS
+};
+
+// A call site that waited on one lock
+typedef struct LockSite {
+    void *site;                // Return address into the caller
+    size_t waits;
+    size_t busy;               // Its own trylocks that failed
+    unsigned long long wait_ns;
+    struct LockSite *next;
+} LockSite;
+
+// A pthread lock that was found held, keyed by address. Uncontended
+// acquisitions never reach oswatch, so every count here is contention.
+typedef struct LockStat {
+    unsigned long addr;
+    int kind;
+    size_t waits;              // Acquisitions that had to block
+    size_t read_waits;         // rwlock: of those, for reading
+    size_t busy;               // trylocks that came back EBUSY
+    unsigned long long wait_ns;
+    unsigned long long max_ns;
+    size_t hist[LOCK_WAIT_BUCKETS];
+    LockSite *sites;
+    struct LockStat *next;
+} LockStat;
+
+// Traced futex waits on one futex word (main thread only)
+typedef struct FutexWait {
+    unsigned long uaddr;
+    size_t calls;
+    double time_ms;
+    struct FutexWait *next;
+} FutexWait;
+
 // File descriptor tracking structure
 typedef struct FileDescriptor {
     int fd;
-    char *filename;
+    const char *filename;      // Interned, owned by the stats arena
     int flags;
     off_t bytes_read;
     off_t bytes_written;
     struct timespec opened_at;
+
+    // Access-pattern state for this open file description
+    off_t offset;              // File position as read/write/lseek move it
+    off_t last_end;            // End of the previous access, -1 before the first
+    off_t last_gap;
+    off_t read_start;          // Contiguous range read so far
+    off_t read_end;
+    size_t tiny_run;
+    size_t writes_since_sync;
+    IoPattern io;
+
+    SocketInfo *sock;          // Own slab node for sockets, NULL for files
     struct FileDescriptor *next;
 } FileDescriptor;
 
+// Access patterns of every descriptor that had the file open, keyed by name
+typedef struct FileAccess {
+    const char *filename;      // Interned
+    size_t opens;
+    IoPattern io;
+    struct FileAccess *next;
+} FileAccess;
+
+// One parsed interceptor event, routed to the shard that owns its address
+enum { EVENT_ALLOC, EVENT_FREE };
+
+typedef struct {
+    int type;
+    void *address;
+    size_t size;
+    void *site;
+} MallocEvent;
+
+typedef struct EventBatch {
+    struct EventBatch *next;
+    int count;
+    MallocEvent events[SHARD_BATCH_EVENTS];
+} EventBatch;
+
+// Address-hashed slice of the live malloc table, owned by one worker
+// thread (tracker_shards.c). Queue fields are guarded by lock; table,
+// counters and arena belong to the worker until tracker_sync(). The
+// worker updates the counters atomically so live snapshots can read them.
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;       // Work queued or stop requested
+    pthread_cond_t drained;    // A batch finished
+    EventBatch *queue_head;
+    EventBatch *queue_tail;
+    size_t queued;
+    int busy;
+    int stop;
+    EventBatch *spare;         // Recycled batches
+    EventBatch *filling;       // Parser side, guarded by the stats lock
+
+    MallocBlock **table;
+    size_t buckets;
+    size_t live_blocks;
+    size_t allocations;
+    size_t frees;
+    size_t bytes_allocated;
+    size_t bytes_freed;
+    size_t unknown_frees;
+    size_t batches;
+    AllocSite *sites[SITE_HASH_SIZE];
+    Arena arena;
+    Slab block_slab;
+    Slab site_slab;
+    struct AsyncLog *log;      // -v, else NULL
+
+    // Largest live sites for --top, refreshed by the worker; hot and
+    // hot_count are guarded by lock
+    int hot_sites;
+    struct timespec hot_at;
+    LiveSite hot[LIVE_TOP_SITES];
+    int hot_count;
+} TrackerShard;
+
+// What oswatch costs the tracee (process_control.c, malloc_tracker.c)
+typedef struct {
+    size_t ptrace_stops;
+    double waitpid_ms;
+    double getregs_ms;
+    double stopped_ms;          // Tracee held stopped while oswatch worked
+    size_t events_ingested;
+    double ingest_ms;
+    size_t pipe_backlog_peak;   // Bytes waiting in the pipe (FIONREAD)
+    size_t events_dropped;      // Malformed or over-long lines
+
+    // Reported by the interceptor when the tracee exits
+    size_t interceptor_events;
+    size_t interceptor_dropped;
+    double interceptor_ms;
+} TracerOverhead;
+
+typedef struct {
+    int fds[COUNTER_COUNT];    // -1 if that counter could not be opened
+    uint64_t values[COUNTER_COUNT];
+    int available;             // At least one counter is open
+    int user_only;             // perf_event_paranoid forced exclude_kernel
+    int reads;
+} PerfCounters;
+
+// Live malloc blocks at exit by LEAK_* class - what both reports agree on
+typedef struct {
+    size_t blocks[LEAK_CLASSES];
+    size_t bytes[LEAK_CLASSES];
+} LeakSummary;
+
+// Streaming JSON writer state (json_writer.c)
+typedef struct {
+    FILE *out;
+    int depth;
+    size_t count[JSON_MAX_DEPTH];  // Members written so far at each open level
+} JsonWriter;
+
+typedef struct {
+    long syscall;
+    size_t samples;
+} BlockedSyscall;
+
+// One tracee thread as seen through /proc/<pid>/task/<tid>
+typedef struct {
+    pid_t tid;
+    char name[16];
+    int fds[SCHED_FILES];      // -1 once the thread is gone
+    unsigned long long run_ns;         // schedstat totals since the thread started
+    unsigned long long wait_ns;        // Runnable but not on a CPU
+    unsigned long long first_run_ns;   // At the first sample, for the off-CPU window
+    unsigned long long first_wait_ns;
+    unsigned long voluntary;
+    unsigned long involuntary;
+    struct timespec first_seen;
+    struct timespec last_seen;
+    size_t samples;
+    size_t states[THREAD_STATES];
+    BlockedSyscall blocked[SCHED_BLOCKED_SLOTS];  // Sleeping samples by syscall
+    size_t blocked_other;
+} SchedThread;
+
+// --sched: periodic per-thread scheduler sampling. Only the sampler
+// thread writes here until it is joined.
+typedef struct {
+    int enabled;
+    int interval_ms;
+    int task_dir;              // /proc/<pid>/task, rescanned for new threads
+    int stop_pipe[2];
+    pthread_t thread;
+    int running;
+    SchedThread threads[MAX_SCHED_THREADS];
+    int thread_count;
+    size_t threads_missed;     // Seen after the table filled up
+    size_t samples;
+    size_t runnable_sum;       // R-state threads summed over samples
+    int runnable_peak;
+    int cpus;                  // Fewest CPUs the tracee was allowed on
+    double sample_ms;          // Sampler's own time
+} SchedSampler;
+
+// --trace-out: Chrome trace-event timeline, streamed as it happens.
+// Written by whichever thread holds the stats lock.
+typedef struct {
+    int enabled;
+    int fd;
+    const char *path;
+    char *buffer;              // TRACE_BUFFER_SIZE bytes
+    size_t used;
+    int failed;                // A write failed; the rest is dropped
+    pid_t pid;
+    int statm_fd;              // /proc/<pid>/statm for the RSS track
+    long page_kb;
+    struct timespec last_counter;
+    size_t last_live;          // Counters are only written when they move
+    size_t last_rss_kb;
+    size_t events;
+    size_t flushes;
+} TraceWriter;
+
+// --record-allocs: the malloc/calloc/realloc/free sequence in parse order,
+// for oswatch-replay (alloc_trace.c). Written by the ingesting thread.
+enum { ALLOC_OP_MALLOC, ALLOC_OP_CALLOC, ALLOC_OP_REALLOC, ALLOC_OP_FREE };
+
+typedef struct {
+    int enabled;
+    int fd;
+    const char *path;
+    unsigned char *buffer;     // ALLOC_TRACE_BUFFER_SIZE bytes
+    size_t used;
+    int failed;                // A write failed; the rest is dropped
+    size_t records;
+    unsigned long long bytes;  // Written so far, header included
+} AllocRecorder;
+
+// One replayable operation. Addresses are resolved at load time to
+// object slots, reused once freed, so a replay needs a slot table only as
+// large as the most objects live at once. A realloc keeps its slot.
+typedef struct {
+    unsigned long long size;
+    unsigned int slot;
+    unsigned char op;
+} AllocOp;
+
+typedef struct {
+    char program[MAX_PROFILE_NAME];
+    AllocOp *ops;
+    size_t count;
+    size_t slots;
+    size_t op_counts[4];       // By ALLOC_OP_*
+    size_t unmatched;          // Frees/reallocs of addresses never seen allocated
+    size_t reordered;          // Allocations over a live address: its free came late
+    unsigned long long peak_live_bytes;
+    size_t peak_live_blocks;
+    size_t live_at_end;
+} AllocTrace;
+
+// Latency of one syscall; quantiles are good to about 12% (profile.c)
+typedef struct {
+    double total_ms;
+    unsigned long long counts[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+// One syscall in a stored profile
+typedef struct {
+    int nr;
+    unsigned long long calls;
+    unsigned long long failures;
+    double time_ms;
+    unsigned long long hist[LATENCY_BUCKETS];
+} ProfileSyscall;
+
+// Leaked bytes by call site, named module+offset so runs line up
+typedef struct {
+    char site[MAX_PROFILE_NAME];
+    unsigned long long blocks;
+    unsigned long long bytes;
+    unsigned int runs;         // Runs that leaked here
+} ProfileSite;
+
+// Compact summary of one or more runs (--baseline, --save-profile,
+// oswatch-merge). Totals are sums over `runs`; comparisons use the
+// per-run mean. syscalls are sorted by nr and sites by name so two
+// profiles merge in one pass.
+typedef struct {
+    char program[MAX_PROFILE_NAME];
+    unsigned int runs;
+    double execution_time_ms;
+    unsigned long long total_syscalls;
+    unsigned long long failed_syscalls;
+    double syscall_time_ms;
+    unsigned long long malloc_allocations;
+    unsigned long long malloc_frees;
+    unsigned long long malloc_bytes_allocated;
+    unsigned long long malloc_bytes_freed;
+    unsigned long long leaked_blocks;
+    unsigned long long leaked_bytes;
+    unsigned int leaking_runs;
+    unsigned long long fd_leaks;
+    unsigned long long peak_rss_kb;
+    unsigned long long max_rss_kb;     // Largest single run
+    int syscall_count;
+    ProfileSyscall *syscalls;
+    int site_count;
+    ProfileSite *sites;
+} Profile;
+
+// A change against the baseline that cleared the thresholds
+typedef struct {
+    char what[MAX_PROFILE_NAME + 16];  // "openat calls", "p99 fsync", "leak at <site>"
+    int unit;                  // DELTA_*
+    double before;
+    double after;
+    int regression;            // Lower is better for everything compared
+    int gated;                 // 0: shown for information, never a regression
+} ProfileDelta;
+
+typedef struct {
+    const char *path;          // --baseline
+    const char *save_path;     // --save-profile
+    double threshold_pct;
+    double threshold_ms;
+    int compared;              // The baseline existed and was read
+    int saved;                 // It didn't; this run became the baseline
+    unsigned int base_runs;
+    ProfileDelta *deltas;
+    int delta_count;
+    int delta_capacity;
+    int regressions;
+} BaselineDiff;
+
+// One syscall in a live snapshot
+typedef struct {
+    int nr;
+    unsigned long long calls;
+    unsigned long long timed;          // Exits seen, the histogram's _count
+    double seconds;
+    unsigned long long buckets[LIVE_LATENCY_BOUNDS + 1];  // Cumulative, last is +Inf
+} LiveSyscall;
+
+// What --metrics and --top show, copied out of ProcessStats by the
+// tracer (live_feed.c). Sites come before syscalls so a copy can stop
+// at the last syscall in use.
+typedef struct {
+    struct timespec taken;
+    unsigned long long total_syscalls;
+    unsigned long long failed_syscalls;
+    double syscall_seconds;
+    unsigned long long malloc_allocations;
+    unsigned long long malloc_frees;
+    unsigned long long malloc_bytes_allocated;
+    unsigned long long malloc_live_bytes;
+    unsigned long long malloc_live_blocks;
+    double allocation_rate;            // Per second since the previous snapshot
+    long open_files;
+    long open_sockets;
+    int counters_available;            // perf counters, read as the snapshot is taken
+    unsigned long long counters[COUNTER_COUNT];
+    int site_count;
+    LiveSite sites[LIVE_TOP_SITES];    // Largest live bytes first
+    int syscall_count;
+    LiveSyscall syscalls[MAX_SYSCALL_NUM];
+} LiveSnapshot;
+
+// Triple buffer between the tracer and one reader thread
+typedef struct {
+    LiveSnapshot *slots;       // Three of them
+    int back;                  // Tracer's slot
+    int front;                 // Reader's slot
+    int middle;                // Newest complete slot, | SNAPSHOT_FRESH until taken
+} SnapshotBuffer;
+
+// Who gets snapshots, and when the last one went out
+typedef struct {
+    SnapshotBuffer *readers[LIVE_MAX_READERS];
+    int reader_count;
+    int want_sites;            // A reader shows allocation sites
+    struct timespec last_publish;
+    struct timespec last_maps; // Code mappings last re-read to name a site
+    unsigned long long last_allocations;
+    size_t publishes;
+} LiveFeed;
+
+// --metrics: OpenMetrics endpoint served by a thread of its own
+typedef struct {
+    int enabled;
+    const char *address;
+    char unix_path[108];       // Unlinked at stop; empty for TCP
+    int listen_fd;
+    int stop_pipe[2];
+    pthread_t thread;
+    int running;
+    int statm_fd;              // RSS is read at scrape time
+    long page_kb;
+    SnapshotBuffer feed;
+    size_t scrapes;            // Server thread's until it is joined
+} MetricsExporter;
+
+// --top: full-screen dashboard redrawn every TOP_FRAME_MS from snapshots.
+// Everything but `enabled` belongs to the dashboard thread until joined.
+typedef struct {
+    int enabled;
+    int tty;                   // Draw in place; otherwise frames are appended
+    int stop_pipe[2];
+    pthread_t thread;
+    int running;
+    int statm_fd;
+    long page_kb;
+    SnapshotBuffer feed;
+    struct timespec prev_at;   // Previous frame, for rates
+    unsigned long long prev_calls[MAX_SYSCALL_NUM];
+    double prev_seconds[MAX_SYSCALL_NUM];
+    unsigned long long prev_syscalls;
+    unsigned long long prev_counters[COUNTER_COUNT];
+    LiveSite prev_sites[LIVE_TOP_SITES];
+    int prev_site_count;
+    size_t frames;
+} TopDashboard;
+
+// --soft-limit/--hard-limit: budgets checked as each live snapshot is
+// published (budget.c), so they cost nothing per event
+enum { BUDGET_HEAP, BUDGET_RSS, BUDGET_FDS, BUDGET_ALLOC_RATE, BUDGET_METRICS };
+enum { BUDGET_KILL, BUDGET_STOP };
+
+typedef struct {
+    unsigned long long soft;   // 0 when not set
+    unsigned long long hard;
+    unsigned long long peak;
+    double soft_at_ms;         // Since start; < 0 until crossed
+    double hard_at_ms;
+    int site_count;            // Top sites when the first limit was crossed
+    LiveSite sites[LIVE_TOP_SITES];
+} BudgetLimit;
+
+typedef struct {
+    int enabled;
+    int action;                // BUDGET_KILL or BUDGET_STOP
+    BudgetLimit limits[BUDGET_METRICS];
+    int tripped;               // Metric + 1 of the hard limit that ended the run
+    int stopped;               // SIGSTOP sent; the tracer lets go of the tracee
+    int statm_fd;
+    long page_kb;
+    SnapshotBuffer feed;       // Only so the feed publishes; read in place
+} BudgetWatch;
+
+// Verbose events, formatted later by the log writer (async_log.c)
+enum {
+    LOG_SYSCALL, LOG_MMAP, LOG_MUNMAP, LOG_MUNMAP_RUNTIME,
+    LOG_HEAP_INIT, LOG_HEAP_GROW, LOG_HEAP_SHRINK,
+    LOG_FILE_OPEN, LOG_FILE_CLOSE, LOG_FAILED, LOG_CONNECT, LOG_ACCEPT,
+    LOG_INVALID_FREE, LOG_MALLOC, LOG_FREE, LOG_UNKNOWN_FREE,
+    LOG_REACHED_MAIN, LOG_EXITED, LOG_SIGNALED
+};
+
+typedef struct {
+    unsigned long seq;         // Ring position the slot is ready for
+    int kind;                  // LOG_*
+    int nr;                    // Syscall number, fd, exit code or signal
+    unsigned long long a, b, c;
+    const char *text;          // Interned or static; read when formatted
+} LogRecord;
+
+// -v: a bounded multi-producer ring (the tracer and the shard workers)
+// drained by one writer thread, which formats and writes in batches
+typedef struct AsyncLog {
+    int enabled;
+    int fd;
+    const char *path;          // --log-file, NULL for stdout
+    LogRecord *ring;           // LOG_RING_RECORDS slots
+    unsigned long tail;        // Next slot to claim; producers CAS it
+    unsigned long head;        // Writer's
+    size_t dropped;            // Ring was full; atomic
+    size_t written;
+    int stop;
+    pthread_t thread;
+    int running;
+    char *buffer;              // LOG_BUFFER_SIZE bytes of formatted text
+    size_t used;
+} AsyncLog;
+
 // Overall process statistics
 typedef struct {
     pid_t pid;
     char *process_name;
 
+    // Tracker metadata allocation (arena.c)
+    Arena arena;
+    Slab memory_slab;
+    Slab file_slab;
+    Slab site_slab;
+    Slab growth_slab;
+    Slab failure_slab;
+    Slab failed_path_slab;
+    Slab file_access_slab;
+    Slab socket_slab;
+    Slab socket_info_slab;
+    Slab lock_slab;
+    Slab lock_site_slab;
+    Slab futex_slab;
+    InternedString *interned[INTERN_HASH_SIZE];
+
     // System call statistics
     size_t total_syscalls;
     size_t syscall_counts[MAX_SYSCALL_NUM];
     double total_syscall_time_ms;
+    LatencyHistogram *syscall_latency[MAX_SYSCALL_NUM];  // From the first exit
+    Slab latency_slab;
+
+    // Failed syscalls and the paths they failed on (error_tracker.c)
+    SyscallFailure *failures[FAILURE_HASH_SIZE];
+    FailedPath *failed_paths[FAILURE_HASH_SIZE];
+    size_t failed_syscalls;
+    double failed_time_ms;
+    size_t failed_path_reads;  // process_vm_readv calls that returned nothing
 
     // Memory statistics (mmap/brk level)
     size_t total_memory_allocated;
@@ -95,12 +938,56 @@ typedef struct {
     size_t malloc_bytes_allocated;
     size_t malloc_bytes_freed;
     size_t malloc_bytes_leaked;
-    MallocBlock *malloc_hash_table[MALLOC_HASH_SIZE];
+    AllocSite *alloc_sites[SITE_HASH_SIZE];  // Merged from the shards by tracker_sync
+
+    // Sharded live malloc table (tracker_shards.c)
+    TrackerShard *shards;
+    int shard_count;           // 0 until the workers start
+    int requested_shards;      // --shards, 0 = one per available CPU
+
+    // Heap growth attribution (growth_tracker.c)
+    size_t event_seq;             // Shared timeline of syscall exits and malloc events
+    HeapGrowth *pending_growth;   // Oldest first
+    size_t brk_extensions;
+    size_t mmap_anon_allocations;
+    size_t growth_attributed_bytes;
+    size_t growth_unattributed_bytes;
+
+    // Conservative reachability scan (reachability.c)
+    int leak_scan_done;
+    int scan_threads;
+    size_t scan_bytes_read;
+    double scan_time_ms;
+    size_t reach_blocks[REACH_STATES];
+    size_t reach_bytes[REACH_STATES];
+
+    // Exec-to-main profile (startup.c)
+    StartupProfile startup;
+
+    // Syscall delay and error injection (fault_injector.c)
+    FaultInjector inject;
+
+    // Executable mappings for call-site classification (symbols.c)
+    CodeMapping code_mappings[MAX_CODE_MAPPINGS];
+    int code_mapping_count;
 
     // File statistics
     int files_opened;
     int files_closed;
     FileDescriptor *open_files;
+    FileAccess *file_access[FILE_ACCESS_HASH_SIZE];  // Folded in at close
+
+    // Socket statistics (socket_tracker.c)
+    int sockets_opened;
+    int sockets_closed;
+    SocketEndpoint *socket_endpoints[SOCKET_HASH_SIZE];  // Folded in at close
+
+    // Lock contention (lock_tracker.c)
+    LockStat *locks[LOCK_HASH_SIZE];
+    FutexWait *futex_waits[LOCK_HASH_SIZE];
+    size_t lock_events;
+    size_t futex_calls;
+    double futex_time_ms;
 
     // Timing
     struct timespec start_time;
@@ -109,10 +996,55 @@ typedef struct {
 
     // Communication with malloc interceptor
     int notify_pipe[2];  // [0] = read, [1] = write
+    char pipe_carry[MAX_EVENT_LINE];  // Partial line left over from the last read
+    size_t pipe_carry_len;
+
+    // Self-overhead instrumentation
+    TracerOverhead overhead;
+
+    // Tracee CPU behaviour: perf counters plus wait4() rusage at reap time
+    PerfCounters perf;
+    struct rusage tracee_rusage;
+    int have_rusage;
+
+    // Per-thread on-CPU/run-queue/off-CPU sampling (sched_sampler.c)
+    SchedSampler sched;
+
+    // Timeline export (trace_writer.c)
+    TraceWriter trace;
+
+    // Allocation trace for oswatch-replay (alloc_trace.c)
+    AllocRecorder alloc_trace;
+
+    // Regression gate against a stored profile (baseline.c)
+    BaselineDiff baseline;
+
+    // Snapshots for the live views (live_feed.c)
+    LiveFeed live;
+
+    // Live OpenMetrics endpoint (metrics_exporter.c)
+    MetricsExporter metrics;
+
+    // Live terminal dashboard (dashboard.c)
+    TopDashboard top;
+
+    // Memory and fd budgets (budget.c)
+    BudgetWatch budget;
+
+    // Verbose event log (async_log.c)
+    AsyncLog log;
+
+    // Held by whichever thread is updating the trackers (monitor or ingest)
+    pthread_mutex_t lock;
 
     // Flags
     int verbose;
     int program_started;
+    int leak_scan;             // --leak-check: scan tracee memory at exit
+    int no_ptrace;             // --no-ptrace: syscalls come from libc wrappers
+    int lock_profile;          // --locks: interceptor wraps pthread locks
+    int report_format;         // REPORT_TEXT or REPORT_JSON
+    const char *report_path;   // --output, NULL for stdout
 } ProcessStats;
 
 // ============================================================================
@@ -126,11 +1058,58 @@ void monitor_process(pid_t pid, ProcessStats *stats);
 // System call handling (syscall_handler.c)
 void handle_syscall_entry(struct user_regs_struct *regs, ProcessStats *stats);
 void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, double duration);
+void handle_wrapped_syscall(ProcessStats *stats, long nr, long ret, double duration,
+                            unsigned long args[4], const char *path);
 const char* get_syscall_name(long syscall_num);
 
+// Failed syscall tracking (error_tracker.c)
+void track_failed_syscall(ProcessStats *stats, struct user_regs_struct *regs,
+                          double duration, const char *path);
+void report_failed_syscalls(ProcessStats *stats);
+int read_tracee_string(pid_t pid, unsigned long addr, char *buf, size_t len);
+int read_tracee_memory(pid_t pid, unsigned long addr, void *buf, size_t len);
+const char* error_name(int error);
+
+// Startup profiling (startup.c)
+void startup_exec_stop(pid_t pid, ProcessStats *stats);
+int startup_breakpoint(pid_t pid, ProcessStats *stats);
+void track_startup_syscall(ProcessStats *stats, struct user_regs_struct *regs, double duration);
+void report_startup(ProcessStats *stats);
+
+// Syscall fault injection, --inject (fault_injector.c)
+int inject_add(FaultInjector *fi, const char *spec);
+void inject_seed(FaultInjector *fi, unsigned long long seed);
+double inject_syscall_entry(pid_t pid, struct user_regs_struct *regs, ProcessStats *stats);
+void inject_syscall_exit(pid_t pid, struct user_regs_struct *regs, ProcessStats *stats);
+void report_injection(ProcessStats *stats);
+
 // File tracking (file_tracker.c)
-void track_file_open(ProcessStats *stats, int fd, const char *name, int flags);
-void track_file_close(ProcessStats *stats, int fd);
+FileDescriptor* track_file_open(ProcessStats *stats, int fd, const char *name, int flags);
+int track_file_close(ProcessStats *stats, int fd);
+FileDescriptor* find_file(ProcessStats *stats, int fd);
+void track_file_io(ProcessStats *stats, int fd, off_t offset, size_t bytes, int is_write);
+void track_file_seek(ProcessStats *stats, int fd, off_t position);
+void track_file_sync(ProcessStats *stats, int fd);
+int track_file_dup(ProcessStats *stats, int oldfd, int newfd);
+void report_file_access(ProcessStats *stats);
+void fold_open_files(ProcessStats *stats);
+const char* file_access_pattern(IoPattern *io);
+
+// Socket tracking (socket_tracker.c)
+void track_socket_syscall(ProcessStats *stats, struct user_regs_struct *regs, double duration);
+void track_socket_io(FileDescriptor *f, size_t bytes, int is_write);
+void fold_socket(ProcessStats *stats, FileDescriptor *f);
+void report_sockets(ProcessStats *stats);
+const char* socket_role_name(int role);
+const char* socket_endpoint_name(ProcessStats *stats, SocketInfo *s);
+
+// Lock contention (lock_tracker.c)
+void track_lock_event(ProcessStats *stats, char kind, void *lock, void *site,
+                      unsigned long long wait_ns);
+void track_futex_wait(ProcessStats *stats, struct user_regs_struct *regs, double duration);
+void report_locks(ProcessStats *stats);
+const char* lock_kind_name(int kind);
+double lock_futex_ms(ProcessStats *stats, LockStat *l, size_t *calls);
 
 // Memory tracking - mmap/brk level (memory_tracker.c)
 void track_memory_allocation(ProcessStats *stats, void *addr, size_t size, const char *type);
@@ -141,13 +1120,144 @@ void detect_memory_leaks(ProcessStats *stats);
 void process_malloc_events(ProcessStats *stats);
 void detect_malloc_leaks(ProcessStats *stats);
 void cleanup_malloc_table(ProcessStats *stats);
+AllocSite* find_or_add_site(AllocSite **table, Slab *slab, void *site);
+AllocSite* get_alloc_site(ProcessStats *stats, void *site);
+int classify_leak(ProcessStats *stats, MallocBlock *block);
+void summarize_leaks(ProcessStats *stats, MallocBlock **live, size_t count, LeakSummary *summary);
+
+// Sharded parallel malloc tracking (tracker_shards.c)
+int start_tracker_shards(ProcessStats *stats);
+void dispatch_malloc_event(ProcessStats *stats, MallocEvent *event);
+void flush_tracker_shards(ProcessStats *stats);
+void tracker_sync(ProcessStats *stats);
+void stop_tracker_shards(ProcessStats *stats);
+MallocBlock** collect_live_blocks(ProcessStats *stats, size_t *count);
+
+// Heap growth attribution - joins brk/mmap with malloc (growth_tracker.c)
+void track_heap_growth(ProcessStats *stats, int is_mmap, void *addr, size_t size);
+void attribute_heap_growth(ProcessStats *stats, void *addr, size_t size, void *site);
+void report_heap_growth(ProcessStats *stats);
+
+// Tracker metadata arenas (arena.c)
+void* arena_alloc(Arena *arena, size_t size);
+void arena_release(Arena *arena);
+void slab_init(Slab *slab, const char *name, Arena *arena, size_t object_size);
+void* slab_alloc(Slab *slab);
+void slab_free(Slab *slab, void *object);
+const char* intern_string(ProcessStats *stats, const char *text);
+void report_tracker_memory(ProcessStats *stats);
+
+// Reachability scan of tracee memory (reachability.c)
+int scan_reachability(pid_t pid, ProcessStats *stats);
+
+// Call-site symbolization (symbols.c)
+void snapshot_code_mappings(pid_t pid, ProcessStats *stats);
+const CodeMapping* find_code_mapping(ProcessStats *stats, void *addr);
+const char* format_site(ProcessStats *stats, void *site, char *buf, size_t len);
+int is_library_allocation(ProcessStats *stats, MallocBlock *block);
+
+// Tracee perf counters (perf_counters.c)
+void open_perf_counters(pid_t pid, ProcessStats *stats);
+void read_perf_counters(ProcessStats *stats);
+void close_perf_counters(ProcessStats *stats);
+
+// Scheduler sampling (sched_sampler.c)
+void start_sched_sampler(pid_t pid, ProcessStats *stats);
+void stop_sched_sampler(ProcessStats *stats);
+void report_sched(ProcessStats *stats);
+double sched_off_cpu_ms(SchedThread *t);
 
 // Report generation (report.c)
-void generate_report(ProcessStats *stats);
+int generate_report(ProcessStats *stats);
 void print_statistics(ProcessStats *stats);
+void print_tracer_overhead(ProcessStats *stats);
+
+// Machine-readable report, --format=json (json_report.c)
+int generate_json_report(ProcessStats *stats);
+
+// Run profiles (profile.c)
+void track_syscall_latency(ProcessStats *stats, long nr, double duration);
+double latency_quantile(const unsigned long long hist[LATENCY_BUCKETS], double q);
+double latency_max(const unsigned long long hist[LATENCY_BUCKETS]);
+double latency_bucket_limit_ms(int bucket);
+int build_profile(ProcessStats *stats, Profile *profile);
+int save_profile(const char *path, Profile *profile);
+int load_profile(const char *path, Profile *profile);
+void free_profile(Profile *profile);
+int merge_profile(Profile *into, Profile *from);
+const char* expand_profile_path(const char *path, pid_t pid, char *buf, size_t len);
+
+// Baseline comparison, --baseline (baseline.c)
+int apply_baseline(ProcessStats *stats);
+void compare_profiles(BaselineDiff *diff, Profile *base, Profile *current);
+const char* format_delta(ProfileDelta *d, char *buf, size_t len);
+void report_baseline(ProcessStats *stats);
+void free_baseline(BaselineDiff *diff);
+
+// Chrome trace-event timeline, --trace-out (trace_writer.c)
+int trace_open(ProcessStats *stats, const char *path);
+void trace_begin(ProcessStats *stats, pid_t pid);
+void trace_syscall(ProcessStats *stats, struct user_regs_struct *regs, double duration);
+void trace_fd_event(ProcessStats *stats, const char *what, long fd, const char *path);
+void trace_counters(ProcessStats *stats);
+int trace_close(ProcessStats *stats);
+
+// Allocation traces, --record-allocs and oswatch-replay (alloc_trace.c)
+int alloc_trace_open(ProcessStats *stats, const char *path);
+void record_alloc(AllocRecorder *r, int op, void *address, void *old, size_t size);
+int alloc_trace_close(ProcessStats *stats);
+int load_alloc_trace(const char *path, AllocTrace *trace);
+void free_alloc_trace(AllocTrace *trace);
+
+// Live snapshots for --metrics and --top (live_feed.c)
+int snapshot_buffer_init(SnapshotBuffer *b);
+void snapshot_buffer_free(SnapshotBuffer *b);
+LiveSnapshot* snapshot_take(SnapshotBuffer *b);
+void live_feed_attach(ProcessStats *stats, SnapshotBuffer *b, int want_sites);
+void publish_live_snapshot(ProcessStats *stats);
+
+// OpenMetrics exporter, --metrics (metrics_exporter.c)
+int metrics_open(ProcessStats *stats, const char *address);
+void start_metrics_exporter(pid_t pid, ProcessStats *stats);
+void stop_metrics_exporter(ProcessStats *stats);
+
+// Live terminal dashboard, --top (dashboard.c)
+int top_open(ProcessStats *stats);
+void start_top_dashboard(pid_t pid, ProcessStats *stats);
+void stop_top_dashboard(ProcessStats *stats);
+
+// Memory and fd budgets, --soft-limit/--hard-limit (budget.c)
+int budget_limit(BudgetWatch *b, const char *spec, int hard);
+int budget_open(ProcessStats *stats);
+void check_budgets(ProcessStats *stats, LiveSnapshot *s);
+void stop_budget_watch(ProcessStats *stats);
+void wait_stopped_tracee(ProcessStats *stats);
+void report_budgets(ProcessStats *stats);
+const char* budget_metric_name(int metric);
+
+// Asynchronous verbose log (async_log.c)
+int log_open(ProcessStats *stats, const char *path);
+void log_event(AsyncLog *log, int kind, int nr, unsigned long long a,
+               unsigned long long b, unsigned long long c, const char *text);
+void log_close(ProcessStats *stats);
+
+// Streaming JSON writer (json_writer.c)
+void json_init(JsonWriter *w, FILE *out);
+void json_begin_object(JsonWriter *w, const char *key);
+void json_end_object(JsonWriter *w);
+void json_begin_array(JsonWriter *w, const char *key);
+void json_end_array(JsonWriter *w);
+void json_write_string(JsonWriter *w, const char *text);
+void json_string(JsonWriter *w, const char *key, const char *value);
+void json_int(JsonWriter *w, const char *key, long long value);
+void json_uint(JsonWriter *w, const char *key, unsigned long long value);
+void json_double(JsonWriter *w, const char *key, double value);
+void json_bool(JsonWriter *w, const char *key, int value);
+void json_pointer(JsonWriter *w, const char *key, unsigned long value);
 
-// Utility functions (main.c)
+// Utility functions (stats.c)
 double calculate_time_diff(struct timespec *start, struct timespec *end);
+double timeval_ms(struct timeval *tv);
 void init_process_stats(ProcessStats *stats, pid_t pid, char *name);
 void cleanup_process_stats(ProcessStats *stats);
 
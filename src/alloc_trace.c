@@ -0,0 +1,388 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+
+// Allocation traces (--record-allocs, oswatch-replay)
+//
+// The ingesting thread appends every malloc, calloc, realloc and free to
+// a fixed buffer in the order it parses them, and writes the buffer out
+// when it fills. On disk it is a little-endian stream:
+//
+//   "OSWALLC\0" u32 version str program
+//   { u8 op u64 address [u64 old, realloc only] [u64 size, all but free] }*
+//
+// str is a u16 length and the bytes. Events from several threads reach us
+// through one pipe, so a free can arrive just after the allocation that
+// reused its address; the loader treats such an allocation as freeing
+// the old block first and counts it as reordered.
+
+static const char trace_magic[8] = "OSWALLC";
+
+static void recorder_flush(AllocRecorder *r) {
+    size_t done = 0;
+
+    while (done < r->used && !r->failed) {
+        ssize_t n = write(r->fd, r->buffer + done, r->used - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            r->failed = 1;
+            break;
+        }
+        done += n;
+    }
+    r->bytes += done;
+    r->used = 0;
+}
+
+static unsigned char* put_le(unsigned char *p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        *p++ = (value >> (8 * i)) & 0xff;
+    }
+    return p;
+}
+
+// Called before the tracee starts so a bad path fails the run up front
+int alloc_trace_open(ProcessStats *stats, const char *path) {
+    AllocRecorder *r = &stats->alloc_trace;
+
+    r->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (r->fd == -1) return -1;
+
+    r->buffer = malloc(ALLOC_TRACE_BUFFER_SIZE);
+    if (!r->buffer) {
+        close(r->fd);
+        return -1;
+    }
+
+    const char *program = stats->process_name ? stats->process_name : "";
+    size_t len = strlen(program);
+    if (len >= MAX_PROFILE_NAME) len = MAX_PROFILE_NAME - 1;
+
+    unsigned char *p = r->buffer;
+    memcpy(p, trace_magic, sizeof(trace_magic));
+    p = put_le(p + sizeof(trace_magic), ALLOC_TRACE_VERSION, 4);
+    p = put_le(p, len, 2);
+    memcpy(p, program, len);
+    r->used = p + len - r->buffer;
+
+    r->path = path;
+    r->enabled = 1;
+    return 0;
+}
+
+void record_alloc(AllocRecorder *r, int op, void *address, void *old, size_t size) {
+    if (r->failed) return;
+    if (ALLOC_TRACE_BUFFER_SIZE - r->used < ALLOC_RECORD_MAX) {
+        recorder_flush(r);
+    }
+
+    unsigned char *p = r->buffer + r->used;
+    *p++ = op;
+    p = put_le(p, (unsigned long)address, 8);
+    if (op == ALLOC_OP_REALLOC) p = put_le(p, (unsigned long)old, 8);
+    if (op != ALLOC_OP_FREE) p = put_le(p, size, 8);
+    r->used = p - r->buffer;
+    r->records++;
+}
+
+// After the last interceptor events are parsed
+int alloc_trace_close(ProcessStats *stats) {
+    AllocRecorder *r = &stats->alloc_trace;
+    if (!r->enabled) return 0;
+
+    recorder_flush(r);
+    int result = r->failed ? -1 : 0;
+    if (close(r->fd) == -1) result = -1;
+    free(r->buffer);
+    r->buffer = NULL;
+    r->enabled = 0;
+    return result;
+}
+
+// --- Loading ---
+
+typedef struct {
+    FILE *in;
+    int bad;                   // Short read
+} TraceReader;
+
+static unsigned long long get_le(TraceReader *r, int bytes) {
+    unsigned long long value = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = getc_unlocked(r->in);
+        if (c == EOF) {
+            r->bad = 1;
+            return 0;
+        }
+        value |= (unsigned long long)c << (8 * i);
+    }
+    return value;
+}
+
+// Live address -> slot, open addressing with linear probing. Address 0
+// marks an empty entry; removal shifts the rest of the run back.
+typedef struct {
+    unsigned long long *keys;
+    unsigned int *slots;
+    size_t mask;
+    size_t used;
+} AddressMap;
+
+static size_t address_hash(unsigned long long address) {
+    return ((address >> 4) * 0x9E3779B97F4A7C15ULL) >> 20;
+}
+
+static size_t map_find(AddressMap *m, unsigned long long address) {
+    size_t i = address_hash(address) & m->mask;
+    while (m->keys[i] != 0 && m->keys[i] != address) {
+        i = (i + 1) & m->mask;
+    }
+    return i;
+}
+
+static int map_init(AddressMap *m, size_t capacity) {
+    m->keys = calloc(capacity, sizeof(unsigned long long));
+    m->slots = malloc(capacity * sizeof(unsigned int));
+    m->mask = capacity - 1;
+    m->used = 0;
+    return m->keys && m->slots ? 0 : -1;
+}
+
+static void map_free(AddressMap *m) {
+    free(m->keys);
+    free(m->slots);
+}
+
+static int map_insert(AddressMap *m, unsigned long long address, unsigned int slot) {
+    if ((m->used + 1) * 2 > m->mask + 1) {
+        AddressMap grown;
+        if (map_init(&grown, (m->mask + 1) * 2) == -1) {
+            map_free(&grown);
+            return -1;
+        }
+        for (size_t i = 0; i <= m->mask; i++) {
+            if (m->keys[i] == 0) continue;
+            size_t j = map_find(&grown, m->keys[i]);
+            grown.keys[j] = m->keys[i];
+            grown.slots[j] = m->slots[i];
+        }
+        grown.used = m->used;
+        map_free(m);
+        *m = grown;
+    }
+
+    size_t i = map_find(m, address);
+    m->keys[i] = address;
+    m->slots[i] = slot;
+    m->used++;
+    return 0;
+}
+
+static void map_remove(AddressMap *m, size_t i) {
+    size_t j = i;
+    while (1) {
+        j = (j + 1) & m->mask;
+        if (m->keys[j] == 0) break;
+
+        // An entry may fill the hole unless its home lies in (i, j]
+        size_t home = address_hash(m->keys[j]) & m->mask;
+        int stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            m->keys[i] = m->keys[j];
+            m->slots[i] = m->slots[j];
+            i = j;
+        }
+    }
+    m->keys[i] = 0;
+    m->used--;
+}
+
+typedef struct {
+    AllocTrace *trace;
+    size_t capacity;
+    AddressMap live;
+    unsigned long long *sizes;  // Per slot, while live
+    unsigned int *free_slots;   // Slots ready for reuse
+    size_t free_count;
+    size_t slot_capacity;
+    unsigned long long live_bytes;
+    size_t live_blocks;
+} TraceLoader;
+
+static int emit(TraceLoader *l, int op, unsigned int slot, unsigned long long size) {
+    AllocTrace *t = l->trace;
+    if (t->count == l->capacity) {
+        size_t grown = l->capacity ? l->capacity * 2 : 65536;
+        AllocOp *more = realloc(t->ops, grown * sizeof(AllocOp));
+        if (!more) return -1;
+        t->ops = more;
+        l->capacity = grown;
+    }
+    AllocOp *o = &t->ops[t->count++];
+    o->size = size;
+    o->slot = slot;
+    o->op = op;
+    t->op_counts[op]++;
+    return 0;
+}
+
+static int take_slot(TraceLoader *l, unsigned int *slot) {
+    if (l->free_count > 0) {
+        *slot = l->free_slots[--l->free_count];
+        return 0;
+    }
+    if (l->trace->slots == l->slot_capacity) {
+        size_t grown = l->slot_capacity ? l->slot_capacity * 2 : 4096;
+        unsigned long long *sizes = realloc(l->sizes, grown * sizeof(unsigned long long));
+        if (!sizes) return -1;
+        l->sizes = sizes;
+        unsigned int *free_slots = realloc(l->free_slots, grown * sizeof(unsigned int));
+        if (!free_slots) return -1;
+        l->free_slots = free_slots;
+        l->slot_capacity = grown;
+    }
+    *slot = l->trace->slots++;
+    return 0;
+}
+
+static void note_live(TraceLoader *l) {
+    AllocTrace *t = l->trace;
+    if (l->live_bytes > t->peak_live_bytes) t->peak_live_bytes = l->live_bytes;
+    if (l->live_blocks > t->peak_live_blocks) t->peak_live_blocks = l->live_blocks;
+}
+
+// The block at map entry i is gone
+static int release(TraceLoader *l, size_t i, int emit_free) {
+    unsigned int slot = l->live.slots[i];
+    map_remove(&l->live, i);
+    l->live_bytes -= l->sizes[slot];
+    l->live_blocks--;
+    l->free_slots[l->free_count++] = slot;
+    return emit_free ? emit(l, ALLOC_OP_FREE, slot, 0) : 0;
+}
+
+// A new block at address; anything still live there missed its free
+static int place(TraceLoader *l, unsigned long long address, unsigned int slot,
+                 unsigned long long size) {
+    size_t i = map_find(&l->live, address);
+    if (l->live.keys[i] != 0) {
+        l->trace->reordered++;
+        if (release(l, i, 1) == -1) return -1;
+    }
+    if (map_insert(&l->live, address, slot) == -1) return -1;
+    l->sizes[slot] = size;
+    l->live_bytes += size;
+    l->live_blocks++;
+    note_live(l);
+    return 0;
+}
+
+static int load_record(TraceLoader *l, TraceReader *r, int op) {
+    AllocTrace *t = l->trace;
+    unsigned long long address = get_le(r, 8);
+    unsigned long long old = op == ALLOC_OP_REALLOC ? get_le(r, 8) : 0;
+    unsigned long long size = op != ALLOC_OP_FREE ? get_le(r, 8) : 0;
+    unsigned int slot;
+    if (r->bad) return 0;
+
+    if (op == ALLOC_OP_FREE) {
+        size_t i = map_find(&l->live, address);
+        if (l->live.keys[i] == 0) {
+            t->unmatched++;
+            return 0;
+        }
+        return release(l, i, 1);
+    }
+
+    if (op != ALLOC_OP_REALLOC || old == 0) {
+        if (address == 0) return 0;
+        if (take_slot(l, &slot) == -1) return -1;
+        if (emit(l, op, slot, size) == -1) return -1;
+        return place(l, address, slot, size);
+    }
+
+    size_t i = map_find(&l->live, old);
+    if (l->live.keys[i] == 0) {
+        // Allocated before the trace began; replay it as realloc(NULL, size)
+        t->unmatched++;
+        if (address == 0) return 0;
+        if (take_slot(l, &slot) == -1) return -1;
+        if (emit(l, op, slot, size) == -1) return -1;
+        return place(l, address, slot, size);
+    }
+
+    slot = l->live.slots[i];
+    if (address == 0) {
+        // realloc(p, 0) freed p; a failed realloc left it alone
+        return size == 0 ? release(l, i, 1) : 0;
+    }
+
+    // The block moves (or stays) but keeps its slot
+    l->live_bytes -= l->sizes[slot];
+    l->live_blocks--;
+    map_remove(&l->live, i);
+    if (emit(l, op, slot, size) == -1) return -1;
+    return place(l, address, slot, size);
+}
+
+// Returns -1 with errno ENOENT when there is no file, EINVAL when it isn't
+// a trace this version understands, ENOMEM when it doesn't fit
+int load_alloc_trace(const char *path, AllocTrace *trace) {
+    memset(trace, 0, sizeof(AllocTrace));
+
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+
+    TraceReader r = { in, 0 };
+    char magic[sizeof(trace_magic)];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        memcmp(magic, trace_magic, sizeof(magic)) != 0 ||
+        get_le(&r, 4) != ALLOC_TRACE_VERSION) {
+        fclose(in);
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t len = get_le(&r, 2);
+    size_t kept = 0;
+    for (size_t i = 0; i < len && !r.bad; i++) {
+        int c = getc_unlocked(in);
+        if (c == EOF) r.bad = 1;
+        else if (kept + 1 < sizeof(trace->program)) trace->program[kept++] = c;
+    }
+    trace->program[kept] = '\0';
+
+    TraceLoader l;
+    memset(&l, 0, sizeof(l));
+    l.trace = trace;
+    int invalid = r.bad;
+    int failed = map_init(&l.live, 4096) == -1;
+
+    // A record cut short by a crash ends the trace; keep what came before
+    int op;
+    while (!failed && !invalid && !r.bad && (op = getc_unlocked(in)) != EOF) {
+        if (op > ALLOC_OP_FREE) {
+            invalid = 1;
+        } else {
+            failed = load_record(&l, &r, op) == -1;
+        }
+    }
+
+    trace->live_at_end = l.live_blocks;
+    map_free(&l.live);
+    free(l.sizes);
+    free(l.free_slots);
+    fclose(in);
+
+    if (failed || invalid) {
+        free_alloc_trace(trace);
+        errno = invalid ? EINVAL : ENOMEM;
+        return -1;
+    }
+    return 0;
+}
+
+void free_alloc_trace(AllocTrace *trace) {
+    free(trace->ops);
+    trace->ops = NULL;
+    trace->count = 0;
+}
@@ -0,0 +1,178 @@
+#include "../include/oswatch.h"
+#include <stdint.h>
+#include <sys/resource.h>
+
+// Tracker metadata allocation
+//
+// Every MallocBlock, MemoryBlock, FileDescriptor, AllocSite and HeapGrowth
+// comes from a per-type slab carved out of an arena (one for ProcessStats,
+// one per tracker shard), so oswatch does not call malloc/free per traced
+// event and teardown is a walk over a handful of 1 MB chunks.
+
+#define ARENA_ALIGN 16
+
+void* arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaChunk *chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size) {
+        size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(ArenaChunk) + chunk_size);
+        if (!chunk) return NULL;
+
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->bytes_reserved += chunk_size;
+    }
+
+    void *ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    arena->bytes_used += size;
+    return ptr;
+}
+
+// Drop every chunk at once
+void arena_release(Arena *arena) {
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->bytes_reserved = 0;
+    arena->bytes_used = 0;
+}
+
+void slab_init(Slab *slab, const char *name, Arena *arena, size_t object_size) {
+    slab->name = name;
+    slab->arena = arena;
+    slab->object_size = object_size < sizeof(void*) ? sizeof(void*) : object_size;
+    slab->free_list = NULL;
+    slab->live = 0;
+    slab->peak = 0;
+}
+
+void* slab_alloc(Slab *slab) {
+    void *object = slab->free_list;
+
+    if (object) {
+        slab->free_list = *(void**)object;
+    } else {
+        object = arena_alloc(slab->arena, slab->object_size);
+        if (!object) return NULL;
+    }
+
+    slab->live++;
+    if (slab->live > slab->peak) {
+        slab->peak = slab->live;
+    }
+    return object;
+}
+
+// Freed nodes go back on the slab's free list, never to the system
+void slab_free(Slab *slab, void *object) {
+    *(void**)object = slab->free_list;
+    slab->free_list = object;
+    slab->live--;
+}
+
+// Return one shared arena copy per distinct string
+const char* intern_string(ProcessStats *stats, const char *text) {
+    unsigned long hash = 5381;
+    for (const char *c = text; *c; c++) {
+        hash = hash * 33 + (unsigned char)*c;
+    }
+    unsigned int idx = hash % INTERN_HASH_SIZE;
+
+    for (InternedString *s = stats->interned[idx]; s; s = s->next) {
+        if (strcmp(s->text, text) == 0) {
+            return s->text;
+        }
+    }
+
+    size_t len = strlen(text);
+    InternedString *s = arena_alloc(&stats->arena, sizeof(InternedString) + len + 1);
+    if (!s) return "<unknown>";
+
+    memcpy(s->text, text, len + 1);
+    s->next = stats->interned[idx];
+    stats->interned[idx] = s;
+    return s->text;
+}
+
+// Current resident set size of oswatch itself, in bytes
+static size_t self_rss_bytes(void) {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+
+    unsigned long size = 0, resident = 0;
+    if (fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    return resident * (page_size > 0 ? page_size : 4096);
+}
+
+void report_tracker_memory(ProcessStats *stats) {
+    // Shard slabs are summed into one row per node type
+    Slab shard_blocks = { "MallocBlock", NULL, sizeof(MallocBlock), NULL, 0, 0 };
+    Slab shard_sites = { "AllocSite/shard", NULL, sizeof(AllocSite), NULL, 0, 0 };
+    size_t arena_reserved = stats->arena.bytes_reserved;
+    size_t arena_used = stats->arena.bytes_used;
+
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+        shard_blocks.live += shard->block_slab.live;
+        shard_blocks.peak += shard->block_slab.peak;
+        shard_sites.live += shard->site_slab.live;
+        shard_sites.peak += shard->site_slab.peak;
+        arena_reserved += shard->arena.bytes_reserved;
+        arena_used += shard->arena.bytes_used;
+    }
+
+    Slab *slabs[] = {
+        &shard_blocks, &stats->memory_slab, &stats->file_slab,
+        &stats->site_slab, &shard_sites, &stats->growth_slab,
+        &stats->failure_slab, &stats->failed_path_slab, &stats->file_access_slab,
+        &stats->socket_slab, &stats->socket_info_slab, &stats->lock_slab,
+        &stats->lock_site_slab, &stats->futex_slab, &stats->latency_slab
+    };
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           OSWATCH TRACKER MEMORY                      ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    printf("  %-16s %-8s %-10s %-10s\n", "NODE TYPE", "SIZE", "LIVE", "PEAK");
+    printf("  -----------------------------------------------\n");
+
+    size_t peak_nodes = 0;
+    for (size_t i = 0; i < sizeof(slabs) / sizeof(slabs[0]); i++) {
+        printf("  %-16s %-8zu %-10zu %-10zu\n",
+               slabs[i]->name, slabs[i]->object_size, slabs[i]->live, slabs[i]->peak);
+        peak_nodes += slabs[i]->peak;
+    }
+    printf("\n");
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    size_t rss = self_rss_bytes();
+
+    printf("  Arena reserved:   %zu bytes (%.2f KB)\n",
+           arena_reserved, arena_reserved / 1024.0);
+    printf("  Arena used:       %zu bytes (%.2f KB)\n",
+           arena_used, arena_used / 1024.0);
+    printf("  oswatch RSS:      %zu bytes (%.2f KB, peak %ld KB)\n",
+           rss, rss / 1024.0, usage.ru_maxrss);
+    if (peak_nodes > 0) {
+        printf("  Per tracked node: %.1f bytes metadata, %.1f bytes RSS\n",
+               (double)arena_used / peak_nodes, (double)rss / peak_nodes);
+    }
+}
@@ -0,0 +1,248 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+
+// Asynchronous verbose log (-v, --log-file)
+//
+// Verbose events used to be printf'd while the tracee sat stopped. Now
+// the tracer and the shard workers only append a small fixed record to a
+// bounded ring: claim a slot with one CAS on `tail`, fill it, publish it
+// by storing its sequence number. A writer thread of our own formats the
+// records and writes them out a buffer at a time. When the ring is full
+// the event is counted as dropped instead of waiting, so a slow terminal
+// never holds the tracee up. Strings in records are interned (or static)
+// and stay valid until the log is closed.
+//
+// Each slot's seq says whose turn it is: equal to the position, it is free
+// for the producer claiming that position; position + 1, it holds a record
+// for the writer; the writer hands it back as position + capacity.
+
+#define LOG_MASK (LOG_RING_RECORDS - 1)
+
+static void log_flush(AsyncLog *log) {
+    size_t done = 0;
+
+    while (done < log->used) {
+        ssize_t n = write(log->fd, log->buffer + done, log->used - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;  // Nowhere to put it; drop the batch
+        done += n;
+    }
+    log->used = 0;
+}
+
+static void format_record(AsyncLog *log, LogRecord *r) {
+    if (LOG_BUFFER_SIZE - log->used < MAX_FAILED_PATH + 256) {
+        log_flush(log);
+    }
+
+    char *out = log->buffer + log->used;
+    size_t room = LOG_BUFFER_SIZE - log->used;
+    int n = 0;
+
+    switch (r->kind) {
+        case LOG_SYSCALL:
+            n = snprintf(out, room, "%s[SYSCALL]%s %-15s (num=%d, args: 0x%llx, 0x%llx, 0x%llx)\n",
+                         COLOR_BLUE, COLOR_RESET, get_syscall_name(r->nr), r->nr, r->a, r->b, r->c);
+            break;
+        case LOG_MMAP:
+            n = snprintf(out, room, "%s[MEMORY]%s mmap allocated %llu bytes at %p (library)\n",
+                         COLOR_GREEN, COLOR_RESET, r->a, (void*)r->b);
+            break;
+        case LOG_MUNMAP:
+            n = snprintf(out, room, "%s[MEMORY]%s munmap freed %llu bytes at %p (library)\n",
+                         COLOR_YELLOW, COLOR_RESET, r->a, (void*)r->b);
+            break;
+        case LOG_MUNMAP_RUNTIME:
+            n = snprintf(out, room, "%s[MEMORY]%s munmap freed %llu bytes at %p (runtime, ignored)\n",
+                         COLOR_CYAN, COLOR_RESET, r->a, (void*)r->b);
+            break;
+        case LOG_HEAP_INIT:
+            n = snprintf(out, room, "%s[MEMORY]%s Initial heap at %p\n",
+                         COLOR_CYAN, COLOR_RESET, (void*)r->a);
+            break;
+        case LOG_HEAP_GROW:
+            n = snprintf(out, room, "%s[MEMORY]%s Heap grew by %llu bytes (was %p, now %p)\n",
+                         COLOR_GREEN, COLOR_RESET, r->a, (void*)r->b, (void*)r->c);
+            break;
+        case LOG_HEAP_SHRINK:
+            n = snprintf(out, room, "%s[MEMORY]%s Heap shrunk by %llu bytes (was %p, now %p)\n",
+                         COLOR_YELLOW, COLOR_RESET, r->a, (void*)r->b, (void*)r->c);
+            break;
+        case LOG_FILE_OPEN:
+            n = snprintf(out, room, "%s[FILE]%s Opened file descriptor:  %d\n",
+                         COLOR_MAGENTA, COLOR_RESET, r->nr);
+            break;
+        case LOG_FILE_CLOSE:
+            n = snprintf(out, room, "%s[FILE]%s Closed file descriptor\n", COLOR_MAGENTA, COLOR_RESET);
+            break;
+        case LOG_FAILED:
+            n = snprintf(out, room, "%s[FAILED]%s %s(\"%s\") = -%s\n", COLOR_RED, COLOR_RESET,
+                         get_syscall_name(r->nr), r->text, error_name(r->a));
+            break;
+        case LOG_CONNECT:
+        case LOG_ACCEPT:
+            n = snprintf(out, room, "%s[SOCKET]%s %s fd %d %s %s\n", COLOR_MAGENTA, COLOR_RESET,
+                         r->kind == LOG_CONNECT ? "connect" : "accept", r->nr,
+                         r->kind == LOG_CONNECT ? "->" : "<-", r->text ? r->text : "?");
+            break;
+        case LOG_INVALID_FREE:
+            n = snprintf(out, room, "%s[ERROR]%s Double-free or invalid free detected at %p\n",
+                         COLOR_RED, COLOR_RESET, (void*)r->a);
+            break;
+        case LOG_MALLOC:
+            n = snprintf(out, room, "%s[MALLOC]%s Allocated %llu bytes at %p\n",
+                         COLOR_GREEN, COLOR_RESET, r->a, (void*)r->b);
+            break;
+        case LOG_FREE:
+            n = snprintf(out, room, "%s[MALLOC]%s Freed %llu bytes at %p\n",
+                         COLOR_YELLOW, COLOR_RESET, r->a, (void*)r->b);
+            break;
+        case LOG_UNKNOWN_FREE:
+            n = snprintf(out, room, "%s[MALLOC]%s Free of unknown address %p (double-free? )\n",
+                         COLOR_RED, COLOR_RESET, (void*)r->a);
+            break;
+        case LOG_REACHED_MAIN:
+            n = snprintf(out, room, "%s[STARTUP]%s Reached %s after %.2f ms\n", COLOR_CYAN,
+                         COLOR_RESET, r->text, r->a / 1000.0);
+            break;
+        case LOG_EXITED:
+            n = snprintf(out, room, "%s[PROCESS]%s Exited with code %d\n",
+                         COLOR_YELLOW, COLOR_RESET, r->nr);
+            break;
+        case LOG_SIGNALED:
+            n = snprintf(out, room, "%s[PROCESS]%s Terminated by signal %d\n",
+                         COLOR_RED, COLOR_RESET, r->nr);
+            break;
+    }
+
+    if (n > 0 && (size_t)n < room) {
+        log->used += n;
+    }
+    log->written++;
+}
+
+// Writer side: format everything published so far; 0 if there was nothing
+static int drain(AsyncLog *log) {
+    int drained = 0;
+
+    while (1) {
+        LogRecord *r = &log->ring[log->head & LOG_MASK];
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != log->head + 1) break;
+
+        format_record(log, r);
+        __atomic_store_n(&r->seq, log->head + LOG_RING_RECORDS, __ATOMIC_RELEASE);
+        log->head++;
+        drained = 1;
+    }
+    return drained;
+}
+
+static void* log_writer(void *arg) {
+    AsyncLog *log = arg;
+    struct timespec nap = { 0, LOG_IDLE_US * 1000L };
+
+    while (1) {
+        if (drain(log)) continue;
+
+        // Empty: get what we have onto the screen before napping
+        if (log->used > 0) log_flush(log);
+        if (__atomic_load_n(&log->stop, __ATOMIC_ACQUIRE)) {
+            drain(log);  // Anything published before stop was set
+            break;
+        }
+        nanosleep(&nap, NULL);
+    }
+    log_flush(log);
+    return NULL;
+}
+
+// Producer side, from any thread; never waits
+void log_event(AsyncLog *log, int kind, int nr, unsigned long long a,
+               unsigned long long b, unsigned long long c, const char *text) {
+    unsigned long pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+    LogRecord *r;
+
+    while (1) {
+        r = &log->ring[pos & LOG_MASK];
+        unsigned long seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)(seq - pos);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&log->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&log->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    r->kind = kind;
+    r->nr = nr;
+    r->a = a;
+    r->b = b;
+    r->c = c;
+    r->text = text;
+    __atomic_store_n(&r->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+// Before the tracee starts; path NULL logs to stdout
+int log_open(ProcessStats *stats, const char *path) {
+    AsyncLog *log = &stats->log;
+
+    log->fd = path ? open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : STDOUT_FILENO;
+    if (log->fd == -1) return -1;
+
+    log->ring = malloc(LOG_RING_RECORDS * sizeof(LogRecord));
+    log->buffer = malloc(LOG_BUFFER_SIZE);
+    if (!log->ring || !log->buffer) {
+        free(log->ring);
+        free(log->buffer);
+        if (path) close(log->fd);
+        return -1;
+    }
+    for (unsigned long i = 0; i < LOG_RING_RECORDS; i++) {
+        log->ring[i].seq = i;
+    }
+
+    // Our own banner lines must come out ahead of the writer's
+    fflush(stdout);
+
+    log->path = path;
+    log->running = pthread_create(&log->thread, NULL, log_writer, log) == 0;
+    if (!log->running) {
+        free(log->ring);
+        free(log->buffer);
+        if (path) close(log->fd);
+        return -1;
+    }
+    log->enabled = 1;
+    return 0;
+}
+
+// Once nothing logs any more: the tracee is reaped and the shards synced
+void log_close(ProcessStats *stats) {
+    AsyncLog *log = &stats->log;
+    if (!log->enabled) return;
+
+    __atomic_store_n(&log->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(log->thread, NULL);
+    log->running = 0;
+
+    if (log->dropped > 0) {
+        log->used = snprintf(log->buffer, LOG_BUFFER_SIZE,
+                             "%s[LOG]%s %zu verbose event(s) dropped, the writer fell behind\n",
+                             COLOR_YELLOW, COLOR_RESET, log->dropped);
+        log_flush(log);
+    }
+
+    if (log->path) close(log->fd);
+    free(log->ring);
+    free(log->buffer);
+    log->ring = NULL;
+    log->buffer = NULL;
+    log->enabled = 0;
+}
@@ -0,0 +1,316 @@
+#include "../include/oswatch.h"
+#include <math.h>
+
+// Baseline comparison
+//
+// --baseline FILE compares this run's profile with the one stored in FILE,
+// or stores it there if there is none yet. Only changes that clear both
+// thresholds are kept: the relative one (--threshold, percent) and a
+// per-unit absolute floor, --threshold-ms for latencies, so a 40% jump on
+// a 3us call isn't news. Everything compared is "lower is better"; any
+// increase that survives is a regression and makes oswatch exit 2.
+//
+// Only numbers that repeat from run to run can fail the gate: call counts,
+// quantiles of syscalls with enough samples, and leaks. Wall time, time in
+// syscalls, bytes allocated and peak RSS carry the tracer's stop overhead
+// or the allocator's mood; their changes are listed for information only.
+
+#define MAX_DELTAS_SHOWN 15
+#define BYTES_FLOOR (64 * 1024)
+#define RSS_FLOOR_KB 1024
+#define P99_MIN_CALLS 100
+
+static void add_change(BaselineDiff *diff, const char *what, int unit, double before,
+                       double after, double floor, double pct, int gated) {
+    double change = after - before;
+    if (change == 0 || fabs(change) < floor) return;
+    if (before > 0 && fabs(change) / before * 100.0 < pct) return;
+
+    if (diff->delta_count == diff->delta_capacity) {
+        int capacity = diff->delta_capacity ? diff->delta_capacity * 2 : 32;
+        ProfileDelta *grown = realloc(diff->deltas, capacity * sizeof(ProfileDelta));
+        if (!grown) return;
+        diff->deltas = grown;
+        diff->delta_capacity = capacity;
+    }
+
+    ProfileDelta *d = &diff->deltas[diff->delta_count++];
+    snprintf(d->what, sizeof(d->what), "%s", what);
+    d->unit = unit;
+    d->before = before;
+    d->after = after;
+    d->gated = gated;
+    d->regression = gated && change > 0;
+    if (d->regression) diff->regressions++;
+}
+
+static void add_delta(BaselineDiff *diff, const char *what, int unit,
+                      double before, double after, double floor, double pct) {
+    add_change(diff, what, unit, before, after, floor, pct, 1);
+}
+
+static void add_info(BaselineDiff *diff, const char *what, int unit,
+                     double before, double after, double floor, double pct) {
+    add_change(diff, what, unit, before, after, floor, pct, 0);
+}
+
+static ProfileSyscall* find_syscall(Profile *p, int nr) {
+    for (int i = 0; i < p->syscall_count; i++) {
+        if (p->syscalls[i].nr == nr) return &p->syscalls[i];
+    }
+    return NULL;
+}
+
+static ProfileSite* find_site(Profile *p, const char *site) {
+    for (int i = 0; i < p->site_count; i++) {
+        if (strcmp(p->sites[i].site, site) == 0) return &p->sites[i];
+    }
+    return NULL;
+}
+
+static void compare_syscall(BaselineDiff *diff, ProfileSyscall *b, double b_runs,
+                            ProfileSyscall *a, double a_runs) {
+    const char *name = get_syscall_name(b ? b->nr : a->nr);
+    double before = b ? b->calls / b_runs : 0;
+    double after = a ? a->calls / a_runs : 0;
+    char what[64];
+
+    snprintf(what, sizeof(what), "%s calls", name);
+    add_delta(diff, what, DELTA_COUNT, before, after, PROFILE_MIN_CALLS, diff->threshold_pct);
+
+    snprintf(what, sizeof(what), "%s failures", name);
+    add_delta(diff, what, DELTA_COUNT, b ? b->failures / b_runs : 0,
+              a ? a->failures / a_runs : 0, PROFILE_MIN_CALLS, diff->threshold_pct);
+
+    // Quantiles of a handful of calls are noise
+    if (before < PROFILE_MIN_CALLS || after < PROFILE_MIN_CALLS) return;
+
+    snprintf(what, sizeof(what), "p50 %s", name);
+    add_delta(diff, what, DELTA_MS, latency_quantile(b->hist, 0.5),
+              latency_quantile(a->hist, 0.5), diff->threshold_ms, diff->threshold_pct);
+
+    // The top percent of a few dozen calls is one or two of them
+    if (before < P99_MIN_CALLS || after < P99_MIN_CALLS) return;
+    snprintf(what, sizeof(what), "p99 %s", name);
+    add_delta(diff, what, DELTA_MS, latency_quantile(b->hist, 0.99),
+              latency_quantile(a->hist, 0.99), diff->threshold_ms, diff->threshold_pct);
+}
+
+static double delta_pct(const ProfileDelta *d) {
+    return d->before > 0 ? fabs(d->after - d->before) / d->before : INFINITY;
+}
+
+// Regressions, improvements, then the ungated totals
+static int delta_group(const ProfileDelta *d) {
+    if (!d->gated) return 2;
+    return d->regression ? 0 : 1;
+}
+
+// By group, then the largest relative changes
+static int compare_deltas(const void *a, const void *b) {
+    const ProfileDelta *da = a;
+    const ProfileDelta *db = b;
+    if (delta_group(da) != delta_group(db)) return delta_group(da) - delta_group(db);
+    double pa = delta_pct(da), pb = delta_pct(db);
+    if (pa < pb) return 1;
+    if (pa > pb) return -1;
+    return strcmp(da->what, db->what);
+}
+
+// Merged profiles hold sums over their runs; compare per-run means
+void compare_profiles(BaselineDiff *diff, Profile *base, Profile *current) {
+    double br = base->runs, cr = current->runs;
+    double pct = diff->threshold_pct;
+
+    add_info(diff, "wall time", DELTA_MS, base->execution_time_ms / br,
+              current->execution_time_ms / cr, diff->threshold_ms, pct);
+    add_delta(diff, "syscalls", DELTA_COUNT, base->total_syscalls / br,
+              current->total_syscalls / cr, PROFILE_MIN_CALLS, pct);
+    add_info(diff, "time in syscalls", DELTA_MS, base->syscall_time_ms / br,
+              current->syscall_time_ms / cr, diff->threshold_ms, pct);
+
+    for (int i = 0; i < base->syscall_count; i++) {
+        ProfileSyscall *b = &base->syscalls[i];
+        compare_syscall(diff, b, br, find_syscall(current, b->nr), cr);
+    }
+    for (int i = 0; i < current->syscall_count; i++) {
+        ProfileSyscall *a = &current->syscalls[i];
+        if (!find_syscall(base, a->nr)) compare_syscall(diff, NULL, br, a, cr);
+    }
+
+    add_delta(diff, "malloc calls", DELTA_COUNT, base->malloc_allocations / br,
+              current->malloc_allocations / cr, PROFILE_MIN_CALLS, pct);
+    add_info(diff, "bytes allocated", DELTA_BYTES, base->malloc_bytes_allocated / br,
+              current->malloc_bytes_allocated / cr, BYTES_FLOOR, pct);
+    add_info(diff, "peak RSS", DELTA_KB, base->peak_rss_kb / br,
+              current->peak_rss_kb / cr, RSS_FLOOR_KB, pct);
+
+    // Any new leak is worth reporting, whatever its size
+    add_delta(diff, "leaked bytes", DELTA_BYTES, base->leaked_bytes / br,
+              current->leaked_bytes / cr, 1, 0);
+    add_delta(diff, "leaked fds", DELTA_COUNT, base->fd_leaks / br,
+              current->fd_leaks / cr, 1, 0);
+
+    char what[MAX_PROFILE_NAME + 16];
+    for (int i = 0; i < base->site_count; i++) {
+        ProfileSite *b = &base->sites[i];
+        ProfileSite *a = find_site(current, b->site);
+        snprintf(what, sizeof(what), "leak at %s", b->site);
+        add_delta(diff, what, DELTA_BYTES, b->bytes / br, a ? a->bytes / cr : 0, 1, 0);
+    }
+    for (int i = 0; i < current->site_count; i++) {
+        ProfileSite *a = &current->sites[i];
+        if (find_site(base, a->site)) continue;
+        snprintf(what, sizeof(what), "leak at %s", a->site);
+        add_delta(diff, what, DELTA_BYTES, 0, a->bytes / cr, 1, 0);
+    }
+
+    if (diff->delta_count > 0) {
+        qsort(diff->deltas, diff->delta_count, sizeof(ProfileDelta), compare_deltas);
+    }
+}
+
+// "openat calls +340% (12 -> 53)", "p99 fsync +2.100 ms (+525%)"
+const char* format_delta(ProfileDelta *d, char *buf, size_t len) {
+    char pct[32];
+    double change = d->after - d->before;
+
+    if (d->before > 0) {
+        snprintf(pct, sizeof(pct), "%+.0f%%", change / d->before * 100.0);
+    } else {
+        snprintf(pct, sizeof(pct), "new");
+    }
+
+    switch (d->unit) {
+        case DELTA_MS:
+            snprintf(buf, len, "%s %+.3f ms (%s, %.3f -> %.3f ms)",
+                     d->what, change, pct, d->before, d->after);
+            break;
+        case DELTA_BYTES:
+            snprintf(buf, len, "%s %+.0f bytes (%s, %.0f -> %.0f)",
+                     d->what, change, pct, d->before, d->after);
+            break;
+        case DELTA_KB:
+            snprintf(buf, len, "%s %+.0f KB (%s, %.0f -> %.0f KB)",
+                     d->what, change, pct, d->before, d->after);
+            break;
+        default:
+            snprintf(buf, len, "%s %s (%.0f -> %.0f)", d->what, pct, d->before, d->after);
+    }
+    return buf;
+}
+
+// Before either report: compare with (or seed) the baseline, then save
+int apply_baseline(ProcessStats *stats) {
+    BaselineDiff *diff = &stats->baseline;
+    if (!diff->path && !diff->save_path) return 0;
+
+    Profile current;
+    if (build_profile(stats, &current) == -1) {
+        fprintf(stderr, "%sError: Cannot build the run profile%s\n", COLOR_RED, COLOR_RESET);
+        return -1;
+    }
+
+    int result = 0;
+    if (diff->path) {
+        Profile base;
+        if (load_profile(diff->path, &base) == 0) {
+            diff->compared = 1;
+            diff->base_runs = base.runs;
+            compare_profiles(diff, &base, &current);
+            free_profile(&base);
+        } else if (errno == ENOENT) {
+            if (save_profile(diff->path, &current) == 0) {
+                diff->saved = 1;
+            } else {
+                fprintf(stderr, "%sError: Cannot write %s: %s%s\n",
+                        COLOR_RED, diff->path, strerror(errno), COLOR_RESET);
+                result = -1;
+            }
+        } else {
+            fprintf(stderr, "%sError: %s is not an oswatch profile (version %d)%s\n",
+                    COLOR_RED, diff->path, PROFILE_VERSION, COLOR_RESET);
+            result = -1;
+        }
+    }
+
+    char path[PATH_MAX];
+    const char *save_path = diff->save_path ?
+        expand_profile_path(diff->save_path, stats->pid, path, sizeof(path)) : NULL;
+    if (save_path && save_profile(save_path, &current) == -1) {
+        fprintf(stderr, "%sError: Cannot write %s: %s%s\n",
+                COLOR_RED, save_path, strerror(errno), COLOR_RESET);
+        result = -1;
+    }
+
+    free_profile(&current);
+    return result;
+}
+
+// Prints the group's heading and deltas; returns how many there were
+static int print_deltas(BaselineDiff *diff, int group, const char *heading, int gap) {
+    int shown = 0, total = 0;
+    char line[256];
+
+    for (int i = 0; i < diff->delta_count; i++) {
+        ProfileDelta *d = &diff->deltas[i];
+        if (delta_group(d) != group) continue;
+        if (total++ == 0) printf("%s%s%s:%s\n", gap ? "\n" : "", COLOR_BOLD, heading, COLOR_RESET);
+        if (shown == MAX_DELTAS_SHOWN) continue;
+
+        int worse = d->after > d->before;
+        const char *color = group == 2 ? COLOR_YELLOW : worse ? COLOR_RED : COLOR_GREEN;
+        printf("  %s%s%s %s\n", color, worse ? "+" : "-", COLOR_RESET,
+               format_delta(d, line, sizeof(line)));
+        shown++;
+    }
+    if (total > shown) {
+        printf("  ... %d more\n", total - shown);
+    }
+    return total;
+}
+
+void report_baseline(ProcessStats *stats) {
+    BaselineDiff *diff = &stats->baseline;
+    if (!diff->path) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           BASELINE COMPARISON                         ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    if (diff->saved) {
+        printf("  No profile at %s yet; saved this run as the baseline\n", diff->path);
+        return;
+    }
+    if (!diff->compared) {
+        printf("  %sBaseline %s could not be read%s\n", COLOR_YELLOW, diff->path, COLOR_RESET);
+        return;
+    }
+
+    printf("  Baseline:   %s (%u run(s))\n", diff->path, diff->base_runs);
+    printf("  Thresholds: %.0f%% and %.3f ms\n\n", diff->threshold_pct, diff->threshold_ms);
+
+    if (diff->delta_count == 0) {
+        printf("  %sNo changes beyond the thresholds%s\n", COLOR_GREEN, COLOR_RESET);
+        return;
+    }
+
+    int printed = print_deltas(diff, 0, "Regressions", 0);
+    printed += print_deltas(diff, 1, "Improvements", printed > 0);
+    print_deltas(diff, 2, "Not gated (run-to-run noise, tracer overhead)", printed > 0);
+
+    if (diff->regressions > 0) {
+        printf("\n  %sREGRESSED: %d metric(s) worse than the baseline%s\n",
+               COLOR_RED, diff->regressions, COLOR_RESET);
+    }
+}
+
+void free_baseline(BaselineDiff *diff) {
+    free(diff->deltas);
+    diff->deltas = NULL;
+    diff->delta_count = 0;
+    diff->delta_capacity = 0;
+}
@@ -0,0 +1,270 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <poll.h>
+
+// Memory and fd budgets (--soft-limit, --hard-limit)
+//
+// Live heap bytes, RSS, open descriptors and allocations per second are
+// compared with their limits each time a live snapshot is published
+// (live_feed.c), at most every LIVE_PUBLISH_INTERVAL_MS and on a thread
+// that already holds the stats lock, so the per-event paths do no extra
+// work. Crossing a soft limit keeps the top allocation sites of that
+// moment for the report. Crossing a hard limit sends SIGKILL, or SIGSTOP
+// with --on-hard-limit stop, and the run ends with the full report.
+
+static const char *metric_names[BUDGET_METRICS] = { "heap", "rss", "fds", "alloc-rate" };
+
+const char* budget_metric_name(int metric) {
+    return metric_names[metric];
+}
+
+static int is_bytes(int metric) {
+    return metric == BUDGET_HEAP || metric == BUDGET_RSS;
+}
+
+// "64M", "1.5G", "512K"; binary for byte metrics, decimal for counts
+static int parse_amount(const char *text, int metric, unsigned long long *out) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return -1;
+
+    double unit = is_bytes(metric) ? 1024 : 1000;
+    double scale = 1;
+    switch (*end) {
+        case 'k': case 'K': scale = unit; end++; break;
+        case 'm': case 'M': scale = unit * unit; end++; break;
+        case 'g': case 'G': scale = unit * unit * unit; end++; break;
+    }
+    if (is_bytes(metric) && (*end == 'B' || *end == 'b')) end++;
+    if (metric == BUDGET_ALLOC_RATE && strcmp(end, "/s") == 0) end += 2;
+    if (*end != '\0') return -1;
+
+    *out = (unsigned long long)(value * scale);
+    return *out > 0 ? 0 : -1;
+}
+
+// METRIC=VALUE; returns -1 for a spec it can't use
+int budget_limit(BudgetWatch *b, const char *spec, int hard) {
+    const char *value = strchr(spec, '=');
+    if (!value) return -1;
+
+    for (int m = 0; m < BUDGET_METRICS; m++) {
+        size_t len = strlen(metric_names[m]);
+        if ((size_t)(value - spec) != len || strncmp(spec, metric_names[m], len) != 0) continue;
+
+        BudgetLimit *l = &b->limits[m];
+        if (parse_amount(value + 1, m, hard ? &l->hard : &l->soft) == -1) return -1;
+        b->enabled = 1;
+        return 0;
+    }
+    return -1;
+}
+
+// Before the tracee starts, so the feed publishes from the first event
+int budget_open(ProcessStats *stats) {
+    BudgetWatch *b = &stats->budget;
+
+    if (snapshot_buffer_init(&b->feed) == -1) return -1;
+    live_feed_attach(stats, &b->feed, 1);
+    for (int m = 0; m < BUDGET_METRICS; m++) {
+        b->limits[m].soft_at_ms = -1;
+        b->limits[m].hard_at_ms = -1;
+    }
+    b->statm_fd = -1;
+    b->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    return 0;
+}
+
+static long long read_rss_kb(ProcessStats *stats) {
+    BudgetWatch *b = &stats->budget;
+    if (b->statm_fd == -1) {
+        char statm[64];
+        snprintf(statm, sizeof(statm), "/proc/%d/statm", stats->pid);
+        b->statm_fd = open(statm, O_RDONLY | O_CLOEXEC);
+        if (b->statm_fd == -1) return -1;
+    }
+
+    char buf[128];
+    unsigned long size, resident;
+    ssize_t n = pread(b->statm_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    if (sscanf(buf, "%lu %lu", &size, &resident) != 2) return -1;
+    return resident * b->page_kb;
+}
+
+static const char* format_amount(int metric, unsigned long long value, char *buf, size_t len) {
+    if (!is_bytes(metric)) {
+        snprintf(buf, len, metric == BUDGET_ALLOC_RATE ? "%llu/s" : "%llu", value);
+        return buf;
+    }
+
+    const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+    double scaled = value;
+    int u = 0;
+    while (scaled >= 1024 && u < 4) {
+        scaled /= 1024;
+        u++;
+    }
+    snprintf(buf, len, u ? "%.1f %s" : "%.0f %s", scaled, units[u]);
+    return buf;
+}
+
+static void crossed(ProcessStats *stats, LiveSnapshot *s, int metric, unsigned long long value,
+                    int hard, double at_ms) {
+    BudgetWatch *b = &stats->budget;
+    BudgetLimit *l = &b->limits[metric];
+
+    // The sites behind the first crossing are the interesting ones
+    if (l->soft_at_ms < 0 && l->hard_at_ms < 0) {
+        l->site_count = s->site_count;
+        memcpy(l->sites, s->sites, s->site_count * sizeof(LiveSite));
+    }
+    if (hard) {
+        l->hard_at_ms = at_ms;
+    } else {
+        l->soft_at_ms = at_ms;
+    }
+
+    // The dashboard owns the screen; it shows the numbers anyway
+    if (!stats->top.enabled) {
+        char now[32], limit[32];
+        fprintf(stderr, "%s[BUDGET]%s %s %s over the %s limit of %s at %.2f s",
+                hard ? COLOR_RED : COLOR_YELLOW, COLOR_RESET, metric_names[metric],
+                format_amount(metric, value, now, sizeof(now)), hard ? "hard" : "soft",
+                format_amount(metric, hard ? l->hard : l->soft, limit, sizeof(limit)),
+                at_ms / 1000.0);
+        if (s->site_count > 0) {
+            fprintf(stderr, " (top site %s, %s live)", s->sites[0].name,
+                    format_amount(BUDGET_HEAP, s->sites[0].live_bytes, now, sizeof(now)));
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+// From publish_live_snapshot, with the stats lock held
+void check_budgets(ProcessStats *stats, LiveSnapshot *s) {
+    BudgetWatch *b = &stats->budget;
+    if (!b->enabled || b->tripped) return;
+
+    unsigned long long values[BUDGET_METRICS];
+    long long rss_kb = b->limits[BUDGET_RSS].soft || b->limits[BUDGET_RSS].hard ?
+        read_rss_kb(stats) : -1;
+    long fds = s->open_files + s->open_sockets;
+
+    values[BUDGET_HEAP] = s->malloc_live_bytes;
+    values[BUDGET_RSS] = rss_kb > 0 ? rss_kb * 1024ULL : 0;
+    values[BUDGET_FDS] = fds > 0 ? fds : 0;
+    values[BUDGET_ALLOC_RATE] = s->allocation_rate;
+
+    double at_ms = calculate_time_diff(&stats->start_time, &s->taken);
+    for (int m = 0; m < BUDGET_METRICS; m++) {
+        BudgetLimit *l = &b->limits[m];
+        if (values[m] > l->peak) l->peak = values[m];
+
+        if (l->soft && l->soft_at_ms < 0 && values[m] >= l->soft) {
+            crossed(stats, s, m, values[m], 0, at_ms);
+        }
+        if (l->hard && values[m] >= l->hard) {
+            crossed(stats, s, m, values[m], 1, at_ms);
+            b->tripped = m + 1;
+            if (b->action == BUDGET_STOP) {
+                // Set before the signal so the tracer knows the stop is ours
+                __atomic_store_n(&b->stopped, 1, __ATOMIC_RELEASE);
+                kill(stats->pid, SIGSTOP);
+            } else {
+                kill(stats->pid, SIGKILL);
+            }
+            return;
+        }
+    }
+}
+
+// After the report. Exiting would orphan the stopped tracee's process
+// group, and the kernel answers that with SIGHUP, so stay until it's gone.
+// Once resumed its interceptor writes events again; read and drop them so
+// it neither blocks on a full pipe nor dies of SIGPIPE.
+void wait_stopped_tracee(ProcessStats *stats) {
+    if (!stats->budget.stopped) return;
+    fflush(stdout);
+
+    struct pollfd fd = { stats->notify_pipe[0], POLLIN, 0 };
+    char discard[4096];
+    while (1) {
+        if (poll(&fd, 1, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        ssize_t n = read(fd.fd, discard, sizeof(discard));
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) break;
+    }
+    close(stats->notify_pipe[0]);
+
+    while (waitpid(stats->pid, NULL, 0) == -1 && errno == EINTR);
+}
+
+void stop_budget_watch(ProcessStats *stats) {
+    BudgetWatch *b = &stats->budget;
+    if (!b->enabled) return;
+
+    if (b->statm_fd != -1) close(b->statm_fd);
+    b->statm_fd = -1;
+    snapshot_buffer_free(&b->feed);
+}
+
+void report_budgets(ProcessStats *stats) {
+    BudgetWatch *b = &stats->budget;
+    if (!b->enabled) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s║               BUDGETS                                 ║%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n", COLOR_CYAN, COLOR_RESET);
+
+    printf("Checked every %.0f ms; a hard limit sends %s\n\n", LIVE_PUBLISH_INTERVAL_MS,
+           b->action == BUDGET_STOP ? "SIGSTOP" : "SIGKILL");
+    printf("  %-12s %-12s %-12s %-12s %s\n", "METRIC", "SOFT", "HARD", "PEAK", "STATUS");
+    printf("  ----------------------------------------------------------------------\n");
+
+    for (int m = 0; m < BUDGET_METRICS; m++) {
+        BudgetLimit *l = &b->limits[m];
+        if (!l->soft && !l->hard) continue;
+
+        char soft[32], hard[32], peak[32];
+        printf("  %-12s %-12s %-12s %-12s ", metric_names[m],
+               l->soft ? format_amount(m, l->soft, soft, sizeof(soft)) : "-",
+               l->hard ? format_amount(m, l->hard, hard, sizeof(hard)) : "-",
+               format_amount(m, l->peak, peak, sizeof(peak)));
+        if (l->hard_at_ms >= 0) {
+            printf("%sHARD at %.2f s%s\n", COLOR_RED, l->hard_at_ms / 1000.0, COLOR_RESET);
+        } else if (l->soft_at_ms >= 0) {
+            printf("%ssoft at %.2f s%s\n", COLOR_YELLOW, l->soft_at_ms / 1000.0, COLOR_RESET);
+        } else {
+            printf("%sok%s\n", COLOR_GREEN, COLOR_RESET);
+        }
+    }
+
+    for (int m = 0; m < BUDGET_METRICS; m++) {
+        BudgetLimit *l = &b->limits[m];
+        if (l->site_count == 0) continue;
+
+        char bytes[32];
+        double at_ms = l->soft_at_ms >= 0 ? l->soft_at_ms : l->hard_at_ms;
+        printf("\nTop allocation sites when %s crossed its limit (%.2f s):\n", metric_names[m],
+               at_ms / 1000.0);
+        for (int i = 0; i < l->site_count && i < 10; i++) {
+            printf("  %-36s %12s in %llu block(s)\n", l->sites[i].name,
+                   format_amount(BUDGET_HEAP, l->sites[i].live_bytes, bytes, sizeof(bytes)),
+                   l->sites[i].live_blocks);
+        }
+    }
+
+    if (b->tripped) {
+        printf("\n%sHard limit on %s exceeded: the program was stopped early; blocks still "
+               "live then are listed as leaks%s\n", COLOR_RED, metric_names[b->tripped - 1],
+               COLOR_RESET);
+        if (b->stopped) {
+            printf("Process %d is stopped: gdb -p %d to look at it, kill -CONT %d to let it "
+                   "finish; oswatch exits when it does\n", stats->pid, stats->pid, stats->pid);
+        }
+    }
+}
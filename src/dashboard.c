@@ -0,0 +1,297 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+
+// Live dashboard (--top)
+//
+// A thread of our own redraws a summary every TOP_FRAME_MS from the
+// newest live snapshot (live_feed.c): syscalls ranked by rate and by time,
+// live heap and allocation rate, the sites holding the most heap and how
+// fast they grow, open fds and RSS. Rates are differences between two
+// snapshots. Nothing is printed per event, and the tracee's own output
+// goes to /dev/null so it can't tear the screen. On a terminal the view
+// lives on the alternate screen; anywhere else frames are appended.
+// Ctrl-C reaches the program only, so it ends the run with a report.
+
+#define TOP_DEFAULT_ROWS 8
+#define TOP_FIXED_LINES 14         // Header, heap line and section titles
+
+typedef struct {
+    int nr;
+    unsigned long long calls;
+    double rate;                   // Calls per second
+    double ms_per_s;               // Time in the call per wall second
+    double avg_us;
+} TopSyscall;
+
+typedef struct {
+    LiveSite *site;
+    double growth;                 // Live bytes per second
+} TopSite;
+
+static const char* human_bytes(double bytes, char *buf, size_t len) {
+    const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+    int u = 0;
+    double magnitude = bytes < 0 ? -bytes : bytes;
+
+    while (magnitude >= 1024 && u < 4) {
+        magnitude /= 1024;
+        bytes /= 1024;
+        u++;
+    }
+    snprintf(buf, len, u ? "%.1f %s" : "%.0f %s", bytes, units[u]);
+    return buf;
+}
+
+static int compare_by_rate(const void *a, const void *b) {
+    const TopSyscall *sa = a;
+    const TopSyscall *sb = b;
+    if (sa->rate != sb->rate) return sa->rate < sb->rate ? 1 : -1;
+    return sa->calls < sb->calls ? 1 : sa->calls > sb->calls ? -1 : 0;
+}
+
+static int compare_by_time(const void *a, const void *b) {
+    const TopSyscall *sa = a;
+    const TopSyscall *sb = b;
+    if (sa->ms_per_s != sb->ms_per_s) return sa->ms_per_s < sb->ms_per_s ? 1 : -1;
+    return compare_by_rate(a, b);
+}
+
+// Fastest growing first; sites holding steady rank by size
+static int compare_by_growth(const void *a, const void *b) {
+    const TopSite *sa = a;
+    const TopSite *sb = b;
+    if (sa->growth != sb->growth) return sa->growth < sb->growth ? 1 : -1;
+    if (sa->site->live_bytes != sb->site->live_bytes) {
+        return sa->site->live_bytes < sb->site->live_bytes ? 1 : -1;
+    }
+    return 0;
+}
+
+// Rows per ranking: what fits the terminal, TOP_DEFAULT_ROWS off one
+static int section_rows(TopDashboard *t) {
+    struct winsize ws;
+    if (!t->tty || ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_row == 0) {
+        return TOP_DEFAULT_ROWS;
+    }
+    int rows = ((int)ws.ws_row - TOP_FIXED_LINES) / 3;
+    if (rows < 3) rows = 3;
+    return rows > LIVE_TOP_SITES ? LIVE_TOP_SITES : rows;
+}
+
+static long read_rss_kb(TopDashboard *t) {
+    char buf[128];
+    unsigned long size, resident;
+    ssize_t n = t->statm_fd != -1 ? pread(t->statm_fd, buf, sizeof(buf) - 1, 0) : -1;
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    if (sscanf(buf, "%lu %lu", &size, &resident) != 2) return -1;
+    return resident * t->page_kb;
+}
+
+static void draw_syscalls(FILE *out, const char *title, TopSyscall *rows, int count, int shown) {
+    fprintf(out, "\n%s%-22s %12s %12s %10s %10s%s\n", COLOR_BOLD, title,
+            "calls/s", "total", "ms/s", "avg us", COLOR_RESET);
+    for (int i = 0; i < count && i < shown; i++) {
+        TopSyscall *r = &rows[i];
+        fprintf(out, "%-22s %12.0f %12llu %10.2f %10.1f\n", get_syscall_name(r->nr),
+                r->rate, r->calls, r->ms_per_s, r->avg_us);
+    }
+}
+
+static void draw_frame(ProcessStats *stats, FILE *out, LiveSnapshot *s) {
+    TopDashboard *t = &stats->top;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double dt = calculate_time_diff(&t->prev_at, &s->taken) / 1000.0;
+    int fresh = dt > 0;
+    int shown = section_rows(t);
+    char a[32], b[32], c[32];
+
+    if (t->tty) {
+        fprintf(out, "\033[H\033[2J");
+    } else if (t->frames > 0) {
+        fprintf(out, "\n");
+    }
+
+    fprintf(out, "%soswatch --top%s  %s (pid %d)  up %.1fs\n", COLOR_CYAN, COLOR_RESET,
+            stats->process_name, stats->pid, calculate_time_diff(&stats->start_time, &now) / 1000.0);
+
+    double syscall_rate = fresh ? (s->total_syscalls - t->prev_syscalls) / dt : 0;
+    fprintf(out, "%sSyscalls:%s %llu total, %.0f/s, %llu failed, %.1f ms in syscalls\n",
+            COLOR_BOLD, COLOR_RESET, s->total_syscalls, syscall_rate, s->failed_syscalls,
+            s->syscall_seconds * 1000.0);
+    fprintf(out, "%sHeap:%s     %s live in %llu blocks, %.0f allocs/s, %s allocated in total\n",
+            COLOR_BOLD, COLOR_RESET, human_bytes(s->malloc_live_bytes, a, sizeof(a)),
+            s->malloc_live_blocks, s->allocation_rate,
+            human_bytes(s->malloc_bytes_allocated, b, sizeof(b)));
+
+    long rss_kb = read_rss_kb(t);
+    fprintf(out, "%sProcess:%s  RSS %s, %ld open files, %ld open sockets\n",
+            COLOR_BOLD, COLOR_RESET, rss_kb >= 0 ? human_bytes(rss_kb * 1024.0, c, sizeof(c)) : "n/a",
+            s->open_files, s->open_sockets);
+
+    if (s->counters_available) {
+        unsigned long long *now_c = s->counters, *prev_c = t->prev_counters;
+        double busy = fresh ? (now_c[COUNTER_TASK_CLOCK] - prev_c[COUNTER_TASK_CLOCK]) / 1e9 / dt : 0;
+        double faults = fresh ? (now_c[COUNTER_MINOR_FAULTS] + now_c[COUNTER_MAJOR_FAULTS] -
+                                 prev_c[COUNTER_MINOR_FAULTS] - prev_c[COUNTER_MAJOR_FAULTS]) / dt : 0;
+        double switches = fresh ?
+            (now_c[COUNTER_CONTEXT_SWITCHES] - prev_c[COUNTER_CONTEXT_SWITCHES]) / dt : 0;
+        fprintf(out, "%sCPU:%s      %.2f CPUs busy, %.0f faults/s (%llu major), %.0f switches/s, "
+                "%llu migrations\n", COLOR_BOLD, COLOR_RESET, busy, faults,
+                now_c[COUNTER_MAJOR_FAULTS], switches, now_c[COUNTER_CPU_MIGRATIONS]);
+    }
+
+    // Syscalls, ranked twice
+    TopSyscall rows[MAX_SYSCALL_NUM];
+    for (int i = 0; i < s->syscall_count; i++) {
+        LiveSyscall *sc = &s->syscalls[i];
+        TopSyscall *r = &rows[i];
+        r->nr = sc->nr;
+        r->calls = sc->calls;
+        r->rate = fresh ? (sc->calls - t->prev_calls[sc->nr]) / dt : 0;
+        r->ms_per_s = fresh ? (sc->seconds - t->prev_seconds[sc->nr]) * 1000.0 / dt : 0;
+        r->avg_us = sc->timed ? sc->seconds * 1e6 / sc->timed : 0;
+    }
+    qsort(rows, s->syscall_count, sizeof(TopSyscall), compare_by_rate);
+    draw_syscalls(out, "TOP SYSCALLS BY RATE", rows, s->syscall_count, shown);
+    qsort(rows, s->syscall_count, sizeof(TopSyscall), compare_by_time);
+    draw_syscalls(out, "TOP SYSCALLS BY TIME", rows, s->syscall_count, shown);
+
+    // Sites, by how fast their live heap grows
+    TopSite sites[LIVE_TOP_SITES];
+    for (int i = 0; i < s->site_count; i++) {
+        LiveSite *site = &s->sites[i];
+        unsigned long long before = 0;
+        for (int j = 0; j < t->prev_site_count; j++) {
+            if (t->prev_sites[j].site == site->site) before = t->prev_sites[j].live_bytes;
+        }
+        sites[i].site = site;
+        sites[i].growth = fresh && before ? ((double)site->live_bytes - before) / dt : 0;
+    }
+    qsort(sites, s->site_count, sizeof(TopSite), compare_by_growth);
+
+    fprintf(out, "\n%s%-34s %12s %12s %10s%s\n", COLOR_BOLD, "TOP GROWING SITES",
+            "growth/s", "live", "blocks", COLOR_RESET);
+    if (s->site_count == 0) {
+        fprintf(out, "  (no live heap yet)\n");
+    }
+    for (int i = 0; i < s->site_count && i < shown; i++) {
+        TopSite *site = &sites[i];
+        const char *color = site->growth > 0 ? COLOR_RED : site->growth < 0 ? COLOR_GREEN : "";
+        fprintf(out, "%-34.34s %s%12s%s %12s %10llu\n", site->site->name, color,
+                human_bytes(site->growth, a, sizeof(a)), *color ? COLOR_RESET : "",
+                human_bytes(site->site->live_bytes, b, sizeof(b)), site->site->live_blocks);
+    }
+
+    // Only move the baseline when the snapshot did
+    if (fresh) {
+        t->prev_at = s->taken;
+        t->prev_syscalls = s->total_syscalls;
+        memcpy(t->prev_counters, s->counters, sizeof(t->prev_counters));
+        for (int i = 0; i < s->syscall_count; i++) {
+            t->prev_calls[s->syscalls[i].nr] = s->syscalls[i].calls;
+            t->prev_seconds[s->syscalls[i].nr] = s->syscalls[i].seconds;
+        }
+        memcpy(t->prev_sites, s->sites, s->site_count * sizeof(LiveSite));
+        t->prev_site_count = s->site_count;
+    }
+}
+
+// One write per frame so the terminal never shows half of one
+static void render(ProcessStats *stats) {
+    char *frame = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&frame, &len);
+    if (!out) return;
+
+    draw_frame(stats, out, snapshot_take(&stats->top.feed));
+    fclose(out);
+
+    for (size_t done = 0; done < len; ) {
+        ssize_t n = write(STDOUT_FILENO, frame + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
+    }
+    free(frame);
+    stats->top.frames++;
+}
+
+static void* dashboard_thread(void *arg) {
+    ProcessStats *stats = arg;
+    TopDashboard *t = &stats->top;
+    struct pollfd stop = { .fd = t->stop_pipe[0], .events = POLLIN };
+
+    while (1) {
+        int ready = poll(&stop, 1, TOP_FRAME_MS);
+        if (ready == -1 && errno == EINTR) continue;
+        if (ready != 0) break;
+        render(stats);
+    }
+    return NULL;
+}
+
+// Called before the tracee starts so the feed has its reader up front
+int top_open(ProcessStats *stats) {
+    TopDashboard *t = &stats->top;
+
+    if (snapshot_buffer_init(&t->feed) == -1) return -1;
+    live_feed_attach(stats, &t->feed, 1);
+    t->tty = isatty(STDOUT_FILENO);
+    t->statm_fd = -1;
+    t->enabled = 1;
+    return 0;
+}
+
+void start_top_dashboard(pid_t pid, ProcessStats *stats) {
+    TopDashboard *t = &stats->top;
+    if (!t->enabled) return;
+
+    char statm[64];
+    snprintf(statm, sizeof(statm), "/proc/%d/statm", pid);
+    t->statm_fd = open(statm, O_RDONLY | O_CLOEXEC);
+    t->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    t->prev_at = stats->start_time;
+
+    // Ctrl-C is meant for the program; stay to restore the screen and report
+    signal(SIGINT, SIG_IGN);
+
+    if (pipe(t->stop_pipe) == -1) return;
+    if (t->tty) {
+        printf("\033[?1049h\033[?25l");  // Alternate screen, cursor hidden
+        fflush(stdout);
+    }
+    t->running = pthread_create(&t->thread, NULL, dashboard_thread, stats) == 0;
+    if (!t->running) {
+        close(t->stop_pipe[0]);
+        close(t->stop_pipe[1]);
+    }
+}
+
+void stop_top_dashboard(ProcessStats *stats) {
+    TopDashboard *t = &stats->top;
+    if (!t->enabled) return;
+
+    if (t->running) {
+        if (write(t->stop_pipe[1], "x", 1) != 1) {
+            perror("dashboard stop failed");
+        }
+        pthread_join(t->thread, NULL);
+        t->running = 0;
+        close(t->stop_pipe[0]);
+        close(t->stop_pipe[1]);
+    }
+    if (t->tty) {
+        printf("\033[?25h\033[?1049l");  // Back to the normal screen for the report
+        fflush(stdout);
+    }
+
+    if (t->statm_fd != -1) close(t->statm_fd);
+    snapshot_buffer_free(&t->feed);
+    t->enabled = 0;
+}
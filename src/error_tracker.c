@@ -0,0 +1,292 @@
+#define _GNU_SOURCE
+#include "../include/oswatch.h"
+#include <sys/uio.h>
+
+// Failed syscall hot spots
+//
+// Every syscall exit with a -errno return is counted per (syscall, errno)
+// along with the time it took. For calls that take a path, the string is
+// copied out of the stopped tracee with process_vm_readv and aggregated,
+// so wasted lookups (loader and plugin search paths, config probing) show
+// up by name.
+
+#define MAX_FAILURES_SHOWN 15
+#define MAX_PATHS_SHOWN 15
+
+// Which argument register holds the path: 0 = rdi, 1 = rsi, -1 = none
+static int path_argument(long syscall_num) {
+    switch (syscall_num) {
+        case 2:    // open
+        case 4:    // stat
+        case 6:    // lstat
+        case 21:   // access
+        case 59:   // execve
+        case 76:   // truncate
+        case 80:   // chdir
+        case 82:   // rename
+        case 83:   // mkdir
+        case 84:   // rmdir
+        case 85:   // creat
+        case 86:   // link
+        case 87:   // unlink
+        case 89:   // readlink
+        case 90:   // chmod
+        case 92:   // chown
+        case 94:   // lchown
+        case 137:  // statfs
+            return 0;
+        case 257:  // openat
+        case 258:  // mkdirat
+        case 259:  // mknodat
+        case 260:  // fchownat
+        case 262:  // newfstatat
+        case 263:  // unlinkat
+        case 264:  // renameat
+        case 265:  // linkat
+        case 267:  // readlinkat
+        case 268:  // fchmodat
+        case 269:  // faccessat
+        case 322:  // execveat
+        case 332:  // statx
+            return 1;
+        default:
+            return -1;
+    }
+}
+
+// Copy a NUL-terminated string out of the tracee. The remote range is
+// split at the page boundary so an unmapped next page still leaves us
+// with the part that was readable.
+int read_tracee_string(pid_t pid, unsigned long addr, char *buf, size_t len) {
+    if (addr == 0) return 0;
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+
+    size_t want = len - 1;
+    size_t first = page_size - (addr % page_size);
+    if (first > want) first = want;
+
+    struct iovec local = { buf, want };
+    struct iovec remote[2] = {
+        { (void*)addr, first },
+        { (void*)(addr + first), want - first }
+    };
+
+    ssize_t got = process_vm_readv(pid, &local, 1, remote, want > first ? 2 : 1, 0);
+    if (got <= 0) return 0;
+
+    buf[got] = '\0';
+    return strnlen(buf, got) < (size_t)got || (size_t)got == want;
+}
+
+// Copy `len` bytes out of the tracee; 1 only if all of them came back
+int read_tracee_memory(pid_t pid, unsigned long addr, void *buf, size_t len) {
+    struct iovec local = { buf, len };
+    struct iovec remote = { (void*)addr, len };
+
+    if (addr == 0) return 0;
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0) == (ssize_t)len;
+}
+
+const char* error_name(int error) {
+    const char *name = strerrorname_np(error);
+    return name ? name : "E?";
+}
+
+static SyscallFailure* get_failure(ProcessStats *stats, long syscall_num, int error) {
+    unsigned int idx = (syscall_num * 131 + error) % FAILURE_HASH_SIZE;
+
+    for (SyscallFailure *f = stats->failures[idx]; f; f = f->next) {
+        if (f->syscall_num == syscall_num && f->error == error) return f;
+    }
+
+    SyscallFailure *f = slab_alloc(&stats->failure_slab);
+    if (!f) return NULL;
+
+    memset(f, 0, sizeof(SyscallFailure));
+    f->syscall_num = syscall_num;
+    f->error = error;
+    f->next = stats->failures[idx];
+    stats->failures[idx] = f;
+    return f;
+}
+
+// Interned paths are unique, so the pointer is the key
+static FailedPath* get_failed_path(ProcessStats *stats, const char *path, int error) {
+    unsigned int idx = (((unsigned long)path >> 4) + error) % FAILURE_HASH_SIZE;
+
+    for (FailedPath *p = stats->failed_paths[idx]; p; p = p->next) {
+        if (p->path == path && p->error == error) return p;
+    }
+
+    FailedPath *p = slab_alloc(&stats->failed_path_slab);
+    if (!p) return NULL;
+
+    memset(p, 0, sizeof(FailedPath));
+    p->path = path;
+    p->error = error;
+    p->next = stats->failed_paths[idx];
+    stats->failed_paths[idx] = p;
+    return p;
+}
+
+// Called at syscall exit for -errno returns. `path` is set when the
+// caller already has the argument (--no-ptrace wrappers).
+void track_failed_syscall(ProcessStats *stats, struct user_regs_struct *regs,
+                          double duration, const char *path) {
+    long syscall_num = regs->orig_rax;
+    int error = -(long)regs->rax;
+
+    stats->failed_syscalls++;
+    stats->failed_time_ms += duration;
+
+    SyscallFailure *f = get_failure(stats, syscall_num, error);
+    if (f) {
+        f->count++;
+        f->time_ms += duration;
+    }
+
+    int arg = path_argument(syscall_num);
+    if (arg < 0) return;
+
+    char buf[MAX_FAILED_PATH];
+    if (!path) {
+        unsigned long addr = arg == 0 ? regs->rdi : regs->rsi;
+        if (!read_tracee_string(stats->pid, addr, buf, sizeof(buf))) {
+            stats->failed_path_reads++;
+            return;
+        }
+        path = buf;
+    }
+
+    const char *name = intern_string(stats, path);
+    FailedPath *p = get_failed_path(stats, name, error);
+    if (p) {
+        p->syscall_num = syscall_num;
+        p->count++;
+        p->time_ms += duration;
+    }
+
+    if (stats->verbose) {
+        log_event(&stats->log, LOG_FAILED, syscall_num, error, 0, 0, name ? name : "?");
+    }
+}
+
+static int compare_failures(const void *a, const void *b) {
+    const SyscallFailure *fa = *(const SyscallFailure * const *)a;
+    const SyscallFailure *fb = *(const SyscallFailure * const *)b;
+
+    if (fa->count < fb->count) return 1;
+    if (fa->count > fb->count) return -1;
+    return 0;
+}
+
+static int compare_failed_paths(const void *a, const void *b) {
+    const FailedPath *pa = *(const FailedPath * const *)a;
+    const FailedPath *pb = *(const FailedPath * const *)b;
+
+    if (pa->count < pb->count) return 1;
+    if (pa->count > pb->count) return -1;
+    return 0;
+}
+
+void report_failed_syscalls(ProcessStats *stats) {
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           FAILED SYSCALL HOT SPOTS                    ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    if (stats->failed_syscalls == 0) {
+        printf("  %sNo syscalls failed%s\n", COLOR_GREEN, COLOR_RESET);
+        return;
+    }
+
+    printf("  Failed calls:   %zu of %zu", stats->failed_syscalls, stats->total_syscalls);
+    if (stats->total_syscalls > 0) {
+        printf(" (%.1f%%)", 100.0 * stats->failed_syscalls / stats->total_syscalls);
+    }
+    printf("\n");
+    printf("  Time failing:   %.2f ms", stats->failed_time_ms);
+    if (stats->total_syscall_time_ms > 0) {
+        printf(" (%.1f%% of syscall time)", 100.0 * stats->failed_time_ms / stats->total_syscall_time_ms);
+    }
+    printf("\n\n");
+
+    // By syscall and errno
+    size_t count = 0;
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (SyscallFailure *f = stats->failures[i]; f; f = f->next) count++;
+    }
+
+    SyscallFailure **failures = malloc(count * sizeof(SyscallFailure*));
+    if (!failures) return;
+
+    size_t n = 0;
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (SyscallFailure *f = stats->failures[i]; f; f = f->next) failures[n++] = f;
+    }
+    qsort(failures, n, sizeof(SyscallFailure*), compare_failures);
+
+    printf("%sBy Syscall:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %-16s %-14s %-10s %-12s %-10s\n", "SYSCALL", "ERRNO", "COUNT", "TIME(ms)", "AVG(us)");
+    printf("  ---------------------------------------------------------------\n");
+    for (size_t i = 0; i < n && i < MAX_FAILURES_SHOWN; i++) {
+        SyscallFailure *f = failures[i];
+        printf("  %-16s %-14s %-10zu %-12.3f %-10.2f\n",
+               get_syscall_name(f->syscall_num), error_name(f->error),
+               f->count, f->time_ms, f->time_ms * 1000.0 / f->count);
+    }
+    if (n > MAX_FAILURES_SHOWN) {
+        printf("  ... %zu more (syscall, errno) pair(s)\n", n - MAX_FAILURES_SHOWN);
+    }
+    printf("\n");
+    free(failures);
+
+    // By path
+    count = 0;
+    size_t path_calls = 0, enoent_calls = 0;
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (FailedPath *p = stats->failed_paths[i]; p; p = p->next) {
+            count++;
+            path_calls += p->count;
+            if (p->error == ENOENT) enoent_calls += p->count;
+        }
+    }
+    if (count == 0) return;
+
+    FailedPath **paths = malloc(count * sizeof(FailedPath*));
+    if (!paths) return;
+
+    n = 0;
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (FailedPath *p = stats->failed_paths[i]; p; p = p->next) paths[n++] = p;
+    }
+    qsort(paths, n, sizeof(FailedPath*), compare_failed_paths);
+
+    printf("%sTop Failing Paths:%s %zu distinct, %zu calls\n", COLOR_BOLD, COLOR_RESET, n, path_calls);
+    printf("  %-8s %-10s %-12s %-10s %s\n", "COUNT", "ERRNO", "SYSCALL", "TIME(ms)", "PATH");
+    printf("  ---------------------------------------------------------------\n");
+    for (size_t i = 0; i < n && i < MAX_PATHS_SHOWN; i++) {
+        FailedPath *p = paths[i];
+        printf("  %-8zu %-10s %-12s %-10.3f %s\n",
+               p->count, error_name(p->error), get_syscall_name(p->syscall_num),
+               p->time_ms, p->path);
+    }
+    if (n > MAX_PATHS_SHOWN) {
+        printf("  ... %zu more path(s)\n", n - MAX_PATHS_SHOWN);
+    }
+    if (stats->failed_path_reads > 0) {
+        printf("  (%zu path argument(s) could not be read from the tracee)\n", stats->failed_path_reads);
+    }
+    free(paths);
+
+    if (enoent_calls * 2 > stats->failed_syscalls) {
+        printf("\n  %sMost failures are ENOENT path lookups.%s Search paths (LD_LIBRARY_PATH,\n"
+               "  plugin and config directories) are probed in order - put the location\n"
+               "  that usually hits first, or cache the result.\n",
+               COLOR_YELLOW, COLOR_RESET);
+    }
+}
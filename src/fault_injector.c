@@ -0,0 +1,210 @@
+#include "../include/oswatch.h"
+
+// Syscall fault injection (--inject SYSCALL:ACTION[:PCT%])
+//
+// Uses the stops the tracer already takes on the main thread:
+//   delay=5ms  the tracer holds the tracee at syscall entry that long, so
+//              the call (and everything waiting on it) takes that much
+//              longer; the added time shows up in its latency
+//   ENOSPC     entry sets orig_rax to -1 so the kernel skips the call, and
+//              exit rewrites rax to -ENOSPC; any errno name works
+//   short      entry halves the byte count of a read/write-style call, so
+//              the program sees a short read or write
+// Each rule draws from its own generator, seeded from --inject-seed and
+// its position, so a given seed and workload inject the same faults every
+// run and adding a rule doesn't move another rule's faults.
+
+// splitmix64
+static unsigned long long next_random(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Calls whose third argument is a byte (or iovec) count
+static int can_shorten(long nr) {
+    switch (nr) {
+        case SYS_read:
+        case SYS_write:
+        case SYS_pread64:
+        case SYS_pwrite64:
+        case SYS_readv:
+        case SYS_writev:
+        case SYS_sendto:
+        case SYS_recvfrom:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int parse_syscall(const char *name) {
+    char *end;
+    long nr = strtol(name, &end, 10);
+    if (end != name && *end == '\0') {
+        return nr >= 0 && nr < MAX_SYSCALL_NUM ? nr : -1;
+    }
+    for (nr = 0; nr < MAX_SYSCALL_NUM; nr++) {
+        if (strcmp(get_syscall_name(nr), name) == 0) return nr;
+    }
+    return -1;
+}
+
+static int parse_errno(const char *name) {
+    for (int error = 1; error < 134; error++) {
+        if (strcmp(error_name(error), name) == 0) return error;
+    }
+    return 0;
+}
+
+// "5ms", "200us", "1.5s"; a bare number is milliseconds
+static double parse_delay_ms(const char *text) {
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0) return -1;
+    if (*end == '\0' || strcmp(end, "ms") == 0) return value;
+    if (strcmp(end, "us") == 0) return value / 1000.0;
+    if (strcmp(end, "s") == 0) return value * 1000.0;
+    return -1;
+}
+
+// Returns -1 for a spec it can't use
+int inject_add(FaultInjector *fi, const char *spec) {
+    if (fi->count == MAX_INJECT_RULES || strlen(spec) >= MAX_INJECT_SPEC) return -1;
+
+    char buf[MAX_INJECT_SPEC];
+    strcpy(buf, spec);
+    char *action = strchr(buf, ':');
+    if (!action) return -1;
+    *action++ = '\0';
+    char *pct = strchr(action, ':');
+    if (pct) *pct++ = '\0';
+
+    InjectRule *r = &fi->rules[fi->count];
+    memset(r, 0, sizeof(InjectRule));
+    strcpy(r->spec, spec);
+    r->nr = parse_syscall(buf);
+    if (r->nr < 0) return -1;
+
+    if (strncmp(action, "delay=", 6) == 0) {
+        r->action = INJECT_DELAY;
+        r->delay_ms = parse_delay_ms(action + 6);
+        if (r->delay_ms <= 0) return -1;
+    } else if (strcmp(action, "short") == 0) {
+        r->action = INJECT_SHORT;
+        if (!can_shorten(r->nr)) return -1;
+    } else {
+        r->action = INJECT_ERROR;
+        r->error = parse_errno(action);
+        if (r->error == 0) return -1;
+    }
+
+    r->probability = 1.0;
+    if (pct) {
+        char *end;
+        double value = strtod(pct, &end);
+        if (end == pct || (*end != '\0' && strcmp(end, "%") != 0) || value < 0 || value > 100) {
+            return -1;
+        }
+        r->probability = value / 100.0;
+    }
+
+    fi->armed[r->nr] = 1;
+    fi->count++;
+    return 0;
+}
+
+void inject_seed(FaultInjector *fi, unsigned long long seed) {
+    fi->seed = seed;
+    for (int i = 0; i < fi->count; i++) {
+        unsigned long long state = seed + i;
+        fi->rules[i].rng = next_random(&state);
+    }
+}
+
+static int roll(InjectRule *r) {
+    double draw = (next_random(&r->rng) >> 11) * 0x1.0p-53;
+    return draw < r->probability;
+}
+
+// At a syscall entry stop; returns how long to hold the tracee before
+// resuming it (the caller sleeps without the stats lock)
+double inject_syscall_entry(pid_t pid, struct user_regs_struct *regs, ProcessStats *stats) {
+    FaultInjector *fi = &stats->inject;
+    long nr = regs->orig_rax;
+
+    fi->pending_error = 0;
+    if (nr < 0 || nr >= MAX_SYSCALL_NUM || !fi->armed[nr]) return 0;
+
+    double delay = 0;
+    int rewrite = 0;
+    for (int i = 0; i < fi->count; i++) {
+        InjectRule *r = &fi->rules[i];
+        if (r->nr != nr) continue;
+        r->matched++;
+        if (!roll(r)) continue;
+
+        if (r->action == INJECT_DELAY) {
+            delay += r->delay_ms;
+            r->delay_total_ms += r->delay_ms;
+            r->injected++;
+        } else if (r->action == INJECT_ERROR && !fi->pending_error) {
+            fi->pending_error = r->error;
+            fi->pending_nr = nr;
+            regs->orig_rax = -1;
+            rewrite = 1;
+            r->injected++;
+        } else if (r->action == INJECT_SHORT && !fi->pending_error && regs->rdx > 1) {
+            r->bytes_withheld += regs->rdx - regs->rdx / 2;
+            regs->rdx /= 2;
+            rewrite = 1;
+            r->injected++;
+        }
+    }
+
+    if (rewrite && ptrace(PTRACE_SETREGS, pid, 0, regs) == -1) {
+        fi->pending_error = 0;
+    }
+    regs->orig_rax = nr;
+    return delay;
+}
+
+// At the matching exit stop: return the error in place of the skipped call.
+// regs is left describing the call the program made, for the trackers.
+void inject_syscall_exit(pid_t pid, struct user_regs_struct *regs, ProcessStats *stats) {
+    FaultInjector *fi = &stats->inject;
+    if (!fi->pending_error) return;
+
+    regs->rax = -fi->pending_error;
+    ptrace(PTRACE_SETREGS, pid, 0, regs);
+    regs->orig_rax = fi->pending_nr;
+    fi->pending_error = 0;
+}
+
+void report_injection(ProcessStats *stats) {
+    FaultInjector *fi = &stats->inject;
+    if (fi->count == 0) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s║               FAULT INJECTION                         ║%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n", COLOR_CYAN, COLOR_RESET);
+
+    printf("Seed: %llu (the same seed and workload inject the same faults)\n\n", fi->seed);
+    printf("  %-28s %-10s %-10s %s\n", "RULE", "MATCHED", "INJECTED", "EFFECT");
+    printf("  ----------------------------------------------------------------------\n");
+
+    for (int i = 0; i < fi->count; i++) {
+        InjectRule *r = &fi->rules[i];
+        char effect[64];
+        if (r->action == INJECT_DELAY) {
+            snprintf(effect, sizeof(effect), "+%.2f ms", r->delay_total_ms);
+        } else if (r->action == INJECT_ERROR) {
+            snprintf(effect, sizeof(effect), "%zu x -%s", r->injected, error_name(r->error));
+        } else {
+            snprintf(effect, sizeof(effect), "%llu bytes withheld", r->bytes_withheld);
+        }
+        printf("  %-28s %-10zu %s%-10zu%s %s\n", r->spec, r->matched,
+               r->injected ? COLOR_YELLOW : "", r->injected, r->injected ? COLOR_RESET : "", effect);
+    }
+}
@@ -1,33 +1,342 @@
 #include "../include/oswatch.h"
 
-void track_file_open(ProcessStats *stats, int fd, const char *name, int flags) {
+// Per-fd access patterns
+//
+// Every read/write is placed at the offset it touched (the fd's position,
+// or the explicit pread/pwrite offset) and compared with the previous
+// access on that fd: sequential if it starts where that one ended,
+// strided if the gap repeats, random otherwise. When the fd is closed its
+// counters are folded into a per-file record so the report can name the
+// file after the descriptor is gone.
 
-    FileDescriptor *f = malloc(sizeof(FileDescriptor));
+#define MAX_FILES_SHOWN 15
+#define MAX_FINDINGS 10
+
+FileDescriptor* track_file_open(ProcessStats *stats, int fd, const char *name, int flags) {
+
+    FileDescriptor *f = slab_alloc(&stats->file_slab);
+    if (!f) return NULL;
+
+    memset(f, 0, sizeof(FileDescriptor));
     f->fd = fd;
     f->flags = flags;
-    f->bytes_read = 0;
-    f->bytes_written = 0;
-    f->filename = name ? strdup(name) : strdup("<unknown>");
+    f->filename = intern_string(stats, name ? name : "<unknown>");
+    f->last_end = -1;
     clock_gettime(CLOCK_MONOTONIC, &f->opened_at);
 
     f->next = stats->open_files;
     stats->open_files = f;
+    return f;
+}
+
+static FileAccess* get_file_access(ProcessStats *stats, const char *filename) {
+    unsigned int idx = ((unsigned long)filename >> 4) % FILE_ACCESS_HASH_SIZE;
+
+    for (FileAccess *a = stats->file_access[idx]; a; a = a->next) {
+        if (a->filename == filename) return a;
+    }
+
+    FileAccess *a = slab_alloc(&stats->file_access_slab);
+    if (!a) return NULL;
+
+    memset(a, 0, sizeof(FileAccess));
+    a->filename = filename;
+    a->next = stats->file_access[idx];
+    stats->file_access[idx] = a;
+    return a;
 }
 
-void track_file_close(ProcessStats *stats, int fd) {
+// Add one descriptor's pattern to its file's totals
+static void fold_file_access(ProcessStats *stats, FileDescriptor *f) {
+    IoPattern *src = &f->io;
+    if (src->reads == 0 && src->writes == 0 && src->fsyncs == 0) return;
+
+    FileAccess *a = get_file_access(stats, f->filename);
+    if (!a) return;
+
+    IoPattern *dst = &a->io;
+    a->opens++;
+    dst->reads += src->reads;
+    dst->writes += src->writes;
+    dst->bytes_read += src->bytes_read;
+    dst->bytes_written += src->bytes_written;
+    dst->sequential += src->sequential;
+    dst->strided += src->strided;
+    dst->random += src->random;
+    for (int i = 0; i < IO_SIZE_BUCKETS; i++) {
+        dst->sizes[i] += src->sizes[i];
+    }
+    dst->tiny_writes += src->tiny_writes;
+    if (src->tiny_run_max > dst->tiny_run_max) dst->tiny_run_max = src->tiny_run_max;
+    dst->rereads += src->rereads;
+    dst->reread_bytes += src->reread_bytes;
+    dst->fsyncs += src->fsyncs;
+    dst->fsyncs_per_write += src->fsyncs_per_write;
+}
+
+// Returns FD_FILE or FD_SOCKET if the fd was being tracked
+int track_file_close(ProcessStats *stats, int fd) {
 
     FileDescriptor *prev = NULL, *cur = stats->open_files;
 
     while (cur) {
         if (cur->fd == fd) {
+            int kind = cur->sock ? FD_SOCKET : FD_FILE;
             if (prev) prev->next = cur->next;
             else stats->open_files = cur->next;
 
-            free(cur->filename);
-            free(cur);
-            return;
+            if (cur->sock) {
+                fold_socket(stats, cur);
+                slab_free(&stats->socket_info_slab, cur->sock);
+            } else {
+                fold_file_access(stats, cur);
+            }
+            slab_free(&stats->file_slab, cur);
+            return kind;
         }
         prev = cur;
         cur = cur->next;
     }
+    return 0;
+}
+
+FileDescriptor* find_file(ProcessStats *stats, int fd) {
+    for (FileDescriptor *f = stats->open_files; f; f = f->next) {
+        if (f->fd == fd) return f;
+    }
+    return NULL;
+}
+
+static int size_bucket(size_t bytes) {
+    if (bytes < 64) return 0;
+    if (bytes < 512) return 1;
+    if (bytes < 4096) return 2;
+    if (bytes < 65536) return 3;
+    if (bytes < 1024 * 1024) return 4;
+    return 5;
+}
+
+// `offset` is -1 for read/write at the file position, which they advance
+void track_file_io(ProcessStats *stats, int fd, off_t offset, size_t bytes, int is_write) {
+    FileDescriptor *f = find_file(stats, fd);
+    if (!f) return;  // stdin/stdout/stderr and pipes we never saw opened
+    if (f->sock) {
+        track_socket_io(f, bytes, is_write);
+        return;
+    }
+
+    IoPattern *io = &f->io;
+    off_t start = offset >= 0 ? offset : f->offset;
+    off_t end = start + bytes;
+    if (offset < 0) f->offset = end;
+
+    if (is_write) {
+        f->bytes_written += bytes;
+        io->writes++;
+        io->bytes_written += bytes;
+    } else {
+        f->bytes_read += bytes;
+        io->reads++;
+        io->bytes_read += bytes;
+    }
+    io->sizes[size_bucket(bytes)]++;
+
+    if (f->last_end >= 0) {
+        off_t gap = start - f->last_end;
+        if (gap == 0) io->sequential++;
+        else if (gap == f->last_gap) io->strided++;
+        else io->random++;
+        f->last_gap = gap;
+    }
+    f->last_end = end;
+
+    if (is_write) {
+        f->writes_since_sync++;
+        if (bytes < TINY_IO_SIZE) {
+            io->tiny_writes++;
+            if (++f->tiny_run > io->tiny_run_max) io->tiny_run_max = f->tiny_run;
+        } else {
+            f->tiny_run = 0;
+        }
+    } else if (start >= f->read_start && end <= f->read_end) {
+        io->rereads++;
+        io->reread_bytes += bytes;
+    } else if (start >= f->read_start && start <= f->read_end) {
+        f->read_end = end;  // Extends the range read so far
+    } else {
+        f->read_start = start;
+        f->read_end = end;
+    }
+}
+
+void track_file_seek(ProcessStats *stats, int fd, off_t position) {
+    FileDescriptor *f = find_file(stats, fd);
+    if (f) {
+        f->offset = position;
+    }
+}
+
+void track_file_sync(ProcessStats *stats, int fd) {
+    FileDescriptor *f = find_file(stats, fd);
+    if (!f) return;
+
+    f->io.fsyncs++;
+    if (f->writes_since_sync == 1) f->io.fsyncs_per_write++;
+    f->writes_since_sync = 0;
+}
+
+// newfd refers to the same file as oldfd from here on. Returns FD_SOCKET
+// when it is a socket.
+int track_file_dup(ProcessStats *stats, int oldfd, int newfd) {
+    FileDescriptor *old = find_file(stats, oldfd);
+    FileDescriptor *f = track_file_open(stats, newfd, old ? old->filename : NULL, old ? old->flags : 0);
+    if (!f || !old) return FD_FILE;
+
+    // Same open file description, so the same position
+    f->offset = old->offset;
+    if (!old->sock) return FD_FILE;
+
+    // The original fd keeps the connection; this one only adds traffic
+    f->sock = slab_alloc(&stats->socket_info_slab);
+    if (!f->sock) return FD_FILE;
+    *f->sock = *old->sock;
+    f->sock->is_dup = 1;
+    f->sock->msgs_sent = f->sock->msgs_received = 0;
+    f->sock->bytes_sent = f->sock->bytes_received = 0;
+    return FD_SOCKET;
+}
+
+static const char* format_bytes(off_t bytes, char *buf, size_t len) {
+    if (bytes < 1024) snprintf(buf, len, "%ld B", (long)bytes);
+    else if (bytes < 1024 * 1024) snprintf(buf, len, "%.1f KB", bytes / 1024.0);
+    else snprintf(buf, len, "%.1f MB", bytes / (1024.0 * 1024.0));
+    return buf;
+}
+
+const char* file_access_pattern(IoPattern *io) {
+    size_t classified = io->sequential + io->strided + io->random;
+
+    if (classified == 0) return "single";
+    if (io->sequential * 10 >= classified * 8) return "sequential";
+    if (io->strided * 2 >= classified) return "strided";
+    if (io->random * 2 >= classified) return "random";
+    return "mixed";
+}
+
+static int compare_file_access(const void *a, const void *b) {
+    const FileAccess *fa = *(const FileAccess * const *)a;
+    const FileAccess *fb = *(const FileAccess * const *)b;
+    size_t ops_a = fa->io.reads + fa->io.writes;
+    size_t ops_b = fb->io.reads + fb->io.writes;
+
+    if (ops_a < ops_b) return 1;
+    if (ops_a > ops_b) return -1;
+    return 0;
+}
+
+// Heading goes out with the first finding
+static int next_finding(int *findings) {
+    if (*findings >= MAX_FINDINGS) return 0;
+    if (*findings == 0) printf("\n%sFindings:%s\n", COLOR_BOLD, COLOR_RESET);
+    (*findings)++;
+    return 1;
+}
+
+// Pathological patterns worth a suggestion
+static void print_findings(FileAccess *a, int *findings) {
+    IoPattern *io = &a->io;
+    size_t classified = io->sequential + io->strided + io->random;
+    size_t ops = io->reads + io->writes;
+    char bytes[32];
+
+    if (io->tiny_writes >= 64 && io->tiny_writes * 2 >= io->writes && next_finding(findings)) {
+        printf("  %s%s%s: %zu writes under %d B (longest run %zu).\n"
+               "    Buffer them (stdio, setvbuf) or batch with writev.\n",
+               COLOR_YELLOW, a->filename, COLOR_RESET,
+               io->tiny_writes, TINY_IO_SIZE, io->tiny_run_max);
+    }
+    if (io->rereads >= 16 && next_finding(findings)) {
+        printf("  %s%s%s: re-read %s it had already read, in %zu reads.\n"
+               "    Keep the data in memory or mmap the file.\n",
+               COLOR_YELLOW, a->filename, COLOR_RESET,
+               format_bytes(io->reread_bytes, bytes, sizeof(bytes)), io->rereads);
+    }
+    if (io->fsyncs_per_write >= 8 && io->fsyncs_per_write * 2 >= io->fsyncs && next_finding(findings)) {
+        printf("  %s%s%s: fsync after every write (%zu of %zu fsyncs).\n"
+               "    Group several writes per fsync, or use fdatasync.\n",
+               COLOR_YELLOW, a->filename, COLOR_RESET, io->fsyncs_per_write, io->fsyncs);
+    }
+    if (classified >= 32 && io->random * 2 >= classified &&
+        (io->bytes_read + io->bytes_written) / (off_t)ops < 4096 && next_finding(findings)) {
+        printf("  %s%s%s: random access in %s requests on average.\n"
+               "    Read larger blocks, hint with posix_fadvise(POSIX_FADV_RANDOM), or mmap it.\n",
+               COLOR_YELLOW, a->filename, COLOR_RESET,
+               format_bytes((io->bytes_read + io->bytes_written) / ops, bytes, sizeof(bytes)));
+    }
+}
+
+// Descriptors still open at exit count too; once, before any report
+void fold_open_files(ProcessStats *stats) {
+    for (FileDescriptor *f = stats->open_files; f; f = f->next) {
+        fold_file_access(stats, f);
+        memset(&f->io, 0, sizeof(IoPattern));
+    }
+}
+
+void report_file_access(ProcessStats *stats) {
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           FILE ACCESS PATTERNS                        ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    size_t count = 0;
+    for (int i = 0; i < FILE_ACCESS_HASH_SIZE; i++) {
+        for (FileAccess *a = stats->file_access[i]; a; a = a->next) count++;
+    }
+    if (count == 0) {
+        printf("  No reads or writes on tracked files\n");
+        return;
+    }
+
+    FileAccess **files = malloc(count * sizeof(FileAccess*));
+    if (!files) return;
+
+    size_t n = 0;
+    for (int i = 0; i < FILE_ACCESS_HASH_SIZE; i++) {
+        for (FileAccess *a = stats->file_access[i]; a; a = a->next) files[n++] = a;
+    }
+    qsort(files, n, sizeof(FileAccess*), compare_file_access);
+
+    printf("  %-32s %-8s %-10s %-10s %-11s %s\n",
+           "FILE", "OPS", "READ", "WRITTEN", "PATTERN", "SIZES <64/<512/<4K/<64K/<1M/1M+");
+    printf("  ------------------------------------------------------------------------------------------\n");
+    for (size_t i = 0; i < n && i < MAX_FILES_SHOWN; i++) {
+        IoPattern *io = &files[i]->io;
+        const char *name = files[i]->filename;
+        size_t len = strlen(name);
+        char rd[32], wr[32];
+
+        // Keep the end of long paths, that's the part that differs
+        printf("  %s%-*s %-8zu %-10s %-10s %-11s %zu/%zu/%zu/%zu/%zu/%zu\n",
+               len > 32 ? "..." : "", len > 32 ? 29 : 32, len > 32 ? name + len - 29 : name,
+               io->reads + io->writes,
+               format_bytes(io->bytes_read, rd, sizeof(rd)),
+               format_bytes(io->bytes_written, wr, sizeof(wr)),
+               file_access_pattern(io),
+               io->sizes[0], io->sizes[1], io->sizes[2], io->sizes[3], io->sizes[4], io->sizes[5]);
+    }
+    if (n > MAX_FILES_SHOWN) {
+        printf("  ... %zu more file(s)\n", n - MAX_FILES_SHOWN);
+    }
+
+    int findings = 0;
+    for (size_t i = 0; i < n; i++) {
+        print_findings(files[i], &findings);
+    }
+    if (findings == 0) {
+        printf("\n  %sNo pathological access patterns%s\n", COLOR_GREEN, COLOR_RESET);
+    }
+    free(files);
 }
@@ -0,0 +1,181 @@
+#include "../include/oswatch.h"
+
+// Heap growth attribution
+//
+// The tracer sees brk/mmap at syscall exit while the tracee is stopped, and
+// the interceptor only writes its ALLOC line after real_malloc() returns.
+// So on the shared event_seq timeline a malloc's ALLOC always lands after
+// the growth it caused. Pending growth is held here until an ALLOC whose
+// chunk lies in the new memory shows up; other threads' mallocs in between
+// don't claim it, and growth nobody allocates from is left unattributed.
+
+#define MAX_GROWTH_SITES_SHOWN 10
+
+// Record a heap extension or anonymous mmap seen at syscall exit
+void track_heap_growth(ProcessStats *stats, int is_mmap, void *addr, size_t size) {
+    HeapGrowth *growth = slab_alloc(&stats->growth_slab);
+    if (!growth) return;
+
+    growth->seq = stats->event_seq;
+    growth->is_mmap = is_mmap;
+    growth->address = addr;
+    growth->size = size;
+    growth->next = NULL;
+
+    // Append so the list stays in timeline order
+    HeapGrowth **tail = &stats->pending_growth;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = growth;
+
+    if (is_mmap) {
+        stats->mmap_anon_allocations++;
+    } else {
+        stats->brk_extensions++;
+    }
+}
+
+static void charge_site(ProcessStats *stats, void *site, size_t size, HeapGrowth *growth) {
+    AllocSite *entry = get_alloc_site(stats, site);
+    if (!entry) return;
+
+    if (growth->is_mmap) {
+        entry->mmap_allocations++;
+        entry->mmap_bytes += growth->size;
+    } else {
+        entry->brk_extensions++;
+        entry->brk_bytes += growth->size;
+    }
+    if (size > entry->largest_trigger) {
+        entry->largest_trigger = size;
+    }
+    stats->growth_attributed_bytes += growth->size;
+}
+
+// Called for every ALLOC as it is parsed, before it goes to a shard
+void attribute_heap_growth(ProcessStats *stats, void *address, size_t size, void *site) {
+    HeapGrowth **current = &stats->pending_growth;
+
+    while (*current) {
+        HeapGrowth *growth = *current;
+        char *start = growth->address;
+        char *addr = address;
+        int claimed = 0;
+        int expired = 0;
+
+        if (growth->is_mmap && addr >= start && addr < start + growth->size) {
+            // Chunk lives inside the mapping - mmap-threshold allocation
+            claimed = 1;
+        } else if (!growth->is_mmap && addr < start + growth->size && addr + size > start) {
+            // Chunk reaches into the new heap - this malloc extended it. It
+            // may start below the old break, carved from what was left of top.
+            claimed = 1;
+        } else if (stats->event_seq - growth->seq > GROWTH_PENDING_WINDOW) {
+            // Nobody allocated from it: mapped directly, or the break was
+            // moved by ld.so or sbrk() rather than by another thread's malloc
+            expired = 1;
+        }
+
+        if (claimed || expired) {
+            if (claimed) {
+                charge_site(stats, site, size, growth);
+            } else {
+                stats->growth_unattributed_bytes += growth->size;
+            }
+            *current = growth->next;
+            slab_free(&stats->growth_slab, growth);
+            continue;
+        }
+        current = &growth->next;
+    }
+}
+
+static int compare_growth_sites(const void *a, const void *b) {
+    const AllocSite *sa = *(const AllocSite * const *)a;
+    const AllocSite *sb = *(const AllocSite * const *)b;
+    size_t ga = sa->brk_bytes + sa->mmap_bytes;
+    size_t gb = sb->brk_bytes + sb->mmap_bytes;
+
+    if (ga < gb) return 1;
+    if (ga > gb) return -1;
+    return 0;
+}
+
+void report_heap_growth(ProcessStats *stats) {
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           HEAP GROWTH ATTRIBUTION                     ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    // Anything still pending never found its malloc
+    size_t unattributed = stats->growth_unattributed_bytes;
+    HeapGrowth *growth = stats->pending_growth;
+    while (growth) {
+        unattributed += growth->size;
+        growth = growth->next;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+
+    printf("%sOS-Level Growth:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  brk extensions:        %zu\n", stats->brk_extensions);
+    printf("  Anonymous mmaps:       %zu\n", stats->mmap_anon_allocations);
+    printf("  Attributed to malloc:  %zu bytes (%.2f KB)\n",
+           stats->growth_attributed_bytes, stats->growth_attributed_bytes / 1024.0);
+    printf("  Unattributed:          %zu bytes (%.2f KB)\n",
+           unattributed, unattributed / 1024.0);
+    printf("  Est. page faults:      %zu %s(first touch of attributed growth)%s\n\n",
+           stats->growth_attributed_bytes / page_size, COLOR_CYAN, COLOR_RESET);
+
+    // Collect sites that caused any growth
+    size_t count = 0;
+    for (int i = 0; i < SITE_HASH_SIZE; i++) {
+        for (AllocSite *s = stats->alloc_sites[i]; s; s = s->next) {
+            if (s->brk_bytes + s->mmap_bytes > 0) count++;
+        }
+    }
+
+    if (count == 0) {
+        printf("  %sNo heap growth was triggered by malloc calls%s\n",
+               COLOR_GREEN, COLOR_RESET);
+        return;
+    }
+
+    AllocSite **sites = malloc(count * sizeof(AllocSite*));
+    if (!sites) return;
+
+    size_t n = 0;
+    for (int i = 0; i < SITE_HASH_SIZE; i++) {
+        for (AllocSite *s = stats->alloc_sites[i]; s; s = s->next) {
+            if (s->brk_bytes + s->mmap_bytes > 0) sites[n++] = s;
+        }
+    }
+    qsort(sites, n, sizeof(AllocSite*), compare_growth_sites);
+
+    printf("%sTop Growth Sites:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %-18s %-6s %-11s %-11s %-12s %-10s\n",
+           "CALL SITE", "BRK", "BRK(KB)", "MMAP(KB)", "LARGEST REQ", "EST.FAULTS");
+    printf("  ---------------------------------------------------------------------\n");
+
+    for (size_t i = 0; i < n && i < MAX_GROWTH_SITES_SHOWN; i++) {
+        AllocSite *s = sites[i];
+        char site[128];
+        printf("  %-18s %-6zu %-11.2f %-11.2f %-12zu %-10zu\n",
+               format_site(stats, s->site, site, sizeof(site)),
+               s->brk_extensions,
+               s->brk_bytes / 1024.0,
+               s->mmap_bytes / 1024.0,
+               s->largest_trigger,
+               (s->brk_bytes + s->mmap_bytes) / page_size);
+    }
+
+    if (n > MAX_GROWTH_SITES_SHOWN) {
+        printf("  ... %zu more site(s)\n", n - MAX_GROWTH_SITES_SHOWN);
+    }
+
+    free(sites);
+}
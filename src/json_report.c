@@ -0,0 +1,661 @@
+#include "../include/oswatch.h"
+
+// --format=json
+//
+// The same figures as the text report, streamed through the JSON writer
+// as they are read from the trackers. Schema (version JSON_SCHEMA_VERSION):
+// fields are only ever added within a version; renaming, removing or
+// changing the meaning of one bumps it. Times are milliseconds, sizes are
+// bytes, addresses are "0x..." strings. Sections for options that were
+// not given (startup, locks, threads, injection, budgets) are null. The "verdict"
+// object is what a CI gate should read.
+
+static void write_site(JsonWriter *w, ProcessStats *stats, const char *key, void *site) {
+    char buf[128];
+    json_string(w, key, site ? format_site(stats, site, buf, sizeof(buf)) : NULL);
+}
+
+static void write_process(JsonWriter *w, ProcessStats *stats) {
+    json_begin_object(w, "process");
+    json_int(w, "pid", stats->pid);
+    json_string(w, "name", stats->process_name);
+    json_string(w, "mode", stats->no_ptrace ? "no-ptrace" : "ptrace");
+    json_double(w, "execution_time_ms", stats->execution_time_ms);
+    json_end_object(w);
+}
+
+static void write_syscalls(JsonWriter *w, ProcessStats *stats) {
+    json_begin_object(w, "syscalls");
+    json_uint(w, "total", stats->total_syscalls);
+    json_double(w, "time_ms", stats->total_syscall_time_ms);
+    json_uint(w, "failed", stats->failed_syscalls);
+    json_double(w, "failed_time_ms", stats->failed_time_ms);
+
+    json_begin_array(w, "counts");
+    for (int nr = 0; nr < MAX_SYSCALL_NUM; nr++) {
+        if (stats->syscall_counts[nr] == 0) continue;
+        json_begin_object(w, NULL);
+        json_int(w, "nr", nr);
+        json_string(w, "name", get_syscall_name(nr));
+        json_uint(w, "count", stats->syscall_counts[nr]);
+
+        // Calls still inside the syscall at exit have no latency yet
+        LatencyHistogram *h = stats->syscall_latency[nr];
+        json_double(w, "time_ms", h ? h->total_ms : 0);
+        if (h) {
+            json_double(w, "p50", latency_quantile(h->counts, 0.5));
+            json_double(w, "p99", latency_quantile(h->counts, 0.99));
+        } else {
+            json_string(w, "p50", NULL);
+            json_string(w, "p99", NULL);
+        }
+        json_end_object(w);
+    }
+    json_end_array(w);
+
+    json_begin_array(w, "failures");
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (SyscallFailure *f = stats->failures[i]; f; f = f->next) {
+            json_begin_object(w, NULL);
+            json_string(w, "syscall", get_syscall_name(f->syscall_num));
+            json_string(w, "errno", error_name(f->error));
+            json_uint(w, "count", f->count);
+            json_double(w, "time_ms", f->time_ms);
+            json_end_object(w);
+        }
+    }
+    json_end_array(w);
+
+    json_begin_array(w, "failed_paths");
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (FailedPath *p = stats->failed_paths[i]; p; p = p->next) {
+            json_begin_object(w, NULL);
+            json_string(w, "path", p->path);
+            json_string(w, "syscall", get_syscall_name(p->syscall_num));
+            json_string(w, "errno", error_name(p->error));
+            json_uint(w, "count", p->count);
+            json_double(w, "time_ms", p->time_ms);
+            json_end_object(w);
+        }
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_cpu(JsonWriter *w, ProcessStats *stats) {
+    PerfCounters *perf = &stats->perf;
+    struct rusage *ru = &stats->tracee_rusage;
+
+    json_begin_object(w, "cpu");
+    if (perf->reads > 0) {
+        json_begin_object(w, "perf");
+        json_double(w, "task_clock_ms", perf->values[COUNTER_TASK_CLOCK] / 1e6);
+        json_uint(w, "minor_faults", perf->values[COUNTER_MINOR_FAULTS]);
+        json_uint(w, "major_faults", perf->values[COUNTER_MAJOR_FAULTS]);
+        json_uint(w, "context_switches", perf->values[COUNTER_CONTEXT_SWITCHES]);
+        json_uint(w, "cpu_migrations", perf->values[COUNTER_CPU_MIGRATIONS]);
+        json_bool(w, "user_only", perf->user_only);
+        json_end_object(w);
+    } else {
+        json_string(w, "perf", NULL);
+    }
+    if (stats->have_rusage) {
+        json_begin_object(w, "rusage");
+        json_double(w, "user_ms", timeval_ms(&ru->ru_utime));
+        json_double(w, "sys_ms", timeval_ms(&ru->ru_stime));
+        json_int(w, "max_rss_kb", ru->ru_maxrss);
+        json_int(w, "minor_faults", ru->ru_minflt);
+        json_int(w, "major_faults", ru->ru_majflt);
+        json_int(w, "voluntary_switches", ru->ru_nvcsw);
+        json_int(w, "involuntary_switches", ru->ru_nivcsw);
+        json_end_object(w);
+    } else {
+        json_string(w, "rusage", NULL);
+    }
+    json_end_object(w);
+}
+
+// mmap/brk level figures
+static void write_memory(JsonWriter *w, ProcessStats *stats) {
+    json_begin_object(w, "memory");
+    json_uint(w, "heap_allocated", stats->heap_allocated);
+    json_uint(w, "heap_freed", stats->heap_freed);
+    json_uint(w, "mapped_total", stats->total_memory_allocated);
+    json_uint(w, "unmapped_total", stats->total_memory_freed);
+    json_uint(w, "mapped_current", stats->current_memory_usage);
+    json_uint(w, "mapped_peak", stats->peak_memory_usage);
+    json_uint(w, "invalid_unmaps", stats->double_free_count);
+
+    json_begin_array(w, "live_mappings");
+    for (MemoryBlock *b = stats->memory_blocks; b; b = b->next) {
+        json_begin_object(w, NULL);
+        json_pointer(w, "address", (unsigned long)b->address);
+        json_uint(w, "size", b->size);
+        json_string(w, "type", b->syscall_type);
+        json_end_object(w);
+    }
+    json_end_array(w);
+
+    json_begin_object(w, "growth");
+    json_uint(w, "brk_extensions", stats->brk_extensions);
+    json_uint(w, "mmap_anon_allocations", stats->mmap_anon_allocations);
+    json_uint(w, "attributed_bytes", stats->growth_attributed_bytes);
+    json_uint(w, "unattributed_bytes", stats->growth_unattributed_bytes);
+    json_end_object(w);
+    json_end_object(w);
+}
+
+static void write_malloc(JsonWriter *w, ProcessStats *stats, LeakSummary *leaks) {
+    static const char *class_names[LEAK_CLASSES] = { "user", "library", "reachable" };
+
+    size_t live_count = 0;
+    MallocBlock **live = collect_live_blocks(stats, &live_count);
+    summarize_leaks(stats, live, live_count, leaks);
+
+    size_t unknown_frees = 0;
+    for (int i = 0; i < stats->shard_count; i++) {
+        unknown_frees += stats->shards[i].unknown_frees;
+    }
+
+    json_begin_object(w, "malloc");
+    json_uint(w, "allocations", stats->malloc_allocations);
+    json_uint(w, "frees", stats->malloc_frees);
+    json_uint(w, "bytes_allocated", stats->malloc_bytes_allocated);
+    json_uint(w, "bytes_freed", stats->malloc_bytes_freed);
+    json_uint(w, "unknown_frees", unknown_frees);
+    json_int(w, "tracker_shards", stats->shard_count);
+
+    json_begin_object(w, "live_at_exit");
+    for (int c = 0; c < LEAK_CLASSES; c++) {
+        json_begin_object(w, class_names[c]);
+        json_uint(w, "blocks", leaks->blocks[c]);
+        json_uint(w, "bytes", leaks->bytes[c]);
+        json_end_object(w);
+    }
+    json_end_object(w);
+
+    // Only what the text report lists as leaks
+    json_begin_array(w, "leaks");
+    for (size_t i = 0; i < live_count; i++) {
+        MallocBlock *b = live[i];
+        if (classify_leak(stats, b) != LEAK_USER) continue;
+        json_begin_object(w, NULL);
+        json_pointer(w, "address", (unsigned long)b->address);
+        json_uint(w, "size", b->size);
+        write_site(w, stats, "site", b->site);
+        if (stats->leak_scan_done) {
+            json_string(w, "status", b->reach == REACH_INDIRECT ? "indirectly lost" : "definitely lost");
+        }
+        json_end_object(w);
+    }
+    json_end_array(w);
+    free(live);
+
+    if (stats->leak_scan_done) {
+        static const char *reach_names[REACH_STATES] = {
+            [REACH_REACHABLE] = "still_reachable",
+            [REACH_INDIRECT] = "indirectly_lost",
+            [REACH_DEFINITE] = "definitely_lost",
+        };
+        json_begin_object(w, "reachability");
+        json_int(w, "threads", stats->scan_threads);
+        json_uint(w, "bytes_read", stats->scan_bytes_read);
+        json_double(w, "time_ms", stats->scan_time_ms);
+        for (int r = 0; r < REACH_STATES; r++) {
+            if (!reach_names[r]) continue;
+            json_begin_object(w, reach_names[r]);
+            json_uint(w, "blocks", stats->reach_blocks[r]);
+            json_uint(w, "bytes", stats->reach_bytes[r]);
+            json_end_object(w);
+        }
+        json_end_object(w);
+    } else {
+        json_string(w, "reachability", NULL);
+    }
+
+    json_begin_array(w, "sites");
+    for (int i = 0; i < SITE_HASH_SIZE; i++) {
+        for (AllocSite *s = stats->alloc_sites[i]; s; s = s->next) {
+            json_begin_object(w, NULL);
+            write_site(w, stats, "site", s->site);
+            json_uint(w, "allocations", s->allocations);
+            json_uint(w, "bytes_allocated", s->bytes_allocated);
+            json_uint(w, "live_blocks", s->live_blocks);
+            json_uint(w, "live_bytes", s->live_bytes);
+            json_uint(w, "brk_extensions", s->brk_extensions);
+            json_uint(w, "brk_bytes", s->brk_bytes);
+            json_uint(w, "mmap_allocations", s->mmap_allocations);
+            json_uint(w, "mmap_bytes", s->mmap_bytes);
+            json_end_object(w);
+        }
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_io_pattern(JsonWriter *w, IoPattern *io) {
+    static const char *bucket_names[IO_SIZE_BUCKETS] = {
+        "lt_64", "lt_512", "lt_4k", "lt_64k", "lt_1m", "ge_1m"
+    };
+
+    json_string(w, "pattern", file_access_pattern(io));
+    json_uint(w, "reads", io->reads);
+    json_uint(w, "writes", io->writes);
+    json_int(w, "bytes_read", io->bytes_read);
+    json_int(w, "bytes_written", io->bytes_written);
+    json_uint(w, "sequential", io->sequential);
+    json_uint(w, "strided", io->strided);
+    json_uint(w, "random", io->random);
+    json_begin_object(w, "sizes");
+    for (int b = 0; b < IO_SIZE_BUCKETS; b++) {
+        json_uint(w, bucket_names[b], io->sizes[b]);
+    }
+    json_end_object(w);
+    json_uint(w, "tiny_writes", io->tiny_writes);
+    json_uint(w, "tiny_run_max", io->tiny_run_max);
+    json_uint(w, "rereads", io->rereads);
+    json_int(w, "reread_bytes", io->reread_bytes);
+    json_uint(w, "fsyncs", io->fsyncs);
+    json_uint(w, "fsyncs_per_write", io->fsyncs_per_write);
+}
+
+static void write_files(JsonWriter *w, ProcessStats *stats) {
+    json_begin_object(w, "files");
+    json_int(w, "opened", stats->files_opened);
+    json_int(w, "closed", stats->files_closed);
+
+    json_begin_array(w, "open_at_exit");
+    for (FileDescriptor *f = stats->open_files; f; f = f->next) {
+        if (f->sock) continue;
+        json_begin_object(w, NULL);
+        json_int(w, "fd", f->fd);
+        json_int(w, "flags", f->flags);
+        json_int(w, "bytes_read", f->bytes_read);
+        json_int(w, "bytes_written", f->bytes_written);
+        json_string(w, "path", f->filename);
+        json_end_object(w);
+    }
+    json_end_array(w);
+
+    json_begin_array(w, "access");
+    for (int i = 0; i < FILE_ACCESS_HASH_SIZE; i++) {
+        for (FileAccess *a = stats->file_access[i]; a; a = a->next) {
+            json_begin_object(w, NULL);
+            json_string(w, "path", a->filename);
+            json_uint(w, "opens", a->opens);
+            write_io_pattern(w, &a->io);
+            json_end_object(w);
+        }
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_sockets(JsonWriter *w, ProcessStats *stats) {
+    json_begin_object(w, "sockets");
+    json_int(w, "opened", stats->sockets_opened);
+    json_int(w, "closed", stats->sockets_closed);
+
+    json_begin_array(w, "endpoints");
+    for (int i = 0; i < SOCKET_HASH_SIZE; i++) {
+        for (SocketEndpoint *e = stats->socket_endpoints[i]; e; e = e->next) {
+            json_begin_object(w, NULL);
+            json_string(w, "endpoint", e->endpoint);
+            json_string(w, "role", socket_role_name(e->role));
+            json_uint(w, "sockets", e->sockets);
+            json_uint(w, "connects", e->connects);
+            json_uint(w, "failed_connects", e->failed_connects);
+            json_double(w, "connect_ms", e->connect_ms);
+            json_double(w, "connect_max_ms", e->connect_max_ms);
+            json_double(w, "lifetime_ms", e->lifetime_ms);
+            json_double(w, "lifetime_max_ms", e->lifetime_max_ms);
+            json_uint(w, "accepted", e->accepted);
+            json_uint(w, "msgs_sent", e->msgs_sent);
+            json_uint(w, "msgs_received", e->msgs_received);
+            json_int(w, "bytes_sent", e->bytes_sent);
+            json_int(w, "bytes_received", e->bytes_received);
+            json_end_object(w);
+        }
+    }
+    json_end_array(w);
+
+    json_begin_array(w, "open_at_exit");
+    for (FileDescriptor *f = stats->open_files; f; f = f->next) {
+        if (!f->sock) continue;
+        json_begin_object(w, NULL);
+        json_int(w, "fd", f->fd);
+        json_string(w, "role", socket_role_name(f->sock->role));
+        json_string(w, "endpoint", socket_endpoint_name(stats, f->sock));
+        json_int(w, "bytes_sent", f->sock->bytes_sent);
+        json_int(w, "bytes_received", f->sock->bytes_received);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_startup(JsonWriter *w, ProcessStats *stats) {
+    StartupProfile *sp = &stats->startup;
+
+    if (!sp->enabled || sp->exec_time.tv_sec == 0) {
+        json_string(w, "startup", NULL);
+        return;
+    }
+
+    json_begin_object(w, "startup");
+    json_double(w, "exec_ms", calculate_time_diff(&stats->start_time, &sp->exec_time));
+    json_string(w, "target", sp->target);
+    json_bool(w, "reached_target", sp->reached_main);
+    json_double(w, "exec_to_target_ms",
+                calculate_time_diff(&sp->exec_time, sp->reached_main ? &sp->main_time : &sp->last_event));
+    json_uint(w, "syscalls", sp->syscalls);
+    json_double(w, "syscall_ms", sp->syscall_ms);
+    json_begin_array(w, "libraries");
+    for (int i = 0; i < sp->lib_count; i++) {
+        StartupLibrary *l = &sp->libs[i];
+        json_begin_object(w, NULL);
+        json_string(w, "name", l->name);
+        json_string(w, "path", l->path);
+        json_uint(w, "syscalls", l->syscalls);
+        json_uint(w, "probes", l->probes);
+        json_double(w, "syscall_ms", l->syscall_ms);
+        json_double(w, "wall_ms", l->wall_ms);
+        json_uint(w, "mapped_bytes", l->mapped_bytes);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_locks(JsonWriter *w, ProcessStats *stats) {
+    if (!stats->lock_profile) {
+        json_string(w, "locks", NULL);
+        return;
+    }
+
+    json_begin_object(w, "locks");
+    json_uint(w, "events", stats->lock_events);
+    if (stats->no_ptrace) {
+        json_string(w, "futex", NULL);
+    } else {
+        json_begin_object(w, "futex");
+        json_uint(w, "calls", stats->futex_calls);
+        json_double(w, "time_ms", stats->futex_time_ms);
+        json_end_object(w);
+    }
+    json_begin_array(w, "contended");
+    for (int i = 0; i < LOCK_HASH_SIZE; i++) {
+        for (LockStat *l = stats->locks[i]; l; l = l->next) {
+            size_t futex_calls = 0;
+            double futex_ms = lock_futex_ms(stats, l, &futex_calls);
+
+            json_begin_object(w, NULL);
+            json_pointer(w, "address", l->addr);
+            json_string(w, "kind", lock_kind_name(l->kind));
+            json_uint(w, "waits", l->waits);
+            json_uint(w, "read_waits", l->read_waits);
+            json_uint(w, "busy_trylocks", l->busy);
+            json_double(w, "wait_ms", l->wait_ns / 1e6);
+            json_double(w, "max_wait_ms", l->max_ns / 1e6);
+            json_begin_array(w, "histogram");
+            for (int b = 0; b < LOCK_WAIT_BUCKETS; b++) {
+                json_uint(w, NULL, l->hist[b]);
+            }
+            json_end_array(w);
+            json_uint(w, "futex_calls", futex_calls);
+            json_double(w, "futex_ms", futex_ms);
+            json_begin_array(w, "sites");
+            for (LockSite *s = l->sites; s; s = s->next) {
+                json_begin_object(w, NULL);
+                write_site(w, stats, "site", s->site);
+                json_uint(w, "waits", s->waits);
+                json_uint(w, "busy_trylocks", s->busy);
+                json_double(w, "wait_ms", s->wait_ns / 1e6);
+                json_end_object(w);
+            }
+            json_end_array(w);
+            json_end_object(w);
+        }
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_threads(JsonWriter *w, ProcessStats *stats) {
+    static const char *state_keys[THREAD_STATES] = {
+        "running", "sleeping", "disk", "stopped", "other"
+    };
+    SchedSampler *s = &stats->sched;
+
+    if (!s->enabled) {
+        json_string(w, "threads", NULL);
+        return;
+    }
+
+    json_begin_object(w, "threads");
+    json_int(w, "interval_ms", s->interval_ms);
+    json_uint(w, "samples", s->samples);
+    json_int(w, "cpus", s->cpus);
+    json_double(w, "runnable_avg", s->samples ? (double)s->runnable_sum / s->samples : 0.0);
+    json_int(w, "runnable_peak", s->runnable_peak);
+    json_uint(w, "untracked", s->threads_missed);
+    json_begin_array(w, "list");
+    for (int i = 0; i < s->thread_count; i++) {
+        SchedThread *t = &s->threads[i];
+        if (t->samples == 0) continue;
+        json_begin_object(w, NULL);
+        json_int(w, "tid", t->tid);
+        json_string(w, "name", t->name);
+        json_double(w, "on_cpu_ms", t->run_ns / 1e6);
+        json_double(w, "runqueue_ms", t->wait_ns / 1e6);
+        json_double(w, "off_cpu_ms", sched_off_cpu_ms(t));
+        json_uint(w, "voluntary_switches", t->voluntary);
+        json_uint(w, "involuntary_switches", t->involuntary);
+        json_begin_object(w, "states");
+        for (int st = 0; st < THREAD_STATES; st++) {
+            json_uint(w, state_keys[st], t->states[st]);
+        }
+        json_end_object(w);
+        json_begin_array(w, "blocked_in");
+        for (int b = 0; b < SCHED_BLOCKED_SLOTS && t->blocked[b].samples > 0; b++) {
+            json_begin_object(w, NULL);
+            json_string(w, "syscall", get_syscall_name(t->blocked[b].syscall));
+            json_uint(w, "samples", t->blocked[b].samples);
+            json_end_object(w);
+        }
+        json_end_array(w);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_injection(JsonWriter *w, ProcessStats *stats) {
+    static const char *action_names[] = { "delay", "error", "short" };
+    FaultInjector *fi = &stats->inject;
+
+    if (fi->count == 0) {
+        json_string(w, "injection", NULL);
+        return;
+    }
+
+    json_begin_object(w, "injection");
+    json_uint(w, "seed", fi->seed);
+    json_begin_array(w, "rules");
+    for (int i = 0; i < fi->count; i++) {
+        InjectRule *r = &fi->rules[i];
+        json_begin_object(w, NULL);
+        json_string(w, "spec", r->spec);
+        json_string(w, "syscall", get_syscall_name(r->nr));
+        json_string(w, "action", action_names[r->action]);
+        json_string(w, "error", r->action == INJECT_ERROR ? error_name(r->error) : NULL);
+        json_double(w, "probability", r->probability);
+        json_uint(w, "matched", r->matched);
+        json_uint(w, "injected", r->injected);
+        json_double(w, "delay_ms", r->delay_total_ms);
+        json_uint(w, "bytes_withheld", r->bytes_withheld);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_budgets(JsonWriter *w, ProcessStats *stats) {
+    BudgetWatch *b = &stats->budget;
+
+    if (!b->enabled) {
+        json_string(w, "budgets", NULL);
+        return;
+    }
+
+    json_begin_object(w, "budgets");
+    json_string(w, "action", b->action == BUDGET_STOP ? "stop" : "kill");
+    json_string(w, "tripped", b->tripped ? budget_metric_name(b->tripped - 1) : NULL);
+    json_begin_array(w, "limits");
+    for (int m = 0; m < BUDGET_METRICS; m++) {
+        BudgetLimit *l = &b->limits[m];
+        if (!l->soft && !l->hard) continue;
+
+        json_begin_object(w, NULL);
+        json_string(w, "metric", budget_metric_name(m));
+        json_uint(w, "soft", l->soft);
+        json_uint(w, "hard", l->hard);
+        json_uint(w, "peak", l->peak);
+        if (l->soft_at_ms >= 0) {
+            json_double(w, "soft_crossed_ms", l->soft_at_ms);
+        } else {
+            json_string(w, "soft_crossed_ms", NULL);
+        }
+        if (l->hard_at_ms >= 0) {
+            json_double(w, "hard_crossed_ms", l->hard_at_ms);
+        } else {
+            json_string(w, "hard_crossed_ms", NULL);
+        }
+        json_begin_array(w, "top_sites");
+        for (int i = 0; i < l->site_count; i++) {
+            json_begin_object(w, NULL);
+            json_string(w, "site", l->sites[i].name);
+            json_uint(w, "live_bytes", l->sites[i].live_bytes);
+            json_uint(w, "live_blocks", l->sites[i].live_blocks);
+            json_end_object(w);
+        }
+        json_end_array(w);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_tracer(JsonWriter *w, ProcessStats *stats) {
+    TracerOverhead *ov = &stats->overhead;
+
+    json_begin_object(w, "tracer");
+    json_uint(w, "ptrace_stops", ov->ptrace_stops);
+    json_double(w, "waitpid_ms", ov->waitpid_ms);
+    json_double(w, "getregs_ms", ov->getregs_ms);
+    json_double(w, "stopped_ms", ov->stopped_ms);
+    json_uint(w, "events_ingested", ov->events_ingested);
+    json_double(w, "ingest_ms", ov->ingest_ms);
+    json_uint(w, "pipe_backlog_peak", ov->pipe_backlog_peak);
+    json_uint(w, "events_dropped", ov->events_dropped);
+    json_uint(w, "interceptor_events", ov->interceptor_events);
+    json_uint(w, "interceptor_dropped", ov->interceptor_dropped);
+    json_double(w, "interceptor_ms", ov->interceptor_ms);
+    json_end_object(w);
+}
+
+static void write_baseline(JsonWriter *w, ProcessStats *stats) {
+    static const char *unit_names[] = { "count", "ms", "bytes", "kB" };
+    BaselineDiff *diff = &stats->baseline;
+
+    if (!diff->path) {
+        json_string(w, "baseline", NULL);
+        return;
+    }
+
+    json_begin_object(w, "baseline");
+    json_string(w, "path", diff->path);
+    json_bool(w, "compared", diff->compared);
+    json_bool(w, "saved", diff->saved);
+    json_uint(w, "runs", diff->base_runs);
+    json_double(w, "threshold_pct", diff->threshold_pct);
+    json_double(w, "threshold_ms", diff->threshold_ms);
+    json_int(w, "regressions", diff->regressions);
+    json_begin_array(w, "deltas");
+    for (int i = 0; i < diff->delta_count; i++) {
+        ProfileDelta *d = &diff->deltas[i];
+        json_begin_object(w, NULL);
+        json_string(w, "metric", d->what);
+        json_string(w, "unit", unit_names[d->unit]);
+        json_double(w, "before", d->before);
+        json_double(w, "after", d->after);
+        if (d->before > 0) {
+            json_double(w, "change_pct", (d->after - d->before) / d->before * 100.0);
+        } else {
+            json_string(w, "change_pct", NULL);
+        }
+        json_bool(w, "regression", d->regression);
+        json_bool(w, "gated", d->gated);
+        json_end_object(w);
+    }
+    json_end_array(w);
+    json_end_object(w);
+}
+
+static void write_verdict(JsonWriter *w, ProcessStats *stats, LeakSummary *leaks) {
+    int fd_leaks = stats->files_opened - stats->files_closed;
+    int socket_leaks = stats->sockets_opened - stats->sockets_closed;
+
+    json_begin_object(w, "verdict");
+    json_uint(w, "user_leaks", leaks->blocks[LEAK_USER]);
+    json_uint(w, "user_leaked_bytes", leaks->bytes[LEAK_USER]);
+    json_int(w, "fd_leaks", fd_leaks > 0 ? fd_leaks : 0);
+    json_int(w, "socket_leaks", socket_leaks > 0 ? socket_leaks : 0);
+    json_bool(w, "leak_free", leaks->blocks[LEAK_USER] == 0 && fd_leaks <= 0 && socket_leaks <= 0);
+    json_bool(w, "budget_exceeded", stats->budget.tripped != 0);
+    json_end_object(w);
+}
+
+int generate_json_report(ProcessStats *stats) {
+    FILE *out = stdout;
+    if (stats->report_path) {
+        out = fopen(stats->report_path, "w");
+        if (!out) {
+            fprintf(stderr, "%sError: Cannot write %s: %s%s\n",
+                    COLOR_RED, stats->report_path, strerror(errno), COLOR_RESET);
+            return -1;
+        }
+    }
+
+    JsonWriter w;
+    LeakSummary leaks;
+    json_init(&w, out);
+
+    json_begin_object(&w, NULL);
+    json_string(&w, "schema", "oswatch-report");
+    json_int(&w, "version", JSON_SCHEMA_VERSION);
+    write_process(&w, stats);
+    write_syscalls(&w, stats);
+    write_cpu(&w, stats);
+    write_memory(&w, stats);
+    write_malloc(&w, stats, &leaks);
+    write_files(&w, stats);
+    write_sockets(&w, stats);
+    write_startup(&w, stats);
+    write_locks(&w, stats);
+    write_threads(&w, stats);
+    write_injection(&w, stats);
+    write_budgets(&w, stats);
+    write_tracer(&w, stats);
+    write_baseline(&w, stats);
+    write_verdict(&w, stats, &leaks);
+    json_end_object(&w);
+
+    int failed = ferror(out);
+    if (out != stdout) {
+        failed |= fclose(out) != 0;
+    } else {
+        fflush(out);
+    }
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,109 @@
+#include "../include/oswatch.h"
+#include <math.h>
+
+// Streaming JSON writer
+//
+// Every value is written to the FILE as soon as it is produced; the only
+// state is one member count per open object/array, so a report with a
+// million leaked blocks costs no more memory than one with none.
+// Members are indented two spaces per level so reports diff cleanly.
+
+void json_init(JsonWriter *w, FILE *out) {
+    memset(w, 0, sizeof(JsonWriter));
+    w->out = out;
+}
+
+// Separator, indentation and "key": for the next member
+static void json_member(JsonWriter *w, const char *key) {
+    if (w->depth > 0) {
+        fputs(w->count[w->depth - 1]++ ? ",\n" : "\n", w->out);
+        fprintf(w->out, "%*s", w->depth * 2, "");
+    }
+    if (key) {
+        json_write_string(w, key);
+        fputs(": ", w->out);
+    }
+}
+
+void json_write_string(JsonWriter *w, const char *text) {
+    fputc('"', w->out);
+    for (const unsigned char *p = (const unsigned char*)text; *p; p++) {
+        switch (*p) {
+            case '"':  fputs("\\\"", w->out); break;
+            case '\\': fputs("\\\\", w->out); break;
+            case '\n': fputs("\\n", w->out); break;
+            case '\t': fputs("\\t", w->out); break;
+            case '\r': fputs("\\r", w->out); break;
+            default:
+                if (*p < 0x20) {
+                    fprintf(w->out, "\\u%04x", *p);
+                } else {
+                    fputc(*p, w->out);
+                }
+        }
+    }
+    fputc('"', w->out);
+}
+
+static void json_open(JsonWriter *w, const char *key, char bracket) {
+    json_member(w, key);
+    fputc(bracket, w->out);
+    if (w->depth < JSON_MAX_DEPTH) {
+        w->count[w->depth] = 0;
+    }
+    w->depth++;
+}
+
+static void json_close(JsonWriter *w, char bracket) {
+    w->depth--;
+    if (w->depth < JSON_MAX_DEPTH && w->count[w->depth] > 0) {
+        fprintf(w->out, "\n%*s", w->depth * 2, "");
+    }
+    fputc(bracket, w->out);
+    if (w->depth == 0) fputc('\n', w->out);
+}
+
+void json_begin_object(JsonWriter *w, const char *key) { json_open(w, key, '{'); }
+void json_end_object(JsonWriter *w)                    { json_close(w, '}'); }
+void json_begin_array(JsonWriter *w, const char *key)  { json_open(w, key, '['); }
+void json_end_array(JsonWriter *w)                     { json_close(w, ']'); }
+
+void json_string(JsonWriter *w, const char *key, const char *value) {
+    json_member(w, key);
+    if (value) {
+        json_write_string(w, value);
+    } else {
+        fputs("null", w->out);
+    }
+}
+
+void json_int(JsonWriter *w, const char *key, long long value) {
+    json_member(w, key);
+    fprintf(w->out, "%lld", value);
+}
+
+void json_uint(JsonWriter *w, const char *key, unsigned long long value) {
+    json_member(w, key);
+    fprintf(w->out, "%llu", value);
+}
+
+// Millisecond figures and ratios; NaN/inf have no JSON form
+void json_double(JsonWriter *w, const char *key, double value) {
+    json_member(w, key);
+    if (isfinite(value)) {
+        fprintf(w->out, "%.3f", value);
+    } else {
+        fputs("null", w->out);
+    }
+}
+
+void json_bool(JsonWriter *w, const char *key, int value) {
+    json_member(w, key);
+    fputs(value ? "true" : "false", w->out);
+}
+
+// Addresses go out as "0x..." strings - JSON numbers lose precision past 2^53
+void json_pointer(JsonWriter *w, const char *key, unsigned long value) {
+    json_member(w, key);
+    fprintf(w->out, "\"0x%lx\"", value);
+}
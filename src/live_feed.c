@@ -0,0 +1,219 @@
+#include "../include/oswatch.h"
+#include <stddef.h>
+
+// Live snapshots (--metrics, --top)
+//
+// The live views run on threads of their own and must never take the
+// stats lock, so whichever tracer thread holds it copies what they show
+// into a LiveSnapshot at most every LIVE_PUBLISH_INTERVAL_MS (the ingest
+// thread wakes that often, so a tracee parked in a syscall still gets
+// fresh numbers). Each reader owns a SnapshotBuffer: the tracer fills one
+// slot, the reader holds another and the newest complete one sits in
+// between. Handing a slot over in either direction is one atomic
+// exchange on `middle`, so neither side ever waits.
+//
+// Latency histograms are folded into decade buckets. A fine bucket counts
+// under the first bound its upper edge fits in, so each count is exact
+// for "at most le" and may trail the true value by part of one bucket.
+
+#define SNAPSHOT_FRESH 4
+#define MAPS_REFRESH_MS 1000.0     // Re-read /proc/<pid>/maps for unnamed sites
+
+static const double bound_ms[LIVE_LATENCY_BOUNDS] = {
+    0.01, 0.1, 1, 10, 100, 1000, 10000
+};
+
+// Which decade bound each fine histogram bucket falls under
+static int bucket_bound[LATENCY_BUCKETS];
+
+int snapshot_buffer_init(SnapshotBuffer *b) {
+    b->slots = calloc(3, sizeof(LiveSnapshot));
+    if (!b->slots) return -1;
+    b->back = 0;
+    b->middle = 1;
+    b->front = 2;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        double limit = latency_bucket_limit_ms(i);
+        int bound = 0;
+        while (bound < LIVE_LATENCY_BOUNDS && limit > bound_ms[bound]) bound++;
+        bucket_bound[i] = bound;
+    }
+    return 0;
+}
+
+void snapshot_buffer_free(SnapshotBuffer *b) {
+    free(b->slots);
+    b->slots = NULL;
+}
+
+// Tracer side: hand the filled slot over and take back whichever was there
+static void snapshot_put(SnapshotBuffer *b) {
+    int previous = __atomic_exchange_n(&b->middle, b->back | SNAPSHOT_FRESH, __ATOMIC_ACQ_REL);
+    b->back = previous & ~SNAPSHOT_FRESH;
+}
+
+// Reader side: the newest snapshot, or the one already held
+LiveSnapshot* snapshot_take(SnapshotBuffer *b) {
+    if (__atomic_load_n(&b->middle, __ATOMIC_ACQUIRE) & SNAPSHOT_FRESH) {
+        int previous = __atomic_exchange_n(&b->middle, b->front, __ATOMIC_ACQ_REL);
+        b->front = previous & ~SNAPSHOT_FRESH;
+    }
+    return &b->slots[b->front];
+}
+
+// Before the tracee starts; readers are fixed from then on
+void live_feed_attach(ProcessStats *stats, SnapshotBuffer *b, int want_sites) {
+    LiveFeed *feed = &stats->live;
+    if (feed->reader_count == LIVE_MAX_READERS) return;
+    feed->readers[feed->reader_count++] = b;
+    if (want_sites) feed->want_sites = 1;
+}
+
+static void fill_syscall(LiveSyscall *out, int nr, size_t calls, LatencyHistogram *h) {
+    memset(out, 0, sizeof(*out));
+    out->nr = nr;
+    out->calls = calls;
+    if (!h) return;
+
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        out->buckets[bucket_bound[b]] += h->counts[b];
+    }
+    for (int i = 1; i <= LIVE_LATENCY_BOUNDS; i++) {
+        out->buckets[i] += out->buckets[i - 1];
+    }
+    out->timed = out->buckets[LIVE_LATENCY_BOUNDS];
+    out->seconds = h->total_ms / 1000.0;
+}
+
+static int compare_live_sites(const void *a, const void *b) {
+    const LiveSite *sa = a;
+    const LiveSite *sb = b;
+    if (sa->live_bytes < sb->live_bytes) return 1;
+    if (sa->live_bytes > sb->live_bytes) return -1;
+    return 0;
+}
+
+// The same site can be hot in several shards; add those up
+static void gather_sites(ProcessStats *stats, LiveSnapshot *s, struct timespec *now) {
+    LiveSite merged[MAX_TRACKER_SHARDS * LIVE_TOP_SITES];
+    int count = 0;
+
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        for (int h = 0; h < shard->hot_count; h++) {
+            LiveSite *hot = &shard->hot[h];
+            int j = 0;
+            while (j < count && merged[j].site != hot->site) j++;
+            if (j == count) {
+                merged[count] = *hot;
+                count++;
+            } else {
+                merged[j].live_bytes += hot->live_bytes;
+                merged[j].live_blocks += hot->live_blocks;
+                merged[j].allocations += hot->allocations;
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    qsort(merged, count, sizeof(LiveSite), compare_live_sites);
+    if (count > LIVE_TOP_SITES) count = LIVE_TOP_SITES;
+
+    // Sites in code mapped since the last look need a fresh /proc read
+    LiveFeed *feed = &stats->live;
+    for (int i = 0; i < count; i++) {
+        if (!find_code_mapping(stats, merged[i].site) &&
+            calculate_time_diff(&feed->last_maps, now) >= MAPS_REFRESH_MS) {
+            snapshot_code_mappings(stats->pid, stats);
+            feed->last_maps = *now;
+        }
+        format_site(stats, merged[i].site, merged[i].name, sizeof(merged[i].name));
+    }
+
+    memcpy(s->sites, merged, count * sizeof(LiveSite));
+    s->site_count = count;
+}
+
+static void fill_snapshot(ProcessStats *stats, LiveSnapshot *s, struct timespec *now, double since) {
+    LiveFeed *feed = &stats->live;
+
+    s->taken = *now;
+    s->total_syscalls = stats->total_syscalls;
+    s->failed_syscalls = stats->failed_syscalls;
+    s->syscall_seconds = stats->total_syscall_time_ms / 1000.0;
+
+    // Shard totals belong to the workers; relaxed reads may trail by a batch
+    unsigned long long allocations = 0, frees = 0, allocated = 0, freed = 0, blocks = 0;
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+        allocations += __atomic_load_n(&shard->allocations, __ATOMIC_RELAXED);
+        frees += __atomic_load_n(&shard->frees, __ATOMIC_RELAXED);
+        allocated += __atomic_load_n(&shard->bytes_allocated, __ATOMIC_RELAXED);
+        freed += __atomic_load_n(&shard->bytes_freed, __ATOMIC_RELAXED);
+        blocks += __atomic_load_n(&shard->live_blocks, __ATOMIC_RELAXED);
+    }
+    s->malloc_allocations = allocations;
+    s->malloc_frees = frees;
+    s->malloc_bytes_allocated = allocated;
+    s->malloc_live_bytes = allocated > freed ? allocated - freed : 0;
+    s->malloc_live_blocks = blocks;
+
+    // The first snapshot has no previous one to measure against
+    s->allocation_rate = feed->publishes && since > 0 ?
+        (allocations - feed->last_allocations) * 1000.0 / since : 0;
+    feed->last_allocations = allocations;
+
+    s->open_files = stats->files_opened - stats->files_closed;
+    s->open_sockets = stats->sockets_opened - stats->sockets_closed;
+
+    // One read() per counter; inherited counters include live threads
+    read_perf_counters(stats);
+    s->counters_available = stats->perf.available;
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        s->counters[i] = stats->perf.values[i];
+    }
+
+    s->site_count = 0;
+    if (feed->want_sites) {
+        gather_sites(stats, s, now);
+    }
+
+    s->syscall_count = 0;
+    for (int nr = 0; nr < MAX_SYSCALL_NUM; nr++) {
+        if (stats->syscall_counts[nr] == 0) continue;
+        fill_syscall(&s->syscalls[s->syscall_count++], nr, stats->syscall_counts[nr],
+                     stats->syscall_latency[nr]);
+    }
+}
+
+// Rate-limited; the caller holds the stats lock
+void publish_live_snapshot(ProcessStats *stats) {
+    LiveFeed *feed = &stats->live;
+    if (feed->reader_count == 0) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double since = calculate_time_diff(&feed->last_publish, &now);
+    if (since < LIVE_PUBLISH_INTERVAL_MS) return;
+
+    // Half-filled batches would hold the heap numbers back indefinitely
+    flush_tracker_shards(stats);
+
+    SnapshotBuffer *first = feed->readers[0];
+    LiveSnapshot *s = &first->slots[first->back];
+    fill_snapshot(stats, s, &now, since);
+    check_budgets(stats, s);
+
+    size_t used = offsetof(LiveSnapshot, syscalls) + s->syscall_count * sizeof(LiveSyscall);
+    for (int i = 1; i < feed->reader_count; i++) {
+        SnapshotBuffer *b = feed->readers[i];
+        memcpy(&b->slots[b->back], s, used);
+        snapshot_put(b);
+    }
+    snapshot_put(first);
+
+    feed->last_publish = now;
+    feed->publishes++;
+}
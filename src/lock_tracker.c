@@ -0,0 +1,318 @@
+#include "../include/oswatch.h"
+#include <linux/futex.h>
+
+// Lock contention
+//
+// With --locks the interceptor wraps pthread mutexes, rwlocks and condvars.
+// Each acquisition tries the lock first; only when that fails is the
+// blocking wait timed and sent as "LOCK kind addr site ns". So everything
+// here is contended, aggregated per lock address and, under it, per call
+// site. The tracer separately times the main thread's futex waits by futex
+// word, which for a glibc mutex is the first word of the mutex itself, and
+// joins the two in the report.
+
+#define MAX_LOCKS_SHOWN 10
+#define MAX_SITES_SHOWN 3
+
+static const char *kind_names[LOCK_KINDS] = { "mutex", "rwlock", "condvar" };
+static const char *bucket_names[LOCK_WAIT_BUCKETS] = {
+    "<10us", "<100us", "<1ms", "<10ms", "<100ms", "100ms+"
+};
+
+const char* lock_kind_name(int kind) {
+    return kind >= 0 && kind < LOCK_KINDS ? kind_names[kind] : "?";
+}
+
+static unsigned int hash_lock(unsigned long addr) {
+    return (addr >> 3) % LOCK_HASH_SIZE;
+}
+
+static int wait_bucket(unsigned long long ns) {
+    int bucket = 0;
+    for (unsigned long long limit = 10000; bucket < LOCK_WAIT_BUCKETS - 1 && ns >= limit; limit *= 10) {
+        bucket++;
+    }
+    return bucket;
+}
+
+// Bytes of the pthread object, to match futex words that fall inside it
+static size_t lock_size(int kind) {
+    switch (kind) {
+        case LOCK_RWLOCK:  return sizeof(pthread_rwlock_t);
+        case LOCK_CONDVAR: return sizeof(pthread_cond_t);
+        default:           return sizeof(pthread_mutex_t);
+    }
+}
+
+static LockStat* get_lock(ProcessStats *stats, unsigned long addr, int kind) {
+    unsigned int idx = hash_lock(addr);
+
+    for (LockStat *l = stats->locks[idx]; l; l = l->next) {
+        if (l->addr == addr) return l;
+    }
+
+    LockStat *l = slab_alloc(&stats->lock_slab);
+    if (!l) return NULL;
+
+    memset(l, 0, sizeof(LockStat));
+    l->addr = addr;
+    l->kind = kind;
+    l->next = stats->locks[idx];
+    stats->locks[idx] = l;
+    return l;
+}
+
+static LockSite* get_lock_site(ProcessStats *stats, LockStat *l, void *site) {
+    for (LockSite *s = l->sites; s; s = s->next) {
+        if (s->site == site) return s;
+    }
+
+    LockSite *s = slab_alloc(&stats->lock_site_slab);
+    if (!s) return NULL;
+
+    memset(s, 0, sizeof(LockSite));
+    s->site = site;
+    s->next = l->sites;
+    l->sites = s;
+    return s;
+}
+
+// kind: M mutex, R/W rwlock read/write, C condvar wait; lower case m/r/w
+// is a trylock that found the lock held
+void track_lock_event(ProcessStats *stats, char kind, void *lock, void *site,
+                      unsigned long long wait_ns) {
+    int busy = kind >= 'a' && kind <= 'z';
+    int type;
+
+    switch (kind) {
+        case 'M': case 'm': type = LOCK_MUTEX; break;
+        case 'R': case 'r':
+        case 'W': case 'w': type = LOCK_RWLOCK; break;
+        case 'C':           type = LOCK_CONDVAR; break;
+        default: return;
+    }
+
+    stats->lock_events++;
+    LockStat *l = get_lock(stats, (unsigned long)lock, type);
+    if (!l) return;
+    LockSite *s = get_lock_site(stats, l, site);
+
+    if (busy) {
+        l->busy++;
+        if (s) s->busy++;
+        return;
+    }
+
+    l->waits++;
+    if (kind == 'R') l->read_waits++;
+    l->wait_ns += wait_ns;
+    if (wait_ns > l->max_ns) l->max_ns = wait_ns;
+    l->hist[wait_bucket(wait_ns)]++;
+    if (s) {
+        s->waits++;
+        s->wait_ns += wait_ns;
+    }
+}
+
+// futex(2) exit on the traced thread: remember blocking waits by word
+void track_futex_wait(ProcessStats *stats, struct user_regs_struct *regs, double duration) {
+    switch (regs->rsi & FUTEX_CMD_MASK) {
+        case FUTEX_WAIT:
+        case FUTEX_WAIT_BITSET:
+        case FUTEX_LOCK_PI:
+        case FUTEX_WAIT_REQUEUE_PI:
+            break;
+        default:
+            return;
+    }
+
+    stats->futex_calls++;
+    stats->futex_time_ms += duration;
+
+    unsigned long uaddr = regs->rdi;
+    unsigned int idx = hash_lock(uaddr);
+    FutexWait *w;
+    for (w = stats->futex_waits[idx]; w; w = w->next) {
+        if (w->uaddr == uaddr) break;
+    }
+    if (!w) {
+        w = slab_alloc(&stats->futex_slab);
+        if (!w) return;
+        memset(w, 0, sizeof(FutexWait));
+        w->uaddr = uaddr;
+        w->next = stats->futex_waits[idx];
+        stats->futex_waits[idx] = w;
+    }
+    w->calls++;
+    w->time_ms += duration;
+}
+
+// Traced futex time on the words inside a lock object
+double lock_futex_ms(ProcessStats *stats, LockStat *l, size_t *calls) {
+    double ms = 0;
+    size_t size = lock_size(l->kind);
+
+    for (unsigned long word = l->addr & ~3UL; word < l->addr + size; word += 4) {
+        for (FutexWait *w = stats->futex_waits[hash_lock(word)]; w; w = w->next) {
+            if (w->uaddr == word) {
+                ms += w->time_ms;
+                *calls += w->calls;
+            }
+        }
+    }
+    return ms;
+}
+
+static int compare_locks(const void *a, const void *b) {
+    const LockStat *la = *(const LockStat * const *)a;
+    const LockStat *lb = *(const LockStat * const *)b;
+
+    // Condvar waits are usually idle time, not contention - list them last
+    if ((la->kind == LOCK_CONDVAR) != (lb->kind == LOCK_CONDVAR)) {
+        return la->kind == LOCK_CONDVAR ? 1 : -1;
+    }
+    if (la->wait_ns < lb->wait_ns) return 1;
+    if (la->wait_ns > lb->wait_ns) return -1;
+    if (la->busy < lb->busy) return 1;
+    if (la->busy > lb->busy) return -1;
+    return 0;
+}
+
+static void print_lock(ProcessStats *stats, LockStat *l) {
+    char name[64];
+    size_t futex_calls = 0;
+    double futex_ms = lock_futex_ms(stats, l, &futex_calls);
+
+    if (l->kind == LOCK_RWLOCK) {
+        snprintf(name, sizeof(name), "rwlock (%zu rd)", l->read_waits);
+    } else {
+        snprintf(name, sizeof(name), "%s", kind_names[l->kind]);
+    }
+
+    printf("  0x%-14lx %-15s %-8zu %-12.3f %-10.2f %-10.3f ",
+           l->addr, name, l->waits, l->wait_ns / 1e6,
+           l->waits ? l->wait_ns / 1e3 / l->waits : 0.0, l->max_ns / 1e6);
+    if (futex_calls > 0) {
+        printf("%.3f (%zu)", futex_ms, futex_calls);
+    } else {
+        printf("-");
+    }
+    if (l->busy > 0) {
+        printf(" %s%zu trylock(s) busy%s", COLOR_YELLOW, l->busy, COLOR_RESET);
+    }
+    printf("\n");
+
+    if (l->waits > 0) {
+        printf("      wait:");
+        for (int b = 0; b < LOCK_WAIT_BUCKETS; b++) {
+            if (l->hist[b] > 0) printf(" %s %zu", bucket_names[b], l->hist[b]);
+        }
+        printf("\n");
+    }
+
+    // Busiest sites first; the lists are short, so select rather than sort
+    LockSite *shown[MAX_SITES_SHOWN];
+    int n = 0;
+    size_t site_count = 0;
+    for (LockSite *s = l->sites; s; s = s->next) site_count++;
+    while (n < MAX_SITES_SHOWN) {
+        LockSite *best = NULL;
+        for (LockSite *s = l->sites; s; s = s->next) {
+            int taken = 0;
+            for (int i = 0; i < n; i++) taken |= shown[i] == s;
+            if (taken) continue;
+            if (!best || s->wait_ns > best->wait_ns ||
+                (s->wait_ns == best->wait_ns && s->busy > best->busy)) {
+                best = s;
+            }
+        }
+        if (!best) break;
+        shown[n++] = best;
+
+        char site[128];
+        printf("      at %-32s %zu wait(s) %.3f ms",
+               format_site(stats, best->site, site, sizeof(site)),
+               best->waits, best->wait_ns / 1e6);
+        if (best->busy > 0) printf(", %zu busy", best->busy);
+        printf("\n");
+    }
+    if (site_count > (size_t)n) {
+        printf("      ... %zu more site(s)\n", site_count - n);
+    }
+}
+
+void report_locks(ProcessStats *stats) {
+    if (!stats->lock_profile) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           LOCK CONTENTION                             ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    size_t count = 0, waits[LOCK_KINDS] = {0}, busy = 0;
+    unsigned long long wait_ns[LOCK_KINDS] = {0};
+    for (int i = 0; i < LOCK_HASH_SIZE; i++) {
+        for (LockStat *l = stats->locks[i]; l; l = l->next) {
+            count++;
+            waits[l->kind] += l->waits;
+            wait_ns[l->kind] += l->wait_ns;
+            busy += l->busy;
+        }
+    }
+
+    if (count == 0) {
+        printf("  %sNo contended pthread locks%s\n", COLOR_GREEN, COLOR_RESET);
+        return;
+    }
+
+    printf("  Contended acquisitions: %zu mutex, %zu rwlock (%.3f ms waiting)\n",
+           waits[LOCK_MUTEX], waits[LOCK_RWLOCK],
+           (wait_ns[LOCK_MUTEX] + wait_ns[LOCK_RWLOCK]) / 1e6);
+    if (busy > 0) {
+        printf("  Failed trylocks:        %zu\n", busy);
+    }
+    if (waits[LOCK_CONDVAR] > 0) {
+        printf("  Condvar waits:          %zu (%.3f ms)\n",
+               waits[LOCK_CONDVAR], wait_ns[LOCK_CONDVAR] / 1e6);
+    }
+    printf("\n");
+
+    LockStat **locks = malloc(count * sizeof(LockStat*));
+    if (!locks) return;
+
+    size_t n = 0;
+    for (int i = 0; i < LOCK_HASH_SIZE; i++) {
+        for (LockStat *l = stats->locks[i]; l; l = l->next) locks[n++] = l;
+    }
+    qsort(locks, n, sizeof(LockStat*), compare_locks);
+
+    printf("%sMost Contended Locks:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %-16s %-15s %-8s %-12s %-10s %-10s %s\n",
+           "LOCK", "KIND", "WAITS", "WAIT(ms)", "AVG(us)", "MAX(ms)", "FUTEX(ms)");
+    printf("  ----------------------------------------------------------------------------------\n");
+    for (size_t i = 0; i < n && i < MAX_LOCKS_SHOWN; i++) {
+        print_lock(stats, locks[i]);
+    }
+    if (n > MAX_LOCKS_SHOWN) {
+        printf("  ... %zu more lock(s)\n", n - MAX_LOCKS_SHOWN);
+    }
+    free(locks);
+
+    // How much of the traced futex time the wrappers account for
+    if (stats->no_ptrace) {
+        printf("\n  (futex correlation needs ptrace; not available with --no-ptrace)\n");
+    } else if (stats->futex_calls > 0) {
+        size_t matched_calls = 0;
+        double matched_ms = 0;
+        for (int i = 0; i < LOCK_HASH_SIZE; i++) {
+            for (LockStat *l = stats->locks[i]; l; l = l->next) {
+                matched_ms += lock_futex_ms(stats, l, &matched_calls);
+            }
+        }
+        printf("\n  Main-thread futex waits: %zu call(s), %.3f ms; %zu call(s), %.3f ms on the locks above\n",
+               stats->futex_calls, stats->futex_time_ms, matched_calls, matched_ms);
+        printf("  (only the main thread is traced; FUTEX is that thread's time in the kernel)\n");
+    }
+}
@@ -13,11 +13,48 @@ void print_usage(char *program_name) {
     printf("Usage: %s [OPTIONS] <program> [program_args...]\n\n", program_name);
     printf("Options:\n");
     printf("  -v, --verbose     Show detailed system call information\n");
+    printf("  --log-file FILE   Write the verbose log to FILE instead of stdout (implies -v)\n");
+    printf("  --leak-check      Scan memory at exit to split leaks into lost/reachable\n");
+    printf("  --no-ptrace       Profile I/O through libc wrappers only (near-native speed)\n");
+    printf("  --startup         Break down exec-to-main time by shared library\n");
+    printf("  --locks           Profile pthread mutex/rwlock/condvar contention\n");
+    printf("  --sched           Sample per-thread on-CPU, run-queue and off-CPU time\n");
+    printf("  --sched-interval MS  Sampling interval for --sched (default: %d)\n",
+           DEFAULT_SCHED_INTERVAL_MS);
+    printf("  --shards N        Malloc tracker worker threads (default: one per CPU, max %d)\n",
+           MAX_TRACKER_SHARDS);
+    printf("  --trace-out FILE  Write a Chrome/Perfetto trace of syscalls, fds and memory\n");
+    printf("  --record-allocs FILE  Record every malloc/calloc/realloc/free for oswatch-replay\n");
+    printf("  --inject SPEC     Inject SYSCALL:ACTION[:PCT%%] faults; ACTION is delay=5ms,\n");
+    printf("                    an errno name (EINTR, EAGAIN, ENOSPC...) or short (repeatable)\n");
+    printf("  --inject-seed N   Seed for --inject (default: %d); same seed, same faults\n",
+           DEFAULT_INJECT_SEED);
+    printf("  --soft-limit M=V  Snapshot the top allocation sites when M reaches V; M is\n");
+    printf("                    heap, rss, fds or alloc-rate (e.g. heap=64M, fds=1000)\n");
+    printf("  --hard-limit M=V  Stop the program when M reaches V and report (exits 3)\n");
+    printf("  --on-hard-limit kill|stop  Signal for --hard-limit (default: kill); stop\n");
+    printf("                    leaves it stopped for a debugger\n");
+    printf("  --top             Live full-screen dashboard (program output is discarded)\n");
+    printf("  --metrics ADDR    Serve live OpenMetrics on PORT, HOST:PORT or unix:PATH\n");
+    printf("  --baseline FILE   Compare with the profile in FILE (saved there on first use)\n");
+    printf("  --save-profile FILE  Save this run's profile to FILE (%%p is the pid; see oswatch-merge)\n");
+    printf("  --threshold PCT   Smallest change --baseline reports (default: %.0f%%)\n",
+           DEFAULT_REGRESS_PCT);
+    printf("  --threshold-ms MS Smallest latency change --baseline reports (default: %.1f)\n",
+           DEFAULT_REGRESS_MS);
+    printf("  --format FMT      Report format: text (default) or json\n");
+    printf("  --output FILE     Write the report to FILE instead of stdout\n");
     printf("  -h, --help        Show this help message\n\n");
     printf("Examples:\n");
     printf("  %s ./leak_test\n", program_name);
     printf("  %s -v ./leak_test\n", program_name);
-    printf("  %s /bin/ls -la\n\n", program_name);
+    printf("  %s /bin/ls -la\n", program_name);
+    printf("  %s --format=json --output report.json ./leak_test\n", program_name);
+    printf("  %s --inject fsync:delay=5ms:1%% --inject write:ENOSPC:10%% ./server\n", program_name);
+    printf("  %s --soft-limit heap=256M --hard-limit rss=1G ./server\n", program_name);
+    printf("  %s --metrics 9464 ./server   (curl localhost:9464/metrics)\n", program_name);
+    printf("  %s --baseline main.profile ./leak_test   (exits 2 on a regression)\n\n",
+           program_name);
 }
 
 int main(int argc, char *argv[]) {
@@ -29,12 +66,131 @@ int main(int argc, char *argv[]) {
 
     // Parse command line options
     int verbose = 0;
+    const char *log_file = NULL;
+    int leak_scan = 0;
+    int shards = 0;
+    int no_ptrace = 0;
+    int startup = 0;
+    int locks = 0;
+    int sched = 0;
+    int sched_interval = 0;
+    int top = 0;
+    int format = REPORT_TEXT;
+    const char *format_name = NULL;
+    const char *output = NULL;
+    const char *trace_out = NULL;
+    const char *record_allocs = NULL;
+    FaultInjector inject;
+    unsigned long long inject_seed_value = DEFAULT_INJECT_SEED;
+    BudgetWatch budget;
+    const char *metrics = NULL;
+    const char *baseline = NULL;
+    const char *save_profile_path = NULL;
+    double threshold_pct = DEFAULT_REGRESS_PCT;
+    double threshold_ms = DEFAULT_REGRESS_MS;
     int program_index = 1;
 
+    memset(&inject, 0, sizeof(inject));
+    memset(&budget, 0, sizeof(budget));
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0) {
             verbose = 1;
             program_index++;
+        } else if (strcmp(argv[i], "--log-file") == 0 && i + 1 < argc) {
+            verbose = 1;
+            log_file = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--leak-check") == 0) {
+            leak_scan = 1;
+            program_index++;
+        } else if (strcmp(argv[i], "--no-ptrace") == 0) {
+            no_ptrace = 1;
+            program_index++;
+        } else if (strcmp(argv[i], "--startup") == 0) {
+            startup = 1;
+            program_index++;
+        } else if (strcmp(argv[i], "--locks") == 0) {
+            locks = 1;
+            program_index++;
+        } else if (strcmp(argv[i], "--sched") == 0) {
+            sched = 1;
+            program_index++;
+        } else if (strcmp(argv[i], "--sched-interval") == 0 && i + 1 < argc) {
+            sched = 1;
+            sched_interval = atoi(argv[++i]);
+            program_index += 2;
+        } else if (strcmp(argv[i], "--top") == 0) {
+            top = 1;
+            program_index++;
+        } else if (strncmp(argv[i], "--format=", 9) == 0) {
+            format_name = argv[i] + 9;
+            program_index++;
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            format_name = argv[++i];
+            program_index += 2;
+        } else if (strncmp(argv[i], "--trace-out=", 12) == 0) {
+            trace_out = argv[i] + 12;
+            program_index++;
+        } else if (strcmp(argv[i], "--trace-out") == 0 && i + 1 < argc) {
+            trace_out = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--record-allocs") == 0 && i + 1 < argc) {
+            record_allocs = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--inject") == 0 && i + 1 < argc) {
+            if (inject_add(&inject, argv[++i]) == -1) {
+                fprintf(stderr, "%sError: Bad --inject '%s' (e.g. fsync:delay=5ms:1%%, "
+                        "write:ENOSPC:10%%, read:short)%s\n", COLOR_RED, argv[i], COLOR_RESET);
+                return 1;
+            }
+            program_index += 2;
+        } else if (strcmp(argv[i], "--inject-seed") == 0 && i + 1 < argc) {
+            inject_seed_value = strtoull(argv[++i], NULL, 10);
+            program_index += 2;
+        } else if ((strcmp(argv[i], "--soft-limit") == 0 || strcmp(argv[i], "--hard-limit") == 0) &&
+                   i + 1 < argc) {
+            int hard = argv[i][2] == 'h';
+            if (budget_limit(&budget, argv[++i], hard) == -1) {
+                fprintf(stderr, "%sError: Bad --%s-limit '%s' (e.g. heap=64M, rss=1G, fds=1000, "
+                        "alloc-rate=100k)%s\n", COLOR_RED, hard ? "hard" : "soft", argv[i], COLOR_RESET);
+                return 1;
+            }
+            program_index += 2;
+        } else if (strcmp(argv[i], "--on-hard-limit") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "stop") == 0) {
+                budget.action = BUDGET_STOP;
+            } else if (strcmp(argv[i], "kill") == 0) {
+                budget.action = BUDGET_KILL;
+            } else {
+                fprintf(stderr, "%sError: --on-hard-limit is kill or stop%s\n", COLOR_RED, COLOR_RESET);
+                return 1;
+            }
+            program_index += 2;
+        } else if (strncmp(argv[i], "--metrics=", 10) == 0) {
+            metrics = argv[i] + 10;
+            program_index++;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--save-profile") == 0 && i + 1 < argc) {
+            save_profile_path = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold_pct = atof(argv[++i]);
+            program_index += 2;
+        } else if (strcmp(argv[i], "--threshold-ms") == 0 && i + 1 < argc) {
+            threshold_ms = atof(argv[++i]);
+            program_index += 2;
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output = argv[++i];
+            program_index += 2;
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            shards = atoi(argv[++i]);
+            program_index += 2;
         } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
             print_usage(argv[0]);
             return 0;
@@ -50,24 +206,190 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (format_name) {
+        if (strcmp(format_name, "json") == 0) {
+            format = REPORT_JSON;
+        } else if (strcmp(format_name, "text") != 0) {
+            fprintf(stderr, "%sError: Unknown report format '%s'%s\n",
+                    COLOR_RED, format_name, COLOR_RESET);
+            return 1;
+        }
+    }
+
     char *target_program = argv[program_index];
+    int quiet = format == REPORT_JSON;
 
-    // Print banner
-    print_banner();
+    if (output && !quiet) {
+        fprintf(stderr, "%sError: --output needs --format=json%s\n", COLOR_RED, COLOR_RESET);
+        return 1;
+    }
 
-    printf("%sTarget Program:%s %s\n", COLOR_BOLD, COLOR_RESET, target_program);
-    if (verbose) {
-        printf("%sMode:%s Verbose\n", COLOR_BOLD, COLOR_RESET);
+    if (top && quiet && !output) {
+        fprintf(stderr, "%sError: --top needs the terminal; send the JSON report to --output%s\n",
+                COLOR_RED, COLOR_RESET);
+        return 1;
+    }
+
+    // The dashboard replaces the per-event log
+    if (top && verbose && !log_file) {
+        fprintf(stderr, "oswatch: --verbose ignored with --top\n");
+        verbose = 0;
+    }
+
+    // A JSON report on stdout must be the only thing there
+    if (quiet && !output && verbose && !log_file) {
+        fprintf(stderr, "oswatch: --verbose ignored while writing JSON to stdout\n");
+        verbose = 0;
+    }
+
+    if (!quiet) {
+        print_banner();
+        printf("%sTarget Program:%s %s\n", COLOR_BOLD, COLOR_RESET, target_program);
+    }
+    if (verbose && !quiet) {
+        printf("%sMode:%s Verbose%s%s\n", COLOR_BOLD, COLOR_RESET,
+               log_file ? ", logged to " : "", log_file ? log_file : "");
+    }
+    if (no_ptrace) {
+        if (!quiet) {
+            printf("%sTracing:%s libc wrappers only, no ptrace\n", COLOR_BOLD, COLOR_RESET);
+        }
+        if (leak_scan) {
+            // The scan reads the tracee at its ptrace exit stop
+            if (!quiet) {
+                printf("%sLeak Check:%s unavailable with --no-ptrace, skipped\n", COLOR_BOLD, COLOR_RESET);
+            }
+            leak_scan = 0;
+        }
+        if (startup) {
+            // Needs the exec stop and a breakpoint
+            if (!quiet) {
+                printf("%sStartup:%s unavailable with --no-ptrace, skipped\n", COLOR_BOLD, COLOR_RESET);
+            }
+            startup = 0;
+        }
+        if (inject.count > 0) {
+            // Faults are applied at syscall stops
+            if (!quiet) {
+                printf("%sInjection:%s unavailable with --no-ptrace, skipped\n", COLOR_BOLD, COLOR_RESET);
+            }
+            inject.count = 0;
+        }
+    }
+    if (!quiet) {
+        if (leak_scan) {
+            printf("%sLeak Check:%s Reachability scan at exit\n", COLOR_BOLD, COLOR_RESET);
+        }
+        if (startup) {
+            printf("%sStartup:%s Exec-to-main profile\n", COLOR_BOLD, COLOR_RESET);
+        }
+        if (locks) {
+            printf("%sLocks:%s Contended pthread lock waits\n", COLOR_BOLD, COLOR_RESET);
+        }
+        if (sched) {
+            printf("%sScheduler:%s Per-thread sampling every %d ms\n", COLOR_BOLD, COLOR_RESET,
+                   sched_interval > 0 ? sched_interval : DEFAULT_SCHED_INTERVAL_MS);
+        }
+        if (trace_out) {
+            printf("%sTrace:%s Timeline to %s\n", COLOR_BOLD, COLOR_RESET, trace_out);
+        }
+        if (inject.count > 0) {
+            printf("%sInjection:%s %d rule(s), seed %llu\n", COLOR_BOLD, COLOR_RESET,
+                   inject.count, inject_seed_value);
+        }
+        if (record_allocs) {
+            printf("%sAllocations:%s Recorded to %s for oswatch-replay\n",
+                   COLOR_BOLD, COLOR_RESET, record_allocs);
+        }
+        if (budget.enabled) {
+            const char *separator = " ";
+            printf("%sBudgets:%s", COLOR_BOLD, COLOR_RESET);
+            for (int m = 0; m < BUDGET_METRICS; m++) {
+                if (budget.limits[m].soft || budget.limits[m].hard) {
+                    printf("%s%s", separator, budget_metric_name(m));
+                    separator = ", ";
+                }
+            }
+            printf(" every %.0f ms; a hard limit will %s the program\n", LIVE_PUBLISH_INTERVAL_MS,
+                   budget.action == BUDGET_STOP ? "stop" : "kill");
+        }
+        if (top) {
+            printf("%sDashboard:%s Live view every %d ms, program output discarded\n",
+                   COLOR_BOLD, COLOR_RESET, TOP_FRAME_MS);
+        }
+        if (metrics) {
+            printf("%sMetrics:%s OpenMetrics on %s\n", COLOR_BOLD, COLOR_RESET, metrics);
+        }
+        if (baseline) {
+            printf("%sBaseline:%s Compare with %s\n", COLOR_BOLD, COLOR_RESET, baseline);
+        }
+        printf("\n");
+        printf("%s═══════════════════════════════════════════════════════%s\n", COLOR_CYAN, COLOR_RESET);
+        printf("%sStarting monitoring...%s\n\n", COLOR_GREEN, COLOR_RESET);
     }
-    printf("\n");
-    printf("%s═══════════════════════════════════════════════════════%s\n", COLOR_CYAN, COLOR_RESET);
-    printf("%sStarting monitoring...%s\n\n", COLOR_GREEN, COLOR_RESET);
 
     // Initialize statistics
     ProcessStats stats;
     init_process_stats(&stats, 0, target_program);
+    stats.leak_scan = leak_scan;
+    stats.requested_shards = shards;
+    stats.no_ptrace = no_ptrace;
+    stats.startup.enabled = startup;
+    stats.lock_profile = locks;
+    stats.sched.enabled = sched;
+    stats.sched.interval_ms = sched_interval;
+    stats.report_format = format;
+    stats.report_path = output;
+    stats.baseline.path = baseline;
+    stats.baseline.save_path = save_profile_path;
+    stats.baseline.threshold_pct = threshold_pct;
+    stats.baseline.threshold_ms = threshold_ms;
+    stats.inject = inject;
+    inject_seed(&stats.inject, inject_seed_value);
+    stats.budget = budget;
+
+    if (budget.enabled && budget_open(&stats) == -1) {
+        fprintf(stderr, "%sError: Cannot watch budgets%s\n", COLOR_RED, COLOR_RESET);
+        cleanup_process_stats(&stats);
+        return 1;
+    }
+
+    if (trace_out && trace_open(&stats, trace_out) == -1) {
+        fprintf(stderr, "%sError: Cannot write %s: %s%s\n",
+                COLOR_RED, trace_out, strerror(errno), COLOR_RESET);
+        cleanup_process_stats(&stats);
+        return 1;
+    }
+
+    if (record_allocs && alloc_trace_open(&stats, record_allocs) == -1) {
+        fprintf(stderr, "%sError: Cannot write %s: %s%s\n",
+                COLOR_RED, record_allocs, strerror(errno), COLOR_RESET);
+        cleanup_process_stats(&stats);
+        return 1;
+    }
+
+    if (metrics && metrics_open(&stats, metrics) == -1) {
+        fprintf(stderr, "%sError: Cannot serve metrics on %s: %s%s\n",
+                COLOR_RED, metrics, strerror(errno), COLOR_RESET);
+        cleanup_process_stats(&stats);
+        return 1;
+    }
+
+    // Only now may anything log: the ring and its writer exist
+    if (verbose && log_open(&stats, log_file) == -1) {
+        fprintf(stderr, "%sError: Cannot write the verbose log%s%s: %s%s\n", COLOR_RED,
+                log_file ? " to " : "", log_file ? log_file : "", strerror(errno), COLOR_RESET);
+        cleanup_process_stats(&stats);
+        return 1;
+    }
     stats.verbose = verbose;
 
+    if (top && top_open(&stats) == -1) {
+        fprintf(stderr, "%sError: Cannot start the dashboard%s\n", COLOR_RED, COLOR_RESET);
+        cleanup_process_stats(&stats);
+        return 1;
+    }
+
     // Launch and monitor the target program
     int result = launch_and_monitor(target_program, &argv[program_index], &stats);
 
@@ -78,58 +400,21 @@ int main(int argc, char *argv[]) {
     }
 
     // Generate final report
-    printf("\n%s═══════════════════════════════════════════════════════%s\n", COLOR_CYAN, COLOR_RESET);
-    printf("%sMonitoring complete. Generating report...%s\n", COLOR_GREEN, COLOR_RESET);
-    printf("%s═══════════════════════════════════════════════════════%s\n\n", COLOR_CYAN, COLOR_RESET);
+    if (!quiet) {
+        printf("\n%s═══════════════════════════════════════════════════════%s\n", COLOR_CYAN, COLOR_RESET);
+        printf("%sMonitoring complete. Generating report...%s\n", COLOR_GREEN, COLOR_RESET);
+        printf("%s═══════════════════════════════════════════════════════%s\n\n", COLOR_CYAN, COLOR_RESET);
+    }
 
-    generate_report(&stats);
+    result = generate_report(&stats);
+    int regressed = stats.baseline.regressions > 0;
+    int over_budget = stats.budget.tripped != 0;
+    wait_stopped_tracee(&stats);
 
     // Cleanup
     cleanup_process_stats(&stats);
 
-    return 0;
-}
-
-// Initialize process statistics structure
-void init_process_stats(ProcessStats *stats, pid_t pid, char *name) {
-    memset(stats, 0, sizeof(ProcessStats));
-    
-    stats->pid = pid;
-    stats->process_name = name;
-    stats->memory_blocks = NULL;
-    stats->open_files = NULL;
-    
-    // Record start time
-    clock_gettime(CLOCK_MONOTONIC, &stats->start_time);
-}
-
-// Cleanup and free allocated memory
-void cleanup_process_stats(ProcessStats *stats) {
-    // Cleanup memory blocks
-    MemoryBlock *mem_current = stats->memory_blocks;
-    while (mem_current) {
-        MemoryBlock *next = mem_current->next;
-        free((char*)mem_current->syscall_type);
-        free(mem_current);
-        mem_current = next;
-    }
-    
-    // Cleanup file descriptors
-    FileDescriptor *file_current = stats->open_files;
-    while (file_current) {
-        FileDescriptor *next = file_current->next;
-        free(file_current->filename);
-        free(file_current);
-        file_current = next;
-    }
-    
-    // Cleanup malloc hash table
-    cleanup_malloc_table(stats);
-}
-
-// Calculate time difference in milliseconds
-double calculate_time_diff(struct timespec *start, struct timespec *end) {
-    double start_ms = start->tv_sec * 1000.0 + start->tv_nsec / 1000000.0;
-    double end_ms = end->tv_sec * 1000.0 + end->tv_nsec / 1000000.0;
-    return end_ms - start_ms;
+    if (result != 0) return 1;
+    if (regressed) return 2;
+    return over_budget ? 3 : 0;
 }
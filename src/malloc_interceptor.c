@@ -1,10 +1,19 @@
 #define _GNU_SOURCE
 #include <dlfcn.h>
+#include <execinfo.h>
+#include <link.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 // Function pointers to real malloc/free/calloc/realloc
 static void* (*real_malloc)(size_t) = NULL;
@@ -12,9 +21,53 @@ static void (*real_free)(void*) = NULL;
 static void* (*real_calloc)(size_t, size_t) = NULL;
 static void* (*real_realloc)(void*, size_t) = NULL;
 
+// Real libc I/O entry points, wrapped only in --no-ptrace mode
+static int (*real_open)(const char*, int, ...) = NULL;
+static int (*real_open64)(const char*, int, ...) = NULL;
+static int (*real_openat)(int, const char*, int, ...) = NULL;
+static int (*real_openat64)(int, const char*, int, ...) = NULL;
+static int (*real_close)(int) = NULL;
+static ssize_t (*real_read)(int, void*, size_t) = NULL;
+static ssize_t (*real_write)(int, const void*, size_t) = NULL;
+static ssize_t (*real_pread)(int, void*, size_t, off_t) = NULL;
+static ssize_t (*real_pread64)(int, void*, size_t, off64_t) = NULL;
+static ssize_t (*real_pwrite)(int, const void*, size_t, off_t) = NULL;
+static ssize_t (*real_pwrite64)(int, const void*, size_t, off64_t) = NULL;
+static off_t (*real_lseek)(int, off_t, int) = NULL;
+static off64_t (*real_lseek64)(int, off64_t, int) = NULL;
+static void* (*real_mmap)(void*, size_t, int, int, int, off_t) = NULL;
+static void* (*real_mmap64)(void*, size_t, int, int, int, off64_t) = NULL;
+static int (*real_munmap)(void*, size_t) = NULL;
+static int (*real_dup)(int) = NULL;
+static int (*real_dup2)(int, int) = NULL;
+static int (*real_dup3)(int, int, int) = NULL;
+static int (*real_fsync)(int) = NULL;
+static int (*real_fdatasync)(int) = NULL;
+static FILE* (*real_fopen)(const char*, const char*) = NULL;
+static FILE* (*real_fopen64)(const char*, const char*) = NULL;
+static int (*real_fclose)(FILE*) = NULL;
+
+// Real pthread functions (--locks)
+static int (*real_mutex_lock)(pthread_mutex_t*) = NULL;
+static int (*real_mutex_trylock)(pthread_mutex_t*) = NULL;
+static int (*real_rwlock_rdlock)(pthread_rwlock_t*) = NULL;
+static int (*real_rwlock_tryrdlock)(pthread_rwlock_t*) = NULL;
+static int (*real_rwlock_wrlock)(pthread_rwlock_t*) = NULL;
+static int (*real_rwlock_trywrlock)(pthread_rwlock_t*) = NULL;
+static int (*real_cond_wait)(pthread_cond_t*, pthread_mutex_t*) = NULL;
+static int (*real_cond_timedwait)(pthread_cond_t*, pthread_mutex_t*, const struct timespec*) = NULL;
+
 static int initialized = 0;
 static int notify_fd = -1;
-static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int io_wrap = 0;
+static int lock_wrap = 0;
+// A spin flag, not a pthread mutex: pthread_mutex_lock is wrapped below
+static char init_busy = 0;
+
+// Self-overhead counters, reported to OSWatch at exit
+static size_t events_sent = 0;
+static size_t events_dropped = 0;
+static unsigned long long notify_ns = 0;
 
 // Temporary buffer for bootstrap allocations
 #define BOOTSTRAP_POOL_SIZE 1024 * 64
@@ -34,9 +87,11 @@ static void* bootstrap_malloc(size_t size) {
 static void init_interceptor() {
     if (initialized) return;
     
-    pthread_mutex_lock(&init_mutex);
+    while (__atomic_test_and_set(&init_busy, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
     if (initialized) {
-        pthread_mutex_unlock(&init_mutex);
+        __atomic_clear(&init_busy, __ATOMIC_RELEASE);
         return;
     }
     
@@ -46,21 +101,197 @@ static void init_interceptor() {
     real_calloc = dlsym(RTLD_NEXT, "calloc");
     real_realloc = dlsym(RTLD_NEXT, "realloc");
     
+    real_open = dlsym(RTLD_NEXT, "open");
+    real_open64 = dlsym(RTLD_NEXT, "open64");
+    real_openat = dlsym(RTLD_NEXT, "openat");
+    real_openat64 = dlsym(RTLD_NEXT, "openat64");
+    real_close = dlsym(RTLD_NEXT, "close");
+    real_read = dlsym(RTLD_NEXT, "read");
+    real_write = dlsym(RTLD_NEXT, "write");
+    real_pread = dlsym(RTLD_NEXT, "pread");
+    real_pread64 = dlsym(RTLD_NEXT, "pread64");
+    real_pwrite = dlsym(RTLD_NEXT, "pwrite");
+    real_pwrite64 = dlsym(RTLD_NEXT, "pwrite64");
+    real_lseek = dlsym(RTLD_NEXT, "lseek");
+    real_lseek64 = dlsym(RTLD_NEXT, "lseek64");
+    real_mmap = dlsym(RTLD_NEXT, "mmap");
+    real_mmap64 = dlsym(RTLD_NEXT, "mmap64");
+    real_munmap = dlsym(RTLD_NEXT, "munmap");
+    real_dup = dlsym(RTLD_NEXT, "dup");
+    real_dup2 = dlsym(RTLD_NEXT, "dup2");
+    real_dup3 = dlsym(RTLD_NEXT, "dup3");
+    real_fsync = dlsym(RTLD_NEXT, "fsync");
+    real_fdatasync = dlsym(RTLD_NEXT, "fdatasync");
+    real_fopen = dlsym(RTLD_NEXT, "fopen");
+    real_fopen64 = dlsym(RTLD_NEXT, "fopen64");
+    real_fclose = dlsym(RTLD_NEXT, "fclose");
+    
+    real_mutex_lock = dlsym(RTLD_NEXT, "pthread_mutex_lock");
+    real_mutex_trylock = dlsym(RTLD_NEXT, "pthread_mutex_trylock");
+    real_rwlock_rdlock = dlsym(RTLD_NEXT, "pthread_rwlock_rdlock");
+    real_rwlock_tryrdlock = dlsym(RTLD_NEXT, "pthread_rwlock_tryrdlock");
+    real_rwlock_wrlock = dlsym(RTLD_NEXT, "pthread_rwlock_wrlock");
+    real_rwlock_trywrlock = dlsym(RTLD_NEXT, "pthread_rwlock_trywrlock");
+    real_cond_wait = dlsym(RTLD_NEXT, "pthread_cond_wait");
+    real_cond_timedwait = dlsym(RTLD_NEXT, "pthread_cond_timedwait");
+    
     // Get notification pipe FD from environment
     char *fd_str = getenv("OSWATCH_NOTIFY_FD");
     if (fd_str) {
         notify_fd = atoi(fd_str);
     }
     
-    initialized = 1;
-    pthread_mutex_unlock(&init_mutex);
+    // Programs the tracee execs inherit the pipe - only the tracee reports
+    char *pid_str = getenv("OSWATCH_TRACEE_PID");
+    if (pid_str && atoi(pid_str) != getpid()) {
+        notify_fd = -1;
+    }
+    
+    // No tracer is watching syscalls - report libc I/O calls ourselves
+    io_wrap = getenv("OSWATCH_IO_WRAP") != NULL;
+    lock_wrap = getenv("OSWATCH_LOCKS") != NULL;
+    
+    __atomic_store_n(&initialized, 1, __ATOMIC_RELEASE);
+    __atomic_clear(&init_busy, __ATOMIC_RELEASE);
+}
+
+// Forked children share the pipe but not the tracee's heap - silence them
+static void stop_notifying_in_child(void) {
+    notify_fd = -1;
+}
+
+// ---------------------------------------------------------------------------
+// Allocation sites
+//
+// The site sent with an allocation is the first return address in the
+// program's own code. When the runtime allocates on the caller's behalf
+// (strdup, getline, asprintf, realpath, operator new...) that is a frame
+// further up, found with backtrace(). A runtime address is only kept for
+// the runtime's own blocks, which the tracer files as library
+// allocations: the loader's (ld.so, thread TLS), stdio buffers, and
+// anything with no program frame above it (runtime initialization).
+// ---------------------------------------------------------------------------
+
+#define MAX_RUNTIME_RANGES 16
+#define SITE_WALK_DEPTH 24
+
+typedef struct {
+    unsigned long start;
+    unsigned long end;
+    int loader;
+} CodeRange;
+
+// Same names the tracer treats as runtime (symbols.c)
+static const char *runtime_libraries[] = {
+    "libc.so", "ld-linux", "libpthread", "libdl", "libm.so",
+    "libstdc++", "libgcc_s", "liboswatch_malloc", NULL
+};
+
+static CodeRange runtime_ranges[MAX_RUNTIME_RANGES];
+static int runtime_range_count = 0;
+static unsigned long stdio_alloc_start = 0;
+static unsigned long stdio_alloc_end = 0;
+static __thread int walking_stack = 0;
+
+static int add_runtime_ranges(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    (void)data;
+    const char *base = strrchr(info->dlpi_name, '/');
+    base = base ? base + 1 : info->dlpi_name;
+
+    int runtime = 0;
+    for (int i = 0; runtime_libraries[i]; i++) {
+        if (strncmp(base, runtime_libraries[i], strlen(runtime_libraries[i])) == 0) runtime = 1;
+    }
+    if (!runtime) return 0;
+
+    for (int i = 0; i < info->dlpi_phnum && runtime_range_count < MAX_RUNTIME_RANGES; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_LOAD || !(ph->p_flags & PF_X)) continue;
+
+        CodeRange *r = &runtime_ranges[runtime_range_count++];
+        r->start = info->dlpi_addr + ph->p_vaddr;
+        r->end = r->start + ph->p_memsz;
+        r->loader = strncmp(base, "ld-linux", 8) == 0;
+    }
+    return 0;
+}
+
+static const CodeRange* runtime_range(void *addr) {
+    unsigned long value = (unsigned long)addr;
+    for (int i = 0; i < runtime_range_count; i++) {
+        if (value >= runtime_ranges[i].start && value < runtime_ranges[i].end) {
+            return &runtime_ranges[i];
+        }
+    }
+    return NULL;
+}
+
+static void* program_site(void *caller) {
+    const CodeRange *r = runtime_range(caller);
+    if (!r || r->loader || walking_stack) return caller;
+
+    unsigned long value = (unsigned long)caller;
+    if (value >= stdio_alloc_start && value < stdio_alloc_end) return caller;
+
+    // The first walk loads the unwinder, whose allocations keep their own site
+    void *frames[SITE_WALK_DEPTH];
+    walking_stack = 1;
+    int depth = backtrace(frames, SITE_WALK_DEPTH);
+    walking_stack = 0;
+
+    for (int i = 0; i < depth; i++) {
+        if (!runtime_range(frames[i])) return frames[i];
+    }
+    return caller;
+}
+
+__attribute__((constructor))
+static void register_fork_handler(void) {
+    pthread_atfork(NULL, NULL, stop_notifying_in_child);
+
+    // Everything the program links against is mapped by now
+    dl_iterate_phdr(add_runtime_ranges, NULL);
+
+    // stdio's buffer allocator, whose blocks live as long as the stream
+    Dl_info info;
+    const ElfW(Sym) *sym = NULL;
+    void *doallocate = dlsym(RTLD_DEFAULT, "_IO_file_doallocate");
+    if (doallocate && dladdr1(doallocate, &info, (void**)&sym, RTLD_DL_SYMENT) && sym) {
+        stdio_alloc_start = (unsigned long)doallocate;
+        stdio_alloc_end = stdio_alloc_start + sym->st_size;
+    }
 }
 
 // Send notification to OSWatch
 static void notify_oswatch(const char *msg) {
     if (notify_fd >= 0) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        
+        // Raw syscall: write() itself may be wrapped below
         size_t len = strlen(msg);
-        write(notify_fd, msg, len);
+        if (syscall(SYS_write, notify_fd, msg, len) == (long)len) {
+            __atomic_fetch_add(&events_sent, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_add(&events_dropped, 1, __ATOMIC_RELAXED);
+        }
+        
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        __atomic_fetch_add(&notify_ns,
+                           (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec,
+                           __ATOMIC_RELAXED);
+    }
+}
+
+// Report what interception cost this process
+__attribute__((destructor))
+static void report_interceptor_stats(void) {
+    if (notify_fd >= 0) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "STATS %zu %zu %llu\n",
+                 events_sent, events_dropped, notify_ns);
+        syscall(SYS_write, notify_fd, buf, strlen(buf));
     }
 }
 
@@ -77,7 +308,8 @@ void* malloc(size_t size) {
     
     if (ptr && notify_fd >= 0) {
         char buf[128];
-        snprintf(buf, sizeof(buf), "ALLOC %p %zu\n", ptr, size);
+        snprintf(buf, sizeof(buf), "ALLOC %p %zu %p\n", ptr, size,
+                 program_site(__builtin_return_address(0)));
         notify_oswatch(buf);
     }
     
@@ -123,7 +355,8 @@ void* calloc(size_t nmemb, size_t size) {
     
     if (ptr && notify_fd >= 0) {
         char buf[128];
-        snprintf(buf, sizeof(buf), "ALLOC %p %zu\n", ptr, nmemb * size);
+        snprintf(buf, sizeof(buf), "CALLOC %p %zu %p\n", ptr, nmemb * size,
+                 program_site(__builtin_return_address(0)));
         notify_oswatch(buf);
     }
     
@@ -143,18 +376,421 @@ void* realloc(void *old_ptr, size_t size) {
     
     void *new_ptr = real_realloc(old_ptr, size);
     
-    if (notify_fd >= 0) {
-        if (old_ptr) {
-            char buf[128];
-            snprintf(buf, sizeof(buf), "FREE %p\n", old_ptr);
-            notify_oswatch(buf);
-        }
-        if (new_ptr) {
-            char buf[128];
-            snprintf(buf, sizeof(buf), "ALLOC %p %zu\n", new_ptr, size);
-            notify_oswatch(buf);
-        }
+    // One line, so a replay sees a realloc rather than a free and a malloc.
+    // Either pointer may be NULL, which %p would print as "(nil)".
+    if (notify_fd >= 0 && (old_ptr || new_ptr)) {
+        char buf[160];
+        snprintf(buf, sizeof(buf), "REALLOC 0x%lx 0x%lx %zu %p\n", (unsigned long)old_ptr,
+                 (unsigned long)new_ptr, size, program_site(__builtin_return_address(0)));
+        notify_oswatch(buf);
     }
     
     return new_ptr;
-}
\ No newline at end of file
+}
+
+// ---------------------------------------------------------------------------
+// libc I/O wrappers (--no-ptrace)
+//
+// Each call is reported as "SYS nr ret ns a0 a1 a2 a3 [path]" so the
+// tracer can run it through the same handlers as a ptrace syscall stop.
+// Calls glibc makes internally (stdio's own read/write, malloc's mmap)
+// and inline syscalls bypass these and are not seen.
+// ---------------------------------------------------------------------------
+
+static int io_reporting(void) {
+    if (!initialized) {
+        init_interceptor();
+    }
+    return io_wrap && notify_fd >= 0;
+}
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report_syscall(long nr, long ret, unsigned long long start,
+                           long a0, long a1, long a2, long a3, const char *path) {
+    int saved_errno = errno;
+    char buf[256];
+    unsigned long long ns = now_ns() - start;
+    
+    // Report failures the way the kernel returns them (-errno)
+    if (ret == -1) ret = -saved_errno;
+    
+    if (path) {
+        snprintf(buf, sizeof(buf), "SYS %ld %ld %llu %lx %lx %lx %lx %.160s\n",
+                 nr, ret, ns, a0, a1, a2, a3, path);
+    } else {
+        snprintf(buf, sizeof(buf), "SYS %ld %ld %llu %lx %lx %lx %lx\n",
+                 nr, ret, ns, a0, a1, a2, a3);
+    }
+    notify_oswatch(buf);
+    errno = saved_errno;
+}
+
+// open(2) flags equivalent to an fopen() mode string
+static int fopen_flags(const char *mode) {
+    int flags = strchr(mode, '+') ? O_RDWR : (mode[0] == 'r' ? O_RDONLY : O_WRONLY);
+    if (mode[0] == 'w') flags |= O_CREAT | O_TRUNC;
+    if (mode[0] == 'a') flags |= O_CREAT | O_APPEND;
+    return flags;
+}
+
+static mode_t open_mode(int flags, va_list ap) {
+    return (flags & (O_CREAT | O_TMPFILE)) ? va_arg(ap, mode_t) : 0;
+}
+
+int open(const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+    
+    if (!io_reporting()) return real_open(path, flags, mode);
+    
+    unsigned long long start = now_ns();
+    int fd = real_open(path, flags, mode);
+    report_syscall(SYS_open, fd, start, (long)path, flags, mode, 0, path);
+    return fd;
+}
+
+int open64(const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+    
+    if (!io_reporting()) return real_open64(path, flags, mode);
+    
+    unsigned long long start = now_ns();
+    int fd = real_open64(path, flags, mode);
+    report_syscall(SYS_open, fd, start, (long)path, flags, mode, 0, path);
+    return fd;
+}
+
+int openat(int dirfd, const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+    
+    if (!io_reporting()) return real_openat(dirfd, path, flags, mode);
+    
+    unsigned long long start = now_ns();
+    int fd = real_openat(dirfd, path, flags, mode);
+    report_syscall(SYS_openat, fd, start, dirfd, (long)path, flags, mode, path);
+    return fd;
+}
+
+int openat64(int dirfd, const char *path, int flags, ...) {
+    va_list ap;
+    va_start(ap, flags);
+    mode_t mode = open_mode(flags, ap);
+    va_end(ap);
+    
+    if (!io_reporting()) return real_openat64(dirfd, path, flags, mode);
+    
+    unsigned long long start = now_ns();
+    int fd = real_openat64(dirfd, path, flags, mode);
+    report_syscall(SYS_openat, fd, start, dirfd, (long)path, flags, mode, path);
+    return fd;
+}
+
+int close(int fd) {
+    if (!io_reporting()) return real_close(fd);
+    
+    unsigned long long start = now_ns();
+    int ret = real_close(fd);
+    report_syscall(SYS_close, ret, start, fd, 0, 0, 0, NULL);
+    return ret;
+}
+
+ssize_t read(int fd, void *buf, size_t count) {
+    if (!io_reporting()) return real_read(fd, buf, count);
+    
+    unsigned long long start = now_ns();
+    ssize_t ret = real_read(fd, buf, count);
+    report_syscall(SYS_read, ret, start, fd, (long)buf, count, 0, NULL);
+    return ret;
+}
+
+ssize_t write(int fd, const void *buf, size_t count) {
+    if (!io_reporting()) return real_write(fd, buf, count);
+    
+    unsigned long long start = now_ns();
+    ssize_t ret = real_write(fd, buf, count);
+    report_syscall(SYS_write, ret, start, fd, (long)buf, count, 0, NULL);
+    return ret;
+}
+
+ssize_t pread(int fd, void *buf, size_t count, off_t offset) {
+    if (!io_reporting()) return real_pread(fd, buf, count, offset);
+    
+    unsigned long long start = now_ns();
+    ssize_t ret = real_pread(fd, buf, count, offset);
+    report_syscall(SYS_pread64, ret, start, fd, (long)buf, count, offset, NULL);
+    return ret;
+}
+
+ssize_t pread64(int fd, void *buf, size_t count, off64_t offset) {
+    if (!io_reporting()) return real_pread64(fd, buf, count, offset);
+    
+    unsigned long long start = now_ns();
+    ssize_t ret = real_pread64(fd, buf, count, offset);
+    report_syscall(SYS_pread64, ret, start, fd, (long)buf, count, offset, NULL);
+    return ret;
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset) {
+    if (!io_reporting()) return real_pwrite(fd, buf, count, offset);
+    
+    unsigned long long start = now_ns();
+    ssize_t ret = real_pwrite(fd, buf, count, offset);
+    report_syscall(SYS_pwrite64, ret, start, fd, (long)buf, count, offset, NULL);
+    return ret;
+}
+
+ssize_t pwrite64(int fd, const void *buf, size_t count, off64_t offset) {
+    if (!io_reporting()) return real_pwrite64(fd, buf, count, offset);
+    
+    unsigned long long start = now_ns();
+    ssize_t ret = real_pwrite64(fd, buf, count, offset);
+    report_syscall(SYS_pwrite64, ret, start, fd, (long)buf, count, offset, NULL);
+    return ret;
+}
+
+off_t lseek(int fd, off_t offset, int whence) {
+    if (!io_reporting()) return real_lseek(fd, offset, whence);
+    
+    unsigned long long start = now_ns();
+    off_t ret = real_lseek(fd, offset, whence);
+    report_syscall(SYS_lseek, ret, start, fd, offset, whence, 0, NULL);
+    return ret;
+}
+
+off64_t lseek64(int fd, off64_t offset, int whence) {
+    if (!io_reporting()) return real_lseek64(fd, offset, whence);
+    
+    unsigned long long start = now_ns();
+    off64_t ret = real_lseek64(fd, offset, whence);
+    report_syscall(SYS_lseek, ret, start, fd, offset, whence, 0, NULL);
+    return ret;
+}
+
+void* mmap(void *addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    if (!io_reporting()) return real_mmap(addr, length, prot, flags, fd, offset);
+    
+    unsigned long long start = now_ns();
+    void *ret = real_mmap(addr, length, prot, flags, fd, offset);
+    report_syscall(SYS_mmap, ret == MAP_FAILED ? -errno : (long)ret, start,
+                   (long)addr, length, prot, flags, NULL);
+    return ret;
+}
+
+void* mmap64(void *addr, size_t length, int prot, int flags, int fd, off64_t offset) {
+    if (!io_reporting()) return real_mmap64(addr, length, prot, flags, fd, offset);
+    
+    unsigned long long start = now_ns();
+    void *ret = real_mmap64(addr, length, prot, flags, fd, offset);
+    report_syscall(SYS_mmap, ret == MAP_FAILED ? -errno : (long)ret, start,
+                   (long)addr, length, prot, flags, NULL);
+    return ret;
+}
+
+int munmap(void *addr, size_t length) {
+    if (!io_reporting()) return real_munmap(addr, length);
+    
+    unsigned long long start = now_ns();
+    int ret = real_munmap(addr, length);
+    report_syscall(SYS_munmap, ret, start, (long)addr, length, 0, 0, NULL);
+    return ret;
+}
+
+int dup(int oldfd) {
+    if (!io_reporting()) return real_dup(oldfd);
+    
+    unsigned long long start = now_ns();
+    int ret = real_dup(oldfd);
+    report_syscall(SYS_dup, ret, start, oldfd, 0, 0, 0, NULL);
+    return ret;
+}
+
+int dup2(int oldfd, int newfd) {
+    if (!io_reporting()) return real_dup2(oldfd, newfd);
+    
+    unsigned long long start = now_ns();
+    int ret = real_dup2(oldfd, newfd);
+    report_syscall(SYS_dup2, ret, start, oldfd, newfd, 0, 0, NULL);
+    return ret;
+}
+
+int dup3(int oldfd, int newfd, int flags) {
+    if (!io_reporting()) return real_dup3(oldfd, newfd, flags);
+    
+    unsigned long long start = now_ns();
+    int ret = real_dup3(oldfd, newfd, flags);
+    report_syscall(SYS_dup3, ret, start, oldfd, newfd, flags, 0, NULL);
+    return ret;
+}
+
+int fsync(int fd) {
+    if (!io_reporting()) return real_fsync(fd);
+    
+    unsigned long long start = now_ns();
+    int ret = real_fsync(fd);
+    report_syscall(SYS_fsync, ret, start, fd, 0, 0, 0, NULL);
+    return ret;
+}
+
+int fdatasync(int fd) {
+    if (!io_reporting()) return real_fdatasync(fd);
+    
+    unsigned long long start = now_ns();
+    int ret = real_fdatasync(fd);
+    report_syscall(SYS_fdatasync, ret, start, fd, 0, 0, 0, NULL);
+    return ret;
+}
+
+// glibc's fopen/fclose call open/close internally, past our wrappers
+FILE* fopen(const char *path, const char *mode) {
+    if (!io_reporting()) return real_fopen(path, mode);
+    
+    unsigned long long start = now_ns();
+    FILE *f = real_fopen(path, mode);
+    report_syscall(SYS_open, f ? fileno(f) : -errno, start,
+                   (long)path, fopen_flags(mode), 0, 0, path);
+    return f;
+}
+
+FILE* fopen64(const char *path, const char *mode) {
+    if (!io_reporting()) return real_fopen64(path, mode);
+    
+    unsigned long long start = now_ns();
+    FILE *f = real_fopen64(path, mode);
+    report_syscall(SYS_open, f ? fileno(f) : -errno, start,
+                   (long)path, fopen_flags(mode), 0, 0, path);
+    return f;
+}
+
+int fclose(FILE *stream) {
+    if (!io_reporting()) return real_fclose(stream);
+    
+    int fd = fileno(stream);
+    unsigned long long start = now_ns();
+    int ret = real_fclose(stream);
+    report_syscall(SYS_close, ret, start, fd, 0, 0, 0, NULL);
+    return ret;
+}
+
+// ---------------------------------------------------------------------------
+// pthread lock wrappers (--locks)
+//
+// Acquisitions try the lock first, so the uncontended path costs one extra
+// call and nothing is reported. Only a wait that actually blocks is timed
+// and sent as "LOCK kind lock site ns". Unlock is left to libc: there is
+// nothing to measure on it. Calls glibc makes internally (stdio's locks,
+// the mutex reacquire inside pthread_cond_wait) are not seen.
+// ---------------------------------------------------------------------------
+
+static int lock_reporting(void) {
+    if (!initialized) {
+        init_interceptor();
+    }
+    return lock_wrap && notify_fd >= 0;
+}
+
+static void report_lock(char kind, void *lock, void *site, unsigned long long ns) {
+    int saved_errno = errno;
+    char buf[96];
+    snprintf(buf, sizeof(buf), "LOCK %c %p %p %llu\n", kind, lock, site, ns);
+    notify_oswatch(buf);
+    errno = saved_errno;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex) {
+    if (!lock_reporting()) return real_mutex_lock(mutex);
+    
+    int ret = real_mutex_trylock(mutex);
+    if (ret != EBUSY) return ret;
+    
+    unsigned long long start = now_ns();
+    ret = real_mutex_lock(mutex);
+    report_lock('M', mutex, __builtin_return_address(0), now_ns() - start);
+    return ret;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex) {
+    if (!lock_reporting()) return real_mutex_trylock(mutex);
+    
+    int ret = real_mutex_trylock(mutex);
+    if (ret == EBUSY) {
+        report_lock('m', mutex, __builtin_return_address(0), 0);
+    }
+    return ret;
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock) {
+    if (!lock_reporting()) return real_rwlock_rdlock(rwlock);
+    
+    int ret = real_rwlock_tryrdlock(rwlock);
+    if (ret != EBUSY) return ret;
+    
+    unsigned long long start = now_ns();
+    ret = real_rwlock_rdlock(rwlock);
+    report_lock('R', rwlock, __builtin_return_address(0), now_ns() - start);
+    return ret;
+}
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock) {
+    if (!lock_reporting()) return real_rwlock_tryrdlock(rwlock);
+    
+    int ret = real_rwlock_tryrdlock(rwlock);
+    if (ret == EBUSY) {
+        report_lock('r', rwlock, __builtin_return_address(0), 0);
+    }
+    return ret;
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock) {
+    if (!lock_reporting()) return real_rwlock_wrlock(rwlock);
+    
+    int ret = real_rwlock_trywrlock(rwlock);
+    if (ret != EBUSY) return ret;
+    
+    unsigned long long start = now_ns();
+    ret = real_rwlock_wrlock(rwlock);
+    report_lock('W', rwlock, __builtin_return_address(0), now_ns() - start);
+    return ret;
+}
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock) {
+    if (!lock_reporting()) return real_rwlock_trywrlock(rwlock);
+    
+    int ret = real_rwlock_trywrlock(rwlock);
+    if (ret == EBUSY) {
+        report_lock('w', rwlock, __builtin_return_address(0), 0);
+    }
+    return ret;
+}
+
+// A condvar wait always blocks, so every one is timed
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    if (!lock_reporting()) return real_cond_wait(cond, mutex);
+    
+    unsigned long long start = now_ns();
+    int ret = real_cond_wait(cond, mutex);
+    report_lock('C', cond, __builtin_return_address(0), now_ns() - start);
+    return ret;
+}
+
+int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex,
+                           const struct timespec *abstime) {
+    if (!lock_reporting()) return real_cond_timedwait(cond, mutex, abstime);
+    
+    unsigned long long start = now_ns();
+    int ret = real_cond_timedwait(cond, mutex, abstime);
+    report_lock('C', cond, __builtin_return_address(0), now_ns() - start);
+    return ret;
+}
@@ -1,72 +1,179 @@
 #include "../include/oswatch.h"
 #include <string.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
 
-// Hash function for address lookup
-static unsigned int hash_addr(void *addr) {
-    unsigned long val = (unsigned long)addr;
-    return (val >> 3) % MALLOC_HASH_SIZE;
+// Hash function for call-site lookup
+static unsigned int hash_site(void *site) {
+    unsigned long val = (unsigned long)site;
+    return (val >> 3) % SITE_HASH_SIZE;
 }
 
-// Track a malloc allocation
-static void track_malloc(ProcessStats *stats, void *addr, size_t size) {
-    unsigned int idx = hash_addr(addr);
+// Find or create the entry for an allocation call site in a site table
+AllocSite* find_or_add_site(AllocSite **table, Slab *slab, void *site) {
+    unsigned int idx = hash_site(site);
     
-    MallocBlock *block = malloc(sizeof(MallocBlock));
-    if (!block) return;  // Failed to allocate tracking block
+    AllocSite *entry = table[idx];
+    while (entry) {
+        if (entry->site == site) {
+            return entry;
+        }
+        entry = entry->next;
+    }
     
-    block->address = addr;
-    block->size = size;
-    block->next = stats->malloc_hash_table[idx];
-    stats->malloc_hash_table[idx] = block;
+    entry = slab_alloc(slab);
+    if (!entry) return NULL;
     
-    stats->malloc_allocations++;
-    stats->malloc_bytes_allocated += size;
+    memset(entry, 0, sizeof(AllocSite));
+    entry->site = site;
+    entry->next = table[idx];
+    table[idx] = entry;
+    return entry;
+}
+
+// Find or create the merged statistics entry for a call site
+AllocSite* get_alloc_site(ProcessStats *stats, void *site) {
+    return find_or_add_site(stats->alloc_sites, &stats->site_slab, site);
+}
+
+// Parse a hex pointer field and step past it
+static int parse_pointer(char **cursor, void **out) {
+    char *end;
+    unsigned long long val = strtoull(*cursor, &end, 16);
+    if (end == *cursor) return 0;
+    *out = (void*)(uintptr_t)val;
+    *cursor = end;
+    return 1;
+}
+
+static void handle_alloc(ProcessStats *stats, void *address, size_t size, void *site) {
+    MallocEvent event = { EVENT_ALLOC, address, size, site };
     
-    if (stats->verbose) {
-        printf("%s[MALLOC]%s Allocated %zu bytes at %p\n",
-               COLOR_GREEN, COLOR_RESET, size, addr);
-    }
+    // Growth pairing needs the parse-order timeline, so do it here
+    attribute_heap_growth(stats, address, size, site);
+    dispatch_malloc_event(stats, &event);
+}
+
+static void handle_free(ProcessStats *stats, void *address) {
+    MallocEvent event = { EVENT_FREE, address, 0, NULL };
+    dispatch_malloc_event(stats, &event);
 }
 
-// Track a free operation
-static void track_free(ProcessStats *stats, void *addr) {
-    unsigned int idx = hash_addr(addr);
-    MallocBlock **current = &stats->malloc_hash_table[idx];
-    
-    while (*current) {
-        if ((*current)->address == addr) {
-            MallocBlock *to_remove = *current;
-            *current = (*current)->next;
-            
-            stats->malloc_frees++;
-            stats->malloc_bytes_freed += to_remove->size;
-            
-            if (stats->verbose) {
-                printf("%s[MALLOC]%s Freed %zu bytes at %p\n",
-                       COLOR_YELLOW, COLOR_RESET, to_remove->size, addr);
+// Parse one interceptor line
+static void handle_event_line(ProcessStats *stats, char *line) {
+    stats->event_seq++;
+    stats->overhead.events_ingested++;
+    
+    // ALLOC/FREE are the hot path: decode by hand and hand off to a shard
+    if (strncmp(line, "ALLOC ", 6) == 0 || strncmp(line, "CALLOC ", 7) == 0) {
+        int zeroed = line[0] == 'C';
+        char *cursor = line + (zeroed ? 7 : 6);
+        char *end;
+        void *address;
+        void *site = NULL;  // Older interceptors don't send a site
+        if (parse_pointer(&cursor, &address)) {
+            size_t size = strtoull(cursor, &end, 10);
+            if (end != cursor) {
+                cursor = end;
+                parse_pointer(&cursor, &site);
+                if (stats->alloc_trace.enabled) {
+                    record_alloc(&stats->alloc_trace, zeroed ? ALLOC_OP_CALLOC : ALLOC_OP_MALLOC,
+                                 address, NULL, size);
+                }
+                handle_alloc(stats, address, size, site);
+                return;
             }
-            
-            free(to_remove);
+        }
+    } else if (strncmp(line, "FREE ", 5) == 0) {
+        char *cursor = line + 5;
+        void *address;
+        if (parse_pointer(&cursor, &address)) {
+            if (stats->alloc_trace.enabled) {
+                record_alloc(&stats->alloc_trace, ALLOC_OP_FREE, address, NULL, 0);
+            }
+            handle_free(stats, address);
+            return;
+        }
+    } else if (strncmp(line, "REALLOC ", 8) == 0) {
+        // old new size site; a failed realloc (new NULL, size > 0) frees nothing
+        char *cursor = line + 8;
+        char *end;
+        void *old, *address;
+        void *site = NULL;
+        if (parse_pointer(&cursor, &old) && parse_pointer(&cursor, &address)) {
+            size_t size = strtoull(cursor, &end, 10);
+            if (end != cursor) {
+                cursor = end;
+                parse_pointer(&cursor, &site);
+                if (stats->alloc_trace.enabled) {
+                    record_alloc(&stats->alloc_trace, ALLOC_OP_REALLOC, address, old, size);
+                }
+                if (old && (address || size == 0)) handle_free(stats, old);
+                if (address) handle_alloc(stats, address, size, site);
+                return;
+            }
+        }
+    } else if (strncmp(line, "SYS ", 4) == 0) {
+        // libc wrapper call (--no-ptrace): nr ret ns a0 a1 a2 a3 [path]
+        long nr, ret;
+        unsigned long long ns;
+        unsigned long args[4];
+        int path_at = 0;
+        if (sscanf(line + 4, "%ld %ld %llu %lx %lx %lx %lx %n",
+                   &nr, &ret, &ns, &args[0], &args[1], &args[2], &args[3], &path_at) == 7) {
+            const char *path = path_at > 0 && line[4 + path_at] ? line + 4 + path_at : NULL;
+            handle_wrapped_syscall(stats, nr, ret, ns / 1000000.0, args, path);
+            return;
+        }
+    } else if (strncmp(line, "LOCK ", 5) == 0) {
+        // Contended pthread lock (--locks): kind lock site wait_ns
+        char kind;
+        void *lock, *site;
+        unsigned long long ns;
+        if (sscanf(line + 5, "%c %p %p %llu", &kind, &lock, &site, &ns) == 4) {
+            track_lock_event(stats, kind, lock, site, ns);
+            return;
+        }
+    } else if (strncmp(line, "STATS ", 6) == 0) {
+        // Interceptor's own counters, sent once at exit
+        size_t events, dropped;
+        unsigned long long ns;
+        if (sscanf(line + 6, "%zu %zu %llu", &events, &dropped, &ns) == 3) {
+            stats->overhead.interceptor_events += events;
+            stats->overhead.interceptor_dropped += dropped;
+            stats->overhead.interceptor_ms += ns / 1000000.0;
             return;
         }
-        current = &(*current)->next;
     }
     
-    // Free of unknown address - possible double-free
-    if (stats->verbose) {
-        printf("%s[MALLOC]%s Free of unknown address %p (double-free? )\n",
-               COLOR_RED, COLOR_RESET, addr);
-    }
+    stats->overhead.events_dropped++;
 }
 
 // Process malloc events from the interceptor pipe
 void process_malloc_events(ProcessStats *stats) {
-    char buf[4096];
+    char buf[4096 + MAX_EVENT_LINE];
     ssize_t n;
+    struct timespec ingest_start, ingest_end;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ingest_start);
+    
+    // How far behind are we?
+    int backlog = 0;
+    if (ioctl(stats->notify_pipe[0], FIONREAD, &backlog) == 0 &&
+        (size_t)backlog > stats->overhead.pipe_backlog_peak) {
+        stats->overhead.pipe_backlog_peak = backlog;
+    }
     
     // Read all available data from pipe (non-blocking)
-    while ((n = read(stats->notify_pipe[0], buf, sizeof(buf) - 1)) > 0) {
-        buf[n] = '\0';
+    while (1) {
+        // Lines can straddle reads - start with what was left over
+        size_t carry = stats->pipe_carry_len;
+        memcpy(buf, stats->pipe_carry, carry);
+        
+        n = read(stats->notify_pipe[0], buf + carry, sizeof(buf) - carry - 1);
+        if (n <= 0) break;
+        
+        buf[carry + n] = '\0';
         
         // Process each line
         char *line = buf;
@@ -74,23 +181,39 @@ void process_malloc_events(ProcessStats *stats) {
         
         while ((next_line = strchr(line, '\n')) != NULL) {
             *next_line = '\0';
-            
-            // Parse the event
-            if (strncmp(line, "ALLOC ", 6) == 0) {
-                void *addr;
-                size_t size;
-                if (sscanf(line + 6, "%p %zu", &addr, &size) == 2) {
-                    track_malloc(stats, addr, size);
-                }
-            } else if (strncmp(line, "FREE ", 5) == 0) {
-                void *addr;
-                if (sscanf(line + 5, "%p", &addr) == 1) {
-                    track_free(stats, addr);
-                }
-            }
-            
+            handle_event_line(stats, line);
             line = next_line + 1;
         }
+        
+        // Keep the unterminated tail for the next read
+        size_t tail = buf + carry + n - line;
+        if (tail >= MAX_EVENT_LINE) {
+            stats->overhead.events_dropped++;
+            tail = 0;
+        }
+        memmove(stats->pipe_carry, line, tail);
+        stats->pipe_carry_len = tail;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &ingest_end);
+    stats->overhead.ingest_ms += calculate_time_diff(&ingest_start, &ingest_end);
+}
+
+// What a block still live at exit counts as
+int classify_leak(ProcessStats *stats, MallocBlock *block) {
+    // Allocated by libc/ld.so (stdio buffers, thread TLS, ...)
+    if (is_library_allocation(stats, block)) return LEAK_LIBRARY;
+    // Still referenced at exit - not a leak
+    if (block->reach == REACH_REACHABLE) return LEAK_REACHABLE;
+    return LEAK_USER;
+}
+
+void summarize_leaks(ProcessStats *stats, MallocBlock **live, size_t count, LeakSummary *summary) {
+    memset(summary, 0, sizeof(LeakSummary));
+    for (size_t i = 0; i < count; i++) {
+        int kind = classify_leak(stats, live[i]);
+        summary->blocks[kind]++;
+        summary->bytes[kind] += live[i]->size;
     }
 }
 
@@ -104,33 +227,16 @@ void detect_malloc_leaks(ProcessStats *stats) {
            COLOR_RED, COLOR_RESET);
     
     // Count leaked blocks
-    size_t leaked_blocks = 0;
-    size_t leaked_bytes = 0;
-    size_t user_leaked_blocks = 0;
-    size_t user_leaked_bytes = 0;
-    size_t stdio_leaked_bytes = 0;
-    
-    for (int i = 0; i < MALLOC_HASH_SIZE; i++) {
-        MallocBlock *block = stats->malloc_hash_table[i];
-        while (block) {
-            leaked_blocks++;
-            leaked_bytes += block->size;
-            
-            // Common stdio/libc buffer sizes
-            int is_stdio_buffer = (block->size == 1024 || 
-                                  block->size == 4096 || 
-                                  block->size == 8192);
-            
-            if (is_stdio_buffer) {
-                stdio_leaked_bytes += block->size;
-            } else {
-                user_leaked_blocks++;
-                user_leaked_bytes += block->size;
-            }
-            
-            block = block->next;
-        }
-    }
+    size_t live_count = 0;
+    MallocBlock **live = collect_live_blocks(stats, &live_count);
+    
+    LeakSummary leaks;
+    summarize_leaks(stats, live, live_count, &leaks);
+    size_t user_leaked_blocks = leaks.blocks[LEAK_USER];
+    size_t user_leaked_bytes = leaks.bytes[LEAK_USER];
+    size_t stdio_leaked_bytes = leaks.bytes[LEAK_LIBRARY];
+    size_t reachable_blocks = leaks.blocks[LEAK_REACHABLE];
+    size_t reachable_bytes = leaks.bytes[LEAK_REACHABLE];
     
     // Report user leaks
     if (user_leaked_blocks == 0) {
@@ -140,22 +246,21 @@ void detect_malloc_leaks(ProcessStats *stats) {
         printf("%sUSER MEMORY LEAKS DETECTED! %s\n\n", COLOR_RED, COLOR_RESET);
         
         int leak_num = 0;
-        for (int i = 0; i < MALLOC_HASH_SIZE; i++) {
-            MallocBlock *block = stats->malloc_hash_table[i];
-            while (block) {
-                // Only show non-stdio leaks
-                int is_stdio = (block->size == 1024 || 
-                               block->size == 4096 || 
-                               block->size == 8192);
-                
-                if (!is_stdio) {
-                    leak_num++;
-                    printf("%s  Leak #%d:%s\n", COLOR_YELLOW, leak_num, COLOR_RESET);
-                    printf("    Address:     %p\n", block->address);
-                    printf("    Size:        %zu bytes\n\n", block->size);
+        for (size_t i = 0; i < live_count; i++) {
+            MallocBlock *block = live[i];
+            // Only show user leaks
+            if (classify_leak(stats, block) == LEAK_USER) {
+                char site[128];
+                leak_num++;
+                printf("%s  Leak #%d:%s\n", COLOR_YELLOW, leak_num, COLOR_RESET);
+                printf("    Address:     %p\n", block->address);
+                printf("    Size:        %zu bytes\n", block->size);
+                printf("    Call site:   %s\n", format_site(stats, block->site, site, sizeof(site)));
+                if (stats->leak_scan_done) {
+                    printf("    Status:      %s\n",
+                           block->reach == REACH_INDIRECT ? "indirectly lost" : "definitely lost");
                 }
-                
-                block = block->next;
+                printf("\n");
             }
         }
         
@@ -165,18 +270,37 @@ void detect_malloc_leaks(ProcessStats *stats) {
         printf("    User bytes leaked: %s%zu bytes (%.2f KB)%s\n\n", 
                COLOR_RED, user_leaked_bytes, user_leaked_bytes / 1024.0, COLOR_RESET);
     }
+    free(live);
     
     // Report stdio/libc leaks separately
     if (stdio_leaked_bytes > 0) {
         printf("%sℹLIBRARY/STDIO ALLOCATIONS:%s\n", COLOR_CYAN, COLOR_RESET);
-        printf("  These are internal buffers from printf/stdio functions.\n");
+        printf("  These are internal buffers from printf/stdio and other libc functions.\n");
         printf("  They are freed automatically when the program exits.\n");
         printf("  This is normal behavior and NOT a bug.\n\n");
-        printf("  Library allocations: %zu\n", leaked_blocks - user_leaked_blocks);
+        printf("  Library allocations: %zu\n", leaks.blocks[LEAK_LIBRARY]);
         printf("  Library bytes:        %zu bytes (%.2f KB)\n\n", 
                stdio_leaked_bytes, stdio_leaked_bytes / 1024.0);
     }
     
+    // Reachability scan results (--leak-check)
+    if (stats->leak_scan_done) {
+        printf("%sReachability Scan:%s %d thread(s), %.2f MB read in %.2f ms\n",
+               COLOR_BOLD, COLOR_RESET, stats->scan_threads,
+               stats->scan_bytes_read / (1024.0 * 1024.0), stats->scan_time_ms);
+        printf("  Definitely lost:  %zu blocks, %zu bytes\n",
+               stats->reach_blocks[REACH_DEFINITE], stats->reach_bytes[REACH_DEFINITE]);
+        printf("  Indirectly lost:  %zu blocks, %zu bytes\n",
+               stats->reach_blocks[REACH_INDIRECT], stats->reach_bytes[REACH_INDIRECT]);
+        printf("  Still reachable:  %zu blocks, %zu bytes\n",
+               stats->reach_blocks[REACH_REACHABLE], stats->reach_bytes[REACH_REACHABLE]);
+        if (reachable_blocks > 0) {
+            printf("  %s(%zu user block(s), %zu bytes, still referenced at exit - not counted as leaks)%s\n",
+                   COLOR_CYAN, reachable_blocks, reachable_bytes, COLOR_RESET);
+        }
+        printf("\n");
+    }
+    
     // Overall statistics
     printf("%sMalloc Statistics:%s\n", COLOR_BOLD, COLOR_RESET);
     printf("  Total Allocations:  %zu\n", stats->malloc_allocations);
@@ -185,6 +309,14 @@ void detect_malloc_leaks(ProcessStats *stats) {
            stats->malloc_bytes_allocated, stats->malloc_bytes_allocated / 1024.0);
     printf("  Freed:              %zu bytes (%.2f KB)\n", 
            stats->malloc_bytes_freed, stats->malloc_bytes_freed / 1024.0);
+    if (stats->shard_count > 0) {
+        size_t unknown = 0;
+        for (int i = 0; i < stats->shard_count; i++) {
+            unknown += stats->shards[i].unknown_frees;
+        }
+        printf("  Unknown frees:      %zu\n", unknown);
+        printf("  Tracker shards:     %d\n", stats->shard_count);
+    }
     
     printf("\n%s─────────────────────────────────────────────────────%s\n", 
            COLOR_CYAN, COLOR_RESET);
@@ -197,15 +329,8 @@ void detect_malloc_leaks(ProcessStats *stats) {
     }
 }
 
-// Cleanup malloc tracking table
+// Cleanup malloc tracking (block tables belong to the shards)
 void cleanup_malloc_table(ProcessStats *stats) {
-    for (int i = 0; i < MALLOC_HASH_SIZE; i++) {
-        MallocBlock *current = stats->malloc_hash_table[i];
-        while (current) {
-            MallocBlock *next = current->next;
-            free(current);
-            current = next;
-        }
-        stats->malloc_hash_table[i] = NULL;
-    }
+    stop_tracker_shards(stats);
+    memset(stats->alloc_sites, 0, sizeof(stats->alloc_sites));
 }
\ No newline at end of file
@@ -2,14 +2,14 @@
 
 void track_memory_allocation(ProcessStats *stats, void *addr, size_t size, const char *type) {
     // Create new memory block entry
-    MemoryBlock *block = malloc(sizeof(MemoryBlock));
+    MemoryBlock *block = slab_alloc(&stats->memory_slab);
     if (!block) {
         return;  // Out of memory
     }
 
     block->address = addr;
     block->size = size;
-    block->syscall_type = strdup(type);
+    block->syscall_type = type;
     clock_gettime(CLOCK_REALTIME, &block->timestamp);
 
     // Add to front of linked list
@@ -36,17 +36,14 @@ void track_memory_deallocation(ProcessStats *stats, void *addr) {
             stats->total_memory_freed += to_remove->size;
             stats->current_memory_usage -= to_remove->size;
 
-            free((char*)to_remove->syscall_type);
-            free(to_remove);
+            slab_free(&stats->memory_slab, to_remove);
             return;  // Found and freed
         }
         current = &(*current)->next;
     }
     
     if (stats->verbose) {
-        // Silently ignore - this is expected for runtime unmaps    
-        fprintf(stderr, "%s[ERROR]%s Double-free or invalid free detected at %p\n",
-            COLOR_RED, COLOR_RESET, addr);
+        log_event(&stats->log, LOG_INVALID_FREE, 0, (unsigned long)addr, 0, 0, NULL);
     }
     stats->double_free_count++;  
 }
@@ -0,0 +1,371 @@
+#include "../include/oswatch.h"
+#include <dirent.h>
+#include <sys/stat.h>
+
+// oswatch-merge: fold many run profiles into one fleet-wide view
+//
+// Loading dominates, so each worker first loads and folds a contiguous
+// slice of the inputs into a partial profile. The partials are then
+// reduced pairwise - log2(workers) rounds, the merges of each round in
+// parallel - and the survivor is the fleet profile. Every profile field
+// is a sum, a max or a histogram, so the order of merges doesn't matter.
+
+#define MAX_MERGE_THREADS 64
+#define MAX_LOAD_ERRORS_SHOWN 5
+#define MAX_SITES_SHOWN 15
+#define MAX_SYSCALLS_SHOWN 20
+#define MAX_LATENCY_SHOWN 10
+
+typedef struct {
+    char **paths;
+    size_t first;
+    size_t count;
+    Profile profile;
+    int have_profile;          // At least one input loaded
+    size_t loaded;
+    size_t unreadable;
+} MergeSlice;
+
+typedef struct {
+    MergeSlice *into;
+    MergeSlice *from;
+    int failed;
+} MergePair;
+
+static int load_errors = 0;
+
+static void usage(const char *name) {
+    printf("Usage: %s [OPTIONS] <profile|directory>...\n\n", name);
+    printf("Merges profiles written by oswatch --save-profile or --baseline.\n");
+    printf("Directories contribute every *.profile file in them.\n\n");
+    printf("Options:\n");
+    printf("  -j N        Worker threads (default: one per CPU, max %d)\n", MAX_MERGE_THREADS);
+    printf("  -o FILE     Also write the merged profile (usable as --baseline)\n");
+    printf("  -h, --help  Show this help message\n\n");
+    printf("Example:\n");
+    printf("  oswatch --save-profile profiles/run-%%p.profile ./test_foo\n");
+    printf("  %s -o fleet.profile profiles/\n\n", name);
+}
+
+static int add_path(char ***paths, size_t *count, size_t *capacity, const char *path) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 256;
+        char **more = realloc(*paths, grown * sizeof(char*));
+        if (!more) return -1;
+        *paths = more;
+        *capacity = grown;
+    }
+    (*paths)[*count] = strdup(path);
+    if (!(*paths)[*count]) return -1;
+    (*count)++;
+    return 0;
+}
+
+static int add_directory(char ***paths, size_t *count, size_t *capacity, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return -1;
+
+    struct dirent *entry;
+    char path[PATH_MAX];
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len <= 8 || strcmp(entry->d_name + len - 8, ".profile") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (add_path(paths, count, capacity, path) == -1) {
+            closedir(d);
+            return -1;
+        }
+    }
+    closedir(d);
+    return 0;
+}
+
+static void* merge_slice(void *arg) {
+    MergeSlice *slice = arg;
+    Profile next;
+
+    for (size_t i = slice->first; i < slice->first + slice->count; i++) {
+        if (load_profile(slice->paths[i], &next) == -1) {
+            if (__atomic_fetch_add(&load_errors, 1, __ATOMIC_RELAXED) < MAX_LOAD_ERRORS_SHOWN) {
+                fprintf(stderr, "oswatch-merge: %s: %s\n", slice->paths[i],
+                        errno == EINVAL ? "not an oswatch profile" : strerror(errno));
+            }
+            slice->unreadable++;
+            continue;
+        }
+
+        if (!slice->have_profile) {
+            slice->profile = next;
+            slice->have_profile = 1;
+        } else {
+            int merged = merge_profile(&slice->profile, &next) == 0;
+            free_profile(&next);
+            if (!merged) {
+                slice->unreadable++;
+                continue;
+            }
+        }
+        slice->loaded++;
+    }
+    return NULL;
+}
+
+static void* merge_pair(void *arg) {
+    MergePair *pair = arg;
+
+    if (!pair->from->have_profile) return NULL;
+    if (!pair->into->have_profile) {
+        pair->into->profile = pair->from->profile;
+        pair->into->have_profile = 1;
+    } else {
+        pair->failed = merge_profile(&pair->into->profile, &pair->from->profile) == -1;
+        free_profile(&pair->from->profile);
+    }
+    pair->from->have_profile = 0;
+    return NULL;
+}
+
+// Round r merges slice i+2^r into slice i for every i that is a multiple
+// of 2^(r+1); the last merge of each round runs on the calling thread
+static int reduce_slices(MergeSlice *slices, int count) {
+    pthread_t threads[MAX_MERGE_THREADS];
+    MergePair pairs[MAX_MERGE_THREADS];
+    int failed = 0;
+
+    for (int step = 1; step < count; step *= 2) {
+        int n = 0;
+        for (int i = 0; i + step < count; i += 2 * step) {
+            pairs[n].into = &slices[i];
+            pairs[n].from = &slices[i + step];
+            pairs[n].failed = 0;
+            n++;
+        }
+
+        int started = 0;
+        for (int p = 0; p < n - 1; p++) {
+            if (pthread_create(&threads[p], NULL, merge_pair, &pairs[p]) != 0) break;
+            started++;
+        }
+        for (int p = started; p < n; p++) merge_pair(&pairs[p]);
+        for (int p = 0; p < started; p++) pthread_join(threads[p], NULL);
+        for (int p = 0; p < n; p++) failed |= pairs[p].failed;
+    }
+    return failed ? -1 : 0;
+}
+
+static int compare_sites_by_bytes(const void *a, const void *b) {
+    const ProfileSite *sa = *(const ProfileSite * const *)a;
+    const ProfileSite *sb = *(const ProfileSite * const *)b;
+    if (sa->bytes < sb->bytes) return 1;
+    if (sa->bytes > sb->bytes) return -1;
+    return strcmp(sa->site, sb->site);
+}
+
+static int compare_syscalls_by_calls(const void *a, const void *b) {
+    const ProfileSyscall *sa = *(const ProfileSyscall * const *)a;
+    const ProfileSyscall *sb = *(const ProfileSyscall * const *)b;
+    if (sa->calls < sb->calls) return 1;
+    if (sa->calls > sb->calls) return -1;
+    return sa->nr - sb->nr;
+}
+
+static int compare_syscalls_by_p99(const void *a, const void *b) {
+    const ProfileSyscall *sa = *(const ProfileSyscall * const *)a;
+    const ProfileSyscall *sb = *(const ProfileSyscall * const *)b;
+    double pa = latency_quantile(sa->hist, 0.99), pb = latency_quantile(sb->hist, 0.99);
+    if (pa < pb) return 1;
+    if (pa > pb) return -1;
+    return sa->nr - sb->nr;
+}
+
+static void print_fleet(Profile *p) {
+    double runs = p->runs;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           OSWATCH FLEET PROFILE                       ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    if (p->program[0]) {
+        printf("  Runs:             %u of %s\n", p->runs, p->program);
+    } else {
+        printf("  Runs:             %u (several programs)\n", p->runs);
+    }
+    printf("  Wall time:        %.2f ms total, %.2f ms per run\n",
+           p->execution_time_ms, p->execution_time_ms / runs);
+    printf("  Syscalls:         %llu (%llu failed), %.2f ms in the kernel\n",
+           p->total_syscalls, p->failed_syscalls, p->syscall_time_ms);
+    printf("  malloc calls:     %llu, %llu bytes\n",
+           p->malloc_allocations, p->malloc_bytes_allocated);
+    printf("  Peak RSS:         %.0f KB mean, %llu KB largest run\n",
+           p->peak_rss_kb / runs, p->max_rss_kb);
+    if (p->leaked_blocks > 0 || p->fd_leaks > 0) {
+        printf("  %sLeaks:            %llu bytes in %llu blocks from %u run(s); %llu fd(s)%s\n",
+               COLOR_RED, p->leaked_bytes, p->leaked_blocks, p->leaking_runs,
+               p->fd_leaks, COLOR_RESET);
+    } else {
+        printf("  %sLeaks:            none%s\n", COLOR_GREEN, COLOR_RESET);
+    }
+
+    if (p->site_count > 0) {
+        ProfileSite **sites = malloc(p->site_count * sizeof(ProfileSite*));
+        if (sites) {
+            for (int i = 0; i < p->site_count; i++) sites[i] = &p->sites[i];
+            qsort(sites, p->site_count, sizeof(ProfileSite*), compare_sites_by_bytes);
+
+            printf("\n%sTop Leaking Sites:%s\n", COLOR_BOLD, COLOR_RESET);
+            printf("  %-40s %-8s %-10s %s\n", "SITE", "RUNS", "BLOCKS", "BYTES");
+            printf("  ----------------------------------------------------------------------\n");
+            for (int i = 0; i < p->site_count && i < MAX_SITES_SHOWN; i++) {
+                printf("  %-40s %-8u %-10llu %llu\n", sites[i]->site, sites[i]->runs,
+                       sites[i]->blocks, sites[i]->bytes);
+            }
+            if (p->site_count > MAX_SITES_SHOWN) {
+                printf("  ... %d more site(s)\n", p->site_count - MAX_SITES_SHOWN);
+            }
+            free(sites);
+        }
+    }
+
+    if (p->syscall_count == 0) return;
+    ProfileSyscall **calls = malloc(p->syscall_count * sizeof(ProfileSyscall*));
+    if (!calls) return;
+    for (int i = 0; i < p->syscall_count; i++) calls[i] = &p->syscalls[i];
+
+    qsort(calls, p->syscall_count, sizeof(ProfileSyscall*), compare_syscalls_by_calls);
+    printf("\n%sSyscall Distribution:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %-16s %-12s %-8s %-12s %s\n", "SYSCALL", "CALLS", "SHARE", "TIME(ms)", "FAILED");
+    printf("  ----------------------------------------------------------------------\n");
+    for (int i = 0; i < p->syscall_count && i < MAX_SYSCALLS_SHOWN; i++) {
+        ProfileSyscall *s = calls[i];
+        printf("  %-16s %-12llu %5.1f%%   %-12.2f %llu\n", get_syscall_name(s->nr), s->calls,
+               p->total_syscalls ? 100.0 * s->calls / p->total_syscalls : 0.0,
+               s->time_ms, s->failures);
+    }
+    if (p->syscall_count > MAX_SYSCALLS_SHOWN) {
+        printf("  ... %d more syscall(s)\n", p->syscall_count - MAX_SYSCALLS_SHOWN);
+    }
+
+    // Quantiles of a handful of calls say nothing about the fleet
+    int n = 0;
+    for (int i = 0; i < p->syscall_count; i++) {
+        if (p->syscalls[i].calls >= PROFILE_MIN_CALLS) calls[n++] = &p->syscalls[i];
+    }
+    qsort(calls, n, sizeof(ProfileSyscall*), compare_syscalls_by_p99);
+    printf("\n%sWorst Latency (p99):%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  %-16s %-12s %-10s %-10s %s\n", "SYSCALL", "CALLS", "P50(ms)", "P99(ms)", "MAX(ms)");
+    printf("  ----------------------------------------------------------------------\n");
+    for (int i = 0; i < n && i < MAX_LATENCY_SHOWN; i++) {
+        ProfileSyscall *s = calls[i];
+        printf("  %-16s %-12llu %-10.3f %-10.3f %.3f\n", get_syscall_name(s->nr), s->calls,
+               latency_quantile(s->hist, 0.5), latency_quantile(s->hist, 0.99),
+               latency_max(s->hist));
+    }
+    printf("  (latencies are histogram bucket midpoints, good to about 12%%)\n");
+    free(calls);
+}
+
+int main(int argc, char *argv[]) {
+    int threads = 0;
+    const char *output = NULL;
+    char **paths = NULL;
+    size_t count = 0, capacity = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else {
+            struct stat st;
+            int added = stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode) ?
+                        add_directory(&paths, &count, &capacity, argv[i]) :
+                        add_path(&paths, &count, &capacity, argv[i]);
+            if (added == -1) {
+                fprintf(stderr, "oswatch-merge: %s: %s\n", argv[i], strerror(errno));
+                return 1;
+            }
+        }
+    }
+
+    if (count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (threads <= 0) threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > MAX_MERGE_THREADS) threads = MAX_MERGE_THREADS;
+    if ((size_t)threads > count) threads = count;
+    if (threads < 1) threads = 1;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Contiguous slices, the first (count % threads) one longer
+    MergeSlice slices[MAX_MERGE_THREADS];
+    pthread_t workers[MAX_MERGE_THREADS];
+    int started[MAX_MERGE_THREADS];
+    size_t next = 0;
+    for (int t = 0; t < threads; t++) {
+        memset(&slices[t], 0, sizeof(MergeSlice));
+        slices[t].paths = paths;
+        slices[t].first = next;
+        slices[t].count = count / threads + ((size_t)t < count % threads);
+        next += slices[t].count;
+        started[t] = t > 0 && pthread_create(&workers[t], NULL, merge_slice, &slices[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!started[t]) merge_slice(&slices[t]);
+    }
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(workers[t], NULL);
+    }
+
+    size_t loaded = 0, unreadable = 0;
+    for (int t = 0; t < threads; t++) {
+        loaded += slices[t].loaded;
+        unreadable += slices[t].unreadable;
+    }
+    int failed = reduce_slices(slices, threads) == -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (size_t i = 0; i < count; i++) free(paths[i]);
+    free(paths);
+
+    if (load_errors > MAX_LOAD_ERRORS_SHOWN) {
+        fprintf(stderr, "oswatch-merge: ... %d more unreadable profile(s)\n",
+                load_errors - MAX_LOAD_ERRORS_SHOWN);
+    }
+    if (!slices[0].have_profile) {
+        fprintf(stderr, "oswatch-merge: no readable profiles\n");
+        return 1;
+    }
+    if (failed) {
+        fprintf(stderr, "oswatch-merge: out of memory while merging\n");
+        free_profile(&slices[0].profile);
+        return 1;
+    }
+
+    printf("Merged %zu profile(s) (%zu unreadable) with %d thread(s) in %.2f ms\n",
+           loaded, unreadable, threads, calculate_time_diff(&start, &end));
+
+    int result = 0;
+    if (output) {
+        if (save_profile(output, &slices[0].profile) == -1) {
+            fprintf(stderr, "oswatch-merge: cannot write %s: %s\n", output, strerror(errno));
+            result = 1;
+        } else {
+            printf("Merged profile written to %s\n", output);
+        }
+    }
+
+    print_fleet(&slices[0].profile);
+    free_profile(&slices[0].profile);
+    return result;
+}
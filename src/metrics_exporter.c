@@ -0,0 +1,351 @@
+#define _GNU_SOURCE
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// OpenMetrics endpoint (--metrics)
+//
+// A thread of our own answers GET /metrics on a local TCP port or unix
+// socket with the live counters in OpenMetrics text, so Prometheus (or
+// curl) can watch a long-running tracee. Scrapes are answered from the
+// newest live snapshot (live_feed.c), perf counters included, and never
+// touch the trackers; only RSS is read fresh from /proc.
+
+#define METRICS_CLIENT_TIMEOUT_MS 1000
+
+static const char *bound_label[LIVE_LATENCY_BOUNDS + 1] = {
+    "1e-05", "0.0001", "0.001", "0.01", "0.1", "1.0", "10.0", "+Inf"
+};
+
+static int parse_address(MetricsExporter *m, const char *address,
+                         struct sockaddr_storage *addr, socklen_t *len) {
+    memset(addr, 0, sizeof(*addr));
+
+    const char *path = strncmp(address, "unix:", 5) == 0 ? address + 5 :
+                       address[0] == '/' ? address : NULL;
+    if (path) {
+        struct sockaddr_un *un = (struct sockaddr_un*)addr;
+        if (!*path || strlen(path) >= sizeof(un->sun_path)) return -1;
+        un->sun_family = AF_UNIX;
+        strcpy(un->sun_path, path);
+        snprintf(m->unix_path, sizeof(m->unix_path), "%s", path);
+        *len = sizeof(struct sockaddr_un);
+        return 0;
+    }
+
+    // PORT binds loopback; HOST:PORT takes an IPv4 address, * for any
+    struct sockaddr_in *in = (struct sockaddr_in*)addr;
+    const char *colon = strrchr(address, ':');
+    const char *port = colon ? colon + 1 : address;
+    char host[64] = "127.0.0.1";
+
+    if (colon) {
+        size_t n = colon - address;
+        if (n >= sizeof(host)) return -1;
+        memcpy(host, address, n);
+        host[n] = '\0';
+    }
+    char *end;
+    long p = strtol(port, &end, 10);
+    if (!*port || *end || p < 0 || p > 65535) return -1;
+
+    in->sin_family = AF_INET;
+    in->sin_port = htons(p);
+    if (strcmp(host, "*") == 0 || host[0] == '\0') {
+        in->sin_addr.s_addr = htonl(INADDR_ANY);
+    } else if (inet_pton(AF_INET, host, &in->sin_addr) != 1) {
+        return -1;
+    }
+    *len = sizeof(struct sockaddr_in);
+    return 0;
+}
+
+// Called before the tracee starts so a busy port fails the run up front
+int metrics_open(ProcessStats *stats, const char *address) {
+    MetricsExporter *m = &stats->metrics;
+    struct sockaddr_storage addr;
+    socklen_t len;
+
+    if (parse_address(m, address, &addr, &len) == -1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    m->listen_fd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (m->listen_fd == -1) return -1;
+
+    if (m->unix_path[0]) {
+        // Replace a socket left behind by an earlier run, but nothing else
+        struct stat st;
+        if (lstat(m->unix_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+            unlink(m->unix_path);
+        }
+    } else {
+        int one = 1;
+        setsockopt(m->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+
+    if (bind(m->listen_fd, (struct sockaddr*)&addr, len) == -1 ||
+        listen(m->listen_fd, 16) == -1) {
+        int saved = errno;
+        close(m->listen_fd);
+        m->unix_path[0] = '\0';
+        errno = saved;
+        return -1;
+    }
+
+    if (snapshot_buffer_init(&m->feed) == -1) {
+        close(m->listen_fd);
+        return -1;
+    }
+    live_feed_attach(stats, &m->feed, 0);
+
+    m->address = address;
+    m->statm_fd = -1;
+    m->enabled = 1;
+    return 0;
+}
+
+// OpenMetrics label values escape backslash, quote and newline
+static void write_label(FILE *out, const char *value) {
+    for (const char *p = value; *p; p++) {
+        if (*p == '\\' || *p == '"') {
+            fputc('\\', out);
+            fputc(*p, out);
+        } else if (*p == '\n') {
+            fputs("\\n", out);
+        } else {
+            fputc(*p, out);
+        }
+    }
+}
+
+static void family(FILE *out, const char *name, const char *type, const char *help) {
+    fprintf(out, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+static void write_metrics(FILE *out, ProcessStats *stats, LiveSnapshot *s) {
+    MetricsExporter *m = &stats->metrics;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    family(out, "oswatch_tracee", "info", "The traced program.");
+    fprintf(out, "oswatch_tracee_info{program=\"");
+    write_label(out, stats->process_name);
+    fprintf(out, "\",pid=\"%d\"} 1\n", stats->pid);
+
+    family(out, "oswatch_uptime_seconds", "gauge", "Time since oswatch started.");
+    fprintf(out, "oswatch_uptime_seconds %.3f\n",
+            calculate_time_diff(&stats->start_time, &now) / 1000.0);
+    family(out, "oswatch_snapshot_age_seconds", "gauge",
+           "How old the counters below are; they refresh while the tracee is active.");
+    fprintf(out, "oswatch_snapshot_age_seconds %.3f\n",
+            s->taken.tv_sec ? calculate_time_diff(&s->taken, &now) / 1000.0 : 0);
+
+    family(out, "oswatch_syscalls", "counter", "System calls made by the tracee.");
+    fprintf(out, "oswatch_syscalls_total %llu\n", s->total_syscalls);
+    family(out, "oswatch_syscall_failures", "counter", "System calls that returned an error.");
+    fprintf(out, "oswatch_syscall_failures_total %llu\n", s->failed_syscalls);
+    family(out, "oswatch_syscall_time_seconds", "counter", "Time spent in system calls.");
+    fprintf(out, "oswatch_syscall_time_seconds_total %.6f\n", s->syscall_seconds);
+
+    family(out, "oswatch_syscall_calls", "counter", "System calls by name.");
+    for (int i = 0; i < s->syscall_count; i++) {
+        fprintf(out, "oswatch_syscall_calls_total{syscall=\"%s\"} %llu\n",
+                get_syscall_name(s->syscalls[i].nr), s->syscalls[i].calls);
+    }
+
+    family(out, "oswatch_syscall_duration_seconds", "histogram", "System call latency by name.");
+    for (int i = 0; i < s->syscall_count; i++) {
+        LiveSyscall *sc = &s->syscalls[i];
+        const char *name = get_syscall_name(sc->nr);
+        if (sc->timed == 0) continue;
+        for (int b = 0; b <= LIVE_LATENCY_BOUNDS; b++) {
+            fprintf(out, "oswatch_syscall_duration_seconds_bucket{syscall=\"%s\",le=\"%s\"} %llu\n",
+                    name, bound_label[b], sc->buckets[b]);
+        }
+        fprintf(out, "oswatch_syscall_duration_seconds_sum{syscall=\"%s\"} %.6f\n", name, sc->seconds);
+        fprintf(out, "oswatch_syscall_duration_seconds_count{syscall=\"%s\"} %llu\n", name, sc->timed);
+    }
+
+    family(out, "oswatch_malloc_allocations", "counter", "malloc-family allocations.");
+    fprintf(out, "oswatch_malloc_allocations_total %llu\n", s->malloc_allocations);
+    family(out, "oswatch_malloc_frees", "counter", "Frees of tracked blocks.");
+    fprintf(out, "oswatch_malloc_frees_total %llu\n", s->malloc_frees);
+    family(out, "oswatch_malloc_allocated_bytes", "counter", "Bytes handed out by malloc.");
+    fprintf(out, "oswatch_malloc_allocated_bytes_total %llu\n", s->malloc_bytes_allocated);
+    family(out, "oswatch_malloc_live_bytes", "gauge", "Bytes allocated and not yet freed.");
+    fprintf(out, "oswatch_malloc_live_bytes %llu\n", s->malloc_live_bytes);
+    family(out, "oswatch_malloc_live_blocks", "gauge", "Blocks allocated and not yet freed.");
+    fprintf(out, "oswatch_malloc_live_blocks %llu\n", s->malloc_live_blocks);
+    family(out, "oswatch_malloc_allocation_rate", "gauge",
+           "Allocations per second between the last two snapshots.");
+    fprintf(out, "oswatch_malloc_allocation_rate %.1f\n", s->allocation_rate);
+
+    family(out, "oswatch_open_fds", "gauge", "Descriptors the tracee opened and has not closed.");
+    fprintf(out, "oswatch_open_fds{kind=\"file\"} %ld\n", s->open_files);
+    fprintf(out, "oswatch_open_fds{kind=\"socket\"} %ld\n", s->open_sockets);
+
+    if (s->counters_available) {
+        family(out, "oswatch_task_clock_seconds", "counter",
+               "CPU time of the tracee and its threads (task-clock).");
+        fprintf(out, "oswatch_task_clock_seconds_total %.6f\n",
+                s->counters[COUNTER_TASK_CLOCK] / 1e9);
+        family(out, "oswatch_page_faults", "counter", "Page faults taken by the tracee.");
+        fprintf(out, "oswatch_page_faults_total{kind=\"minor\"} %llu\n",
+                s->counters[COUNTER_MINOR_FAULTS]);
+        fprintf(out, "oswatch_page_faults_total{kind=\"major\"} %llu\n",
+                s->counters[COUNTER_MAJOR_FAULTS]);
+        family(out, "oswatch_context_switches", "counter", "Times the tracee was switched out.");
+        fprintf(out, "oswatch_context_switches_total %llu\n",
+                s->counters[COUNTER_CONTEXT_SWITCHES]);
+        family(out, "oswatch_cpu_migrations", "counter", "Moves of the tracee to another CPU.");
+        fprintf(out, "oswatch_cpu_migrations_total %llu\n", s->counters[COUNTER_CPU_MIGRATIONS]);
+    }
+
+    char buf[128];
+    unsigned long size, resident;
+    ssize_t n = m->statm_fd != -1 ? pread(m->statm_fd, buf, sizeof(buf) - 1, 0) : -1;
+    if (n > 0) {
+        buf[n] = '\0';
+        if (sscanf(buf, "%lu %lu", &size, &resident) == 2) {
+            family(out, "oswatch_rss_bytes", "gauge", "Resident set size of the tracee.");
+            fprintf(out, "oswatch_rss_bytes %lu\n", resident * m->page_kb * 1024);
+        }
+    }
+
+    fprintf(out, "# EOF\n");
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Read up to the end of the request header; a slow client gets dropped
+static int read_request(int fd, char *buf, size_t len) {
+    size_t used = 0;
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    while (used < len - 1) {
+        int ready = poll(&pfd, 1, METRICS_CLIENT_TIMEOUT_MS);
+        if (ready == -1 && errno == EINTR) continue;
+        if (ready <= 0) return -1;
+
+        ssize_t n = recv(fd, buf + used, len - 1 - used, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        used += n;
+        buf[used] = '\0';
+        if (strstr(buf, "\r\n\r\n") || strstr(buf, "\n\n")) return 0;
+    }
+    return -1;
+}
+
+static void serve_client(ProcessStats *stats, int fd) {
+    MetricsExporter *m = &stats->metrics;
+    char request[METRICS_REQUEST_MAX];
+
+    if (read_request(fd, request, sizeof(request)) == -1) return;
+
+    if (strncmp(request, "GET /metrics ", 13) != 0 && strncmp(request, "GET / ", 6) != 0) {
+        static const char not_found[] =
+            "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n"
+            "Content-Length: 10\r\nConnection: close\r\n\r\nNot Found\n";
+        send_all(fd, not_found, sizeof(not_found) - 1);
+        return;
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+    FILE *out = open_memstream(&body, &body_len);
+    if (!out) return;
+    write_metrics(out, stats, snapshot_take(&m->feed));
+    fclose(out);
+
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.0 200 OK\r\n"
+                     "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                     "Content-Length: %zu\r\nConnection: close\r\n\r\n", body_len);
+    if (send_all(fd, header, n) == 0) {
+        send_all(fd, body, body_len);
+    }
+    free(body);
+    m->scrapes++;
+}
+
+static void* metrics_thread(void *arg) {
+    ProcessStats *stats = arg;
+    MetricsExporter *m = &stats->metrics;
+    struct pollfd fds[2];
+
+    fds[0].fd = m->listen_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m->stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    while (1) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (!(fds[0].revents & POLLIN)) continue;
+
+        int client = accept4(m->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client == -1) continue;
+        serve_client(stats, client);
+        close(client);
+    }
+    return NULL;
+}
+
+void start_metrics_exporter(pid_t pid, ProcessStats *stats) {
+    MetricsExporter *m = &stats->metrics;
+    if (!m->enabled) return;
+
+    char statm[64];
+    snprintf(statm, sizeof(statm), "/proc/%d/statm", pid);
+    m->statm_fd = open(statm, O_RDONLY | O_CLOEXEC);
+    m->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+
+    if (pipe(m->stop_pipe) == -1) return;
+    m->running = pthread_create(&m->thread, NULL, metrics_thread, stats) == 0;
+    if (!m->running) {
+        close(m->stop_pipe[0]);
+        close(m->stop_pipe[1]);
+    }
+}
+
+void stop_metrics_exporter(ProcessStats *stats) {
+    MetricsExporter *m = &stats->metrics;
+    if (!m->enabled) return;
+
+    if (m->running) {
+        if (write(m->stop_pipe[1], "x", 1) != 1) {
+            perror("metrics exporter stop failed");
+        }
+        pthread_join(m->thread, NULL);
+        m->running = 0;
+        close(m->stop_pipe[0]);
+        close(m->stop_pipe[1]);
+    }
+
+    if (m->statm_fd != -1) close(m->statm_fd);
+    close(m->listen_fd);
+    if (m->unix_path[0]) unlink(m->unix_path);
+    snapshot_buffer_free(&m->feed);
+    m->enabled = 0;
+}
@@ -0,0 +1,89 @@
+#include "../include/oswatch.h"
+#include <linux/perf_event.h>
+
+// Software perf counters on the tracee
+//
+// Opened from the parent right after fork while the child waits to exec,
+// and armed with enable_on_exec so oswatch's own pre-exec setup is not
+// counted. They need no PMU. inherit=1 folds in every thread and child
+// the tracee creates. Live snapshots read them on every publish
+// (live_feed.c); exited children's counts are folded in as they go, which
+// is why the final read happens after the tracee has been reaped.
+
+static const struct {
+    unsigned long long config;
+    const char *name;
+} counter_events[COUNTER_COUNT] = {
+    [COUNTER_TASK_CLOCK]       = { PERF_COUNT_SW_TASK_CLOCK,       "task-clock" },
+    [COUNTER_MINOR_FAULTS]     = { PERF_COUNT_SW_PAGE_FAULTS_MIN,  "minor-faults" },
+    [COUNTER_MAJOR_FAULTS]     = { PERF_COUNT_SW_PAGE_FAULTS_MAJ,  "major-faults" },
+    [COUNTER_CONTEXT_SWITCHES] = { PERF_COUNT_SW_CONTEXT_SWITCHES, "context-switches" },
+    [COUNTER_CPU_MIGRATIONS]   = { PERF_COUNT_SW_CPU_MIGRATIONS,   "cpu-migrations" },
+};
+
+static int open_counter(pid_t pid, unsigned long long config, int user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.inherit = 1;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.exclude_kernel = user_only;
+    attr.exclude_hv = user_only;
+
+    return syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+void open_perf_counters(pid_t pid, ProcessStats *stats) {
+    PerfCounters *perf = &stats->perf;
+
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        perf->fds[i] = open_counter(pid, counter_events[i].config, perf->user_only);
+
+        // perf_event_paranoid >= 2: retry everything with kernel events excluded
+        if (perf->fds[i] == -1 && (errno == EACCES || errno == EPERM) && !perf->user_only) {
+            for (int j = 0; j < i; j++) {
+                close(perf->fds[j]);
+            }
+            perf->user_only = 1;
+            i = -1;
+            continue;
+        }
+        if (perf->fds[i] != -1) {
+            perf->available = 1;
+        } else if (stats->verbose) {
+            fprintf(stderr, "%s[PERF]%s %s counter unavailable: %s\n",
+                    COLOR_YELLOW, COLOR_RESET, counter_events[i].name, strerror(errno));
+        }
+    }
+}
+
+// Counters only grow, so each read simply replaces the last
+void read_perf_counters(ProcessStats *stats) {
+    PerfCounters *perf = &stats->perf;
+    if (!perf->available) return;
+
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        uint64_t value;
+        if (perf->fds[i] != -1 && read(perf->fds[i], &value, sizeof(value)) == sizeof(value)) {
+            perf->values[i] = value;
+        }
+    }
+    perf->reads++;
+}
+
+void close_perf_counters(ProcessStats *stats) {
+    PerfCounters *perf = &stats->perf;
+    if (!perf->available) return;
+
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (perf->fds[i] != -1) {
+            close(perf->fds[i]);
+            perf->fds[i] = -1;
+        }
+    }
+    perf->available = 0;
+}
@@ -1,5 +1,82 @@
 #include "../include/oswatch.h"
 #include <fcntl.h>
+#include <poll.h>
+
+static int ingest_stop_pipe[2] = { -1, -1 };
+
+// Drain the interceptor pipe while the tracee runs. Without this a
+// multi-threaded tracee can fill the pipe while its traced thread sits in
+// a blocking syscall (e.g. pthread_join), and both sides wait forever.
+static void* ingest_thread(void *arg) {
+    ProcessStats *stats = arg;
+    struct pollfd fds[2];
+
+    fds[0].fd = stats->notify_pipe[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = ingest_stop_pipe[0];
+    fds[1].events = POLLIN;
+
+    // Live views want fresh snapshots even while the traced thread blocks
+    int timeout = stats->live.reader_count ? (int)LIVE_PUBLISH_INTERVAL_MS : -1;
+
+    while (1) {
+        int ready = poll(fds, 2, timeout);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (ready == 0) {
+            pthread_mutex_lock(&stats->lock);
+            publish_live_snapshot(stats);
+            pthread_mutex_unlock(&stats->lock);
+            continue;
+        }
+        if (fds[1].revents) break;
+
+        if (fds[0].revents & POLLIN) {
+            pthread_mutex_lock(&stats->lock);
+            process_malloc_events(stats);
+            trace_counters(stats);
+            publish_live_snapshot(stats);
+            // No exit stop without ptrace; map code while the tracee is alive
+            if (stats->no_ptrace && stats->code_mapping_count == 0) {
+                snapshot_code_mappings(stats->pid, stats);
+            }
+            pthread_mutex_unlock(&stats->lock);
+        } else if (fds[0].revents & (POLLHUP | POLLERR)) {
+            break;  // Every writer is gone
+        }
+    }
+    return NULL;
+}
+
+// --no-ptrace: the ingest thread does all the work, we only wait for exit
+static void wait_untraced(pid_t pid, ProcessStats *stats) {
+    int status;
+
+    while (1) {
+        if (wait4(pid, &status, WUNTRACED, &stats->tracee_rusage) == -1) {
+            if (errno == EINTR) continue;
+            perror("wait4 failed");
+            return;
+        }
+        // A hard budget stopped it; report now and leave it stopped
+        if (WIFSTOPPED(status)) {
+            if (__atomic_load_n(&stats->budget.stopped, __ATOMIC_ACQUIRE)) return;
+            continue;
+        }
+        break;
+    }
+    stats->have_rusage = 1;
+
+    if (stats->verbose) {
+        if (WIFEXITED(status)) {
+            log_event(&stats->log, LOG_EXITED, WEXITSTATUS(status), 0, 0, 0, NULL);
+        } else if (WIFSIGNALED(status)) {
+            log_event(&stats->log, LOG_SIGNALED, WTERMSIG(status), 0, 0, 0, NULL);
+        }
+    }
+}
 
 int launch_and_monitor(char *program, char **args, ProcessStats *stats) {
     // Create pipe for malloc interceptor communication
@@ -12,10 +89,19 @@ int launch_and_monitor(char *program, char **args, ProcessStats *stats) {
     int flags = fcntl(stats->notify_pipe[0], F_GETFL, 0);
     fcntl(stats->notify_pipe[0], F_SETFL, flags | O_NONBLOCK);
     
+    // Child holds off exec until the perf counters are attached
+    int exec_gate[2];
+    if (pipe(exec_gate) == -1) {
+        perror("pipe failed");
+        return -1;
+    }
+    
     pid_t child_pid = fork();
 
     if (child_pid == -1) {
         perror("fork failed");
+        close(exec_gate[0]);
+        close(exec_gate[1]);
         return -1;
     }
 
@@ -25,18 +111,54 @@ int launch_and_monitor(char *program, char **args, ProcessStats *stats) {
         // Close read end of pipe
         close(stats->notify_pipe[0]);
         
+        char go;
+        close(exec_gate[1]);
+        if (read(exec_gate[0], &go, 1) != 1) {
+            exit(1);  // Parent gave up on us
+        }
+        close(exec_gate[0]);
+        
+        // stdout carries the JSON report; keep the program's output off it
+        if (stats->report_format == REPORT_JSON && !stats->report_path) {
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+        }
+
+        // --top owns the screen; the program's output would tear it
+        if (stats->top.enabled) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            if (null_fd != -1) {
+                dup2(null_fd, STDOUT_FILENO);
+                dup2(null_fd, STDERR_FILENO);
+                close(null_fd);
+            }
+        }
+        
         // Set environment variable for interceptor
         char fd_str[32];
         snprintf(fd_str, sizeof(fd_str), "%d", stats->notify_pipe[1]);
         setenv("OSWATCH_NOTIFY_FD", fd_str, 1);
         
+        // exec keeps our pid; anything the tracee forks or execs won't match
+        char pid_str[32];
+        snprintf(pid_str, sizeof(pid_str), "%d", getpid());
+        setenv("OSWATCH_TRACEE_PID", pid_str, 1);
+        
         // Set LD_PRELOAD to load our interceptor
         setenv("LD_PRELOAD", "./liboswatch_malloc.so", 1);
 
-        // Allow parent to trace this process
-        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1) {
-            perror("ptrace TRACEME failed");
-            exit(1);
+        if (stats->lock_profile) {
+            setenv("OSWATCH_LOCKS", "1", 1);
+        }
+
+        if (stats->no_ptrace) {
+            // The interceptor reports libc I/O calls in place of ptrace stops
+            setenv("OSWATCH_IO_WRAP", "1", 1);
+        } else {
+            // Allow parent to trace this process
+            if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) == -1) {
+                perror("ptrace TRACEME failed");
+                exit(1);
+            }
         }
 
         // Execute target program
@@ -53,26 +175,88 @@ int launch_and_monitor(char *program, char **args, ProcessStats *stats) {
         close(stats->notify_pipe[1]);
         
         stats->pid = child_pid;
+        trace_begin(stats, child_pid);
+
+        // Attach counters before exec; inherit covers threads and children
+        close(exec_gate[0]);
+        open_perf_counters(child_pid, stats);
+        if (write(exec_gate[1], "x", 1) != 1) {
+            perror("exec gate failed");
+        }
+        close(exec_gate[1]);
+
+        if (!stats->no_ptrace) {
+            // Wait for child to stop after PTRACE_TRACEME
+            int status;
+            waitpid(child_pid, &status, 0);
+            
+            // That stop is execve returning; ld.so hasn't run yet
+            if (stats->startup.enabled) {
+                startup_exec_stop(child_pid, stats);
+            }
+
+            // Set ptrace options (exit stop keeps memory readable for the leak scan)
+            if (ptrace(PTRACE_SETOPTIONS, child_pid, 0, 
+                       PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL | PTRACE_O_TRACEEXIT) == -1) {
+                perror("ptrace SETOPTIONS failed");
+                return -1;
+            }
+        }
 
-        // Wait for child to stop after PTRACE_TRACEME
-        int status;
-        waitpid(child_pid, &status, 0);
+        // Keep the interceptor pipe flowing while the tracee runs
+        pthread_t ingest;
+        int ingest_running = 0;
+        if (pipe(ingest_stop_pipe) == 0) {
+            ingest_running = pthread_create(&ingest, NULL, ingest_thread, stats) == 0;
+        }
 
-        // Set ptrace options
-        if (ptrace(PTRACE_SETOPTIONS, child_pid, 0, 
-                   PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL) == -1) {
-            perror("ptrace SETOPTIONS failed");
-            return -1;
+        if (stats->sched.enabled) {
+            start_sched_sampler(child_pid, stats);
         }
+        start_metrics_exporter(child_pid, stats);
+        start_top_dashboard(child_pid, stats);
 
         // Start monitoring
-        monitor_process(child_pid, stats);
+        if (stats->no_ptrace) {
+            wait_untraced(child_pid, stats);
+        } else {
+            monitor_process(child_pid, stats);
+        }
+        stop_sched_sampler(stats);
+        stop_metrics_exporter(stats);
+        stop_top_dashboard(stats);
+        stop_budget_watch(stats);
+
+        if (ingest_running) {
+            if (write(ingest_stop_pipe[1], "x", 1) != 1) {
+                perror("ingest stop failed");
+            }
+            pthread_join(ingest, NULL);
+        }
+        close(ingest_stop_pipe[0]);
+        close(ingest_stop_pipe[1]);
+
+        // Reaped, so every thread's counts have been folded in
+        read_perf_counters(stats);
+        close_perf_counters(stats);
 
-        // Process any remaining malloc events
+        // Process any remaining malloc events and fold the shards together
         process_malloc_events(stats);
+        tracker_sync(stats);
+        log_close(stats);
+        if (trace_close(stats) == -1) {
+            fprintf(stderr, "%s[ERROR]%s Writing %s failed\n",
+                    COLOR_RED, COLOR_RESET, stats->trace.path);
+        }
+        if (alloc_trace_close(stats) == -1) {
+            fprintf(stderr, "%s[ERROR]%s Writing %s failed\n",
+                    COLOR_RED, COLOR_RESET, stats->alloc_trace.path);
+        }
         
-        // Close pipe
-        close(stats->notify_pipe[0]);
+        // Close pipe (a tracee a budget left stopped may still be resumed)
+        if (!stats->budget.stopped) {
+            close(stats->notify_pipe[0]);
+        }
 
         // Record end time
         clock_gettime(CLOCK_MONOTONIC, &stats->end_time);
@@ -84,29 +268,53 @@ int launch_and_monitor(char *program, char **args, ProcessStats *stats) {
 void monitor_process(pid_t pid, ProcessStats *stats) {
     int status;
     int in_syscall = 0;
+    int inject_signal = 0;
+    int held = 0;  // Tracee is stopped and waiting on us
     struct user_regs_struct regs;
     struct timespec syscall_start, syscall_end;
+    struct timespec stopped_at, t0, t1;
+    struct rusage usage;
+    TracerOverhead *ov = &stats->overhead;
     
     while (1) {
         // Process malloc events from interceptor
+        pthread_mutex_lock(&stats->lock);
         process_malloc_events(stats);
+        trace_counters(stats);
+        publish_live_snapshot(stats);
+        pthread_mutex_unlock(&stats->lock);
         
-        // Continue execution until next syscall
-        if (ptrace(PTRACE_SYSCALL, pid, 0, 0) == -1) {
+        // Everything since the last stop was time the tracee couldn't run
+        if (held) {
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            ov->stopped_ms += calculate_time_diff(&stopped_at, &t0);
+            held = 0;
+        }
+        
+        // Continue execution until next syscall, delivering any pending signal
+        if (ptrace(PTRACE_SYSCALL, pid, 0, inject_signal) == -1) {
             break;
         }
+        inject_signal = 0;
         
         // Wait for child to stop
-        if (waitpid(pid, &status, 0) == -1) {
-            perror("waitpid failed");
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (wait4(pid, &status, 0, &usage) == -1) {
+            perror("wait4 failed");
             break;
         }
+        clock_gettime(CLOCK_MONOTONIC, &stopped_at);
+        ov->waitpid_ms += calculate_time_diff(&t0, &stopped_at);
+        
+        if (WIFEXITED(status) || WIFSIGNALED(status)) {
+            stats->tracee_rusage = usage;
+            stats->have_rusage = 1;
+        }
         
         // Check if process exited
         if (WIFEXITED(status)) {
             if (stats->verbose) {
-                printf("%s[PROCESS]%s Exited with code %d\n", 
-                       COLOR_YELLOW, COLOR_RESET, WEXITSTATUS(status));
+                log_event(&stats->log, LOG_EXITED, WEXITSTATUS(status), 0, 0, 0, NULL);
             }
             break;
         }
@@ -114,40 +322,98 @@ void monitor_process(pid_t pid, ProcessStats *stats) {
         // Check if process was terminated by signal
         if (WIFSIGNALED(status)) {
             if (stats->verbose) {
-                printf("%s[PROCESS]%s Terminated by signal %d\n", 
-                       COLOR_RED, COLOR_RESET, WTERMSIG(status));
+                log_event(&stats->log, LOG_SIGNALED, WTERMSIG(status), 0, 0, 0, NULL);
             }
             break;
         }
         
+        ov->ptrace_stops++;
+        held = 1;
+        
         // Check if stopped by syscall
         if (WIFSTOPPED(status)) {
             int stop_signal = WSTOPSIG(status);
             
+            // The --startup breakpoint on main
+            if (stop_signal == SIGTRAP && stats->startup.breakpoint) {
+                pthread_mutex_lock(&stats->lock);
+                int hit = startup_breakpoint(pid, stats);
+                pthread_mutex_unlock(&stats->lock);
+                if (hit) continue;
+            }
+            
+            // A hard budget stopped it: let go so it stays stopped for inspection
+            if (stop_signal == SIGSTOP && __atomic_load_n(&stats->budget.stopped, __ATOMIC_ACQUIRE)) {
+                pthread_mutex_lock(&stats->lock);
+                snapshot_code_mappings(pid, stats);
+                pthread_mutex_unlock(&stats->lock);
+                ptrace(PTRACE_DETACH, pid, 0, SIGSTOP);
+                break;
+            }
+            
             if (stop_signal != SIGTRAP && stop_signal != (SIGTRAP | 0x80)) {
-                ptrace(PTRACE_SYSCALL, pid, 0, stop_signal);
+                // Not ours - pass it on when we resume
+                inject_signal = stop_signal;
                 continue;
             }
             
             if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXIT << 8))) {
-                break;
+                // Tracee is exiting but its memory is still mapped
+                pthread_mutex_lock(&stats->lock);
+                read_perf_counters(stats);
+                snapshot_code_mappings(pid, stats);
+                pthread_mutex_unlock(&stats->lock);
+                
+                if (stats->leak_scan) {
+                    pthread_mutex_lock(&stats->lock);
+                    process_malloc_events(stats);
+                    tracker_sync(stats);
+                    if (scan_reachability(pid, stats) == -1) {
+                        fprintf(stderr, "%s[ERROR]%s Reachability scan failed\n",
+                                COLOR_RED, COLOR_RESET);
+                    }
+                    pthread_mutex_unlock(&stats->lock);
+                }
+                continue;
             }
         }
         
         // Get register values
+        clock_gettime(CLOCK_MONOTONIC, &t0);
         if (ptrace(PTRACE_GETREGS, pid, 0, &regs) == -1) {
             break;
         }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ov->getregs_ms += calculate_time_diff(&t0, &t1);
         
+        double delay_ms = 0;
+        pthread_mutex_lock(&stats->lock);
         if (! in_syscall) {
             clock_gettime(CLOCK_MONOTONIC, &syscall_start);
             handle_syscall_entry(&regs, stats);
+            if (stats->inject.count > 0) {
+                delay_ms = inject_syscall_entry(pid, &regs, stats);
+            }
             in_syscall = 1;
         } else {
             clock_gettime(CLOCK_MONOTONIC, &syscall_end);
             double duration = calculate_time_diff(&syscall_start, &syscall_end);
+            if (stats->inject.count > 0) {
+                inject_syscall_exit(pid, &regs, stats);
+            }
             handle_syscall_exit(&regs, stats, duration);
             in_syscall = 0;
         }
+        pthread_mutex_unlock(&stats->lock);
+        
+        // An injected delay holds the tracee at entry; it isn't our overhead
+        if (delay_ms > 0) {
+            long long ns = (long long)(delay_ms * 1000000.0);
+            struct timespec nap = { ns / 1000000000LL, ns % 1000000000LL };
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            while (nanosleep(&nap, &nap) == -1 && errno == EINTR);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            ov->stopped_ms -= calculate_time_diff(&t0, &t1);
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,506 @@
+#include "../include/oswatch.h"
+#include <math.h>
+
+// Run profiles
+//
+// A profile is the part of a run worth comparing later: per-syscall counts
+// and latency histograms, malloc totals, leaked bytes by call site and peak
+// RSS. Every field is a sum or a histogram, so profiles of many runs merge
+// into one without losing anything the comparison or fleet view uses. On
+// disk it is a little-endian stream of fixed-width fields:
+//
+//   "OSWPROF\0" u32 version u32 runs str program f64 execution_ms
+//   u64 syscalls u64 failed f64 syscall_ms u64 mallocs u64 frees
+//   u64 bytes_allocated u64 bytes_freed u64 leaked_blocks u64 leaked_bytes
+//   u32 leaking_runs u64 fd_leaks u64 peak_rss_kb u64 max_rss_kb
+//   u32 n { u16 nr u64 calls u64 failures f64 ms u8 k { u8 bucket u64 count }*k }*n
+//   u32 n { str site u64 blocks u64 bytes u32 runs }*n
+//
+// str is a u16 length and the bytes. Only non-empty histogram buckets are
+// stored, so a typical profile is a few KB.
+
+static const char profile_magic[8] = "OSWPROF";
+
+// Bucket 0 is under 1us; after that four buckets per power of two
+static int latency_bucket(unsigned long long ns) {
+    if (ns < 1024) return 0;
+    int octave = 63 - __builtin_clzll(ns);
+    int bucket = 1 + (octave - 10) * 4 + (int)((ns >> (octave - 2)) & 3);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// Midpoint of a bucket in ms
+static double bucket_ms(int bucket) {
+    if (bucket == 0) return 0.0005;
+    int octave = 10 + (bucket - 1) / 4;
+    int sub = (bucket - 1) % 4;
+    double low = (double)((4ULL + sub) << (octave - 2));
+    double high = (double)((5ULL + sub) << (octave - 2));
+    return (low + high) / 2 / 1e6;
+}
+
+// Upper edge of a bucket in ms; nothing in it took longer
+double latency_bucket_limit_ms(int bucket) {
+    if (bucket == 0) return 1024 / 1e6;
+    if (bucket >= LATENCY_BUCKETS - 1) return INFINITY;
+    int octave = 10 + (bucket - 1) / 4;
+    int sub = (bucket - 1) % 4;
+    return (double)((5ULL + sub) << (octave - 2)) / 1e6;
+}
+
+void track_syscall_latency(ProcessStats *stats, long nr, double duration) {
+    if (nr < 0 || nr >= MAX_SYSCALL_NUM) return;
+
+    LatencyHistogram *h = stats->syscall_latency[nr];
+    if (!h) {
+        h = slab_alloc(&stats->latency_slab);
+        if (!h) return;
+        memset(h, 0, sizeof(LatencyHistogram));
+        stats->syscall_latency[nr] = h;
+    }
+    h->total_ms += duration;
+    h->counts[latency_bucket((unsigned long long)(duration * 1e6))]++;
+}
+
+double latency_quantile(const unsigned long long hist[LATENCY_BUCKETS], double q) {
+    unsigned long long total = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) total += hist[b];
+    if (total == 0) return 0;
+
+    unsigned long long rank = (unsigned long long)(q * (total - 1)) + 1;
+    unsigned long long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= rank) return bucket_ms(b);
+    }
+    return bucket_ms(LATENCY_BUCKETS - 1);
+}
+
+// Midpoint of the slowest non-empty bucket
+double latency_max(const unsigned long long hist[LATENCY_BUCKETS]) {
+    for (int b = LATENCY_BUCKETS - 1; b >= 0; b--) {
+        if (hist[b] > 0) return bucket_ms(b);
+    }
+    return 0;
+}
+
+static int compare_leaks_by_site(const void *a, const void *b) {
+    const MallocBlock *ba = *(const MallocBlock * const *)a;
+    const MallocBlock *bb = *(const MallocBlock * const *)b;
+    if (ba->site < bb->site) return -1;
+    if (ba->site > bb->site) return 1;
+    return 0;
+}
+
+static int compare_sites_by_name(const void *a, const void *b) {
+    return strcmp(((const ProfileSite*)a)->site, ((const ProfileSite*)b)->site);
+}
+
+static int compare_syscalls_by_nr(const void *a, const void *b) {
+    return ((const ProfileSyscall*)a)->nr - ((const ProfileSyscall*)b)->nr;
+}
+
+// Sort by name and fold sites that format the same (two return addresses
+// in one unresolved module, say)
+static void sort_sites(Profile *profile) {
+    if (profile->site_count == 0) return;
+    qsort(profile->sites, profile->site_count, sizeof(ProfileSite), compare_sites_by_name);
+
+    int n = 1;
+    for (int i = 1; i < profile->site_count; i++) {
+        ProfileSite *last = &profile->sites[n - 1];
+        if (strcmp(last->site, profile->sites[i].site) == 0) {
+            last->blocks += profile->sites[i].blocks;
+            last->bytes += profile->sites[i].bytes;
+        } else {
+            profile->sites[n++] = profile->sites[i];
+        }
+    }
+    profile->site_count = n;
+}
+
+// The leak sites of this run, grouped by the caller's return address
+static int build_leak_sites(ProcessStats *stats, Profile *profile) {
+    size_t live_count = 0;
+    MallocBlock **live = collect_live_blocks(stats, &live_count);
+    if (!live && live_count > 0) return -1;
+
+    size_t n = 0;
+    for (size_t i = 0; i < live_count; i++) {
+        if (classify_leak(stats, live[i]) == LEAK_USER) live[n++] = live[i];
+    }
+    qsort(live, n, sizeof(MallocBlock*), compare_leaks_by_site);
+
+    profile->sites = calloc(n ? n : 1, sizeof(ProfileSite));
+    if (!profile->sites) {
+        free(live);
+        return -1;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || live[i]->site != live[i - 1]->site) {
+            ProfileSite *s = &profile->sites[profile->site_count++];
+            format_site(stats, live[i]->site, s->site, sizeof(s->site));
+            s->runs = 1;
+        }
+        ProfileSite *s = &profile->sites[profile->site_count - 1];
+        s->blocks++;
+        s->bytes += live[i]->size;
+        profile->leaked_blocks++;
+        profile->leaked_bytes += live[i]->size;
+    }
+    free(live);
+
+    sort_sites(profile);
+    profile->leaking_runs = profile->leaked_blocks > 0;
+    return 0;
+}
+
+int build_profile(ProcessStats *stats, Profile *profile) {
+    memset(profile, 0, sizeof(Profile));
+
+    snprintf(profile->program, sizeof(profile->program), "%s", stats->process_name);
+    profile->runs = 1;
+    profile->execution_time_ms = stats->execution_time_ms;
+    profile->total_syscalls = stats->total_syscalls;
+    profile->failed_syscalls = stats->failed_syscalls;
+    profile->syscall_time_ms = stats->total_syscall_time_ms;
+    profile->malloc_allocations = stats->malloc_allocations;
+    profile->malloc_frees = stats->malloc_frees;
+    profile->malloc_bytes_allocated = stats->malloc_bytes_allocated;
+    profile->malloc_bytes_freed = stats->malloc_bytes_freed;
+    if (stats->have_rusage) {
+        profile->peak_rss_kb = stats->tracee_rusage.ru_maxrss;
+        profile->max_rss_kb = profile->peak_rss_kb;
+    }
+    int fd_leaks = stats->files_opened - stats->files_closed;
+    profile->fd_leaks = fd_leaks > 0 ? fd_leaks : 0;
+
+    int count = 0;
+    for (int nr = 0; nr < MAX_SYSCALL_NUM; nr++) {
+        if (stats->syscall_counts[nr] > 0) count++;
+    }
+    profile->syscalls = calloc(count ? count : 1, sizeof(ProfileSyscall));
+    if (!profile->syscalls) return -1;
+
+    for (int nr = 0; nr < MAX_SYSCALL_NUM; nr++) {
+        if (stats->syscall_counts[nr] == 0) continue;
+        ProfileSyscall *p = &profile->syscalls[profile->syscall_count++];
+        p->nr = nr;
+        p->calls = stats->syscall_counts[nr];
+        if (stats->syscall_latency[nr]) {
+            p->time_ms = stats->syscall_latency[nr]->total_ms;
+            memcpy(p->hist, stats->syscall_latency[nr]->counts, sizeof(p->hist));
+        }
+    }
+
+    // Failures are kept per (syscall, errno); fold the errnos together
+    for (int i = 0; i < FAILURE_HASH_SIZE; i++) {
+        for (SyscallFailure *f = stats->failures[i]; f; f = f->next) {
+            for (int j = 0; j < profile->syscall_count; j++) {
+                if (profile->syscalls[j].nr == f->syscall_num) {
+                    profile->syscalls[j].failures += f->count;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (build_leak_sites(stats, profile) == -1) {
+        free_profile(profile);
+        return -1;
+    }
+    return 0;
+}
+
+void free_profile(Profile *profile) {
+    free(profile->syscalls);
+    free(profile->sites);
+    profile->syscalls = NULL;
+    profile->sites = NULL;
+    profile->syscall_count = 0;
+    profile->site_count = 0;
+}
+
+// --- Encoding ---
+
+static void put_bytes(FILE *out, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((value >> (8 * i)) & 0xff, out);
+    }
+}
+
+static void put_f64(FILE *out, double value) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_bytes(out, bits, 8);
+}
+
+static void put_str(FILE *out, const char *text) {
+    size_t len = strlen(text);
+    put_bytes(out, len, 2);
+    fwrite(text, 1, len, out);
+}
+
+int save_profile(const char *path, Profile *profile) {
+    FILE *out = fopen(path, "wb");
+    if (!out) return -1;
+
+    fwrite(profile_magic, 1, sizeof(profile_magic), out);
+    put_bytes(out, PROFILE_VERSION, 4);
+    put_bytes(out, profile->runs, 4);
+    put_str(out, profile->program);
+    put_f64(out, profile->execution_time_ms);
+    put_bytes(out, profile->total_syscalls, 8);
+    put_bytes(out, profile->failed_syscalls, 8);
+    put_f64(out, profile->syscall_time_ms);
+    put_bytes(out, profile->malloc_allocations, 8);
+    put_bytes(out, profile->malloc_frees, 8);
+    put_bytes(out, profile->malloc_bytes_allocated, 8);
+    put_bytes(out, profile->malloc_bytes_freed, 8);
+    put_bytes(out, profile->leaked_blocks, 8);
+    put_bytes(out, profile->leaked_bytes, 8);
+    put_bytes(out, profile->leaking_runs, 4);
+    put_bytes(out, profile->fd_leaks, 8);
+    put_bytes(out, profile->peak_rss_kb, 8);
+    put_bytes(out, profile->max_rss_kb, 8);
+
+    put_bytes(out, profile->syscall_count, 4);
+    for (int i = 0; i < profile->syscall_count; i++) {
+        ProfileSyscall *p = &profile->syscalls[i];
+        int used = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; b++) used += p->hist[b] > 0;
+
+        put_bytes(out, p->nr, 2);
+        put_bytes(out, p->calls, 8);
+        put_bytes(out, p->failures, 8);
+        put_f64(out, p->time_ms);
+        put_bytes(out, used, 1);
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            if (p->hist[b] == 0) continue;
+            put_bytes(out, b, 1);
+            put_bytes(out, p->hist[b], 8);
+        }
+    }
+
+    put_bytes(out, profile->site_count, 4);
+    for (int i = 0; i < profile->site_count; i++) {
+        put_str(out, profile->sites[i].site);
+        put_bytes(out, profile->sites[i].blocks, 8);
+        put_bytes(out, profile->sites[i].bytes, 8);
+        put_bytes(out, profile->sites[i].runs, 4);
+    }
+
+    int failed = ferror(out);
+    failed |= fclose(out) != 0;
+    return failed ? -1 : 0;
+}
+
+// --- Decoding ---
+
+typedef struct {
+    FILE *in;
+    int bad;                   // Short read or a value out of range
+} ProfileReader;
+
+static unsigned long long get_bytes(ProfileReader *r, int bytes) {
+    unsigned long long value = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = fgetc(r->in);
+        if (c == EOF) {
+            r->bad = 1;
+            return 0;
+        }
+        value |= (unsigned long long)c << (8 * i);
+    }
+    return value;
+}
+
+static double get_f64(ProfileReader *r) {
+    unsigned long long bits = get_bytes(r, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void get_str(ProfileReader *r, char *buf, size_t len) {
+    size_t n = get_bytes(r, 2);
+    size_t kept = 0;
+    for (size_t i = 0; i < n && !r->bad; i++) {
+        int c = fgetc(r->in);
+        if (c == EOF) r->bad = 1;
+        else if (kept + 1 < len) buf[kept++] = c;
+    }
+    buf[kept] = '\0';
+}
+
+// Returns -1 with errno ENOENT when there is no file, EINVAL when it isn't
+// a profile this version understands
+int load_profile(const char *path, Profile *profile) {
+    memset(profile, 0, sizeof(Profile));
+
+    FILE *in = fopen(path, "rb");
+    if (!in) return -1;
+
+    ProfileReader r = { in, 0 };
+    char magic[sizeof(profile_magic)];
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        memcmp(magic, profile_magic, sizeof(magic)) != 0 ||
+        get_bytes(&r, 4) != PROFILE_VERSION) {
+        fclose(in);
+        errno = EINVAL;
+        return -1;
+    }
+
+    profile->runs = get_bytes(&r, 4);
+    get_str(&r, profile->program, sizeof(profile->program));
+    profile->execution_time_ms = get_f64(&r);
+    profile->total_syscalls = get_bytes(&r, 8);
+    profile->failed_syscalls = get_bytes(&r, 8);
+    profile->syscall_time_ms = get_f64(&r);
+    profile->malloc_allocations = get_bytes(&r, 8);
+    profile->malloc_frees = get_bytes(&r, 8);
+    profile->malloc_bytes_allocated = get_bytes(&r, 8);
+    profile->malloc_bytes_freed = get_bytes(&r, 8);
+    profile->leaked_blocks = get_bytes(&r, 8);
+    profile->leaked_bytes = get_bytes(&r, 8);
+    profile->leaking_runs = get_bytes(&r, 4);
+    profile->fd_leaks = get_bytes(&r, 8);
+    profile->peak_rss_kb = get_bytes(&r, 8);
+    profile->max_rss_kb = get_bytes(&r, 8);
+
+    unsigned long long count = get_bytes(&r, 4);
+    if (!r.bad && count <= MAX_SYSCALL_NUM) {
+        profile->syscalls = calloc(count ? count : 1, sizeof(ProfileSyscall));
+    }
+    for (unsigned long long i = 0; profile->syscalls && i < count && !r.bad; i++) {
+        ProfileSyscall *p = &profile->syscalls[profile->syscall_count++];
+        p->nr = get_bytes(&r, 2);
+        p->calls = get_bytes(&r, 8);
+        p->failures = get_bytes(&r, 8);
+        p->time_ms = get_f64(&r);
+        int used = get_bytes(&r, 1);
+        for (int k = 0; k < used && !r.bad; k++) {
+            int b = get_bytes(&r, 1);
+            unsigned long long n = get_bytes(&r, 8);
+            if (b >= LATENCY_BUCKETS) r.bad = 1;
+            else p->hist[b] = n;
+        }
+        if (p->nr >= MAX_SYSCALL_NUM) r.bad = 1;
+    }
+
+    // Sanity cap before trusting the count with an allocation
+    count = get_bytes(&r, 4);
+    if (!r.bad && profile->syscalls && count <= 1u << 24) {
+        profile->sites = calloc(count ? count : 1, sizeof(ProfileSite));
+    }
+    for (unsigned long long i = 0; profile->sites && i < count && !r.bad; i++) {
+        ProfileSite *s = &profile->sites[profile->site_count++];
+        get_str(&r, s->site, sizeof(s->site));
+        s->blocks = get_bytes(&r, 8);
+        s->bytes = get_bytes(&r, 8);
+        s->runs = get_bytes(&r, 4);
+    }
+
+    fclose(in);
+    if (r.bad || !profile->syscalls || !profile->sites || profile->runs == 0) {
+        free_profile(profile);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Written sorted; don't let a hand-made file break the merge
+    qsort(profile->syscalls, profile->syscall_count, sizeof(ProfileSyscall), compare_syscalls_by_nr);
+    sort_sites(profile);
+    return 0;
+}
+
+// --- Merging ---
+
+static void merge_syscall(ProfileSyscall *into, ProfileSyscall *from) {
+    into->calls += from->calls;
+    into->failures += from->failures;
+    into->time_ms += from->time_ms;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        into->hist[b] += from->hist[b];
+    }
+}
+
+// Adds `from` into `into`; both tables are merged like sorted runs.
+// Returns -1 (leaving `into` unchanged) if memory runs out.
+int merge_profile(Profile *into, Profile *from) {
+    int max_syscalls = into->syscall_count + from->syscall_count;
+    int max_sites = into->site_count + from->site_count;
+    ProfileSyscall *syscalls = malloc((max_syscalls ? max_syscalls : 1) * sizeof(ProfileSyscall));
+    ProfileSite *sites = malloc((max_sites ? max_sites : 1) * sizeof(ProfileSite));
+    if (!syscalls || !sites) {
+        free(syscalls);
+        free(sites);
+        return -1;
+    }
+
+    int i = 0, j = 0, n = 0;
+    while (i < into->syscall_count || j < from->syscall_count) {
+        if (j == from->syscall_count ||
+            (i < into->syscall_count && into->syscalls[i].nr < from->syscalls[j].nr)) {
+            syscalls[n++] = into->syscalls[i++];
+        } else if (i == into->syscall_count || from->syscalls[j].nr < into->syscalls[i].nr) {
+            syscalls[n++] = from->syscalls[j++];
+        } else {
+            syscalls[n] = into->syscalls[i++];
+            merge_syscall(&syscalls[n++], &from->syscalls[j++]);
+        }
+    }
+    free(into->syscalls);
+    into->syscalls = syscalls;
+    into->syscall_count = n;
+
+    i = j = n = 0;
+    while (i < into->site_count || j < from->site_count) {
+        int order = i == into->site_count ? 1 : j == from->site_count ? -1 :
+                    strcmp(into->sites[i].site, from->sites[j].site);
+        if (order < 0) {
+            sites[n++] = into->sites[i++];
+        } else if (order > 0) {
+            sites[n++] = from->sites[j++];
+        } else {
+            sites[n] = into->sites[i++];
+            sites[n].blocks += from->sites[j].blocks;
+            sites[n].bytes += from->sites[j].bytes;
+            sites[n++].runs += from->sites[j++].runs;
+        }
+    }
+    free(into->sites);
+    into->sites = sites;
+    into->site_count = n;
+
+    // A merge of different programs has no single name
+    if (strcmp(into->program, from->program) != 0) {
+        into->program[0] = '\0';
+    }
+    into->runs += from->runs;
+    into->execution_time_ms += from->execution_time_ms;
+    into->total_syscalls += from->total_syscalls;
+    into->failed_syscalls += from->failed_syscalls;
+    into->syscall_time_ms += from->syscall_time_ms;
+    into->malloc_allocations += from->malloc_allocations;
+    into->malloc_frees += from->malloc_frees;
+    into->malloc_bytes_allocated += from->malloc_bytes_allocated;
+    into->malloc_bytes_freed += from->malloc_bytes_freed;
+    into->leaked_blocks += from->leaked_blocks;
+    into->leaked_bytes += from->leaked_bytes;
+    into->leaking_runs += from->leaking_runs;
+    into->fd_leaks += from->fd_leaks;
+    into->peak_rss_kb += from->peak_rss_kb;
+    if (from->max_rss_kb > into->max_rss_kb) into->max_rss_kb = from->max_rss_kb;
+    return 0;
+}
+
+// "%p" in a --save-profile path becomes the tracee's pid, so every run of
+// a test suite can write its own file
+const char* expand_profile_path(const char *path, pid_t pid, char *buf, size_t len) {
+    const char *mark = strstr(path, "%p");
+    if (!mark) return path;
+    snprintf(buf, len, "%.*s%d%s", (int)(mark - path), path, pid, mark + 2);
+    return buf;
+}
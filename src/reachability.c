@@ -0,0 +1,414 @@
+#define _GNU_SOURCE
+#include "../include/oswatch.h"
+#include <sys/uio.h>
+#include <pthread.h>
+#include <stdint.h>
+
+// Conservative reachability scan
+//
+// Runs while the tracee is stopped at PTRACE_EVENT_EXIT, when its mappings
+// are still intact. Every aligned word in the writable non-heap mappings
+// (data, bss, live stack, thread stacks) and in the registers is a root.
+// Roots are scanned in parallel; each thread marks blocks with a CAS and
+// then follows only the blocks it marked, so no work is shared or lost.
+// Blocks left unmarked are split into definitely/indirectly lost the way
+// valgrind does: the first unmarked block of a group is the leader.
+
+#define SCAN_CHUNK_SIZE (1024 * 1024)
+#define SCAN_BATCH_IOVECS 64
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+    MallocBlock *block;
+} ScanBlock;
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+} ScanRange;
+
+typedef struct {
+    pid_t pid;
+    ScanBlock *blocks;
+    size_t nblocks;
+    unsigned char *state;
+    uintptr_t lowest;
+    uintptr_t highest;
+
+    ScanRange *roots;
+    size_t nroots;
+    size_t next_root;          // Claimed atomically by workers
+    size_t bytes_read;         // Updated atomically
+} ScanContext;
+
+typedef struct {
+    ScanContext *ctx;
+    size_t *stack;
+    size_t top;
+    size_t cap;
+    char *buf;
+
+    // Lost-block classification (single worker only)
+    int classify;
+    size_t leader;
+} ScanWorker;
+
+static int compare_scan_blocks(const void *a, const void *b) {
+    const ScanBlock *ba = a;
+    const ScanBlock *bb = b;
+    if (ba->start < bb->start) return -1;
+    if (ba->start > bb->start) return 1;
+    return 0;
+}
+
+// Index of the block containing value (interior pointers count), or -1
+static long find_block(ScanContext *ctx, uintptr_t value) {
+    size_t lo = 0, hi = ctx->nblocks;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ctx->blocks[mid].start <= value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return -1;
+
+    ScanBlock *candidate = &ctx->blocks[lo - 1];
+    if (value < candidate->end) return lo - 1;
+    return -1;
+}
+
+static void push_block(ScanWorker *w, size_t idx) {
+    if (w->top == w->cap) {
+        size_t cap = w->cap ? w->cap * 2 : 1024;
+        size_t *stack = realloc(w->stack, cap * sizeof(size_t));
+        if (!stack) return;  // Out of memory - block stays unexplored
+        w->stack = stack;
+        w->cap = cap;
+    }
+    w->stack[w->top++] = idx;
+}
+
+static void visit_word(ScanWorker *w, uintptr_t value) {
+    ScanContext *ctx = w->ctx;
+
+    if (value < ctx->lowest || value >= ctx->highest) return;
+
+    long idx = find_block(ctx, value);
+    if (idx < 0) return;
+
+    if (!w->classify) {
+        unsigned char expected = REACH_UNKNOWN;
+        if (__atomic_compare_exchange_n(&ctx->state[idx], &expected, REACH_REACHABLE,
+                                        0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            push_block(w, idx);
+        }
+        return;
+    }
+
+    // Classification: anything reached from a lost leader is indirect
+    if ((size_t)idx == w->leader) return;
+    unsigned char state = ctx->state[idx];
+    if (state == REACH_UNKNOWN) {
+        ctx->state[idx] = REACH_INDIRECT;
+        push_block(w, idx);
+    } else if (state == REACH_DEFINITE) {
+        // An earlier leader hangs off this group; its children are done
+        ctx->state[idx] = REACH_INDIRECT;
+    }
+}
+
+static void scan_words(ScanWorker *w, const char *data, size_t len) {
+    for (size_t off = 0; off + sizeof(uintptr_t) <= len; off += sizeof(uintptr_t)) {
+        uintptr_t value;
+        memcpy(&value, data + off, sizeof(value));
+        visit_word(w, value);
+    }
+}
+
+// Read a batch of remote ranges with one process_vm_readv and scan them.
+// An unreadable range is skipped and the rest of the batch retried.
+static void read_and_scan(ScanWorker *w, ScanRange *ranges, int count) {
+    struct iovec local[SCAN_BATCH_IOVECS];
+    struct iovec remote[SCAN_BATCH_IOVECS];
+    int first = 0;
+
+    while (first < count) {
+        size_t offset = 0;
+        int n = 0;
+        for (int i = first; i < count; i++, n++) {
+            size_t len = ranges[i].end - ranges[i].start;
+            local[n].iov_base = w->buf + offset;
+            local[n].iov_len = len;
+            remote[n].iov_base = (void*)ranges[i].start;
+            remote[n].iov_len = len;
+            offset += len;
+        }
+
+        ssize_t got = process_vm_readv(w->ctx->pid, local, n, remote, n, 0);
+        if (got < 0) got = 0;
+        __atomic_fetch_add(&w->ctx->bytes_read, (size_t)got, __ATOMIC_RELAXED);
+
+        // Scan everything that arrived
+        size_t left = got;
+        int done = 0;
+        while (done < n && left > 0) {
+            size_t len = local[done].iov_len < left ? local[done].iov_len : left;
+            scan_words(w, local[done].iov_base, len);
+            left -= len;
+            if (len < local[done].iov_len) break;
+            done++;
+        }
+
+        // Skip past the iovec that failed
+        first += done + 1;
+    }
+}
+
+// Follow every block this worker has marked
+static void drain_worker(ScanWorker *w) {
+    ScanContext *ctx = w->ctx;
+    ScanRange ranges[SCAN_BATCH_IOVECS];
+
+    while (w->top > 0) {
+        int count = 0;
+        size_t batch_bytes = 0;
+
+        // Gather blocks into one batched read, splitting huge blocks
+        while (w->top > 0 && count < SCAN_BATCH_IOVECS) {
+            size_t idx = w->stack[w->top - 1];
+            ScanBlock *b = &ctx->blocks[idx];
+            size_t len = b->end - b->start;
+
+            if (len > SCAN_CHUNK_SIZE - batch_bytes) {
+                if (batch_bytes > 0) break;
+                // Block larger than the buffer: scan it piece by piece
+                w->top--;
+                for (uintptr_t p = b->start; p < b->end; p += SCAN_CHUNK_SIZE) {
+                    ScanRange piece = { p, p + SCAN_CHUNK_SIZE < b->end ? p + SCAN_CHUNK_SIZE : b->end };
+                    read_and_scan(w, &piece, 1);
+                }
+                continue;
+            }
+
+            w->top--;
+            ranges[count].start = b->start;
+            ranges[count].end = b->end;
+            batch_bytes += len;
+            count++;
+        }
+
+        if (count > 0) {
+            read_and_scan(w, ranges, count);
+        }
+    }
+}
+
+static void* scan_thread(void *arg) {
+    ScanWorker *w = arg;
+    ScanContext *ctx = w->ctx;
+
+    // Claim root chunks until none are left
+    while (1) {
+        size_t i = __atomic_fetch_add(&ctx->next_root, 1, __ATOMIC_RELAXED);
+        if (i >= ctx->nroots) break;
+        read_and_scan(w, &ctx->roots[i], 1);
+        drain_worker(w);
+    }
+    drain_worker(w);
+    return NULL;
+}
+
+static void add_root(ScanRange **roots, size_t *count, size_t *cap,
+                     uintptr_t start, uintptr_t end) {
+    // Split into buffer-sized chunks so threads can share big regions
+    for (uintptr_t p = start; p < end; p += SCAN_CHUNK_SIZE) {
+        if (*count == *cap) {
+            size_t new_cap = *cap ? *cap * 2 : 64;
+            ScanRange *grown = realloc(*roots, new_cap * sizeof(ScanRange));
+            if (!grown) return;
+            *roots = grown;
+            *cap = new_cap;
+        }
+        (*roots)[*count].start = p;
+        (*roots)[*count].end = p + SCAN_CHUNK_SIZE < end ? p + SCAN_CHUNK_SIZE : end;
+        (*count)++;
+    }
+}
+
+// Does any live block start inside [start, end)?
+static int region_has_blocks(ScanContext *ctx, uintptr_t start, uintptr_t end) {
+    size_t lo = 0, hi = ctx->nblocks;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ctx->blocks[mid].start < start) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < ctx->nblocks && ctx->blocks[lo].start < end;
+}
+
+// Writable mappings become roots. Malloc's own memory ([heap], arenas,
+// mmap-threshold chunks) is skipped: live blocks are scanned only once
+// reached, and freed chunks would otherwise hold stale pointers.
+static int collect_roots(ScanContext *ctx, uintptr_t stack_pointer) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", ctx->pid);
+
+    FILE *maps = fopen(path, "r");
+    if (!maps) return -1;
+
+    size_t cap = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), maps)) {
+        unsigned long start, end, offset, inode;
+        char perms[8], dev[16], name[256] = "";
+
+        if (sscanf(line, "%lx-%lx %7s %lx %15s %lu %255s",
+                   &start, &end, perms, &offset, dev, &inode, name) < 6) {
+            continue;
+        }
+        if (perms[0] != 'r' || perms[1] != 'w') continue;
+        if (strcmp(name, "[heap]") == 0 || strcmp(name, "[vvar]") == 0) continue;
+
+        if (strcmp(name, "[stack]") == 0) {
+            // Only the live part of the stack. The 128-byte red zone below
+            // sp is included on purpose: leaf frames keep pointers there.
+            uintptr_t live = stack_pointer >= 128 ? stack_pointer - 128 : stack_pointer;
+            if (live > start && live < end) start = live;
+        } else if (inode == 0 && region_has_blocks(ctx, start, end)) {
+            continue;
+        }
+
+        add_root(&ctx->roots, &ctx->nroots, &cap, start, end);
+    }
+
+    fclose(maps);
+    return 0;
+}
+
+int scan_reachability(pid_t pid, ProcessStats *stats) {
+    struct timespec scan_start, scan_end;
+    clock_gettime(CLOCK_MONOTONIC, &scan_start);
+
+    ScanContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.pid = pid;
+
+    // Snapshot the live table as a sorted array (shards are synced by the caller)
+    MallocBlock **live = collect_live_blocks(stats, &ctx.nblocks);
+    if (!live) return -1;
+    if (ctx.nblocks == 0) {
+        free(live);
+        stats->leak_scan_done = 1;
+        return 0;
+    }
+
+    ctx.blocks = malloc(ctx.nblocks * sizeof(ScanBlock));
+    ctx.state = calloc(ctx.nblocks, 1);
+    if (!ctx.blocks || !ctx.state) {
+        free(live);
+        free(ctx.blocks);
+        free(ctx.state);
+        return -1;
+    }
+
+    for (size_t n = 0; n < ctx.nblocks; n++) {
+        MallocBlock *b = live[n];
+        ctx.blocks[n].start = (uintptr_t)b->address;
+        ctx.blocks[n].end = (uintptr_t)b->address + (b->size ? b->size : 1);
+        ctx.blocks[n].block = b;
+    }
+    free(live);
+    qsort(ctx.blocks, ctx.nblocks, sizeof(ScanBlock), compare_scan_blocks);
+    ctx.lowest = ctx.blocks[0].start;
+    for (size_t i = 0; i < ctx.nblocks; i++) {
+        if (ctx.blocks[i].end > ctx.highest) ctx.highest = ctx.blocks[i].end;
+    }
+
+    // Registers are roots too
+    struct user_regs_struct regs;
+    memset(&regs, 0, sizeof(regs));
+    ptrace(PTRACE_GETREGS, pid, 0, &regs);
+
+    if (collect_roots(&ctx, regs.rsp) == -1) {
+        free(ctx.blocks);
+        free(ctx.state);
+        return -1;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = cpus > 0 ? (int)cpus : 1;
+    if (nthreads > MAX_SCAN_THREADS) nthreads = MAX_SCAN_THREADS;
+    if ((size_t)nthreads > ctx.nroots) nthreads = ctx.nroots ? (int)ctx.nroots : 1;
+
+    ScanWorker workers[MAX_SCAN_THREADS];
+    pthread_t threads[MAX_SCAN_THREADS];
+    memset(workers, 0, sizeof(workers));
+
+    int failed = 0;
+    for (int t = 0; t < nthreads; t++) {
+        workers[t].ctx = &ctx;
+        workers[t].buf = malloc(SCAN_CHUNK_SIZE);
+        if (!workers[t].buf) failed = 1;
+    }
+
+    if (!failed) {
+        // Register roots go to the first worker before the threads start
+        const unsigned long long *reg_words = (const unsigned long long *)&regs;
+        for (size_t i = 0; i < sizeof(regs) / sizeof(*reg_words); i++) {
+            visit_word(&workers[0], (uintptr_t)reg_words[i]);
+        }
+
+        int started = 0;
+        for (int t = 1; t < nthreads; t++) {
+            if (pthread_create(&threads[t], NULL, scan_thread, &workers[t]) != 0) break;
+            started = t;
+        }
+        scan_thread(&workers[0]);
+        for (int t = 1; t <= started; t++) {
+            pthread_join(threads[t], NULL);
+        }
+
+        // Whatever is still unmarked is lost; group it under leaders
+        workers[0].classify = 1;
+        for (size_t i = 0; i < ctx.nblocks; i++) {
+            if (ctx.state[i] != REACH_UNKNOWN) continue;
+            ctx.state[i] = REACH_DEFINITE;
+            workers[0].leader = i;
+            push_block(&workers[0], i);
+            drain_worker(&workers[0]);
+        }
+
+        memset(stats->reach_blocks, 0, sizeof(stats->reach_blocks));
+        memset(stats->reach_bytes, 0, sizeof(stats->reach_bytes));
+        for (size_t i = 0; i < ctx.nblocks; i++) {
+            MallocBlock *b = ctx.blocks[i].block;
+            b->reach = ctx.state[i];
+            stats->reach_blocks[b->reach]++;
+            stats->reach_bytes[b->reach] += b->size;
+        }
+
+        stats->leak_scan_done = 1;
+        stats->scan_threads = nthreads;
+        stats->scan_bytes_read = ctx.bytes_read;
+    }
+
+    for (int t = 0; t < nthreads; t++) {
+        free(workers[t].buf);
+        free(workers[t].stack);
+    }
+    free(ctx.roots);
+    free(ctx.blocks);
+    free(ctx.state);
+
+    clock_gettime(CLOCK_MONOTONIC, &scan_end);
+    stats->scan_time_ms = calculate_time_diff(&scan_start, &scan_end);
+
+    return failed ? -1 : 0;
+}
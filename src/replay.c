@@ -0,0 +1,572 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <sys/resource.h>
+
+// oswatch-replay: re-run a recorded allocation trace (--record-allocs)
+//
+// The native driver issues the trace's malloc/calloc/realloc/free calls
+// against whichever allocator this process runs with (LD_PRELOAD one to
+// compare), touching every page it gets back as the program would have,
+// and reports throughput and how far RSS rose. Addresses were resolved to
+// slots at load time, so the timed loop is nothing but allocator calls.
+//
+// --simulate instead models size-class allocators that carve fixed-size
+// slabs into equal objects: a request takes the smallest class it fits,
+// a slab is mapped when its class has no room and given back once empty,
+// and anything above the largest class gets a page-rounded mapping of its
+// own. For each class layout it reports the peak footprint against the
+// peak live bytes the program asked for, and how much rounding wasted.
+
+#define DEFAULT_SLAB_BYTES (64 * 1024)
+#define SIM_PAGE_BYTES 4096ULL
+#define MAX_SIM_CLASSES 128
+#define MAX_SIM_MODELS 3
+#define MAX_CLASSES_SHOWN 12
+
+typedef struct {
+    unsigned int live;
+    int partial;               // On its class's partial stack
+} SimSlab;
+
+typedef struct {
+    unsigned long long size;
+    unsigned int per_slab;
+    SimSlab *slabs;
+    size_t slab_count;
+    size_t slab_capacity;
+    unsigned int *partial;     // Slabs with room, most recent on top
+    size_t partial_count;
+    size_t mapped;             // Slabs holding at least one object
+    size_t peak_mapped;
+    size_t allocations;
+    unsigned long long requested;
+    unsigned long long rounded;
+} SimClass;
+
+typedef struct {
+    int cls;                   // -1 for a large mapping, -2 when not live
+    unsigned int slab;
+    unsigned long long bytes;  // Large mappings only
+} SimObject;
+
+typedef struct {
+    const char *name;
+    SimClass classes[MAX_SIM_CLASSES];
+    int class_count;
+    unsigned long long slab_bytes;
+    SimObject *objects;
+    unsigned long long footprint;
+    unsigned long long peak_footprint;
+    unsigned long long large_bytes;
+    size_t large_allocations;
+    size_t slabs_mapped;       // Empty-to-used transitions, i.e. mmap calls
+    size_t inplace_reallocs;
+    unsigned long long requested;
+    unsigned long long rounded;
+    int failed;
+} SimModel;
+
+static void usage(const char *name) {
+    printf("Usage: %s [OPTIONS] <trace>\n\n", name);
+    printf("Replays an allocation trace written by oswatch --record-allocs.\n\n");
+    printf("Options:\n");
+    printf("  -n N            Replay the trace N times (default: 1)\n");
+    printf("  --no-touch      Don't write to the blocks (allocator cost only)\n");
+    printf("  --simulate      Model size-class/slab allocators instead of running one\n");
+    printf("  --slab BYTES    Slab size for --simulate (default: %d)\n", DEFAULT_SLAB_BYTES);
+    printf("  --classes LIST  Also simulate these comma-separated size classes\n");
+    printf("  -h, --help      Show this help message\n\n");
+    printf("Example:\n");
+    printf("  oswatch --record-allocs app.allocs ./app\n");
+    printf("  %s app.allocs\n", name);
+    printf("  LD_PRELOAD=/usr/lib/libjemalloc.so %s app.allocs\n", name);
+    printf("  %s --simulate --classes 32,64,128,512,4096 app.allocs\n\n", name);
+}
+
+static const char* human_bytes(double bytes, char *buf, size_t len) {
+    const char *units[] = { "B", "KB", "MB", "GB", "TB" };
+    int u = 0;
+
+    while (bytes >= 1024 && u < 4) {
+        bytes /= 1024;
+        u++;
+    }
+    snprintf(buf, len, u ? "%.1f %s" : "%.0f %s", bytes, units[u]);
+    return buf;
+}
+
+static void print_header(const char *title) {
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           %-44s║%s\n", COLOR_CYAN, title, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+}
+
+// --- Native replay ---
+
+static long read_kb(const char *field) {
+    char line[256];
+    long kb = -1;
+    size_t len = strlen(field);
+
+    FILE *status = fopen("/proc/self/status", "r");
+    if (!status) return -1;
+    while (fgets(line, sizeof(line), status)) {
+        if (strncmp(line, field, len) == 0) {
+            kb = atol(line + len);
+            break;
+        }
+    }
+    fclose(status);
+    return kb;
+}
+
+// One byte per page, as a program filling its blocks would fault them in
+static inline void touch(char *p, unsigned long long size) {
+    for (unsigned long long off = 0; off < size; off += SIM_PAGE_BYTES) {
+        p[off] = 1;
+    }
+}
+
+static void replay_native(AllocTrace *t, int passes, int touch_pages) {
+    void **objects = calloc(t->slots ? t->slots : 1, sizeof(void*));
+    if (!objects) {
+        fprintf(stderr, "oswatch-replay: out of memory for %zu slots\n", t->slots);
+        return;
+    }
+
+    // Start the high-water mark at what loading left behind (Linux 4.0+)
+    int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    int reset = fd != -1 && write(fd, "5", 1) == 1;
+    if (fd != -1) close(fd);
+    long rss_before = read_kb("VmRSS:");
+
+    double total_ms = 0;
+    size_t failures = 0;
+    for (int pass = 0; pass < passes; pass++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for (size_t i = 0; i < t->count; i++) {
+            AllocOp *o = &t->ops[i];
+            void *p;
+            switch (o->op) {
+                case ALLOC_OP_MALLOC:
+                    p = malloc(o->size);
+                    if (p && touch_pages) touch(p, o->size);
+                    break;
+                case ALLOC_OP_CALLOC:
+                    p = calloc(1, o->size);
+                    if (p && touch_pages) touch(p, o->size);
+                    break;
+                case ALLOC_OP_REALLOC:
+                    p = realloc(objects[o->slot], o->size);
+                    if (p && touch_pages) touch(p, o->size);
+                    if (!p && o->size > 0) continue;  // The old block is still there
+                    break;
+                default:
+                    free(objects[o->slot]);
+                    p = NULL;
+                    break;
+            }
+            if (!p && o->op != ALLOC_OP_FREE && o->size > 0) failures++;
+            objects[o->slot] = p;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        total_ms += calculate_time_diff(&start, &end);
+
+        // What the program never freed, outside the timing
+        for (size_t s = 0; s < t->slots; s++) {
+            free(objects[s]);
+            objects[s] = NULL;
+        }
+    }
+    free(objects);
+
+    long peak = reset ? read_kb("VmHWM:") : -1;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    const char *preload = getenv("LD_PRELOAD");
+    double ops = (double)t->count * passes;
+
+    print_header("NATIVE ALLOCATION REPLAY");
+    printf("  Allocator:        %s\n", preload && *preload ? preload : "system malloc");
+    printf("  Operations:       %zu per pass, %d pass(es)%s\n", t->count, passes,
+           touch_pages ? "" : ", blocks untouched");
+    printf("  Replay time:      %.2f ms\n", total_ms);
+    if (total_ms > 0) {
+        printf("  Throughput:       %s%.2f Mops/s%s (%.1f ns per operation)\n", COLOR_YELLOW,
+               ops / total_ms / 1000.0, COLOR_RESET, total_ms * 1e6 / ops);
+    }
+    if (peak >= 0 && rss_before >= 0) {
+        printf("  Peak RSS:         %ld KB, %ld KB above the loaded trace\n",
+               peak, peak > rss_before ? peak - rss_before : 0);
+    } else {
+        printf("  Peak RSS:         %ld KB (includes loading the trace)\n", usage.ru_maxrss);
+    }
+    if (failures > 0) {
+        printf("  %sFailed calls:     %zu%s\n", COLOR_RED, failures, COLOR_RESET);
+    }
+}
+
+// --- Simulation ---
+
+static int add_class(SimModel *m, unsigned long long size) {
+    if (size == 0 || size > m->slab_bytes / 2) return 0;  // Leave it to large mappings
+    if (m->class_count > 0 && size <= m->classes[m->class_count - 1].size) return -1;
+    if (m->class_count == MAX_SIM_CLASSES) return -1;
+
+    SimClass *c = &m->classes[m->class_count++];
+    memset(c, 0, sizeof(SimClass));
+    c->size = size;
+    c->per_slab = m->slab_bytes / size;
+    return 0;
+}
+
+// Powers of two from 16 up to an eighth of a slab
+static void pow2_classes(SimModel *m) {
+    for (unsigned long long size = 16; size <= m->slab_bytes / 8; size *= 2) {
+        add_class(m, size);
+    }
+}
+
+// 8 and 16, then four evenly spaced classes per doubling
+static void quarter_classes(SimModel *m) {
+    add_class(m, 8);
+    add_class(m, 16);
+    for (unsigned long long base = 16; base * 2 <= m->slab_bytes / 8; base *= 2) {
+        unsigned long long step = base < 64 ? 16 : base / 4;
+        for (unsigned long long size = base + step; size <= base * 2; size += step) {
+            add_class(m, size);
+        }
+    }
+}
+
+static int parse_classes(SimModel *m, const char *list) {
+    char *copy = strdup(list);
+    if (!copy) return -1;
+
+    int result = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *end;
+        unsigned long long size = strtoull(tok, &end, 10);
+        if (end == tok || *end != '\0' || add_class(m, size) == -1) {
+            result = -1;
+            break;
+        }
+    }
+    free(copy);
+    return m->class_count > 0 ? result : -1;
+}
+
+static int class_for(SimModel *m, unsigned long long size) {
+    int lo = 0, hi = m->class_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (m->classes[mid].size < size) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < m->class_count ? lo : -1;
+}
+
+static void note_footprint(SimModel *m) {
+    if (m->footprint > m->peak_footprint) m->peak_footprint = m->footprint;
+}
+
+static int sim_alloc(SimModel *m, unsigned int slot, unsigned long long size) {
+    SimObject *o = &m->objects[slot];
+    if (size == 0) size = 1;  // malloc(0) still hands out a block
+    int cls = class_for(m, size);
+    m->requested += size;
+
+    if (cls < 0) {
+        o->cls = -1;
+        o->bytes = (size + SIM_PAGE_BYTES - 1) / SIM_PAGE_BYTES * SIM_PAGE_BYTES;
+        m->rounded += o->bytes;
+        m->large_bytes += o->bytes;
+        m->large_allocations++;
+        m->footprint += o->bytes;
+        note_footprint(m);
+        return 0;
+    }
+
+    SimClass *c = &m->classes[cls];
+    c->allocations++;
+    c->requested += size;
+    c->rounded += c->size;
+    m->rounded += c->size;
+
+    // Full slabs leave the partial stack lazily
+    while (c->partial_count > 0 &&
+           c->slabs[c->partial[c->partial_count - 1]].live == c->per_slab) {
+        c->slabs[c->partial[--c->partial_count]].partial = 0;
+    }
+    if (c->partial_count == 0) {
+        if (c->slab_count == c->slab_capacity) {
+            size_t grown = c->slab_capacity ? c->slab_capacity * 2 : 16;
+            SimSlab *slabs = realloc(c->slabs, grown * sizeof(SimSlab));
+            unsigned int *partial = slabs ? realloc(c->partial, grown * sizeof(unsigned int)) : NULL;
+            if (slabs) c->slabs = slabs;
+            if (!partial) return -1;
+            c->partial = partial;
+            c->slab_capacity = grown;
+        }
+        c->slabs[c->slab_count].live = 0;
+        c->slabs[c->slab_count].partial = 1;
+        c->partial[c->partial_count++] = c->slab_count++;
+    }
+
+    unsigned int slab = c->partial[c->partial_count - 1];
+    if (c->slabs[slab].live++ == 0) {
+        c->mapped++;
+        if (c->mapped > c->peak_mapped) c->peak_mapped = c->mapped;
+        m->slabs_mapped++;
+        m->footprint += m->slab_bytes;
+        note_footprint(m);
+    }
+    o->cls = cls;
+    o->slab = slab;
+    return 0;
+}
+
+static void sim_free(SimModel *m, unsigned int slot) {
+    SimObject *o = &m->objects[slot];
+    if (o->cls == -2) return;
+
+    if (o->cls == -1) {
+        m->large_bytes -= o->bytes;
+        m->footprint -= o->bytes;
+    } else {
+        SimClass *c = &m->classes[o->cls];
+        SimSlab *s = &c->slabs[o->slab];
+        if (--s->live == 0) {
+            c->mapped--;
+            m->footprint -= m->slab_bytes;  // Emptied slabs go back
+        }
+        if (!s->partial) {
+            s->partial = 1;
+            c->partial[c->partial_count++] = o->slab;
+        }
+    }
+    o->cls = -2;
+}
+
+static int sim_realloc(SimModel *m, unsigned int slot, unsigned long long size) {
+    SimObject *o = &m->objects[slot];
+
+    // Still fits where it is: the same class, or the same number of pages
+    if (o->cls >= 0 && size > 0 && class_for(m, size) == o->cls) {
+        m->inplace_reallocs++;
+        return 0;
+    }
+    if (o->cls == -1 && size > 0 && class_for(m, size) == -1 &&
+        (size + SIM_PAGE_BYTES - 1) / SIM_PAGE_BYTES * SIM_PAGE_BYTES == o->bytes) {
+        m->inplace_reallocs++;
+        return 0;
+    }
+    sim_free(m, slot);
+    return size == 0 ? 0 : sim_alloc(m, slot, size);
+}
+
+static void simulate(SimModel *m, AllocTrace *t) {
+    m->objects = malloc((t->slots ? t->slots : 1) * sizeof(SimObject));
+    if (!m->objects) {
+        m->failed = 1;
+        return;
+    }
+    for (size_t s = 0; s < t->slots; s++) m->objects[s].cls = -2;
+
+    for (size_t i = 0; i < t->count && !m->failed; i++) {
+        AllocOp *o = &t->ops[i];
+        switch (o->op) {
+            case ALLOC_OP_MALLOC:
+            case ALLOC_OP_CALLOC:
+                m->failed = sim_alloc(m, o->slot, o->size) == -1;
+                break;
+            case ALLOC_OP_REALLOC:
+                m->failed = m->objects[o->slot].cls == -2 ?
+                            sim_alloc(m, o->slot, o->size) == -1 :
+                            sim_realloc(m, o->slot, o->size) == -1;
+                break;
+            default:
+                sim_free(m, o->slot);
+                break;
+        }
+    }
+    free(m->objects);
+    m->objects = NULL;
+}
+
+static void free_model(SimModel *m) {
+    for (int i = 0; i < m->class_count; i++) {
+        free(m->classes[i].slabs);
+        free(m->classes[i].partial);
+    }
+}
+
+static int compare_classes_by_slabs(const void *a, const void *b) {
+    const SimClass *ca = *(const SimClass* const*)a;
+    const SimClass *cb = *(const SimClass* const*)b;
+    if (ca->peak_mapped != cb->peak_mapped) return ca->peak_mapped < cb->peak_mapped ? 1 : -1;
+    return ca->allocations < cb->allocations ? 1 : ca->allocations > cb->allocations ? -1 : 0;
+}
+
+static void print_simulation(AllocTrace *t, SimModel *models, int count, unsigned long long slab) {
+    char a[32], b[32];
+
+    print_header("ALLOCATOR SIMULATION");
+    printf("  Slab size:        %s; blocks above the largest class get their own pages\n",
+           human_bytes(slab, a, sizeof(a)));
+    printf("  Peak live heap:   %s in %zu blocks (what an exact-fit allocator needs)\n\n",
+           human_bytes(t->peak_live_bytes, b, sizeof(b)), t->peak_live_blocks);
+
+    printf("  %-10s %-8s %-15s %-9s %-9s %-8s %s\n", "MODEL", "CLASSES", "PEAK FOOTPRINT",
+           "OVERHEAD", "ROUNDING", "SLABS", "IN-PLACE REALLOC");
+    printf("  ----------------------------------------------------------------------\n");
+
+    int best = -1;
+    for (int i = 0; i < count; i++) {
+        SimModel *m = &models[i];
+        if (m->failed) {
+            printf("  %-10s (out of memory)\n", m->name);
+            continue;
+        }
+        if (best < 0 || m->peak_footprint < models[best].peak_footprint) best = i;
+
+        char overhead[16], rounding[16];
+        snprintf(overhead, sizeof(overhead), t->peak_live_bytes ? "%.2fx" : "-",
+                 t->peak_live_bytes ? (double)m->peak_footprint / t->peak_live_bytes : 0.0);
+        snprintf(rounding, sizeof(rounding), "%.1f%%",
+                 m->rounded ? 100.0 * (m->rounded - m->requested) / m->rounded : 0.0);
+        printf("  %-10s %-8d %-15s %-9s %-9s %-8zu %zu\n", m->name, m->class_count,
+               human_bytes(m->peak_footprint, a, sizeof(a)), overhead, rounding,
+               m->slabs_mapped, m->inplace_reallocs);
+    }
+    if (best < 0) return;
+    printf("  Smallest footprint: %s%s%s\n", COLOR_GREEN, models[best].name, COLOR_RESET);
+
+    SimModel *m = &models[best];
+    SimClass *busiest[MAX_SIM_CLASSES];
+    int n = 0;
+    for (int i = 0; i < m->class_count; i++) {
+        if (m->classes[i].allocations > 0) busiest[n++] = &m->classes[i];
+    }
+    qsort(busiest, n, sizeof(SimClass*), compare_classes_by_slabs);
+
+    printf("\n%sBusiest Size Classes (%s):%s\n", COLOR_BOLD, m->name, COLOR_RESET);
+    printf("  %-10s %-12s %-11s %-14s %s\n", "CLASS", "ALLOCS", "PEAK SLABS", "PEAK MEMORY", "ROUNDING");
+    printf("  ----------------------------------------------------------------------\n");
+    for (int i = 0; i < n && i < MAX_CLASSES_SHOWN; i++) {
+        SimClass *c = busiest[i];
+        printf("  %-10llu %-12zu %-11zu %-14s %.1f%%\n", c->size, c->allocations, c->peak_mapped,
+               human_bytes((double)c->peak_mapped * m->slab_bytes, a, sizeof(a)),
+               100.0 * (c->rounded - c->requested) / c->rounded);
+    }
+    if (m->large_allocations > 0) {
+        printf("  %-10s %-12zu (page-rounded, freed straight back)\n", "large", m->large_allocations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int passes = 1;
+    int touch_pages = 1;
+    int sim = 0;
+    unsigned long long slab = DEFAULT_SLAB_BYTES;
+    const char *classes = NULL;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            passes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-touch") == 0) {
+            touch_pages = 0;
+        } else if (strcmp(argv[i], "--simulate") == 0) {
+            sim = 1;
+        } else if (strcmp(argv[i], "--slab") == 0 && i + 1 < argc) {
+            sim = 1;
+            slab = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--classes") == 0 && i + 1 < argc) {
+            sim = 1;
+            classes = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            usage(argv[0]);
+            return 0;
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!path) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (passes < 1) passes = 1;
+    if (slab < 4096) {
+        fprintf(stderr, "oswatch-replay: --slab must be at least 4096 bytes\n");
+        return 1;
+    }
+
+    AllocTrace trace;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (load_alloc_trace(path, &trace) == -1) {
+        fprintf(stderr, "oswatch-replay: %s: %s\n", path,
+                errno == EINVAL ? "not an allocation trace" : strerror(errno));
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("Loaded %zu operation(s) of %s in %.2f ms\n", trace.count,
+           trace.program[0] ? trace.program : "(unknown program)", calculate_time_diff(&start, &end));
+    printf("  %zu malloc, %zu calloc, %zu realloc, %zu free; %zu block(s) never freed\n",
+           trace.op_counts[ALLOC_OP_MALLOC], trace.op_counts[ALLOC_OP_CALLOC],
+           trace.op_counts[ALLOC_OP_REALLOC], trace.op_counts[ALLOC_OP_FREE], trace.live_at_end);
+    if (trace.unmatched > 0 || trace.reordered > 0) {
+        printf("  %zu free(s) of blocks from before the trace skipped, %zu late free(s) moved up\n",
+               trace.unmatched, trace.reordered);
+    }
+
+    int result = 0;
+    if (!sim) {
+        replay_native(&trace, passes, touch_pages);
+    } else {
+        SimModel models[MAX_SIM_MODELS];
+        int count = 0;
+        memset(models, 0, sizeof(models));
+
+        models[count].name = "pow2";
+        models[count].slab_bytes = slab;
+        pow2_classes(&models[count++]);
+        models[count].name = "quarter";
+        models[count].slab_bytes = slab;
+        quarter_classes(&models[count++]);
+        if (classes) {
+            models[count].name = "custom";
+            models[count].slab_bytes = slab;
+            if (parse_classes(&models[count], classes) == -1) {
+                fprintf(stderr, "oswatch-replay: --classes wants increasing sizes up to half "
+                        "a slab, e.g. 16,64,256\n");
+                free_model(&models[count]);
+                free_alloc_trace(&trace);
+                return 1;
+            }
+            count++;
+        }
+
+        for (int i = 0; i < count; i++) {
+            simulate(&models[i], &trace);
+            result |= models[i].failed;
+        }
+        print_simulation(&trace, models, count, slab);
+        for (int i = 0; i < count; i++) free_model(&models[i]);
+    }
+
+    free_alloc_trace(&trace);
+    return result;
+}
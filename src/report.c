@@ -1,4 +1,5 @@
 #include "../include/oswatch.h"
+#include <sys/resource.h>
 
 void print_open_file_table(ProcessStats *stats) {
     FileDescriptor *fd = stats->open_files;
@@ -9,18 +10,76 @@ void print_open_file_table(ProcessStats *stats) {
     }
 
     printf("\n%sLeaked File Descriptors:%s\n", COLOR_RED, COLOR_RESET);
-    printf("  %-6s %-12s %-12s %-14s\n", "FD", "FLAGS", "READ(bytes)", "WRITE(bytes)");
-    printf("  ---------------------------------------------\n");
+    printf("  %-6s %-12s %-12s %-14s %s\n", "FD", "FLAGS", "READ(bytes)", "WRITE(bytes)", "FILE");
+    printf("  ------------------------------------------------------------\n");
 
     while (fd) {
-        printf("  %-6d %-12d %-12ld %-14ld\n",
+        if (fd->sock) {
+            fd = fd->next;  // Listed under SOCKETS
+            continue;
+        }
+        printf("  %-6d %-12d %-12ld %-14ld %s\n",
                fd->fd,
                fd->flags,
                fd->bytes_read,
-               fd->bytes_written);
+               fd->bytes_written,
+               fd->filename);
         fd = fd->next;
     }
 }
+
+// perf counters and wait4() rusage: was the time spent on faults,
+// on waiting for a CPU, or in syscalls?
+static void print_cpu_statistics(ProcessStats *stats) {
+    PerfCounters *perf = &stats->perf;
+    struct rusage *ru = &stats->tracee_rusage;
+    double wall = stats->execution_time_ms;
+
+    printf("%sCPU & Scheduling:%s\n", COLOR_BOLD, COLOR_RESET);
+
+    if (perf->reads > 0) {
+        double task_ms = perf->values[COUNTER_TASK_CLOCK] / 1000000.0;
+        printf("  Task Clock:       %.2f ms", task_ms);
+        if (wall > 0) {
+            printf(" (%.2f CPUs utilized)", task_ms / wall);
+        }
+        printf("\n");
+        printf("  Page Faults:      %llu minor, %llu major\n",
+               (unsigned long long)perf->values[COUNTER_MINOR_FAULTS],
+               (unsigned long long)perf->values[COUNTER_MAJOR_FAULTS]);
+        printf("  Context Switches: %llu\n",
+               (unsigned long long)perf->values[COUNTER_CONTEXT_SWITCHES]);
+        printf("  CPU Migrations:   %llu\n",
+               (unsigned long long)perf->values[COUNTER_CPU_MIGRATIONS]);
+        if (perf->user_only) {
+            printf("  %s(user-space only: perf_event_paranoid blocks kernel counts)%s\n",
+                   COLOR_CYAN, COLOR_RESET);
+        }
+    } else {
+        printf("  perf counters:    unavailable\n");
+    }
+
+    if (stats->have_rusage) {
+        double user_ms = timeval_ms(&ru->ru_utime);
+        double sys_ms = timeval_ms(&ru->ru_stime);
+
+        printf("  User / Sys CPU:   %.2f ms / %.2f ms\n", user_ms, sys_ms);
+        printf("  Max RSS:          %ld KB\n", ru->ru_maxrss);
+        printf("  rusage Faults:    %ld minor, %ld major\n", ru->ru_minflt, ru->ru_majflt);
+        printf("  rusage Switches:  %ld voluntary, %ld involuntary\n", ru->ru_nvcsw, ru->ru_nivcsw);
+
+        // Off-CPU is blocked or runnable-but-waiting (and, traced, held at stops)
+        if (wall > 0) {
+            double off_cpu = wall - user_ms - sys_ms;
+            if (off_cpu < 0) off_cpu = 0;  // Multi-threaded runs can exceed wall
+            printf("  Wall Time Split:  user %.1f%%, sys %.1f%%, off-CPU %.1f%%%s\n",
+                   100.0 * user_ms / wall, 100.0 * sys_ms / wall, 100.0 * off_cpu / wall,
+                   stats->no_ptrace ? "" : " (includes ptrace stops)");
+        }
+    }
+    printf("\n");
+}
+
 void print_statistics(ProcessStats *stats) {
     printf("%s╔═══════════════════════════════════════════════════════╗%s\n", COLOR_CYAN, COLOR_RESET);
     printf("%s║               PROCESS STATISTICS                      ║%s\n", COLOR_CYAN, COLOR_RESET);
@@ -34,13 +93,19 @@ void print_statistics(ProcessStats *stats) {
 
     // System call stats
     printf("%sSystem Call Statistics:%s\n", COLOR_BOLD, COLOR_RESET);
-    printf("  Total Syscalls: %zu\n", stats->total_syscalls);
+    printf("  Total Syscalls: %zu", stats->total_syscalls);
+    if (stats->no_ptrace) {
+        printf(" %s(libc wrapper calls only)%s", COLOR_CYAN, COLOR_RESET);
+    }
+    printf("\n");
     printf("  Total Time:     %.2f ms\n", stats->total_syscall_time_ms);
     if (stats->total_syscalls > 0) {
         printf("  Avg Duration:   %.4f ms\n", stats->total_syscall_time_ms / stats->total_syscalls);
     }
     printf("\n");
 
+    print_cpu_statistics(stats);
+
     // Memory stats
     printf("%sMemory Statistics:%s\n", COLOR_BOLD, COLOR_RESET);
     
@@ -67,12 +132,113 @@ void print_statistics(ProcessStats *stats) {
     }
 }
 
-void generate_report(ProcessStats *stats) {
+void print_tracer_overhead(ProcessStats *stats) {
+    TracerOverhead *ov = &stats->overhead;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s║               TRACER OVERHEAD                         ║%s\n", COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n", COLOR_CYAN, COLOR_RESET);
+
+    struct rusage self_usage, child_usage;
+    getrusage(RUSAGE_SELF, &self_usage);
+    getrusage(RUSAGE_CHILDREN, &child_usage);
+    double tracer_cpu = timeval_ms(&self_usage.ru_utime) + timeval_ms(&self_usage.ru_stime);
+    double tracee_cpu = timeval_ms(&child_usage.ru_utime) + timeval_ms(&child_usage.ru_stime);
+
+    printf("%sptrace:%s\n", COLOR_BOLD, COLOR_RESET);
+    if (stats->no_ptrace) {
+        printf("  Not used (--no-ptrace)\n\n");
+    } else {
+        printf("  Stops:            %zu\n", ov->ptrace_stops);
+        printf("  waitpid time:     %.2f ms\n", ov->waitpid_ms);
+        printf("  GETREGS time:     %.2f ms\n", ov->getregs_ms);
+        printf("  Tracee held:      %.2f ms", ov->stopped_ms);
+        if (ov->ptrace_stops > 0) {
+            printf(" (%.2f us/stop)", ov->stopped_ms * 1000.0 / ov->ptrace_stops);
+        }
+        printf("\n\n");
+    }
+
+    printf("%sMalloc event channel:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  Events ingested:  %zu", ov->events_ingested);
+    if (stats->execution_time_ms > 0) {
+        printf(" (%.0f events/sec)", ov->events_ingested * 1000.0 / stats->execution_time_ms);
+    }
+    printf("\n");
+    printf("  Ingest time:      %.2f ms\n", ov->ingest_ms);
+    printf("  Pipe backlog max: %zu bytes\n", ov->pipe_backlog_peak);
+    printf("  Dropped events:   %zu (tracer) / %zu (interceptor)\n",
+           ov->events_dropped, ov->interceptor_dropped);
+    printf("  Interceptor time: %.2f ms over %zu events", ov->interceptor_ms, ov->interceptor_events);
+    if (!stats->no_ptrace) {
+        printf(" %s(includes ptrace stops on its writes)%s", COLOR_CYAN, COLOR_RESET);
+    }
+    printf("\n\n");
+
+    if (stats->alloc_trace.path) {
+        printf("%sAllocation trace:%s\n", COLOR_BOLD, COLOR_RESET);
+        printf("  Records:          %zu (%llu bytes) in %s\n\n", stats->alloc_trace.records,
+               stats->alloc_trace.bytes, stats->alloc_trace.path);
+    }
+
+    if (stats->verbose) {
+        printf("%sVerbose log:%s\n", COLOR_BOLD, COLOR_RESET);
+        printf("  Lines written:    %zu\n", stats->log.written);
+        printf("  Dropped events:   %zu%s\n\n", stats->log.dropped,
+               stats->log.dropped ? " (the writer fell behind)" : "");
+    }
+
+    if (stats->metrics.address) {
+        printf("%sMetrics endpoint:%s\n", COLOR_BOLD, COLOR_RESET);
+        printf("  Snapshots:        %zu\n", stats->live.publishes);
+        printf("  Scrapes served:   %zu\n\n", stats->metrics.scrapes);
+    }
+
+    printf("%sCPU:%s\n", COLOR_BOLD, COLOR_RESET);
+    printf("  Tracer CPU:       %.2f ms\n", tracer_cpu);
+    printf("  Tracee CPU:       %.2f ms\n", tracee_cpu);
+
+    // Lower bound: ignores the kernel's context switches at each stop.
+    // Interceptor time is left out - most of it is spent in those stops.
+    // Without ptrace the interceptor's pipe writes are the whole cost.
+    double perturbation = stats->no_ptrace ? ov->interceptor_ms : ov->stopped_ms;
+    double native_estimate = stats->execution_time_ms - perturbation;
+    if (native_estimate > 0.01) {
+        printf("  Est. slowdown:    %s%.2fx%s (lower bound, %.2f ms of %.2f ms spent in oswatch)\n",
+               COLOR_YELLOW, stats->execution_time_ms / native_estimate, COLOR_RESET,
+               perturbation, stats->execution_time_ms);
+    } else {
+        printf("  Est. slowdown:    n/a (run too short)\n");
+    }
+}
+
+int generate_report(ProcessStats *stats) {
+    // Finish the model once; the renderers below only read it
+    fold_open_files(stats);
+    int result = apply_baseline(stats);
+
+    if (stats->report_format == REPORT_JSON) {
+        return generate_json_report(stats) == -1 ? -1 : result;
+    }
+
     print_statistics(stats);
+    report_startup(stats);
+    report_budgets(stats);
     detect_malloc_leaks(stats); 
     detect_memory_leaks(stats);
+    report_heap_growth(stats);
+    report_file_access(stats);
+    report_sockets(stats);
+    report_locks(stats);
+    report_sched(stats);
+    report_injection(stats);
+    report_failed_syscalls(stats);
+    report_tracker_memory(stats);
+    print_tracer_overhead(stats);
+    report_baseline(stats);
     printf("\n%s═══════════════════════════════════════════════════════%s\n",  COLOR_CYAN, COLOR_RESET);
     printf("%sAnalysis complete!%s\n", COLOR_GREEN, COLOR_RESET);
     printf("%s═══════════════════════════════════════════════════════%s\n\n", COLOR_CYAN, COLOR_RESET);
+    return result;
 }
 
@@ -0,0 +1,388 @@
+#define _GNU_SOURCE
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+
+// Per-thread scheduler sampling
+//
+// A thread of our own wakes every interval and reads, for each tracee
+// thread, /proc/<pid>/task/<tid>/schedstat (time on a CPU and time
+// runnable but queued), status (state and context switches) and syscall
+// (what it is blocked in). The files are opened once per thread and
+// re-read with pread at offset 0; the task directory is rescanned with
+// getdents64 into a stack buffer. Nothing in the loop allocates, and the
+// tracer's lock is never taken.
+//
+// The syscall file shows any thread's blocking call even though ptrace
+// only follows the main thread, so sleeping samples are charged to it.
+
+#define MAX_SCHED_SHOWN 15
+#define MAX_STARVED_SHOWN 5
+#define STARVED_SHARE 0.2          // Run-queue wait over runnable time
+#define STARVED_MIN_MS 5.0
+
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+static const char *state_names[THREAD_STATES] = {
+    "running", "sleeping", "disk", "stopped", "other"
+};
+
+static void open_thread(SchedSampler *s, pid_t tid, struct timespec *now) {
+    static const char *files[SCHED_FILES] = { "schedstat", "status", "syscall" };
+
+    if (s->thread_count >= MAX_SCHED_THREADS) {
+        s->threads_missed++;
+        return;
+    }
+
+    SchedThread *t = &s->threads[s->thread_count];
+    memset(t, 0, sizeof(SchedThread));
+    t->tid = tid;
+    t->first_seen = *now;
+
+    for (int i = 0; i < SCHED_FILES; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "%d/%s", tid, files[i]);
+        t->fds[i] = openat(s->task_dir, path, O_RDONLY | O_CLOEXEC);
+    }
+    if (t->fds[SCHED_FILE_SCHEDSTAT] == -1 || t->fds[SCHED_FILE_STATUS] == -1) {
+        // Gone already, or schedstats are not compiled in
+        for (int i = 0; i < SCHED_FILES; i++) {
+            if (t->fds[i] != -1) close(t->fds[i]);
+        }
+        return;
+    }
+    s->thread_count++;
+}
+
+static void close_thread(SchedThread *t) {
+    for (int i = 0; i < SCHED_FILES; i++) {
+        if (t->fds[i] != -1) close(t->fds[i]);
+        t->fds[i] = -1;
+    }
+}
+
+// Pick up threads created since the last pass
+static void scan_tasks(SchedSampler *s, struct timespec *now) {
+    char buf[4096];
+    long n;
+
+    lseek(s->task_dir, 0, SEEK_SET);
+    while ((n = syscall(SYS_getdents64, s->task_dir, buf, sizeof(buf))) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64*)(buf + off);
+            off += d->d_reclen;
+
+            pid_t tid = atoi(d->d_name);
+            if (tid <= 0) continue;
+
+            int known = 0;
+            for (int i = 0; i < s->thread_count && !known; i++) {
+                known = s->threads[i].tid == tid;
+            }
+            if (!known) open_thread(s, tid, now);
+        }
+    }
+}
+
+static ssize_t read_file(int fd, char *buf, size_t len) {
+    ssize_t n = pread(fd, buf, len - 1, 0);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+static unsigned long status_field(const char *status, const char *key) {
+    const char *p = strstr(status, key);
+    return p ? strtoul(p + strlen(key), NULL, 10) : 0;
+}
+
+static int state_index(char state) {
+    switch (state) {
+        case 'R': return THREAD_RUNNING;
+        case 'S': return THREAD_SLEEPING;
+        case 'D': return THREAD_DISK;
+        case 't':
+        case 'T': return THREAD_STOPPED;
+        default:  return THREAD_OTHER;
+    }
+}
+
+static void note_blocked(SchedThread *t, long nr) {
+    for (int i = 0; i < SCHED_BLOCKED_SLOTS; i++) {
+        if (t->blocked[i].samples == 0) t->blocked[i].syscall = nr;
+        if (t->blocked[i].syscall == nr) {
+            t->blocked[i].samples++;
+            return;
+        }
+    }
+    t->blocked_other++;
+}
+
+// One pass over a live thread; returns its state, or -1 once it has exited
+static int sample_thread(SchedThread *t, struct timespec *now) {
+    char buf[4096];
+
+    if (read_file(t->fds[SCHED_FILE_SCHEDSTAT], buf, sizeof(buf)) == -1) return -1;
+    char *end;
+    unsigned long long run = strtoull(buf, &end, 10);
+    unsigned long long wait = strtoull(end, NULL, 10);
+
+    if (t->samples == 0) {
+        t->first_run_ns = run;
+        t->first_wait_ns = wait;
+    }
+    t->run_ns = run;
+    t->wait_ns = wait;
+
+    if (read_file(t->fds[SCHED_FILE_STATUS], buf, sizeof(buf)) == -1) return -1;
+    const char *name = strstr(buf, "Name:\t");
+    if (name) {
+        name += 6;
+        size_t len = strcspn(name, "\n");
+        if (len >= sizeof(t->name)) len = sizeof(t->name) - 1;
+        memcpy(t->name, name, len);
+        t->name[len] = '\0';
+    }
+    const char *state = strstr(buf, "State:\t");
+    int st = state_index(state ? state[7] : '?');
+    t->voluntary = status_field(buf, "\nvoluntary_ctxt_switches:\t");
+    t->involuntary = status_field(buf, "nonvoluntary_ctxt_switches:\t");
+
+    // "nr args... sp pc" while in a syscall, "-1 sp pc" or "running" otherwise
+    if ((st == THREAD_SLEEPING || st == THREAD_DISK) && t->fds[SCHED_FILE_SYSCALL] != -1 &&
+        read_file(t->fds[SCHED_FILE_SYSCALL], buf, sizeof(buf)) != -1 &&
+        buf[0] >= '0' && buf[0] <= '9') {
+        note_blocked(t, strtol(buf, NULL, 10));
+    }
+
+    t->states[st]++;
+    t->samples++;
+    t->last_seen = *now;
+    return st;
+}
+
+static void sample_once(SchedSampler *s, pid_t pid) {
+    struct timespec now, done;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    scan_tasks(s, &now);
+
+    int runnable = 0;
+    for (int i = 0; i < s->thread_count; i++) {
+        SchedThread *t = &s->threads[i];
+        if (t->fds[SCHED_FILE_SCHEDSTAT] == -1) continue;
+
+        int st = sample_thread(t, &now);
+        if (st == -1) {
+            close_thread(t);
+        } else if (st == THREAD_RUNNING) {
+            runnable++;
+        }
+    }
+
+    cpu_set_t cpus;
+    if (sched_getaffinity(pid, sizeof(cpus), &cpus) == 0) {
+        int count = CPU_COUNT(&cpus);
+        if (s->cpus == 0 || count < s->cpus) s->cpus = count;
+    }
+
+    s->samples++;
+    s->runnable_sum += runnable;
+    if (runnable > s->runnable_peak) s->runnable_peak = runnable;
+
+    clock_gettime(CLOCK_MONOTONIC, &done);
+    s->sample_ms += calculate_time_diff(&now, &done);
+}
+
+static void* sched_sampler_thread(void *arg) {
+    ProcessStats *stats = arg;
+    SchedSampler *s = &stats->sched;
+    struct pollfd stop = { s->stop_pipe[0], POLLIN, 0 };
+
+    while (1) {
+        sample_once(s, stats->pid);
+
+        int ready = poll(&stop, 1, s->interval_ms);
+        if (ready > 0) break;
+        if (ready == -1 && errno != EINTR) break;
+    }
+    return NULL;
+}
+
+void start_sched_sampler(pid_t pid, ProcessStats *stats) {
+    SchedSampler *s = &stats->sched;
+    char path[64];
+
+    if (s->interval_ms <= 0) s->interval_ms = DEFAULT_SCHED_INTERVAL_MS;
+
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    s->task_dir = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (s->task_dir == -1) {
+        fprintf(stderr, "%s[SCHED]%s Cannot open %s: %s\n",
+                COLOR_YELLOW, COLOR_RESET, path, strerror(errno));
+        return;
+    }
+    if (pipe(s->stop_pipe) == -1) {
+        close(s->task_dir);
+        return;
+    }
+    s->running = pthread_create(&s->thread, NULL, sched_sampler_thread, stats) == 0;
+    if (!s->running) {
+        close(s->stop_pipe[0]);
+        close(s->stop_pipe[1]);
+        close(s->task_dir);
+    }
+}
+
+void stop_sched_sampler(ProcessStats *stats) {
+    SchedSampler *s = &stats->sched;
+    if (!s->running) return;
+
+    if (write(s->stop_pipe[1], "x", 1) != 1) {
+        perror("sched sampler stop failed");
+    }
+    pthread_join(s->thread, NULL);
+    s->running = 0;
+
+    for (int i = 0; i < s->thread_count; i++) {
+        close_thread(&s->threads[i]);
+    }
+    close(s->stop_pipe[0]);
+    close(s->stop_pipe[1]);
+    close(s->task_dir);
+}
+
+// Time neither on a CPU nor queued for one, over the sampled window
+double sched_off_cpu_ms(SchedThread *t) {
+    double window = calculate_time_diff(&t->first_seen, &t->last_seen);
+    double busy = (t->run_ns - t->first_run_ns + t->wait_ns - t->first_wait_ns) / 1e6;
+    return window > busy ? window - busy : 0.0;
+}
+
+static double queue_share(SchedThread *t) {
+    unsigned long long runnable = t->run_ns + t->wait_ns;
+    return runnable ? (double)t->wait_ns / runnable : 0.0;
+}
+
+static int compare_threads(const void *a, const void *b) {
+    const SchedThread *ta = *(const SchedThread * const *)a;
+    const SchedThread *tb = *(const SchedThread * const *)b;
+
+    if (ta->wait_ns < tb->wait_ns) return 1;
+    if (ta->wait_ns > tb->wait_ns) return -1;
+    if (ta->run_ns < tb->run_ns) return 1;
+    if (ta->run_ns > tb->run_ns) return -1;
+    return 0;
+}
+
+// "futex 80%" - where its sleeping samples were spent
+static const char* top_blocker(SchedThread *t, char *buf, size_t len) {
+    size_t sleeping = t->states[THREAD_SLEEPING] + t->states[THREAD_DISK];
+    BlockedSyscall *top = NULL;
+
+    for (int i = 0; i < SCHED_BLOCKED_SLOTS; i++) {
+        if (t->blocked[i].samples > 0 && (!top || t->blocked[i].samples > top->samples)) {
+            top = &t->blocked[i];
+        }
+    }
+    if (!top || sleeping == 0) {
+        snprintf(buf, len, "-");
+    } else {
+        snprintf(buf, len, "%s %.0f%%", get_syscall_name(top->syscall),
+                 100.0 * top->samples / sleeping);
+    }
+    return buf;
+}
+
+void report_sched(ProcessStats *stats) {
+    SchedSampler *s = &stats->sched;
+    if (!s->enabled) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           SCHEDULER LATENCY (PER THREAD)              ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    if (s->thread_count == 0) {
+        printf("  %sNo samples (is /proc/<pid>/task/*/schedstat available?)%s\n",
+               COLOR_YELLOW, COLOR_RESET);
+        return;
+    }
+
+    printf("  Samples:          %zu every %d ms (sampler time %.2f ms)\n",
+           s->samples, s->interval_ms, s->sample_ms);
+    printf("  Threads seen:     %d", s->thread_count);
+    if (s->threads_missed > 0) {
+        printf(" (%zu more not tracked)", s->threads_missed);
+    }
+    printf("\n");
+    printf("  Runnable threads: %.1f avg, %d peak on %d CPU(s)\n\n",
+           s->samples ? (double)s->runnable_sum / s->samples : 0.0, s->runnable_peak, s->cpus);
+
+    SchedThread *threads[MAX_SCHED_THREADS];
+    int n = 0;
+    for (int i = 0; i < s->thread_count; i++) {
+        if (s->threads[i].samples > 0) threads[n++] = &s->threads[i];
+    }
+    qsort(threads, n, sizeof(SchedThread*), compare_threads);
+
+    printf("  %-8s %-16s %-11s %-11s %-7s %-12s %-13s %s\n",
+           "TID", "NAME", "ON-CPU(ms)", "RUNQ(ms)", "RUNQ%", "OFF-CPU(ms)", "VOL/INVOL", "BLOCKED IN");
+    printf("  ------------------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < n && i < MAX_SCHED_SHOWN; i++) {
+        SchedThread *t = threads[i];
+        char switches[32], blocker[48];
+        snprintf(switches, sizeof(switches), "%lu/%lu", t->voluntary, t->involuntary);
+        printf("  %-8d %-16s %-11.2f %-11.2f %-7.1f %-12.2f %-13s %s\n",
+               t->tid, t->name, t->run_ns / 1e6, t->wait_ns / 1e6, 100.0 * queue_share(t),
+               sched_off_cpu_ms(t), switches, top_blocker(t, blocker, sizeof(blocker)));
+    }
+    if (n > MAX_SCHED_SHOWN) {
+        printf("  ... %d more thread(s)\n", n - MAX_SCHED_SHOWN);
+    }
+    printf("  (RUNQ: runnable but waiting for a CPU; OFF-CPU: blocked or sleeping while sampled)\n");
+
+    // Threads that spent a real share of their runnable time queued
+    int starved = 0;
+    for (int i = 0; i < n; i++) {
+        SchedThread *t = threads[i];
+        if (queue_share(t) < STARVED_SHARE || t->wait_ns / 1e6 < STARVED_MIN_MS) continue;
+
+        if (starved++ == 0) printf("\n%sFindings:%s\n", COLOR_BOLD, COLOR_RESET);
+        if (starved > MAX_STARVED_SHOWN) continue;
+        printf("  %s!%s Thread %d (%s) waited %.2f ms for a CPU (%.0f%% of its runnable time, "
+               "%lu involuntary switches)\n",
+               COLOR_YELLOW, COLOR_RESET, t->tid, t->name, t->wait_ns / 1e6,
+               100.0 * queue_share(t), t->involuntary);
+    }
+    if (starved > MAX_STARVED_SHOWN) {
+        printf("  ... %d more starved thread(s)\n", starved - MAX_STARVED_SHOWN);
+    }
+    if (starved > 0 && s->runnable_peak > s->cpus) {
+        printf("    Up to %d threads were runnable on %d CPU(s): the process is oversubscribed.\n"
+               "    Size thread pools to the CPUs it may use, or move background work off them.\n",
+               s->runnable_peak, s->cpus);
+    }
+
+    if (s->samples > 0) {
+        size_t stopped = 0, total = 0;
+        for (int i = 0; i < n; i++) {
+            stopped += threads[i]->states[THREAD_STOPPED];
+            for (int st = 0; st < THREAD_STATES; st++) total += threads[i]->states[st];
+        }
+        if (stopped > 0 && !stats->no_ptrace) {
+            printf("\n  %.1f%% of thread samples found a thread %s (ptrace stops)\n",
+                   100.0 * stopped / total, state_names[THREAD_STOPPED]);
+        }
+    }
+}
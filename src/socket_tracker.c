@@ -0,0 +1,403 @@
+#include "../include/oswatch.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <stddef.h>
+
+// Socket tracking
+//
+// Socket fds live in the file tracker's list and point at a SocketInfo
+// node of their own; plain files carry none. Addresses are decoded from
+// the sockaddr the tracee passed (or got back from accept and recvfrom),
+// copied out with process_vm_readv. Blocking connects are
+// timed by the syscall itself; a non-blocking connect is timed from the
+// EINPROGRESS return to the first traffic on the socket. When the socket
+// is closed its counters go into a per-(endpoint, role) record.
+
+#define MAX_ENDPOINTS_SHOWN 15
+
+static const char *role_names[SOCK_ROLES] = {
+    "unconnected", "client", "server", "listen", "dgram", "pair"
+};
+
+const char* socket_role_name(int role) {
+    return role >= 0 && role < SOCK_ROLES ? role_names[role] : "?";
+}
+
+static double elapsed_ms(struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return calculate_time_diff(since, &now);
+}
+
+// "127.0.0.1:8080", "[::1]:443", "unix:/run/x.sock", "unix:@abstract"
+static const char* decode_sockaddr(ProcessStats *stats, unsigned long addr, socklen_t len) {
+    struct sockaddr_storage ss;
+    char host[INET6_ADDRSTRLEN];
+    char text[160];
+
+    if (addr == 0 || len < sizeof(sa_family_t)) return NULL;
+    if (len > sizeof(ss)) len = sizeof(ss);
+    memset(&ss, 0, sizeof(ss));
+    if (!read_tracee_memory(stats->pid, addr, &ss, len)) return NULL;
+
+    switch (ss.ss_family) {
+        case AF_INET: {
+            struct sockaddr_in *in = (struct sockaddr_in*)&ss;
+            inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+            snprintf(text, sizeof(text), "%s:%u", host, ntohs(in->sin_port));
+            break;
+        }
+        case AF_INET6: {
+            struct sockaddr_in6 *in6 = (struct sockaddr_in6*)&ss;
+            inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+            snprintf(text, sizeof(text), "[%s]:%u", host, ntohs(in6->sin6_port));
+            break;
+        }
+        case AF_UNIX: {
+            struct sockaddr_un *un = (struct sockaddr_un*)&ss;
+            size_t path_len = len - offsetof(struct sockaddr_un, sun_path);
+            if (len <= offsetof(struct sockaddr_un, sun_path)) {
+                snprintf(text, sizeof(text), "unix:(unnamed)");
+            } else if (un->sun_path[0] == '\0') {
+                snprintf(text, sizeof(text), "unix:@%.*s", (int)path_len - 1, un->sun_path + 1);
+            } else {
+                snprintf(text, sizeof(text), "unix:%.*s", (int)path_len, un->sun_path);
+            }
+            break;
+        }
+        default:
+            snprintf(text, sizeof(text), "family %d", ss.ss_family);
+    }
+    return intern_string(stats, text);
+}
+
+// accept/recvfrom write the address length back through a pointer
+static const char* decode_returned_sockaddr(ProcessStats *stats, unsigned long addr, unsigned long len_ptr) {
+    socklen_t len;
+    if (addr == 0 || !read_tracee_memory(stats->pid, len_ptr, &len, sizeof(len))) return NULL;
+    return decode_sockaddr(stats, addr, len);
+}
+
+// Datagram sockets may name the peer per message
+static const char* decode_msghdr_name(ProcessStats *stats, unsigned long msg) {
+    struct msghdr hdr;
+    if (!read_tracee_memory(stats->pid, msg, &hdr, sizeof(hdr))) return NULL;
+    return decode_sockaddr(stats, (unsigned long)hdr.msg_name, hdr.msg_namelen);
+}
+
+static FileDescriptor* open_socket(ProcessStats *stats, int fd, int family, int type, int role) {
+    SocketInfo *s = slab_alloc(&stats->socket_info_slab);
+    if (!s) return NULL;
+    FileDescriptor *f = track_file_open(stats, fd, "socket", 0);
+    if (!f) {
+        slab_free(&stats->socket_info_slab, s);
+        return NULL;
+    }
+
+    memset(s, 0, sizeof(SocketInfo));
+    f->sock = s;
+    f->sock->family = family;
+    f->sock->type = type & 0xf;  // Strip SOCK_NONBLOCK/SOCK_CLOEXEC
+    f->sock->role = role;
+    f->sock->shutdown_how = -1;
+    stats->sockets_opened++;
+    return f;
+}
+
+static FileDescriptor* find_socket(ProcessStats *stats, long fd) {
+    FileDescriptor *f = find_file(stats, fd);
+    return f && f->sock ? f : NULL;
+}
+
+static SocketEndpoint* get_endpoint(ProcessStats *stats, const char *endpoint, int role) {
+    unsigned int idx = (((unsigned long)endpoint >> 4) + role) % SOCKET_HASH_SIZE;
+
+    for (SocketEndpoint *e = stats->socket_endpoints[idx]; e; e = e->next) {
+        if (e->endpoint == endpoint && e->role == role) return e;
+    }
+
+    SocketEndpoint *e = slab_alloc(&stats->socket_slab);
+    if (!e) return NULL;
+
+    memset(e, 0, sizeof(SocketEndpoint));
+    e->endpoint = endpoint;
+    e->role = role;
+    e->next = stats->socket_endpoints[idx];
+    stats->socket_endpoints[idx] = e;
+    return e;
+}
+
+// Accepted connections are grouped under the address they came in on,
+// not the client's ephemeral port
+const char* socket_endpoint_name(ProcessStats *stats, SocketInfo *s) {
+    if ((s->role == SOCK_ROLE_LISTEN || s->role == SOCK_ROLE_SERVER) && s->local) return s->local;
+    if (s->peer) return s->peer;
+    if (s->local) return s->local;
+    return intern_string(stats, "-");
+}
+
+// A non-blocking connect is done once the socket carries traffic
+static void finish_connect(SocketInfo *s) {
+    if (s->connect_pending) {
+        s->connect_ms = elapsed_ms(&s->connect_start);
+        s->connect_pending = 0;
+    }
+}
+
+void track_socket_io(FileDescriptor *f, size_t bytes, int is_write) {
+    SocketInfo *s = f->sock;
+
+    finish_connect(s);
+    if (is_write) {
+        s->msgs_sent++;
+        s->bytes_sent += bytes;
+    } else {
+        s->msgs_received++;
+        s->bytes_received += bytes;
+    }
+}
+
+static void record_failed_connect(ProcessStats *stats, const char *peer) {
+    SocketEndpoint *e = get_endpoint(stats, peer ? peer : intern_string(stats, "-"), SOCK_ROLE_CLIENT);
+    if (e) e->failed_connects++;
+}
+
+void track_socket_syscall(ProcessStats *stats, struct user_regs_struct *regs, double duration) {
+    long nr = regs->orig_rax;
+    long ret = regs->rax;
+    int ok = !(ret < 0 && ret > -4096);
+    FileDescriptor *f;
+
+    switch (nr) {
+        case 41:  // socket
+            if (ok) open_socket(stats, ret, regs->rdi, regs->rsi, SOCK_ROLE_NONE);
+            break;
+
+        case 53:  // socketpair
+            if (ok) {
+                int sv[2];
+                if (read_tracee_memory(stats->pid, regs->r10, sv, sizeof(sv))) {
+                    for (int i = 0; i < 2; i++) {
+                        f = open_socket(stats, sv[i], regs->rdi, regs->rsi, SOCK_ROLE_PAIR);
+                        if (f) f->sock->peer = intern_string(stats, "socketpair");
+                    }
+                }
+            }
+            break;
+
+        case 49:  // bind
+            if (ok && (f = find_socket(stats, regs->rdi))) {
+                f->sock->local = decode_sockaddr(stats, regs->rsi, regs->rdx);
+            }
+            break;
+
+        case 51:  // getsockname - the real port after binding to port 0
+            if (ok && (f = find_socket(stats, regs->rdi))) {
+                const char *local = decode_returned_sockaddr(stats, regs->rsi, regs->rdx);
+                if (local) f->sock->local = local;
+            }
+            break;
+
+        case 50:  // listen
+            if (ok && (f = find_socket(stats, regs->rdi))) {
+                f->sock->role = SOCK_ROLE_LISTEN;
+            }
+            break;
+
+        case 42:  // connect
+            if ((f = find_socket(stats, regs->rdi))) {
+                const char *peer = decode_sockaddr(stats, regs->rsi, regs->rdx);
+                if (ok || ret == -EINPROGRESS) {
+                    f->sock->peer = peer;
+                    f->sock->role = SOCK_ROLE_CLIENT;
+                    if (ok) {
+                        f->sock->connect_ms = duration;
+                    } else {
+                        f->sock->connect_pending = 1;
+                        clock_gettime(CLOCK_MONOTONIC, &f->sock->connect_start);
+                    }
+                } else {
+                    record_failed_connect(stats, peer);
+                }
+            }
+            break;
+
+        case 43:   // accept
+        case 288:  // accept4
+            if (ok) {
+                FileDescriptor *listener = find_socket(stats, regs->rdi);
+                f = open_socket(stats, ret, listener ? listener->sock->family : 0,
+                                listener ? listener->sock->type : SOCK_STREAM, SOCK_ROLE_SERVER);
+                if (f) {
+                    f->sock->peer = decode_returned_sockaddr(stats, regs->rsi, regs->rdx);
+                    f->sock->local = listener ? listener->sock->local : NULL;
+                }
+                if (listener) listener->sock->accepted++;
+            }
+            break;
+
+        case 44:  // sendto
+        case 46:  // sendmsg
+            if (ok && (f = find_socket(stats, regs->rdi))) {
+                track_socket_io(f, ret, 1);
+                if (!f->sock->peer && f->sock->role != SOCK_ROLE_LISTEN) {
+                    f->sock->peer = nr == 44 ? decode_sockaddr(stats, regs->r8, regs->r9)
+                                            : decode_msghdr_name(stats, regs->rsi);
+                    if (f->sock->peer && f->sock->role == SOCK_ROLE_NONE) f->sock->role = SOCK_ROLE_DGRAM;
+                }
+            }
+            break;
+
+        case 45:  // recvfrom
+        case 47:  // recvmsg
+            if (ok && ret > 0 && (f = find_socket(stats, regs->rdi))) {
+                track_socket_io(f, ret, 0);
+                if (!f->sock->peer && f->sock->role == SOCK_ROLE_NONE) {
+                    f->sock->peer = nr == 45 ? decode_returned_sockaddr(stats, regs->r8, regs->r9)
+                                            : decode_msghdr_name(stats, regs->rsi);
+                    if (f->sock->peer) f->sock->role = SOCK_ROLE_DGRAM;
+                }
+            }
+            break;
+
+        case 48:  // shutdown
+            if (ok && (f = find_socket(stats, regs->rdi))) {
+                f->sock->shutdown_how = regs->rsi;
+            }
+            break;
+    }
+
+    if (stats->verbose && ok && (nr == 42 || nr == 43 || nr == 288)) {
+        f = find_socket(stats, nr == 42 ? (long)regs->rdi : ret);
+        if (f) {
+            log_event(&stats->log, nr == 42 ? LOG_CONNECT : LOG_ACCEPT, f->fd, 0, 0, 0, f->sock->peer);
+        }
+    }
+}
+
+// Socket is being closed: add it to its endpoint's totals
+void fold_socket(ProcessStats *stats, FileDescriptor *f) {
+    SocketInfo *s = f->sock;
+    SocketEndpoint *e = get_endpoint(stats, socket_endpoint_name(stats, s), s->role);
+    if (!e) return;
+
+    e->msgs_sent += s->msgs_sent;
+    e->msgs_received += s->msgs_received;
+    e->bytes_sent += s->bytes_sent;
+    e->bytes_received += s->bytes_received;
+    if (s->is_dup) return;
+
+    double lifetime = elapsed_ms(&f->opened_at);
+    e->sockets++;
+    e->accepted += s->accepted;
+    e->lifetime_ms += lifetime;
+    if (lifetime > e->lifetime_max_ms) e->lifetime_max_ms = lifetime;
+    if (s->role == SOCK_ROLE_CLIENT && !s->connect_pending) {
+        e->connects++;
+        e->connect_ms += s->connect_ms;
+        if (s->connect_ms > e->connect_max_ms) e->connect_max_ms = s->connect_ms;
+    }
+}
+
+static int compare_endpoints(const void *a, const void *b) {
+    const SocketEndpoint *ea = *(const SocketEndpoint * const *)a;
+    const SocketEndpoint *eb = *(const SocketEndpoint * const *)b;
+    off_t bytes_a = ea->bytes_sent + ea->bytes_received;
+    off_t bytes_b = eb->bytes_sent + eb->bytes_received;
+
+    if (bytes_a < bytes_b) return 1;
+    if (bytes_a > bytes_b) return -1;
+    if (ea->sockets < eb->sockets) return 1;
+    if (ea->sockets > eb->sockets) return -1;
+    return 0;
+}
+
+static void print_leaked_sockets(ProcessStats *stats) {
+    printf("\n%sLeaked Sockets:%s\n", COLOR_RED, COLOR_RESET);
+    printf("  %-6s %-12s %-28s %-12s %-12s %s\n", "FD", "ROLE", "ENDPOINT", "SENT", "RECEIVED", "OPEN FOR");
+    printf("  ------------------------------------------------------------------------------\n");
+
+    for (FileDescriptor *f = stats->open_files; f; f = f->next) {
+        if (!f->sock) continue;
+        printf("  %-6d %-12s %-28s %-12ld %-12ld %.2f ms\n",
+               f->fd, role_names[f->sock->role], socket_endpoint_name(stats, f->sock),
+               (long)f->sock->bytes_sent, (long)f->sock->bytes_received,
+               calculate_time_diff(&f->opened_at, &stats->end_time));
+    }
+}
+
+void report_sockets(ProcessStats *stats) {
+    if (stats->sockets_opened == 0) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           SOCKETS                                     ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    printf("  Sockets Opened: %d\n", stats->sockets_opened);
+    printf("  Sockets Closed: %d\n", stats->sockets_closed);
+
+    size_t count = 0;
+    for (int i = 0; i < SOCKET_HASH_SIZE; i++) {
+        for (SocketEndpoint *e = stats->socket_endpoints[i]; e; e = e->next) count++;
+    }
+
+    if (count > 0) {
+        SocketEndpoint **endpoints = malloc(count * sizeof(SocketEndpoint*));
+        if (!endpoints) return;
+
+        size_t n = 0;
+        for (int i = 0; i < SOCKET_HASH_SIZE; i++) {
+            for (SocketEndpoint *e = stats->socket_endpoints[i]; e; e = e->next) endpoints[n++] = e;
+        }
+        qsort(endpoints, n, sizeof(SocketEndpoint*), compare_endpoints);
+
+        printf("\n%sClosed Connections:%s\n", COLOR_BOLD, COLOR_RESET);
+        printf("  %-28s %-11s %-6s %-11s %-11s %-11s %-15s %s\n", "ENDPOINT", "ROLE", "SOCKS",
+               "SENT", "RECEIVED", "MSGS OUT/IN", "CONNECT(ms)", "LIFETIME(ms)");
+        printf("  ------------------------------------------------------------------------------------------------------\n");
+        for (size_t i = 0; i < n && i < MAX_ENDPOINTS_SHOWN; i++) {
+            SocketEndpoint *e = endpoints[i];
+            char msgs[32], connect[32];
+
+            snprintf(msgs, sizeof(msgs), "%zu/%zu", e->msgs_sent, e->msgs_received);
+            if (e->connects > 0) {
+                snprintf(connect, sizeof(connect), "%.3f/%.3f", e->connect_ms / e->connects, e->connect_max_ms);
+            } else {
+                snprintf(connect, sizeof(connect), "-");
+            }
+            printf("  %-28.28s %-11s %-6zu %-11ld %-11ld %-11s %-15s",
+                   e->endpoint, role_names[e->role], e->sockets,
+                   (long)e->bytes_sent, (long)e->bytes_received, msgs, connect);
+            if (e->sockets > 0) {
+                printf(" %.2f avg, %.2f max", e->lifetime_ms / e->sockets, e->lifetime_max_ms);
+            }
+            if (e->accepted > 0) {
+                printf(" (%zu accepted)", e->accepted);
+            }
+            if (e->failed_connects > 0) {
+                printf(" %s%zu failed connect(s)%s", COLOR_YELLOW, e->failed_connects, COLOR_RESET);
+            }
+            printf("\n");
+        }
+        if (n > MAX_ENDPOINTS_SHOWN) {
+            printf("  ... %zu more endpoint(s)\n", n - MAX_ENDPOINTS_SHOWN);
+        }
+        printf("  %s(CONNECT is avg/max per endpoint; bytes are totals over its sockets)%s\n",
+               COLOR_CYAN, COLOR_RESET);
+        free(endpoints);
+    }
+
+    printf("\n");
+    if (stats->sockets_opened != stats->sockets_closed) {
+        printf("  %s Warning: %d socket(s) not closed!%s\n", COLOR_YELLOW,
+               stats->sockets_opened - stats->sockets_closed, COLOR_RESET);
+        print_leaked_sockets(stats);
+    } else {
+        printf("  %s✓ All sockets closed%s\n", COLOR_GREEN, COLOR_RESET);
+    }
+}
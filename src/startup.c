@@ -0,0 +1,395 @@
+#include "../include/oswatch.h"
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+// Startup profiler (--startup)
+//
+// The exec stop is where the kernel hands over to ld.so. From there every
+// syscall is charged to the library it works on: the file name it opens
+// (failed search-path probes included), then its fd (read/fstat/mmap),
+// then the address span it was mapped at (mprotect/munmap for RELRO and
+// cleanup). The wall time since the previous syscall goes to the same
+// library, which covers symbol lookup and relocation between the calls.
+// An int3 on main (or the ELF entry point when the binary is stripped)
+// ends the profile.
+
+#define LIB_LOADER 0   // ld.so work not tied to one library
+#define LIB_INIT   1   // Constructors and libc start-up outside ld.so
+#define MAX_LIBS_SHOWN 20
+
+static const char* base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int get_library(ProcessStats *stats, const char *name) {
+    StartupProfile *sp = &stats->startup;
+    const char *key = intern_string(stats, name);
+
+    for (int i = 0; i < sp->lib_count; i++) {
+        if (sp->libs[i].name == key) return i;
+    }
+    if (sp->lib_count >= MAX_STARTUP_LIBS) return LIB_LOADER;
+
+    StartupLibrary *lib = &sp->libs[sp->lib_count];
+    memset(lib, 0, sizeof(StartupLibrary));
+    lib->name = key;
+    return sp->lib_count++;
+}
+
+static int library_at(StartupProfile *sp, unsigned long addr) {
+    for (int i = 0; i < sp->lib_count; i++) {
+        if (addr >= sp->libs[i].map_start && addr < sp->libs[i].map_end) return i;
+    }
+    return -1;
+}
+
+static int library_of_fd(StartupProfile *sp, long fd) {
+    if (fd < 0 || fd >= MAX_STARTUP_FDS) return -1;
+    return sp->fd_lib[fd];
+}
+
+// Which file holds `addr` in the tracee right now
+static const char* module_at(ProcessStats *stats, unsigned long addr) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", stats->pid);
+
+    FILE *maps = fopen(path, "r");
+    if (!maps) return NULL;
+
+    const char *module = NULL;
+    char line[512];
+    while (fgets(line, sizeof(line), maps)) {
+        unsigned long start, end;
+        char name[256] = "";
+        if (sscanf(line, "%lx-%lx %*s %*x %*s %*u %255s", &start, &end, name) < 2) continue;
+        if (addr >= start && addr < end) {
+            module = name[0] ? intern_string(stats, base_name(name)) : NULL;
+            break;
+        }
+    }
+
+    fclose(maps);
+    return module;
+}
+
+// Address of main() from .symtab, or the entry point if it's stripped.
+// `load_start` is where the first PT_LOAD segment landed.
+static unsigned long find_target(const char *exe, unsigned long load_start, const char **what) {
+    int fd = open(exe, O_RDONLY);
+    if (fd == -1) return 0;
+
+    unsigned long target = 0;
+    Elf64_Ehdr eh;
+    if (pread(fd, &eh, sizeof(eh), 0) != sizeof(eh) ||
+        memcmp(eh.e_ident, ELFMAG, SELFMAG) != 0 || eh.e_ident[EI_CLASS] != ELFCLASS64) {
+        close(fd);
+        return 0;
+    }
+
+    // PIE: symbol values are relative to the first segment's vaddr
+    unsigned long bias = 0;
+    if (eh.e_type == ET_DYN) {
+        bias = load_start;
+        for (int i = 0; i < eh.e_phnum; i++) {
+            Elf64_Phdr ph;
+            if (pread(fd, &ph, sizeof(ph), eh.e_phoff + i * sizeof(ph)) != sizeof(ph)) break;
+            if (ph.p_type == PT_LOAD) {
+                bias = load_start - (ph.p_vaddr & ~0xfffUL);
+                break;
+            }
+        }
+    }
+
+    Elf64_Shdr *sh = calloc(eh.e_shnum, sizeof(Elf64_Shdr));
+    if (sh && eh.e_shnum > 0 &&
+        pread(fd, sh, eh.e_shnum * sizeof(Elf64_Shdr), eh.e_shoff) == (ssize_t)(eh.e_shnum * sizeof(Elf64_Shdr))) {
+        for (int i = 0; i < eh.e_shnum && !target; i++) {
+            if (sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh.e_shnum) continue;
+
+            Elf64_Shdr *strtab = &sh[sh[i].sh_link];
+            char *names = malloc(strtab->sh_size + 1);
+            Elf64_Sym *syms = malloc(sh[i].sh_size);
+            if (names && syms &&
+                pread(fd, names, strtab->sh_size, strtab->sh_offset) == (ssize_t)strtab->sh_size &&
+                pread(fd, syms, sh[i].sh_size, sh[i].sh_offset) == (ssize_t)sh[i].sh_size) {
+                names[strtab->sh_size] = '\0';
+                size_t count = sh[i].sh_size / sizeof(Elf64_Sym);
+                for (size_t j = 0; j < count; j++) {
+                    if (ELF64_ST_TYPE(syms[j].st_info) == STT_FUNC &&
+                        syms[j].st_shndx != SHN_UNDEF && syms[j].st_value != 0 &&
+                        syms[j].st_name < strtab->sh_size &&
+                        strcmp(names + syms[j].st_name, "main") == 0) {
+                        target = bias + syms[j].st_value;
+                        *what = "main()";
+                        break;
+                    }
+                }
+            }
+            free(names);
+            free(syms);
+        }
+    }
+    free(sh);
+    close(fd);
+
+    if (!target && eh.e_entry) {
+        target = bias + eh.e_entry;
+        *what = "entry point";
+    }
+    return target;
+}
+
+// Tracee is stopped right after execve returned: only the executable and
+// ld.so are mapped. Find ld.so's text and plant the breakpoint.
+void startup_exec_stop(pid_t pid, ProcessStats *stats) {
+    StartupProfile *sp = &stats->startup;
+
+    clock_gettime(CLOCK_MONOTONIC, &sp->exec_time);
+    sp->last_event = sp->exec_time;
+    sp->active = 1;
+    for (int i = 0; i < MAX_STARTUP_FDS; i++) {
+        sp->fd_lib[i] = -1;
+    }
+    get_library(stats, "[ld.so]");
+    get_library(stats, "[init]");
+
+    char link[64], exe[PATH_MAX];
+    snprintf(link, sizeof(link), "/proc/%d/exe", pid);
+    ssize_t len = readlink(link, exe, sizeof(exe) - 1);
+    if (len <= 0) return;
+    exe[len] = '\0';
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", pid);
+    FILE *maps = fopen(path, "r");
+    if (!maps) return;
+
+    unsigned long exe_start = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), maps)) {
+        unsigned long start, end;
+        char perms[8], name[PATH_MAX] = "";
+        if (sscanf(line, "%lx-%lx %7s %*x %*s %*u %4095s", &start, &end, perms, name) < 4) continue;
+
+        if (strcmp(name, exe) == 0) {
+            if (!exe_start) exe_start = start;
+        } else if (name[0] == '/' && perms[2] == 'x') {
+            sp->loader_start = start;  // The interpreter (statically linked: none)
+            sp->loader_end = end;
+        }
+    }
+    fclose(maps);
+
+    unsigned long target = exe_start ? find_target(link, exe_start, &sp->target) : 0;
+    if (!target) return;
+
+    errno = 0;
+    long word = ptrace(PTRACE_PEEKTEXT, pid, (void*)target, NULL);
+    if (errno != 0) return;
+    if (ptrace(PTRACE_POKETEXT, pid, (void*)target, (void*)((word & ~0xffL) | 0xcc)) == -1) return;
+
+    sp->breakpoint = target;
+    sp->breakpoint_word = word;
+}
+
+// A plain SIGTRAP stop: ours if the tracee sits just past the int3
+int startup_breakpoint(pid_t pid, ProcessStats *stats) {
+    StartupProfile *sp = &stats->startup;
+    struct user_regs_struct regs;
+
+    if (!sp->breakpoint) return 0;
+    if (ptrace(PTRACE_GETREGS, pid, 0, &regs) == -1) return 0;
+    if (regs.rip != sp->breakpoint + 1) return 0;
+
+    // Put the original instruction back and re-run it
+    ptrace(PTRACE_POKETEXT, pid, (void*)sp->breakpoint, (void*)sp->breakpoint_word);
+    regs.rip = sp->breakpoint;
+    ptrace(PTRACE_SETREGS, pid, 0, &regs);
+
+    clock_gettime(CLOCK_MONOTONIC, &sp->main_time);
+    sp->libs[sp->left_loader ? LIB_INIT : LIB_LOADER].wall_ms +=
+        calculate_time_diff(&sp->last_event, &sp->main_time);
+    sp->breakpoint = 0;
+    sp->reached_main = 1;
+    sp->active = 0;
+
+    if (stats->verbose) {
+        log_event(&stats->log, LOG_REACHED_MAIN, 0,
+                  calculate_time_diff(&stats->start_time, &sp->main_time) * 1000.0, 0, 0, sp->target);
+    }
+    return 1;
+}
+
+// Called at each syscall exit until main
+void track_startup_syscall(ProcessStats *stats, struct user_regs_struct *regs, double duration) {
+    StartupProfile *sp = &stats->startup;
+    long nr = regs->orig_rax;
+    long ret = regs->rax;
+    int ok = !(ret < 0 && ret > -4096);
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double gap = calculate_time_diff(&sp->last_event, &now);
+    sp->last_event = now;
+    sp->syscalls++;
+    sp->syscall_ms += duration;
+
+    int in_loader = regs->rip >= sp->loader_start && regs->rip < sp->loader_end;
+    if (!in_loader && sp->loader_end && !sp->left_loader) {
+        sp->left_loader = 1;
+        sp->loader_exit_time = now;
+        sp->loader_exit_syscall = nr;
+        sp->loader_exit_module = module_at(stats, regs->rip);
+    }
+
+    int lib = -1;
+    switch (nr) {
+        case 2:    // open
+        case 257:  // openat
+            if (in_loader) {
+                char path[MAX_FAILED_PATH];
+                unsigned long addr = nr == 2 ? regs->rdi : regs->rsi;
+                if (read_tracee_string(stats->pid, addr, path, sizeof(path))) {
+                    lib = get_library(stats, base_name(path));
+                    if (!ok) {
+                        sp->libs[lib].probes++;
+                    } else {
+                        sp->libs[lib].path = intern_string(stats, path);
+                        if (ret < MAX_STARTUP_FDS) sp->fd_lib[ret] = lib;
+                    }
+                }
+            }
+            break;
+
+        case 0:    // read
+        case 5:    // fstat
+        case 17:   // pread64
+        case 262:  // newfstatat (AT_EMPTY_PATH on the fd)
+            lib = library_of_fd(sp, (int)regs->rdi);
+            break;
+
+        case 3:    // close
+            lib = library_of_fd(sp, (int)regs->rdi);
+            if (lib >= 0 && ok) sp->fd_lib[regs->rdi] = -1;
+            break;
+
+        case 9:    // mmap: file-backed by fd, or anonymous (bss) inside the span
+            lib = (regs->r10 & MAP_ANONYMOUS) ? -1 : library_of_fd(sp, (int)regs->r8);
+            if (lib < 0 && regs->rdi) lib = library_at(sp, regs->rdi);
+            if (lib >= 0 && ok) {
+                StartupLibrary *l = &sp->libs[lib];
+                unsigned long start = ret, end = ret + regs->rsi;
+                l->mapped_bytes += regs->rsi;
+                if (!l->map_end || start < l->map_start) l->map_start = start;
+                if (end > l->map_end) l->map_end = end;
+            }
+            break;
+
+        case 10:   // mprotect (RELRO after relocation)
+        case 11:   // munmap
+            lib = library_at(sp, regs->rdi);
+            break;
+    }
+    if (lib < 0) lib = in_loader ? LIB_LOADER : LIB_INIT;
+
+    StartupLibrary *l = &sp->libs[lib];
+    l->syscalls++;
+    l->syscall_ms += duration;
+    l->wall_ms += gap;
+
+    // Without a breakpoint, leaving ld.so is the best marker we have
+    if (sp->left_loader && !sp->breakpoint) {
+        sp->active = 0;
+    }
+}
+
+static int compare_libraries(const void *a, const void *b) {
+    const StartupLibrary *la = *(const StartupLibrary * const *)a;
+    const StartupLibrary *lb = *(const StartupLibrary * const *)b;
+
+    if (la->wall_ms < lb->wall_ms) return 1;
+    if (la->wall_ms > lb->wall_ms) return -1;
+    return 0;
+}
+
+void report_startup(ProcessStats *stats) {
+    StartupProfile *sp = &stats->startup;
+
+    if (!sp->enabled) return;
+
+    printf("\n%s╔═══════════════════════════════════════════════════════╗%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s║           STARTUP PROFILE                             ║%s\n",
+           COLOR_CYAN, COLOR_RESET);
+    printf("%s╚═══════════════════════════════════════════════════════╝%s\n\n",
+           COLOR_CYAN, COLOR_RESET);
+
+    if (sp->lib_count == 0) {
+        printf("  %sNo exec stop was seen - nothing to report%s\n", COLOR_YELLOW, COLOR_RESET);
+        return;
+    }
+
+    printf("  exec() returned:  %.2f ms after launch\n",
+           calculate_time_diff(&stats->start_time, &sp->exec_time));
+    if (sp->left_loader) {
+        printf("  Left ld.so:       +%.2f ms (first syscall from %s: %s)\n",
+               calculate_time_diff(&sp->exec_time, &sp->loader_exit_time),
+               sp->loader_exit_module ? sp->loader_exit_module : "?",
+               get_syscall_name(sp->loader_exit_syscall));
+    } else if (!sp->loader_end) {
+        printf("  Left ld.so:       n/a (statically linked)\n");
+    }
+
+    double startup_ms = 0;
+    if (sp->reached_main) {
+        char label[32];
+        startup_ms = calculate_time_diff(&sp->exec_time, &sp->main_time);
+        snprintf(label, sizeof(label), "Reached %s:", sp->target);
+        printf("  %-18s+%.2f ms\n", label, startup_ms);
+        snprintf(label, sizeof(label), "Time to %s:", sp->target);
+        printf("  %s%-18s%.2f ms from launch%s\n", COLOR_BOLD, label,
+               calculate_time_diff(&stats->start_time, &sp->main_time), COLOR_RESET);
+    } else {
+        printf("  %s%s not reached%s (no symbol/entry found, or the program exited first)\n",
+               COLOR_YELLOW, sp->target ? sp->target : "main()", COLOR_RESET);
+        startup_ms = calculate_time_diff(&sp->exec_time, &sp->last_event);
+    }
+    printf("  Before that:      %zu syscalls, %.2f ms inside them\n\n", sp->syscalls, sp->syscall_ms);
+
+    StartupLibrary *libs[MAX_STARTUP_LIBS];
+    size_t probes = 0;
+    int loaded = 0;
+    for (int i = 0; i < sp->lib_count; i++) {
+        libs[i] = &sp->libs[i];
+        probes += sp->libs[i].probes;
+        if (sp->libs[i].path) loaded++;
+    }
+    qsort(libs, sp->lib_count, sizeof(StartupLibrary*), compare_libraries);
+
+    printf("%sPer-Library Cost:%s %d file(s) opened by ld.so, %zu failed probe(s)\n",
+           COLOR_BOLD, COLOR_RESET, loaded, probes);
+    printf("  %-26s %-9s %-7s %-12s %-10s %-10s %s\n",
+           "LIBRARY", "SYSCALLS", "PROBES", "SYSCALL(ms)", "WALL(ms)", "MAPPED(KB)", "SHARE");
+    printf("  ------------------------------------------------------------------------------------\n");
+    for (int i = 0; i < sp->lib_count && i < MAX_LIBS_SHOWN; i++) {
+        StartupLibrary *l = libs[i];
+        if (l->syscalls == 0 && l->wall_ms == 0) continue;
+        printf("  %-26.26s %-9zu %-7zu %-12.3f %-10.3f %-10zu %.1f%%\n",
+               l->name, l->syscalls, l->probes, l->syscall_ms, l->wall_ms,
+               l->mapped_bytes / 1024,
+               startup_ms > 0 ? 100.0 * l->wall_ms / startup_ms : 0.0);
+    }
+    if (sp->lib_count > MAX_LIBS_SHOWN) {
+        printf("  ... %d more\n", sp->lib_count - MAX_LIBS_SHOWN);
+    }
+    printf("\n  [ld.so] is loader work not tied to one library, [init] is constructors\n"
+           "  and libc start-up. Wall times include ptrace stop overhead.\n");
+
+    if (probes > (size_t)loaded) {
+        printf("\n  %sMore failed probes than libraries.%s Each miss is a syscall on every\n"
+               "  start: trim LD_LIBRARY_PATH or set DT_RUNPATH to where the libraries live.\n",
+               COLOR_YELLOW, COLOR_RESET);
+    }
+}
@@ -0,0 +1,70 @@
+#include "../include/oswatch.h"
+
+// Initialize process statistics structure
+void init_process_stats(ProcessStats *stats, pid_t pid, char *name) {
+    memset(stats, 0, sizeof(ProcessStats));
+    
+    stats->pid = pid;
+    stats->process_name = name;
+    stats->memory_blocks = NULL;
+    stats->open_files = NULL;
+    
+    // Tracker nodes come from per-type slabs in one arena (MallocBlocks
+    // live in the tracker shards, which start on the first event)
+    slab_init(&stats->memory_slab, "MemoryBlock", &stats->arena, sizeof(MemoryBlock));
+    slab_init(&stats->file_slab, "FileDescriptor", &stats->arena, sizeof(FileDescriptor));
+    slab_init(&stats->site_slab, "AllocSite", &stats->arena, sizeof(AllocSite));
+    slab_init(&stats->growth_slab, "HeapGrowth", &stats->arena, sizeof(HeapGrowth));
+    slab_init(&stats->failure_slab, "SyscallFailure", &stats->arena, sizeof(SyscallFailure));
+    slab_init(&stats->failed_path_slab, "FailedPath", &stats->arena, sizeof(FailedPath));
+    slab_init(&stats->file_access_slab, "FileAccess", &stats->arena, sizeof(FileAccess));
+    slab_init(&stats->socket_slab, "SocketEndpoint", &stats->arena, sizeof(SocketEndpoint));
+    slab_init(&stats->socket_info_slab, "SocketInfo", &stats->arena, sizeof(SocketInfo));
+    slab_init(&stats->lock_slab, "LockStat", &stats->arena, sizeof(LockStat));
+    slab_init(&stats->lock_site_slab, "LockSite", &stats->arena, sizeof(LockSite));
+    slab_init(&stats->futex_slab, "FutexWait", &stats->arena, sizeof(FutexWait));
+    slab_init(&stats->latency_slab, "LatencyHistogram", &stats->arena, sizeof(LatencyHistogram));
+    
+    pthread_mutex_init(&stats->lock, NULL);
+    
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        stats->perf.fds[i] = -1;
+    }
+    
+    // Record start time
+    clock_gettime(CLOCK_MONOTONIC, &stats->start_time);
+}
+
+// Cleanup and free allocated memory
+void cleanup_process_stats(ProcessStats *stats) {
+    // All tracker nodes and interned strings live in the arena
+    stats->memory_blocks = NULL;
+    stats->open_files = NULL;
+    stats->pending_growth = NULL;
+    memset(stats->interned, 0, sizeof(stats->interned));
+    memset(stats->failures, 0, sizeof(stats->failures));
+    memset(stats->failed_paths, 0, sizeof(stats->failed_paths));
+    memset(stats->file_access, 0, sizeof(stats->file_access));
+    memset(stats->socket_endpoints, 0, sizeof(stats->socket_endpoints));
+    memset(stats->locks, 0, sizeof(stats->locks));
+    memset(stats->futex_waits, 0, sizeof(stats->futex_waits));
+    memset(stats->syscall_latency, 0, sizeof(stats->syscall_latency));
+    free_baseline(&stats->baseline);
+    stop_metrics_exporter(stats);  // Only still running if the launch failed
+    stop_top_dashboard(stats);
+    log_close(stats);
+    
+    cleanup_malloc_table(stats);
+    arena_release(&stats->arena);
+}
+
+// Calculate time difference in milliseconds
+double calculate_time_diff(struct timespec *start, struct timespec *end) {
+    double start_ms = start->tv_sec * 1000.0 + start->tv_nsec / 1000000.0;
+    double end_ms = end->tv_sec * 1000.0 + end->tv_nsec / 1000000.0;
+    return end_ms - start_ms;
+}
+
+double timeval_ms(struct timeval *tv) {
+    return tv->tv_sec * 1000.0 + tv->tv_usec / 1000.0;
+}
@@ -0,0 +1,97 @@
+#include "../include/oswatch.h"
+
+// Call-site symbolization
+//
+// Sites are raw return addresses in the tracee. The executable mappings
+// are read from /proc/<pid>/maps while the tracee sits at its exit stop,
+// so sites can be printed as module+offset (addr2line-ready) and told
+// apart as user code or runtime library code.
+
+// The C/C++ runtime. The interceptor only leaves a site in here for the
+// runtime's own blocks; allocations it makes for the program (strdup,
+// operator new...) carry the program's call site instead.
+static const char *runtime_libraries[] = {
+    "libc.so", "ld-linux", "libpthread", "libdl", "libm.so",
+    "libstdc++", "libgcc_s", "liboswatch_malloc", NULL
+};
+
+static int is_runtime_path(const char *path) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    for (int i = 0; runtime_libraries[i]; i++) {
+        if (strncmp(base, runtime_libraries[i], strlen(runtime_libraries[i])) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void snapshot_code_mappings(pid_t pid, ProcessStats *stats) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/maps", pid);
+
+    FILE *maps = fopen(path, "r");
+    if (!maps) return;
+
+    stats->code_mapping_count = 0;
+
+    char line[512];
+    while (fgets(line, sizeof(line), maps) && stats->code_mapping_count < MAX_CODE_MAPPINGS) {
+        unsigned long start, end, offset, inode;
+        char perms[8], dev[16], name[256] = "";
+
+        if (sscanf(line, "%lx-%lx %7s %lx %15s %lu %255s",
+                   &start, &end, perms, &offset, dev, &inode, name) < 7) {
+            continue;
+        }
+        if (perms[2] != 'x' || name[0] != '/') continue;
+
+        CodeMapping *m = &stats->code_mappings[stats->code_mapping_count++];
+        m->start = start;
+        m->end = end;
+        m->offset = offset;
+        m->path = intern_string(stats, name);
+        m->is_runtime = is_runtime_path(name);
+    }
+
+    fclose(maps);
+}
+
+const CodeMapping* find_code_mapping(ProcessStats *stats, void *addr) {
+    unsigned long value = (unsigned long)addr;
+
+    for (int i = 0; i < stats->code_mapping_count; i++) {
+        CodeMapping *m = &stats->code_mappings[i];
+        if (value >= m->start && value < m->end) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+// "leak_test+0x11b2" (file offset, feed to addr2line -e), or the raw address
+const char* format_site(ProcessStats *stats, void *site, char *buf, size_t len) {
+    const CodeMapping *m = find_code_mapping(stats, site);
+
+    if (!m) {
+        snprintf(buf, len, "%p", site);
+        return buf;
+    }
+
+    const char *base = strrchr(m->path, '/');
+    base = base ? base + 1 : m->path;
+    snprintf(buf, len, "%s+0x%lx", base, (unsigned long)site - m->start + m->offset);
+    return buf;
+}
+
+// Was this block allocated by libc/ld.so rather than by user code?
+int is_library_allocation(ProcessStats *stats, MallocBlock *block) {
+    if (block->site && stats->code_mapping_count > 0) {
+        const CodeMapping *m = find_code_mapping(stats, block->site);
+        if (m) return m->is_runtime;
+    }
+
+    // No site information - fall back to common stdio/libc buffer sizes
+    return block->size == 1024 || block->size == 4096 || block->size == 8192;
+}
@@ -46,6 +46,13 @@ const char* get_syscall_name(long syscall_num) {
         case 91: return "fchmod";
         case 92: return "chown";
         case 93: return "fchown";
+        case 94: return "lchown";
+        case 137: return "statfs";
+        case 158: return "arch_prctl";
+        case 218: return "set_tid_address";
+        case 273: return "set_robust_list";
+        case 302: return "prlimit64";
+        case 334: return "rseq";
         case 217: return "getdents64";
         case 257: return "openat";
         case 258: return "mkdirat";
@@ -129,6 +136,10 @@ const char* get_syscall_name(long syscall_num) {
         case 233: return "epoll_ctl";
         case 234: return "tgkill";
         case 281: return "epoll_pwait";
+        case 288: return "accept4";
+        case 292: return "dup3";
+        case 322: return "execveat";
+        case 332: return "statx";
         case 318: return "getrandom";
         
         default: 
@@ -153,16 +164,9 @@ void handle_syscall_entry(struct user_regs_struct *regs, ProcessStats *stats) {
     stats->total_syscalls++;
     stats->syscall_counts[syscall_num]++;
 
-    // Get syscall name
-    const char *syscall_name = get_syscall_name(syscall_num);
-
     // Verbose output
     if (stats->verbose) {
-        printf("%s[SYSCALL]%s %-15s (num=%ld, args: 0x%llx, 0x%llx, 0x%llx)\n",
-               COLOR_BLUE, COLOR_RESET,
-               syscall_name,
-               syscall_num,
-               regs->rdi, regs->rsi, regs->rdx);
+        log_event(&stats->log, LOG_SYSCALL, syscall_num, regs->rdi, regs->rsi, regs->rdx, NULL);
     }
 }
 
@@ -170,11 +174,29 @@ void handle_syscall_entry(struct user_regs_struct *regs, ProcessStats *stats) {
 static void *initial_brk = NULL;
 static void *last_brk = NULL;
 
-void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, double duration) {
+// `path` is the path argument when the caller already has it (wrappers)
+static void handle_exit(struct user_regs_struct *regs, ProcessStats *stats,
+                        double duration, const char *path) {
     long syscall_num = regs->orig_rax;
     long return_value = regs->rax;  // Return value is in rax
 
     stats->total_syscall_time_ms += duration;
+    stats->event_seq++;
+    track_syscall_latency(stats, syscall_num, duration);
+
+    if (stats->trace.enabled) {
+        trace_syscall(stats, regs, duration);
+    }
+
+    // -4095..-1 is an errno
+    if (return_value < 0 && return_value > -4096 &&
+        syscall_num >= 0 && syscall_num < MAX_SYSCALL_NUM) {
+        track_failed_syscall(stats, regs, duration, path);
+    }
+
+    if (stats->startup.active) {
+        track_startup_syscall(stats, regs, duration);
+    }
 
     // Handle specific syscalls based on their behavior
     switch (syscall_num) {
@@ -182,14 +204,19 @@ void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, dou
             if (return_value > 0 && return_value != -1) {
                 // Memory was allocated
                 size_t size = regs->rsi;  // Second argument is size
+                int map_flags = regs->r10;
+                
+                // Anonymous mappings may be malloc's mmap-threshold chunks
+                if ((map_flags & MAP_ANONYMOUS) && !(map_flags & MAP_STACK)) {
+                    track_heap_growth(stats, 1, (void*)return_value, size);
+                }
                 
                 // Only track large allocations (likely libraries)
-                if (size >= 65536) {  // 64 KB threshold
+                if (size >= MMAP_TRACK_THRESHOLD) {
                     track_memory_allocation(stats, (void*)return_value, size, "mmap (library)");
                     
                     if (stats->verbose) {
-                        printf("%s[MEMORY]%s mmap allocated %zu bytes at %p (library)\n",
-                               COLOR_GREEN, COLOR_RESET, size, (void*)return_value);
+                        log_event(&stats->log, LOG_MMAP, 0, size, return_value, 0, NULL);
                     }
                 }
             }
@@ -206,8 +233,7 @@ void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, dou
                     last_brk = new_brk;
                     
                     if (stats->verbose) {
-                        printf("%s[MEMORY]%s Initial heap at %p\n",
-                            COLOR_CYAN, COLOR_RESET, new_brk);
+                        log_event(&stats->log, LOG_HEAP_INIT, 0, return_value, 0, 0, NULL);
                     }
                 } else if (new_brk != last_brk) {
                     // Heap changed
@@ -215,18 +241,19 @@ void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, dou
                         size_t size = (char*)new_brk - (char*)last_brk;
                         
                         if (stats->verbose) {
-                            printf("%s[MEMORY]%s Heap grew by %zu bytes (was %p, now %p)\n",
-                                COLOR_GREEN, COLOR_RESET, size, last_brk, new_brk);
+                            log_event(&stats->log, LOG_HEAP_GROW, 0, size,
+                                      (unsigned long)last_brk, (unsigned long)new_brk, NULL);
                         }
                         
                         // Track cumulative heap growth
                         stats->heap_allocated += size;
+                        track_heap_growth(stats, 0, last_brk, size);
                     } else {
                         size_t size = (char*)last_brk - (char*)new_brk;
                         
                         if (stats->verbose) {
-                            printf("%s[MEMORY]%s Heap shrunk by %zu bytes (was %p, now %p)\n",
-                                COLOR_YELLOW, COLOR_RESET, size, last_brk, new_brk);
+                            log_event(&stats->log, LOG_HEAP_SHRINK, 0, size,
+                                      (unsigned long)last_brk, (unsigned long)new_brk, NULL);
                         }
                         
                         stats->heap_freed += size;
@@ -245,17 +272,15 @@ void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, dou
                 
                 // Only track unmapping of large regions (libraries)
                 // Small regions might be runtime management
-                if (size >= 65536) {
+                if (size >= MMAP_TRACK_THRESHOLD) {
                     track_memory_deallocation(stats, addr);
                     if (stats->verbose) {
-                        printf("%s[MEMORY]%s munmap freed %zu bytes at %p (library)\n",
-                               COLOR_YELLOW, COLOR_RESET, size, addr);
+                        log_event(&stats->log, LOG_MUNMAP, 0, size, (unsigned long)addr, 0, NULL);
                     }
                 } else {
                     // Small munmap - likely runtime, ignore
                     if (stats->verbose) {
-                        printf("%s[MEMORY]%s munmap freed %zu bytes at %p (runtime, ignored)\n",
-                               COLOR_CYAN, COLOR_RESET, size, addr);
+                        log_event(&stats->log, LOG_MUNMAP_RUNTIME, 0, size, (unsigned long)addr, 0, NULL);
                     }
                 }
             }
@@ -264,24 +289,145 @@ void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, dou
         case 2:   // open
         case 257: // openat
             if (return_value >= 0) {
+                // Wrappers send the path along; under ptrace read it from the tracee
+                char name[MAX_FAILED_PATH];
+                if (!path && read_tracee_string(stats->pid, syscall_num == 257 ? regs->rsi : regs->rdi,
+                                                name, sizeof(name))) {
+                    path = name;
+                }
                 stats->files_opened++;
-                track_file_open(stats, return_value, NULL, regs->rsi);
+                track_file_open(stats, return_value, path,
+                                syscall_num == 257 ? regs->rdx : regs->rsi);
+                if (stats->trace.enabled) {
+                    trace_fd_event(stats, "open", return_value, path);
+                }
                 if (stats->verbose) {
-                    printf("%s[FILE]%s Opened file descriptor:  %ld\n",
-                           COLOR_MAGENTA, COLOR_RESET, return_value);
+                    log_event(&stats->log, LOG_FILE_OPEN, return_value, 0, 0, 0, NULL);
                 }
             }
             break;
 
+        case 0:   // read
+        case 19:  // readv
+            if (return_value > 0) {
+                track_file_io(stats, regs->rdi, -1, return_value, 0);
+            }
+            break;
+
+        case 17:  // pread64
+            if (return_value > 0) {
+                track_file_io(stats, regs->rdi, regs->r10, return_value, 0);
+            }
+            break;
+
+        case 1:   // write
+        case 20:  // writev
+            if (return_value > 0) {
+                track_file_io(stats, regs->rdi, -1, return_value, 1);
+            }
+            break;
+
+        case 18:  // pwrite64
+            if (return_value > 0) {
+                track_file_io(stats, regs->rdi, regs->r10, return_value, 1);
+            }
+            break;
+
+        case 8:   // lseek
+            if (return_value >= 0) {
+                track_file_seek(stats, regs->rdi, return_value);
+            }
+            break;
+
+        case 74:  // fsync
+        case 75:  // fdatasync
+            if (return_value == 0) {
+                track_file_sync(stats, regs->rdi);
+            }
+            break;
+
+        case 32:  // dup
+        case 33:  // dup2
+        case 292: // dup3
+            if (return_value >= 0 && (syscall_num == 32 || regs->rdi != regs->rsi)) {
+                // dup2/dup3 silently close whatever newfd was
+                int closed = syscall_num != 32 ? track_file_close(stats, return_value) : FD_UNTRACKED;
+                if (closed == FD_FILE) stats->files_closed++;
+                if (closed == FD_SOCKET) stats->sockets_closed++;
+
+                if (track_file_dup(stats, regs->rdi, return_value) == FD_SOCKET) {
+                    stats->sockets_opened++;
+                } else {
+                    stats->files_opened++;
+                }
+                if (stats->trace.enabled) {
+                    trace_fd_event(stats, "dup", return_value, NULL);
+                }
+            }
+            break;
+
+        case 41:  // socket
+        case 42:  // connect
+        case 43:  // accept
+        case 44:  // sendto
+        case 45:  // recvfrom
+        case 46:  // sendmsg
+        case 47:  // recvmsg
+        case 48:  // shutdown
+        case 49:  // bind
+        case 50:  // listen
+        case 51:  // getsockname
+        case 53:  // socketpair
+        case 288: // accept4
+            track_socket_syscall(stats, regs, duration);
+            if (stats->trace.enabled && return_value >= 0 &&
+                (syscall_num == 41 || syscall_num == 43 || syscall_num == 288)) {
+                trace_fd_event(stats, "socket", return_value, NULL);
+            }
+            break;
+
+        case 202: // futex
+            if (stats->lock_profile) {
+                track_futex_wait(stats, regs, duration);
+            }
+            break;
+
         case 3: // close
             if (return_value == 0) {
-                stats->files_closed++;
-                track_file_close(stats, regs->rdi);
+                if (track_file_close(stats, regs->rdi) == FD_SOCKET) {
+                    stats->sockets_closed++;
+                } else {
+                    stats->files_closed++;
+                }
+                if (stats->trace.enabled) {
+                    trace_fd_event(stats, "close", regs->rdi, NULL);
+                }
                 if (stats->verbose) {
-                    printf("%s[FILE]%s Closed file descriptor\n",
-                           COLOR_MAGENTA, COLOR_RESET);
+                    log_event(&stats->log, LOG_FILE_CLOSE, regs->rdi, 0, 0, 0, NULL);
                 }
             }
             break;
     }
 }
+
+void handle_syscall_exit(struct user_regs_struct *regs, ProcessStats *stats, double duration) {
+    handle_exit(regs, stats, duration, NULL);
+}
+
+// A syscall reported by the preload library's libc wrappers (--no-ptrace).
+// Rebuild the registers ptrace would have shown and reuse the handlers.
+void handle_wrapped_syscall(ProcessStats *stats, long nr, long ret, double duration,
+                            unsigned long args[4], const char *path) {
+    struct user_regs_struct regs;
+    memset(&regs, 0, sizeof(regs));
+
+    regs.orig_rax = nr;
+    regs.rax = ret;
+    regs.rdi = args[0];
+    regs.rsi = args[1];
+    regs.rdx = args[2];
+    regs.r10 = args[3];
+
+    handle_syscall_entry(&regs, stats);
+    handle_exit(&regs, stats, duration, path);
+}
@@ -0,0 +1,232 @@
+#include "../include/oswatch.h"
+#include <fcntl.h>
+#include <stdarg.h>
+
+// Chrome trace-event timeline (--trace-out)
+//
+// Events are formatted straight into a fixed buffer and written out when
+// it fills, so a long run costs TRACE_BUFFER_SIZE of memory however many
+// events it produces. The file is a {"traceEvents": [...]} object that
+// chrome://tracing and ui.perfetto.dev both load:
+//   X  one slice per syscall on the traced thread's track (ts/dur in us)
+//   C  counter tracks for malloc live bytes and RSS, sampled at most every
+//      TRACE_COUNTER_INTERVAL_MS and only when the value changed
+//   i  instants for fd open/close
+// Under ptrace the track is the main thread; with --no-ptrace the wrapper
+// calls from every thread share the process track.
+
+static void trace_flush(TraceWriter *t) {
+    size_t done = 0;
+
+    while (done < t->used) {
+        ssize_t n = write(t->fd, t->buffer + done, t->used - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            t->failed = 1;
+            break;
+        }
+        done += n;
+    }
+    t->used = 0;
+    t->flushes++;
+}
+
+static void trace_printf(TraceWriter *t, const char *fmt, ...) {
+    if (TRACE_BUFFER_SIZE - t->used < TRACE_EVENT_MAX) {
+        trace_flush(t);
+    }
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(t->buffer + t->used, TRACE_EVENT_MAX, fmt, ap);
+    va_end(ap);
+
+    // An over-long event is cut short; keep the file well-formed by dropping it
+    if (n > 0 && n < TRACE_EVENT_MAX) {
+        t->used += n;
+    }
+}
+
+// Every event after the first is preceded by a comma
+static void trace_event(TraceWriter *t, const char *fmt, ...) {
+    if (TRACE_BUFFER_SIZE - t->used < TRACE_EVENT_MAX) {
+        trace_flush(t);
+    }
+
+    size_t start = t->used;
+    int n = snprintf(t->buffer + start, TRACE_EVENT_MAX, "%s\n", t->events ? "," : "");
+
+    va_list ap;
+    va_start(ap, fmt);
+    int m = vsnprintf(t->buffer + start + n, TRACE_EVENT_MAX - n, fmt, ap);
+    va_end(ap);
+
+    if (m > 0 && n + m < TRACE_EVENT_MAX) {
+        t->used += n + m;
+        t->events++;
+    }
+}
+
+// Microseconds since oswatch started, the trace's time base
+static double trace_now_us(ProcessStats *stats) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return calculate_time_diff(&stats->start_time, &now) * 1000.0;
+}
+
+// JSON string body for a path; anything unusual becomes '?'
+static void escape_path(const char *path, char *out, size_t len) {
+    size_t n = 0;
+    for (const unsigned char *p = (const unsigned char*)path; *p && n + 3 < len; p++) {
+        if (*p == '"' || *p == '\\') {
+            out[n++] = '\\';
+            out[n++] = *p;
+        } else {
+            out[n++] = *p < 0x20 ? '?' : *p;
+        }
+    }
+    out[n] = '\0';
+}
+
+// Called before the tracee starts so a bad path fails the run up front
+int trace_open(ProcessStats *stats, const char *path) {
+    TraceWriter *t = &stats->trace;
+
+    t->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (t->fd == -1) return -1;
+
+    t->buffer = malloc(TRACE_BUFFER_SIZE);
+    if (!t->buffer) {
+        close(t->fd);
+        return -1;
+    }
+
+    t->path = path;
+    t->statm_fd = -1;
+    t->enabled = 1;
+    return 0;
+}
+
+void trace_begin(ProcessStats *stats, pid_t pid) {
+    TraceWriter *t = &stats->trace;
+    if (!t->enabled) return;
+
+    char name[256];
+    escape_path(stats->process_name, name, sizeof(name));
+
+    t->pid = pid;
+    t->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+
+    char statm[64];
+    snprintf(statm, sizeof(statm), "/proc/%d/statm", pid);
+    t->statm_fd = open(statm, O_RDONLY | O_CLOEXEC);
+
+    trace_printf(t, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    trace_event(t, "{\"ph\": \"M\", \"pid\": %d, \"name\": \"process_name\", "
+                "\"args\": {\"name\": \"%s\"}}", pid, name);
+    trace_event(t, "{\"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"name\": \"thread_name\", "
+                "\"args\": {\"name\": \"%s\"}}", pid, pid,
+                stats->no_ptrace ? "libc wrappers" : "traced thread");
+}
+
+// At syscall exit: the slice ends now and started duration ms ago
+void trace_syscall(ProcessStats *stats, struct user_regs_struct *regs, double duration) {
+    TraceWriter *t = &stats->trace;
+    if (!t->enabled || t->failed) return;
+
+    long ret = regs->rax;
+    double end = trace_now_us(stats);
+    double dur = duration * 1000.0;
+
+    if (ret < 0 && ret > -4096) {
+        trace_event(t, "{\"ph\": \"X\", \"cat\": \"syscall\", \"name\": \"%s\", \"pid\": %d, "
+                    "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"ret\": %ld, "
+                    "\"error\": \"%s\"}}",
+                    get_syscall_name(regs->orig_rax), t->pid, t->pid, end - dur, dur,
+                    ret, error_name(-ret));
+    } else {
+        trace_event(t, "{\"ph\": \"X\", \"cat\": \"syscall\", \"name\": \"%s\", \"pid\": %d, "
+                    "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"ret\": %ld}}",
+                    get_syscall_name(regs->orig_rax), t->pid, t->pid, end - dur, dur, ret);
+    }
+}
+
+// what: "open", "dup", "socket" or "close"
+void trace_fd_event(ProcessStats *stats, const char *what, long fd, const char *path) {
+    TraceWriter *t = &stats->trace;
+    if (!t->enabled || t->failed) return;
+
+    char name[MAX_FAILED_PATH];
+    escape_path(path ? path : "", name, sizeof(name));
+
+    trace_event(t, "{\"ph\": \"i\", \"s\": \"t\", \"cat\": \"fd\", \"name\": \"%s\", "
+                "\"pid\": %d, \"tid\": %d, \"ts\": %.3f, \"args\": {\"fd\": %ld%s%s%s}}",
+                what, t->pid, t->pid, trace_now_us(stats), fd,
+                path ? ", \"path\": \"" : "", name, path ? "\"" : "");
+}
+
+// Malloc live bytes and RSS, rate-limited; both tracer threads call this
+void trace_counters(ProcessStats *stats) {
+    TraceWriter *t = &stats->trace;
+    if (!t->enabled || t->failed) return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (calculate_time_diff(&t->last_counter, &now) < TRACE_COUNTER_INTERVAL_MS) {
+        return;
+    }
+    t->last_counter = now;
+    double ts = calculate_time_diff(&stats->start_time, &now) * 1000.0;
+
+    // Shard totals belong to the workers; a relaxed read may trail the
+    // queue by a batch, which is fine for a plot
+    size_t allocated = 0, freed = 0;
+    for (int i = 0; i < stats->shard_count; i++) {
+        allocated += __atomic_load_n(&stats->shards[i].bytes_allocated, __ATOMIC_RELAXED);
+        freed += __atomic_load_n(&stats->shards[i].bytes_freed, __ATOMIC_RELAXED);
+    }
+    size_t live = allocated > freed ? allocated - freed : 0;
+    if (live != t->last_live) {
+        trace_event(t, "{\"ph\": \"C\", \"name\": \"malloc live bytes\", \"pid\": %d, "
+                    "\"ts\": %.3f, \"args\": {\"bytes\": %zu}}", t->pid, ts, live);
+        t->last_live = live;
+    }
+
+    char buf[128];
+    unsigned long size, resident;
+    ssize_t n = t->statm_fd != -1 ? pread(t->statm_fd, buf, sizeof(buf) - 1, 0) : -1;
+    if (n > 0) {
+        buf[n] = '\0';
+        if (sscanf(buf, "%lu %lu", &size, &resident) == 2) {
+            size_t rss_kb = resident * t->page_kb;
+            if (rss_kb != t->last_rss_kb) {
+                trace_event(t, "{\"ph\": \"C\", \"name\": \"RSS\", \"pid\": %d, "
+                            "\"ts\": %.3f, \"args\": {\"kB\": %zu}}", t->pid, ts, rss_kb);
+                t->last_rss_kb = rss_kb;
+            }
+        }
+    }
+}
+
+// After the shards are synced, so the last live-bytes point is exact
+int trace_close(ProcessStats *stats) {
+    TraceWriter *t = &stats->trace;
+    if (!t->enabled) return 0;
+
+    if (t->statm_fd != -1) {
+        close(t->statm_fd);  // The tracee is gone; no RSS to read
+        t->statm_fd = -1;
+    }
+    t->last_counter.tv_sec = 0;  // Force a final sample
+    trace_counters(stats);
+
+    trace_printf(t, "\n]}\n");
+    trace_flush(t);
+
+    int result = t->failed ? -1 : 0;
+    if (close(t->fd) == -1) result = -1;
+    free(t->buffer);
+    t->buffer = NULL;
+    t->enabled = 0;
+    return result;
+}
@@ -0,0 +1,393 @@
+#define _GNU_SOURCE
+#include "../include/oswatch.h"
+#include <sched.h>
+#include <stdint.h>
+
+// Sharded malloc tracking
+//
+// The parser (process_malloc_events) only decodes lines and routes each
+// event by address hash into a per-shard batch. Every shard has a worker
+// thread that owns its slice of the live table, its counters and its
+// arena, so the hot path takes no shared lock. Events for one address
+// always land on the same shard in order, so FREE never overtakes ALLOC.
+// tracker_sync() waits for the queues to drain and folds the shard
+// counters into ProcessStats for the report.
+
+static uint64_t hash_address(void *addr) {
+    return ((uint64_t)(uintptr_t)addr >> 4) * 0x9E3779B97F4A7C15ULL;
+}
+
+static size_t bucket_of(TrackerShard *shard, uint64_t hash) {
+    return (hash >> 16) & (shard->buckets - 1);
+}
+
+// Double the bucket array once the chains average one entry
+static void grow_table(TrackerShard *shard) {
+    size_t buckets = shard->buckets * 2;
+    MallocBlock **table = calloc(buckets, sizeof(MallocBlock*));
+    if (!table) return;  // Keep the old table; chains just get longer
+
+    MallocBlock **old = shard->table;
+    size_t old_buckets = shard->buckets;
+    shard->table = table;
+    shard->buckets = buckets;
+
+    for (size_t i = 0; i < old_buckets; i++) {
+        MallocBlock *block = old[i];
+        while (block) {
+            MallocBlock *next = block->next;
+            size_t idx = bucket_of(shard, hash_address(block->address));
+            block->next = table[idx];
+            table[idx] = block;
+            block = next;
+        }
+    }
+    free(old);
+}
+
+// Track a malloc allocation
+static void track_malloc(TrackerShard *shard, MallocEvent *event) {
+    MallocBlock *block = slab_alloc(&shard->block_slab);
+    if (!block) return;  // Failed to allocate tracking block
+
+    size_t idx = bucket_of(shard, hash_address(event->address));
+    block->address = event->address;
+    block->size = event->size;
+    block->site = event->site;
+    block->reach = REACH_UNKNOWN;
+    block->next = shard->table[idx];
+    shard->table[idx] = block;
+
+    // fill_snapshot reads these from another thread
+    __atomic_fetch_add(&shard->allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shard->bytes_allocated, event->size, __ATOMIC_RELAXED);
+
+    AllocSite *entry = find_or_add_site(shard->sites, &shard->site_slab, event->site);
+    if (entry) {
+        entry->allocations++;
+        entry->bytes_allocated += event->size;
+        entry->live_blocks++;
+        entry->live_bytes += event->size;
+    }
+
+    if (shard->log) {
+        log_event(shard->log, LOG_MALLOC, 0, event->size, (unsigned long)event->address, 0, NULL);
+    }
+
+    if (__atomic_add_fetch(&shard->live_blocks, 1, __ATOMIC_RELAXED) > shard->buckets) {
+        grow_table(shard);
+    }
+}
+
+// Track a free operation
+static void track_free(TrackerShard *shard, MallocEvent *event) {
+    MallocBlock **current = &shard->table[bucket_of(shard, hash_address(event->address))];
+
+    while (*current) {
+        if ((*current)->address == event->address) {
+            MallocBlock *to_remove = *current;
+            *current = (*current)->next;
+
+            __atomic_fetch_add(&shard->frees, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&shard->bytes_freed, to_remove->size, __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&shard->live_blocks, 1, __ATOMIC_RELAXED);
+
+            AllocSite *entry = find_or_add_site(shard->sites, &shard->site_slab, to_remove->site);
+            if (entry) {
+                entry->live_blocks--;
+                entry->live_bytes -= to_remove->size;
+            }
+
+            if (shard->log) {
+                log_event(shard->log, LOG_FREE, 0, to_remove->size,
+                          (unsigned long)event->address, 0, NULL);
+            }
+
+            slab_free(&shard->block_slab, to_remove);
+            return;
+        }
+        current = &(*current)->next;
+    }
+
+    // Free of unknown address - possible double-free
+    shard->unknown_frees++;
+    if (shard->log) {
+        log_event(shard->log, LOG_UNKNOWN_FREE, 0, (unsigned long)event->address, 0, 0, NULL);
+    }
+}
+
+// --top: this shard's largest live sites, at most every publish interval
+static void refresh_hot_sites(TrackerShard *shard) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (calculate_time_diff(&shard->hot_at, &now) < LIVE_PUBLISH_INTERVAL_MS) return;
+    shard->hot_at = now;
+
+    LiveSite hot[LIVE_TOP_SITES];
+    int count = 0;
+    for (int b = 0; b < SITE_HASH_SIZE; b++) {
+        for (AllocSite *site = shard->sites[b]; site; site = site->next) {
+            if (site->live_bytes == 0) continue;
+            if (count == LIVE_TOP_SITES && site->live_bytes <= hot[count - 1].live_bytes) continue;
+
+            // Insert into the short list, largest first
+            int i = count < LIVE_TOP_SITES ? count++ : count - 1;
+            while (i > 0 && hot[i - 1].live_bytes < site->live_bytes) {
+                hot[i] = hot[i - 1];
+                i--;
+            }
+            hot[i].site = site->site;
+            hot[i].live_bytes = site->live_bytes;
+            hot[i].live_blocks = site->live_blocks;
+            hot[i].allocations = site->allocations;
+            hot[i].name[0] = '\0';
+        }
+    }
+
+    pthread_mutex_lock(&shard->lock);
+    memcpy(shard->hot, hot, count * sizeof(LiveSite));
+    shard->hot_count = count;
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static void* shard_worker(void *arg) {
+    TrackerShard *shard = arg;
+
+    pthread_mutex_lock(&shard->lock);
+    while (1) {
+        while (!shard->queue_head && !shard->stop) {
+            pthread_cond_wait(&shard->wake, &shard->lock);
+        }
+        if (!shard->queue_head) break;  // Stopped and drained
+
+        EventBatch *batch = shard->queue_head;
+        shard->queue_head = batch->next;
+        if (!shard->queue_head) shard->queue_tail = NULL;
+        shard->queued--;
+        shard->busy = 1;
+        pthread_mutex_unlock(&shard->lock);
+
+        for (int i = 0; i < batch->count; i++) {
+            if (batch->events[i].type == EVENT_ALLOC) {
+                track_malloc(shard, &batch->events[i]);
+            } else {
+                track_free(shard, &batch->events[i]);
+            }
+        }
+        shard->batches++;
+        if (shard->hot_sites) {
+            refresh_hot_sites(shard);
+        }
+
+        pthread_mutex_lock(&shard->lock);
+        batch->next = shard->spare;
+        shard->spare = batch;
+        shard->busy = 0;
+        pthread_cond_broadcast(&shard->drained);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return NULL;
+}
+
+// One shard per CPU we may run on, unless --shards said otherwise
+static int default_shard_count(void) {
+    cpu_set_t set;
+    int cpus = 0;
+
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        cpus = CPU_COUNT(&set);
+    }
+    if (cpus < 1) cpus = 1;
+    return cpus;
+}
+
+// All shards or none: a failure stops the workers already running
+int start_tracker_shards(ProcessStats *stats) {
+    if (stats->shard_count > 0) return 0;
+
+    int count = stats->requested_shards > 0 ? stats->requested_shards : default_shard_count();
+    if (count > MAX_TRACKER_SHARDS) count = MAX_TRACKER_SHARDS;
+
+    stats->shards = calloc(count, sizeof(TrackerShard));
+    if (!stats->shards) return -1;
+
+    for (int i = 0; i < count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+
+        shard->buckets = MALLOC_HASH_SIZE;
+        shard->table = calloc(shard->buckets, sizeof(MallocBlock*));
+        shard->log = stats->log.enabled ? &stats->log : NULL;
+        shard->hot_sites = stats->live.want_sites;
+        slab_init(&shard->block_slab, "MallocBlock", &shard->arena, sizeof(MallocBlock));
+        slab_init(&shard->site_slab, "AllocSite", &shard->arena, sizeof(AllocSite));
+        pthread_mutex_init(&shard->lock, NULL);
+        pthread_cond_init(&shard->wake, NULL);
+        pthread_cond_init(&shard->drained, NULL);
+
+        if (!shard->table || pthread_create(&shard->thread, NULL, shard_worker, shard) != 0) {
+            free(shard->table);
+            pthread_mutex_destroy(&shard->lock);
+            pthread_cond_destroy(&shard->wake);
+            pthread_cond_destroy(&shard->drained);
+            stop_tracker_shards(stats);
+            return -1;
+        }
+        stats->shard_count++;
+    }
+    return 0;
+}
+
+static void submit_batch(TrackerShard *shard) {
+    EventBatch *batch = shard->filling;
+    shard->filling = NULL;
+    batch->next = NULL;
+
+    pthread_mutex_lock(&shard->lock);
+    // Back-pressure: a slow shard eventually stalls the pipe, not memory
+    while (shard->queued >= SHARD_MAX_QUEUED) {
+        pthread_cond_wait(&shard->drained, &shard->lock);
+    }
+    if (shard->queue_tail) {
+        shard->queue_tail->next = batch;
+    } else {
+        shard->queue_head = batch;
+    }
+    shard->queue_tail = batch;
+    shard->queued++;
+    pthread_cond_signal(&shard->wake);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+// Caller holds the stats lock (or is the only thread touching stats)
+void dispatch_malloc_event(ProcessStats *stats, MallocEvent *event) {
+    if (stats->shard_count == 0 && start_tracker_shards(stats) == -1) return;
+
+    TrackerShard *shard = &stats->shards[(hash_address(event->address) >> 56) % stats->shard_count];
+
+    if (!shard->filling) {
+        pthread_mutex_lock(&shard->lock);
+        shard->filling = shard->spare;
+        if (shard->filling) shard->spare = shard->filling->next;
+        pthread_mutex_unlock(&shard->lock);
+
+        if (!shard->filling) {
+            shard->filling = malloc(sizeof(EventBatch));
+            if (!shard->filling) return;
+        }
+        shard->filling->count = 0;
+    }
+
+    shard->filling->events[shard->filling->count++] = *event;
+    if (shard->filling->count == SHARD_BATCH_EVENTS) {
+        submit_batch(shard);
+    }
+}
+
+// Hand partially filled batches to the workers
+void flush_tracker_shards(ProcessStats *stats) {
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+        if (shard->filling && shard->filling->count > 0) {
+            submit_batch(shard);
+        }
+    }
+}
+
+// Wait until every shard is idle, then merge shard counters into stats
+void tracker_sync(ProcessStats *stats) {
+    flush_tracker_shards(stats);
+
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        while (shard->queue_head || shard->busy) {
+            pthread_cond_wait(&shard->drained, &shard->lock);
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+
+    stats->malloc_allocations = 0;
+    stats->malloc_frees = 0;
+    stats->malloc_bytes_allocated = 0;
+    stats->malloc_bytes_freed = 0;
+
+    // Growth counters belong to stats; allocation counters are re-summed
+    for (int i = 0; i < SITE_HASH_SIZE; i++) {
+        for (AllocSite *s = stats->alloc_sites[i]; s; s = s->next) {
+            s->allocations = 0;
+            s->bytes_allocated = 0;
+            s->live_blocks = 0;
+            s->live_bytes = 0;
+        }
+    }
+
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+
+        stats->malloc_allocations += shard->allocations;
+        stats->malloc_frees += shard->frees;
+        stats->malloc_bytes_allocated += shard->bytes_allocated;
+        stats->malloc_bytes_freed += shard->bytes_freed;
+
+        for (int j = 0; j < SITE_HASH_SIZE; j++) {
+            for (AllocSite *s = shard->sites[j]; s; s = s->next) {
+                AllocSite *merged = get_alloc_site(stats, s->site);
+                if (!merged) continue;
+                merged->allocations += s->allocations;
+                merged->bytes_allocated += s->bytes_allocated;
+                merged->live_blocks += s->live_blocks;
+                merged->live_bytes += s->live_bytes;
+            }
+        }
+    }
+}
+
+void stop_tracker_shards(ProcessStats *stats) {
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+
+        pthread_mutex_lock(&shard->lock);
+        shard->stop = 1;
+        pthread_cond_signal(&shard->wake);
+        pthread_mutex_unlock(&shard->lock);
+        pthread_join(shard->thread, NULL);
+
+        free(shard->filling);
+        while (shard->spare) {
+            EventBatch *next = shard->spare->next;
+            free(shard->spare);
+            shard->spare = next;
+        }
+        free(shard->table);
+        arena_release(&shard->arena);
+        pthread_mutex_destroy(&shard->lock);
+        pthread_cond_destroy(&shard->wake);
+        pthread_cond_destroy(&shard->drained);
+    }
+
+    free(stats->shards);
+    stats->shards = NULL;
+    stats->shard_count = 0;
+}
+
+// Snapshot of every live block across shards (call after tracker_sync)
+MallocBlock** collect_live_blocks(ProcessStats *stats, size_t *count) {
+    size_t total = 0;
+    for (int i = 0; i < stats->shard_count; i++) {
+        total += stats->shards[i].live_blocks;
+    }
+
+    *count = 0;
+    MallocBlock **blocks = malloc((total ? total : 1) * sizeof(MallocBlock*));
+    if (!blocks) return NULL;
+
+    for (int i = 0; i < stats->shard_count; i++) {
+        TrackerShard *shard = &stats->shards[i];
+        for (size_t b = 0; b < shard->buckets; b++) {
+            for (MallocBlock *block = shard->table[b]; block; block = block->next) {
+                blocks[(*count)++] = block;
+            }
+        }
+    }
+    return blocks;
+}
@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Steady heap growth for --soft-limit/--hard-limit: allocates N blocks of
+// 1 MB (default 32), touching each and pausing 10 ms in between so the
+// budgets see it climb, then frees them all.
+
+#define BLOCK_SIZE (1024 * 1024)
+
+int main(int argc, char **argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 32;
+    char **blocks = calloc(count, sizeof(char*));
+    struct timespec pause = { 0, 10 * 1000000L };
+    if (!blocks) return 1;
+
+    for (int i = 0; i < count; i++) {
+        blocks[i] = malloc(BLOCK_SIZE);
+        if (!blocks[i]) return 1;
+        memset(blocks[i], i, BLOCK_SIZE);
+        nanosleep(&pause, NULL);
+    }
+    printf("Holding %d MB\n", count);
+
+    for (int i = 0; i < count; i++) {
+        free(blocks[i]);
+    }
+    free(blocks);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Access patterns the file tracker should flag: tiny unbuffered writes,
+// fsync after every write, random small preads and repeated reads.
+
+int main() {
+    char buf[4096];
+    memset(buf, 'x', sizeof(buf));
+
+    // Tiny writes, one syscall per record
+    int log = open("io_pattern_log.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (log == -1) return 1;
+    for (int i = 0; i < 500; i++) {
+        if (write(log, buf, 32) != 32) return 1;
+    }
+    close(log);
+
+    // A journal that syncs each record
+    int journal = open("io_pattern_journal.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (journal == -1) return 1;
+    for (int i = 0; i < 20; i++) {
+        if (write(journal, buf, 1024) != 1024) return 1;
+        fsync(journal);
+    }
+    close(journal);
+
+    // Random small reads, then the same header read over and over
+    int data = open("io_pattern_data.txt", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (data == -1) return 1;
+    for (int i = 0; i < 4; i++) {
+        if (write(data, buf, sizeof(buf)) != sizeof(buf)) return 1;
+    }
+    unsigned int seed = 1;
+    for (int i = 0; i < 100; i++) {
+        seed = seed * 1103515245 + 12345;
+        if (pread(data, buf, 64, (seed >> 8) % 15000) < 0) return 1;
+    }
+    for (int i = 0; i < 50; i++) {
+        lseek(data, 0, SEEK_SET);
+        if (read(data, buf, 256) != 256) return 1;
+    }
+    close(data);
+
+    unlink("io_pattern_log.txt");
+    unlink("io_pattern_journal.txt");
+    unlink("io_pattern_data.txt");
+    printf("I/O pattern test done\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Leaks of memory libc allocates for the caller: strdup and asprintf
+// results are never freed (2 user leaks), while the getline buffer and
+// realpath result are. stdout's buffer is libc's own and isn't a leak.
+
+int main() {
+    char *copy = strdup("hello world leak");
+    char *formatted;
+    if (asprintf(&formatted, "%s %d", copy, 42) < 0) return 1;
+
+    char *line = NULL;
+    size_t cap = 0;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f) {
+        if (getline(&line, &cap, f) < 0) line[0] = '\0';
+        fclose(f);
+    }
+    char *path = realpath("/tmp", NULL);
+
+    printf("%s, %s, %s", copy, formatted, line ? line : "\n");
+    free(line);
+    free(path);
+    return 0;
+}
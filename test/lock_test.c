@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Lock convoy workload for --locks: every thread, the main one included,
+// hammers one "hot" mutex with a non-trivial critical section, a writer
+// fights readers on an rwlock, and a producer hands items to a consumer
+// through a condvar. A private mutex only the main thread touches must
+// never show up as contended.
+
+#define THREADS 4
+#define ROUNDS 2000
+
+static pthread_mutex_t hot = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t cold = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t table = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+
+static volatile unsigned long counter;
+static volatile unsigned long entries[64];
+static int queued, done;
+
+// Hold the lock long enough for the others to pile up behind it
+static void critical_section(void) {
+    for (int i = 0; i < 2000; i++) counter++;
+}
+
+static void* hammer(void *arg) {
+    (void)arg;
+    for (int i = 0; i < ROUNDS; i++) {
+        pthread_mutex_lock(&hot);
+        critical_section();
+        pthread_mutex_unlock(&hot);
+
+        if (i % 8 == 0) {
+            pthread_rwlock_wrlock(&table);
+            for (int j = 0; j < 64; j++) entries[j]++;
+            pthread_rwlock_unlock(&table);
+        } else {
+            pthread_rwlock_rdlock(&table);
+            unsigned long sum = 0;
+            for (int j = 0; j < 64; j++) sum += entries[j];
+            (void)sum;
+            pthread_rwlock_unlock(&table);
+        }
+
+        // Spin-then-lock, as some code does
+        if (pthread_mutex_trylock(&hot) == 0) {
+            pthread_mutex_unlock(&hot);
+        }
+    }
+    return NULL;
+}
+
+static void* consumer(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&queue_lock);
+    while (!done || queued > 0) {
+        while (queued == 0 && !done) {
+            pthread_cond_wait(&queue_ready, &queue_lock);
+        }
+        if (queued > 0) queued--;
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return NULL;
+}
+
+int main(void) {
+    pthread_t workers[THREADS], drain;
+
+    pthread_create(&drain, NULL, consumer, NULL);
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&workers[i], NULL, hammer, NULL);
+    }
+
+    hammer(NULL);
+
+    for (int i = 0; i < 200; i++) {
+        pthread_mutex_lock(&cold);
+        counter++;
+        pthread_mutex_unlock(&cold);
+
+        pthread_mutex_lock(&queue_lock);
+        queued++;
+        pthread_cond_signal(&queue_ready);
+        pthread_mutex_unlock(&queue_lock);
+        if (i % 20 == 0) usleep(1000);
+    }
+    pthread_mutex_lock(&queue_lock);
+    done = 1;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    pthread_join(drain, NULL);
+
+    printf("Lock test done (hot mutex %p, cold mutex %p)\n", (void*)&hot, (void*)&cold);
+    return 0;
+}
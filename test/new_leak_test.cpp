@@ -0,0 +1,25 @@
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// C++ allocations go through operator new in libstdc++: one new[] is
+// never deleted (1 user leak); the vector, string and thrown exception
+// are all released. libstdc++'s emergency exception pool isn't a leak.
+
+int main() {
+    int *lost = new int[50];
+    lost[0] = 1;
+
+    std::vector<std::string> words;
+    for (int i = 0; i < 100; i++) {
+        words.push_back("a string too long for the small-string buffer " + std::to_string(i));
+    }
+
+    try {
+        throw std::runtime_error("caught");
+    } catch (const std::exception &e) {
+        std::printf("%s, %zu words, %d\n", e.what(), words.size(), lost[0]);
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+#!/bin/sh
+# Run workloads under oswatch, check leak and fd verdicts against known
+# expectations, then measure wall-time overhead versus a native run as the
+# thread count scales.
+#
+# Usage: test/run_checks.sh
+#
+# Tunables (environment):
+#   CHECK_ALLOCS   total allocations per scaling run   (default 1000000)
+#   CHECK_THREADS  thread counts for the scaling table (default "1 2 4 8 16 32 64")
+#   CHECK_CSV      scaling results file                (default check_scaling.csv)
+
+ALLOCS=${CHECK_ALLOCS:-1000000}
+THREADS=${CHECK_THREADS:-"1 2 4 8 16 32 64"}
+CSV=${CHECK_CSV:-check_scaling.csv}
+
+PASS=0
+FAIL=0
+
+# oswatch output without color codes
+run_plain() {
+    ./oswatch "$@" 2>&1 | sed 's/\x1b\[[0-9;]*m//g'
+}
+
+# expect <description> <expected leak count> <expected leaked fds> <program> [args...]
+expect() {
+    desc=$1; leaks=$2; fds=$3; shift 3
+    out=$(run_plain "$@")
+
+    if [ "$leaks" -eq 0 ]; then
+        echo "$out" | grep -q "VERDICT: USER CODE IS LEAK-FREE"
+    else
+        echo "$out" | grep -q "User leaks: *$leaks allocations" &&
+        echo "$out" | grep -q "VERDICT: USER CODE HAS MEMORY LEAKS"
+    fi
+    leak_ok=$?
+
+    if [ "$fds" -eq 0 ]; then
+        echo "$out" | grep -q "All files properly closed"
+    else
+        echo "$out" | grep -q "Warning: $fds file(s) not properly closed"
+    fi
+    fd_ok=$?
+
+    if [ $leak_ok -eq 0 ] && [ $fd_ok -eq 0 ]; then
+        echo "  PASS  $desc"
+        PASS=$((PASS + 1))
+    else
+        echo "  FAIL  $desc (expected $leaks leak(s), $fds leaked fd(s))"
+        echo "$out" | grep -E "VERDICT|User leaks|not properly closed" | sed 's/^/        /'
+        FAIL=$((FAIL + 1))
+    fi
+}
+
+# expect_output <description> <pattern> <program> [args...]
+expect_output() {
+    desc=$1; pattern=$2; shift 2
+    out=$(run_plain "$@")
+
+    if echo "$out" | grep -qE "$pattern"; then
+        echo "  PASS  $desc"
+        PASS=$((PASS + 1))
+    else
+        echo "  FAIL  $desc (no line matching \"$pattern\")"
+        FAIL=$((FAIL + 1))
+    fi
+}
+
+# expect_json <description> <pattern> <program> [args...]
+# The report alone must be on stdout and, where python3 exists, parse.
+expect_json() {
+    desc=$1; pattern=$2; shift 2
+    out=$(./oswatch --format=json "$@" 2>/dev/null)
+    parsed=0
+    if command -v python3 > /dev/null; then
+        echo "$out" | python3 -m json.tool > /dev/null 2>&1 || parsed=1
+    fi
+
+    if [ $parsed -eq 0 ] && echo "$out" | grep -qE "$pattern"; then
+        echo "  PASS  $desc"
+        PASS=$((PASS + 1))
+    else
+        echo "  FAIL  $desc (invalid JSON or no line matching \"$pattern\")"
+        FAIL=$((FAIL + 1))
+    fi
+}
+
+# expect_trace <description> <pattern> <program> [args...]
+# Like expect_json, for the --trace-out file
+expect_trace() {
+    desc=$1; pattern=$2; shift 2
+    trace=${TMPDIR:-/tmp}/oswatch_check_trace.$$.json
+    ./oswatch --trace-out "$trace" "$@" > /dev/null 2>&1
+    parsed=0
+    if command -v python3 > /dev/null; then
+        python3 -m json.tool "$trace" > /dev/null 2>&1 || parsed=1
+    fi
+
+    if [ $parsed -eq 0 ] && grep -qE "$pattern" "$trace"; then
+        echo "  PASS  $desc"
+        PASS=$((PASS + 1))
+    else
+        echo "  FAIL  $desc (invalid trace or no event matching \"$pattern\")"
+        FAIL=$((FAIL + 1))
+    fi
+    rm -f "$trace"
+}
+
+# expect_exit <description> <expected status> <program> [args...]
+expect_exit() {
+    desc=$1; status=$2; shift 2
+    ./oswatch "$@" > /dev/null 2>&1
+    got=$?
+
+    if [ "$got" -eq "$status" ]; then
+        echo "  PASS  $desc"
+        PASS=$((PASS + 1))
+    else
+        echo "  FAIL  $desc (exit $got, expected $status)"
+        FAIL=$((FAIL + 1))
+    fi
+}
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+echo "Verdict checks:"
+expect "leak_test"            1 0 test/leak_test
+expect "no_leak_test"         0 0 test/no_leak_test
+expect "mixed_test"           2 0 test/mixed_test
+expect "multiple_leaks_test"  3 0 test/multiple_leaks_test
+expect "file_test"            0 0 test/file_test
+expect "comprehensive_test"   2 0 test/comprehensive_test
+expect "1 thread, small"      0 0 test/stress_workload -t 1 -n 200000 -d small
+expect "8 threads, mixed"     5 0 test/stress_workload -t 8 -n 50000 -d mixed -l 5
+expect "4 threads, large"     0 0 test/stress_workload -t 4 -n 2000 -d large
+expect "fd churn + fd leaks"  0 3 test/stress_workload -t 0 -f 5000 -L 3
+expect "fork tree"            2 0 test/stress_workload -t 2 -n 20000 -k 3 -l 2
+expect "everything at once"   4 2 test/stress_workload -t 16 -n 20000 -d mixed -f 1000 -k 2 -l 4 -L 2
+expect "no-ptrace fd leaks"   3 3 --no-ptrace test/stress_workload -t 4 -n 20000 -f 5000 -l 3 -L 3
+expect "no-ptrace file_test"  0 0 --no-ptrace test/file_test
+expect "startup breakpoint"   1 0 --startup test/leak_test
+expect "socket_test"          0 0 test/socket_test
+expect "lock_test"            0 0 --locks test/lock_test
+expect "sched_test"           0 0 --sched test/sched_test
+expect "strdup/asprintf leaks" 2 0 test/libc_leak_test
+expect "operator new leak"    1 0 test/new_leak_test
+expect "no-ptrace new leak"   1 0 --no-ptrace test/new_leak_test
+
+echo ""
+echo "Report checks:"
+expect_output "brk growth charged"      "^  stress_workload\+0x[0-9a-f]+ +[1-9][0-9]* +[0-9.]+ " test/stress_workload -t 4 -n 20000
+expect_output "strdup leak site"        "Call site: +libc_leak_test\+0x[0-9a-f]+" test/libc_leak_test
+expect_output "tiny writes flagged"     "io_pattern_log.txt: 500 writes under 512 B" test/io_pattern_test
+expect_output "random reads flagged"    "io_pattern_data.txt: random access" test/io_pattern_test
+expect_output "fsync per write flagged" "fsync after every write \(20 of 20" --no-ptrace test/io_pattern_test
+expect_output "loopback endpoints"      "127\.0\.0\.1:[0-9]+ +listen .*\(2 accepted\)" test/socket_test
+expect_output "refused connect"         "1 failed connect" test/socket_test
+expect_output "socket leak reported"    "Warning: 1 socket\(s\) not closed" test/socket_test leak
+expect_output "mutex contention"        "Contended acquisitions: [1-9][0-9]* mutex" --locks test/lock_test
+expect_output "condvar waits listed"    "0x[0-9a-f]+ +condvar +[1-9]" --locks test/lock_test
+expect_output "futex joined to locks"   "futex waits: .* ms on the locks above" --locks test/lock_test
+expect_output "starved threads flagged" "waited .* ms for a CPU" --sched test/sched_test
+expect_output "oversubscription noted"  "runnable on 1 CPU\(s\): the process is oversubscribed" --sched test/sched_test
+expect_output "blocked syscall sampled" "read [0-9]+%" --sched test/sched_test
+expect_json   "json leak verdict"       '"user_leaks": 1,' test/leak_test
+expect_json   "json leak-free verdict"  '"leak_free": true' test/no_leak_test
+expect_json   "json syscall quantiles"  '"p99": [0-9.]+' test/file_test
+expect_json   "json with every section" '"contended": \[' --locks --sched --startup test/mixed_test
+expect_trace  "trace syscall slices"    '"ph": "X", "cat": "syscall", "name": "openat"' test/file_test
+expect_trace  "trace fd instants"       '"name": "open", .*"path": "test_output.txt"' test/file_test
+expect_trace  "trace memory counters"   '"name": "malloc live bytes"' test/stress_workload -t 2 -n 20000
+expect_output "verbose malloc log"       "\[MALLOC\].* Allocated 1000 bytes" -v test/leak_test
+expect_output "verbose log accounted"   "Lines written: +[1-9][0-9]*" -v test/leak_test
+expect_output "injected errors"         "^  write:EIO +[0-9]+ +[1-9][0-9]* +[0-9]+ x -EIO" --inject write:EIO test/no_leak_test
+expect_output "injected delay"          "^  close:delay=2ms +[0-9]+ +[1-9][0-9]* +\+[0-9.]+ ms" --inject close:delay=2ms test/no_leak_test
+
+# The verbose log goes to the file, the program's output stays on stdout
+LOG=${TMPDIR:-/tmp}/oswatch_check.$$.log
+out=$(run_plain --log-file "$LOG" test/leak_test)
+if echo "$out" | grep -q "Allocated 1000 bytes at address" && ! echo "$out" | grep -q "\[SYSCALL\]" &&
+   grep -q "Allocated 1000 bytes at 0x" "$LOG" && grep -q "\[PROCESS\].* Exited with code 0" "$LOG"; then
+    echo "  PASS  verbose log to file"
+    PASS=$((PASS + 1))
+else
+    echo "  FAIL  verbose log to file"
+    FAIL=$((FAIL + 1))
+fi
+rm -f "$LOG"
+
+expect_output "top dashboard frame"     "^TOP SYSCALLS BY RATE" --top /bin/sleep 1
+expect_output "top cpu counters"        "CPU: +[0-9.]+ CPUs busy, [0-9]+ faults/s" --top test/stress_workload -t 2 -n 1500000
+expect_output "top growing sites"       "^stress_workload\+0x[0-9a-f]+ +[0-9.]+ [KM]?B" --top test/stress_workload -t 2 -n 1500000
+
+# Scrape the OpenMetrics endpoint while the tracee sleeps
+if command -v curl > /dev/null; then
+    SOCK=${TMPDIR:-/tmp}/oswatch_check_metrics.$$.sock
+    ./oswatch --metrics "unix:$SOCK" /bin/sh -c 'cat /dev/null; sleep 1' > /dev/null 2>&1 &
+    watcher=$!
+    for _ in 1 2 3 4 5 6 7 8 9 10; do
+        [ -S "$SOCK" ] && break
+        sleep 0.1
+    done
+    sleep 0.3
+    scrape=$(curl -s --max-time 2 --unix-socket "$SOCK" http://localhost/metrics)
+    wait "$watcher"
+    if echo "$scrape" | grep -qE '^oswatch_syscalls_total [1-9]' &&
+       echo "$scrape" | grep -qE '^oswatch_task_clock_seconds_total [0-9.]+$' &&
+       echo "$scrape" | grep -qE 'oswatch_syscall_duration_seconds_bucket\{syscall="[a-z0-9_]+",le="\+Inf"\} [1-9]' &&
+       [ "$(echo "$scrape" | tail -1)" = "# EOF" ] && [ ! -e "$SOCK" ]; then
+        echo "  PASS  metrics scrape"
+        PASS=$((PASS + 1))
+    else
+        echo "  FAIL  metrics scrape"
+        FAIL=$((FAIL + 1))
+    fi
+fi
+
+echo ""
+echo "Budget checks:"
+expect        "soft limit lets it run"  0 0 --soft-limit heap=8M test/budget_test
+expect_output "soft limit top sites"    "^  budget_test\+0x[0-9a-f]+ +[0-9.]+ MB in [0-9]+ block" --soft-limit heap=8M test/budget_test
+expect_exit   "hard limit kills"        3 --hard-limit heap=8M test/budget_test 64
+expect_json   "hard limit in verdict"   '"budget_exceeded": true' --hard-limit rss=16M test/budget_test 64
+
+# --on-hard-limit stop: still there and stopped after the report, then resumable
+STOPPED=${TMPDIR:-/tmp}/oswatch_check_stop.$$.out
+./oswatch --hard-limit heap=8M --on-hard-limit stop test/budget_test 64 > "$STOPPED" 2>&1 &
+watcher=$!
+tracee=""
+for _ in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do
+    tracee=$(sed -n 's/.*Process \([0-9]*\) is stopped.*/\1/p' "$STOPPED")
+    [ -n "$tracee" ] && break
+    sleep 0.1
+done
+state=""
+if [ -n "$tracee" ]; then
+    state=$(sed -n 's/^State:\t\(.\).*/\1/p' "/proc/$tracee/status")
+    kill -CONT "$tracee"
+else
+    kill "$watcher"
+fi
+wait "$watcher"
+status=$?
+if [ "$state" = "T" ] && [ $status -eq 3 ] && grep -q "^Holding 64 MB" "$STOPPED"; then
+    echo "  PASS  hard limit stops"
+    PASS=$((PASS + 1))
+else
+    echo "  FAIL  hard limit stops (state '$state', exit $status)"
+    FAIL=$((FAIL + 1))
+fi
+rm -f "$STOPPED"
+
+echo ""
+echo "Baseline checks:"
+PROFILE=${TMPDIR:-/tmp}/oswatch_check.$$.profile
+rm -f "$PROFILE"
+expect_exit   "baseline seeded"         0 --baseline "$PROFILE" test/stress_workload -t 0 -f 500
+expect_exit   "unchanged run passes"    0 --baseline "$PROFILE" test/stress_workload -t 0 -f 500
+expect_exit   "new leak regresses"      2 --baseline "$PROFILE" test/stress_workload -t 0 -f 500 -l 1
+expect_output "syscall delta named"     "openat calls \+[0-9]+%" --baseline "$PROFILE" test/stress_workload -t 0 -f 2000
+rm -f "$PROFILE"
+
+# Profiles from several runs, merged by oswatch-merge
+PROFILES=${TMPDIR:-/tmp}/oswatch_check_profiles.$$
+mkdir -p "$PROFILES"
+for run in 1 2 3; do
+    ./oswatch --save-profile "$PROFILES/run-%p.profile" test/leak_test > /dev/null 2>&1
+done
+./oswatch --save-profile "$PROFILES/run-%p.profile" test/file_test > /dev/null 2>&1
+merged=$(./oswatch-merge -j 2 -o "$PROFILES/fleet" "$PROFILES" 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
+if echo "$merged" | grep -q "Merged 4 profile(s) (0 unreadable)" &&
+   echo "$merged" | grep -qE "leak_test\+0x[0-9a-f]+ +3 +3 +3000"; then
+    echo "  PASS  merged leak sites"
+    PASS=$((PASS + 1))
+else
+    echo "  FAIL  merged leak sites"
+    FAIL=$((FAIL + 1))
+fi
+expect_exit   "merged profile as baseline" 0 --baseline "$PROFILES/fleet" test/no_leak_test
+rm -rf "$PROFILES"
+
+# A recorded allocation trace, replayed natively and through the simulator
+ALLOCS_TRACE=${TMPDIR:-/tmp}/oswatch_check.$$.allocs
+./oswatch --record-allocs "$ALLOCS_TRACE" test/mixed_test > /dev/null 2>&1
+replayed=$(./oswatch-replay "$ALLOCS_TRACE" 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
+simulated=$(./oswatch-replay --simulate --classes 64,512 "$ALLOCS_TRACE" 2>&1 | sed 's/\x1b\[[0-9;]*m//g')
+if echo "$replayed" | grep -q "^  5 malloc, 0 calloc, 0 realloc, 2 free" &&
+   echo "$replayed" | grep -qE "Throughput: +[0-9.]+ Mops/s" &&
+   echo "$simulated" | grep -qE "^  custom +2 " &&
+   echo "$simulated" | grep -q "Smallest footprint:"; then
+    echo "  PASS  allocation trace replay"
+    PASS=$((PASS + 1))
+else
+    echo "  FAIL  allocation trace replay"
+    FAIL=$((FAIL + 1))
+fi
+rm -f "$ALLOCS_TRACE"
+
+echo ""
+echo "Scaling ($ALLOCS allocations split across threads):"
+printf "  %-8s %-12s %-12s %-10s\n" "THREADS" "NATIVE(ms)" "OSWATCH(ms)" "OVERHEAD"
+echo "threads,allocs,native_ms,oswatch_ms,overhead" > "$CSV"
+
+for t in $THREADS; do
+    n=$((ALLOCS / t))
+
+    start=$(now_ms)
+    test/stress_workload -t "$t" -n "$n" -d mixed > /dev/null
+    native=$(( $(now_ms) - start ))
+
+    start=$(now_ms)
+    ./oswatch test/stress_workload -t "$t" -n "$n" -d mixed > /dev/null 2>&1
+    traced=$(( $(now_ms) - start ))
+
+    [ "$native" -lt 1 ] && native=1
+    overhead=$(awk "BEGIN { printf \"%.1f\", $traced / $native }")
+    printf "  %-8s %-12s %-12s %-10s\n" "$t" "$native" "$traced" "${overhead}x"
+    echo "$t,$ALLOCS,$native,$traced,$overhead" >> "$CSV"
+done
+
+echo ""
+echo "$PASS passed, $FAIL failed (scaling results in $CSV)"
+[ "$FAIL" -eq 0 ]
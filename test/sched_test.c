@@ -0,0 +1,65 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+
+// Oversubscription workload for --sched: the process pins itself to one
+// CPU and runs three spinning threads on it, so each spends most of its
+// runnable time queued. A fourth thread sleeps in a blocking read and
+// should show up as off-CPU, blocked in read, not as starved.
+
+#define SPINNERS 3
+#define SPIN_MS 150
+
+static int idle_pipe[2];
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// Burn SPIN_MS of CPU time, however long that takes on a shared CPU
+static void* spin(void *arg) {
+    (void)arg;
+    volatile unsigned long x = 0;
+    double start = now_ms();
+    while (now_ms() - start < SPIN_MS) {
+        for (int i = 0; i < 10000; i++) x++;
+    }
+    return NULL;
+}
+
+static void* idle(void *arg) {
+    (void)arg;
+    char c;
+    if (read(idle_pipe[0], &c, 1) != 1) return NULL;
+    return NULL;
+}
+
+int main(void) {
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(sched_getcpu() >= 0 ? sched_getcpu() : 0, &one);
+    sched_setaffinity(0, sizeof(one), &one);
+
+    if (pipe(idle_pipe) == -1) return 1;
+
+    pthread_t spinners[SPINNERS], sleeper;
+    pthread_create(&sleeper, NULL, idle, NULL);
+    for (int i = 0; i < SPINNERS; i++) {
+        pthread_create(&spinners[i], NULL, spin, NULL);
+    }
+    for (int i = 0; i < SPINNERS; i++) {
+        pthread_join(spinners[i], NULL);
+    }
+
+    if (write(idle_pipe[1], "x", 1) != 1) return 1;
+    pthread_join(sleeper, NULL);
+
+    printf("Sched test done (%d spinners on one CPU)\n", SPINNERS);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Loopback-only socket workload, all on the main thread (the one oswatch
+// traces): a TCP listener with a blocking and a non-blocking client, a UDP
+// exchange, a socketpair and a refused connect.
+//
+// Usage: socket_test [leak]   - "leak" leaves one client socket open
+
+static struct sockaddr_in loopback(unsigned short port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+// Ping-pong `rounds` messages between a connected client and its server side
+static int exchange(int client, int server, int rounds) {
+    char buf[256];
+    memset(buf, 'p', sizeof(buf));
+
+    for (int i = 0; i < rounds; i++) {
+        if (send(client, buf, sizeof(buf), 0) != sizeof(buf)) return -1;
+        if (recv(server, buf, sizeof(buf), MSG_WAITALL) != sizeof(buf)) return -1;
+        if (write(server, buf, 64) != 64) return -1;
+        if (read(client, buf, 64) != 64) return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int leak = argc > 1 && strcmp(argv[1], "leak") == 0;
+
+    // Listener on an ephemeral loopback port
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = loopback(0);
+    socklen_t len = sizeof(addr);
+    if (listener == -1 ||
+        bind(listener, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+        listen(listener, 8) == -1 ||
+        getsockname(listener, (struct sockaddr*)&addr, &len) == -1) {
+        perror("listener");
+        return 1;
+    }
+    unsigned short port = ntohs(addr.sin_port);
+
+    // Blocking client: the handshake completes against the backlog
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    addr = loopback(port);
+    if (connect(client, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        perror("connect");
+        return 1;
+    }
+    int server = accept(listener, NULL, NULL);
+    if (server == -1 || exchange(client, server, 20) == -1) {
+        perror("exchange");
+        return 1;
+    }
+    shutdown(client, SHUT_WR);
+    close(client);
+    close(server);
+
+    // Non-blocking client: EINPROGRESS, then poll for completion
+    client = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (connect(client, (struct sockaddr*)&addr, sizeof(addr)) == -1 && errno != EINPROGRESS) {
+        perror("connect");
+        return 1;
+    }
+    struct pollfd pfd = { client, POLLOUT, 0 };
+    poll(&pfd, 1, 1000);
+    struct sockaddr_in peer;
+    len = sizeof(peer);
+    server = accept4(listener, (struct sockaddr*)&peer, &len, 0);
+    fcntl(client, F_SETFL, 0);
+    if (server == -1 || exchange(client, server, 5) == -1) {
+        perror("exchange");
+        return 1;
+    }
+    close(server);
+    if (!leak) close(client);
+    close(listener);
+
+    // UDP: one datagram each way
+    int udp_a = socket(AF_INET, SOCK_DGRAM, 0);
+    int udp_b = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a_addr = loopback(0), b_addr = loopback(0);
+    socklen_t a_len = sizeof(a_addr), b_len = sizeof(b_addr);
+    bind(udp_a, (struct sockaddr*)&a_addr, sizeof(a_addr));
+    bind(udp_b, (struct sockaddr*)&b_addr, sizeof(b_addr));
+    getsockname(udp_a, (struct sockaddr*)&a_addr, &a_len);
+    getsockname(udp_b, (struct sockaddr*)&b_addr, &b_len);
+
+    char dgram[512] = "hello";
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    sendto(udp_a, dgram, 100, 0, (struct sockaddr*)&b_addr, sizeof(b_addr));
+    recvfrom(udp_b, dgram, sizeof(dgram), 0, (struct sockaddr*)&from, &from_len);
+    sendto(udp_b, dgram, 200, 0, (struct sockaddr*)&from, from_len);
+    recvfrom(udp_a, dgram, sizeof(dgram), 0, NULL, NULL);
+    close(udp_a);
+    close(udp_b);
+
+    // socketpair
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0) {
+        if (write(pair[0], "ping", 4) != 4 || read(pair[1], dgram, 4) != 4) return 1;
+        close(pair[0]);
+        close(pair[1]);
+    }
+
+    // Nobody listens on the old port any more
+    int refused = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(refused, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        printf("unexpected connect\n");
+    }
+    close(refused);
+
+    printf("Socket test done%s\n", leak ? " (one client socket left open)" : "");
+    return 0;
+}
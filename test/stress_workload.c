@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+// Parameterized stress workload for oswatch
+//
+//   -t N   worker threads doing malloc/free churn      (default 1)
+//   -n N   allocations per thread                      (default 100000)
+//   -d D   size distribution: small | mixed | large    (default small)
+//   -f N   open/close pairs on the main thread         (default 0)
+//   -k N   fork tree depth, two children per level     (default 0)
+//   -l N   blocks deliberately leaked by the main process
+//   -L N   file descriptors deliberately leaked
+//
+// Children of the fork tree churn and leak too; oswatch must only
+// report what the launched process leaked.
+
+#define LEAK_SIZE 777   // Not a stdio buffer size, so it counts as a user leak
+
+static long allocs_per_thread = 100000;
+static int distribution = 0;  // 0 = small, 1 = mixed, 2 = large
+
+static size_t pick_size(unsigned int *seed) {
+    unsigned int r = rand_r(seed);
+
+    switch (distribution) {
+        case 1:   // Log-uniform 16 B .. 64 KB
+            return (size_t)16 << (r % 13);
+        case 2:   // Past the mmap threshold
+            return 128 * 1024 + (r % (896 * 1024));
+        default:  // 16 .. 256 B
+            return 16 + (r % 241);
+    }
+}
+
+static void* churn(void *arg) {
+    unsigned int seed = (unsigned int)(size_t)arg;
+    void *ring[64] = { 0 };
+
+    // Keep a small window of live blocks so frees come out of order
+    for (long i = 0; i < allocs_per_thread; i++) {
+        int slot = rand_r(&seed) % 64;
+        free(ring[slot]);
+        ring[slot] = malloc(pick_size(&seed));
+        if (ring[slot]) {
+            memset(ring[slot], 0, 8);
+        }
+    }
+
+    for (int i = 0; i < 64; i++) {
+        free(ring[i]);
+    }
+    return NULL;
+}
+
+static void run_threads(int threads) {
+    pthread_t *tids = malloc(threads * sizeof(pthread_t));
+    if (!tids) return;
+
+    for (int t = 0; t < threads; t++) {
+        pthread_create(&tids[t], NULL, churn, (void*)(size_t)(t + 1));
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    free(tids);
+}
+
+static void fork_tree(int depth) {
+    if (depth <= 0) return;
+
+    for (int c = 0; c < 2; c++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            churn((void*)(size_t)(depth * 10 + c));
+            if (!malloc(LEAK_SIZE)) _exit(1);  // Leak in the child - must not be reported
+            fork_tree(depth - 1);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int threads = 1, fd_churn = 0, fork_depth = 0, leaks = 0, fd_leaks = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:d:f:k:l:L:")) != -1) {
+        switch (opt) {
+            case 't': threads = atoi(optarg); break;
+            case 'n': allocs_per_thread = atol(optarg); break;
+            case 'd':
+                if (strcmp(optarg, "mixed") == 0) distribution = 1;
+                else if (strcmp(optarg, "large") == 0) distribution = 2;
+                break;
+            case 'f': fd_churn = atoi(optarg); break;
+            case 'k': fork_depth = atoi(optarg); break;
+            case 'l': leaks = atoi(optarg); break;
+            case 'L': fd_leaks = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-t threads] [-n allocs] [-d small|mixed|large] "
+                        "[-f fd_churn] [-k fork_depth] [-l leaks] [-L fd_leaks]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    for (int i = 0; i < fd_churn; i++) {
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd >= 0) close(fd);
+    }
+
+    run_threads(threads);
+    fork_tree(fork_depth);
+
+    for (int i = 0; i < leaks; i++) {
+        if (!malloc(LEAK_SIZE)) break;
+    }
+    for (int i = 0; i < fd_leaks; i++) {
+        open("/dev/null", O_RDONLY);
+    }
+
+    printf("stress: threads=%d allocs=%ld leaks=%d fd_leaks=%d\n",
+           threads, allocs_per_thread * threads, leaks, fd_leaks);
+    return 0;
+}